@@ -115,11 +115,13 @@
  *   - 5025: Changed WD priority from unsigned to int.
  *   - 5029: Adding implicit parameter to work descriptor flags.
  *   - 5030: Adding instrumentation support to wrap main function.
+ *   - 5031: Providing team size and default dependencies manager information.
  * - nanos interface family: worksharing
  *   - 1000: First implementation of work-sharing services (create and next-item)
  * - nanos interface family: deps_api
  *   - 1000: First implementation of dependencies plugins.
  *   - 1001: Commutative clause support.
+ *   - 1002: Task graph record and replay services.
  * - nanos interface family: openmp
  *   - 1: First Nanos OpenMP interface: nanos_omp_single ( b ) service
  *   - 2: Including nanos_omp_barrier() service
@@ -145,6 +147,7 @@
 
 // C++ types hidden as void *
 typedef void * nanos_wg_t;
+typedef void * nanos_task_graph_t;
 typedef void * nanos_team_t;
 typedef void * nanos_sched_t;
 typedef void * nanos_slicer_t;
@@ -257,6 +260,7 @@ NANOS_API_DECL(nanos_err_t, nanos_release_sync_init, ( void ));
 
 NANOS_API_DECL(nanos_err_t, nanos_memory_fence, (void));
 
+NANOS_API_DECL(nanos_err_t, nanos_team_get_num_threads, ( int *n ) );
 NANOS_API_DECL(nanos_err_t, nanos_team_get_num_supporting_threads, ( int *n ) );
 NANOS_API_DECL(nanos_err_t, nanos_team_get_supporting_threads, ( int *n, nanos_thread_t *list_of_threads) );
 NANOS_API_DECL(nanos_err_t, nanos_register_reduction, ( nanos_reduction_t *red) );
@@ -281,6 +285,12 @@ NANOS_API_DECL(nanos_err_t, nanos_expel_current_thread, (void));
 NANOS_API_DECL(nanos_err_t, nanos_dependence_release_all, ( void ) );
 NANOS_API_DECL(nanos_err_t, nanos_dependence_pendant_writes, ( bool *res, void *addr ));
 NANOS_API_DECL(nanos_err_t, nanos_dependence_create, ( nanos_wd_t pred, nanos_wd_t succ ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_record_begin, ( void ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_record_end, ( nanos_task_graph_t *graph ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_replay_begin, ( nanos_task_graph_t graph ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_replay_end, ( void ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_destroy, ( nanos_task_graph_t graph ) );
+NANOS_API_DECL(nanos_err_t, nanos_task_graph_get_size, ( nanos_task_graph_t graph, unsigned int *num_tasks, unsigned int *num_edges ) );
 
 // worksharing
 NANOS_API_DECL(nanos_err_t, nanos_worksharing_create ,( nanos_ws_desc_t **wsd, nanos_ws_t ws, nanos_ws_info_t *info, bool *b ) );
@@ -318,6 +328,7 @@ NANOS_API_DECL(nanos_err_t, nanos_copy_value, ( void *dst, nanos_copy_id_t copy_
 NANOS_API_DECL(const char *, nanos_get_runtime_version, () );
 NANOS_API_DECL(const char *, nanos_get_default_architecture, ());
 NANOS_API_DECL(const char *, nanos_get_pm, ());
+NANOS_API_DECL(const char *, nanos_get_default_dependencies_manager, ());
 NANOS_API_DECL(nanos_err_t, nanos_get_default_binding, ( bool *res ));
 
 NANOS_API_DECL(nanos_err_t, nanos_delay_start, ());
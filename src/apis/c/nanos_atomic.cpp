@@ -29,6 +29,9 @@
 #include <math.h>
 #include <signal.h>
 #include <complex.h>
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
 
 namespace {
 nanos::Lock update_lock;
@@ -132,6 +135,93 @@ struct atomic_type_trait
     typedef typename suitable_integer_type<sizeof(T_)>::T T;
 };
 
+// Double-width (16 byte) compare-and-swap, used for the types that do not fit in a
+// native integer (long double, _Complex double) when the CPU supports it
+namespace
+{
+    struct dwcas_t { uint64_t lo; uint64_t hi; } __attribute__((aligned(16)));
+
+#if defined(__x86_64__)
+    // cmpxchg16b is missing from some early x86-64 processors
+    bool dwcas_check_cpu()
+    {
+        unsigned int eax, ebx, ecx, edx;
+        if ( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) ) return false;
+        return ( ecx & bit_CMPXCHG16B ) != 0;
+    }
+
+    inline bool dwcas_supported()
+    {
+        static const bool supported = dwcas_check_cpu();
+        return supported;
+    }
+
+    // On failure, expected is updated with the current contents of ptr
+    inline bool dwcas(volatile void *ptr, dwcas_t &expected, const dwcas_t &desired)
+    {
+        bool ok;
+        __asm__ __volatile__ ( "lock; cmpxchg16b %1\n\tsete %0"
+                               : "=q" (ok), "+m" (*(volatile dwcas_t *) ptr),
+                                 "+a" (expected.lo), "+d" (expected.hi)
+                               : "b" (desired.lo), "c" (desired.hi)
+                               : "memory", "cc" );
+        return ok;
+    }
+#elif defined(__aarch64__)
+    inline bool dwcas_supported() { return true; }
+
+    // On failure, expected is updated with the current contents of ptr
+    inline bool dwcas(volatile void *ptr, dwcas_t &expected, const dwcas_t &desired)
+    {
+        uint64_t lo, hi;
+        uint32_t failed;
+        do {
+            __asm__ __volatile__ ( "ldaxp %0, %1, %2"
+                                   : "=&r" (lo), "=&r" (hi)
+                                   : "Q" (*(volatile dwcas_t *) ptr)
+                                   : "memory" );
+            if ( lo != expected.lo || hi != expected.hi ) {
+                __asm__ __volatile__ ( "clrex" : : : "memory" );
+                expected.lo = lo;
+                expected.hi = hi;
+                return false;
+            }
+            __asm__ __volatile__ ( "stlxp %w0, %2, %3, %1"
+                                   : "=&r" (failed), "=Q" (*(volatile dwcas_t *) ptr)
+                                   : "r" (desired.lo), "r" (desired.hi)
+                                   : "memory" );
+        } while ( failed );
+        return true;
+    }
+#else
+    inline bool dwcas_supported() { return false; }
+
+    inline bool dwcas(volatile void *ptr, dwcas_t &expected, const dwcas_t &desired)
+    {
+        // Never called: dwcas_usable() is always false here
+        raise(SIGABRT);
+        return false;
+    }
+#endif
+
+    // Whether updates of a 16 byte object at ptr can use dwcas(). The answer only depends
+    // on the object address, so all the updates of a given object use the same path.
+    inline bool dwcas_usable(volatile void *ptr)
+    {
+        return dwcas_supported() && ( ( (uintptr_t) ptr ) & 15 ) == 0;
+    }
+
+    // Plain read of a 16 byte object, it may be torn: dwcas() fixes it up
+    inline dwcas_t dwcas_read(volatile void *ptr)
+    {
+        volatile dwcas_t *p = (volatile dwcas_t *) ptr;
+        dwcas_t v;
+        v.lo = p->lo;
+        v.hi = p->hi;
+        return v;
+    }
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 extern "C"
 {
@@ -227,14 +317,14 @@ NANOS_API_DEF(void, nanos_atomic_##op##_##type_name, (volatile type * x, type y)
 #ifdef HAVE_INT128_T
  #define NANOS_PERFORM_ATOMIC_OP_FLOAT_ldouble(type, op, x, y)   NANOS_CAS_ATOMIC(type, x, y, op)
 #else
- #define NANOS_PERFORM_ATOMIC_OP_FLOAT_ldouble(type, op, x, y)   NANOS_LOCK_UPDATE(type, x, y, op)
+ #define NANOS_PERFORM_ATOMIC_OP_FLOAT_ldouble(type, op, x, y)   NANOS_DWCAS_ATOMIC(type, x, y, op)
 #endif
 
 // Implementation of each atomic op for complex floating types
 #define NANOS_PERFORM_ATOMIC_OP_COMPLEX(type_name, type, op, x, y)   NANOS_PERFORM_ATOMIC_OP_COMPLEX_##type_name(type, op, x, y)
 
-#define NANOS_PERFORM_ATOMIC_OP_COMPLEX_cfloat(type, op, x, y)   NANOS_LOCK_UPDATE(type, x, y, op)
-#define NANOS_PERFORM_ATOMIC_OP_COMPLEX_cdouble(type, op, x, y)  NANOS_LOCK_UPDATE(type, x, y, op)
+#define NANOS_PERFORM_ATOMIC_OP_COMPLEX_cfloat(type, op, x, y)   NANOS_ALIGNED_CAS_ATOMIC(type, x, y, op)
+#define NANOS_PERFORM_ATOMIC_OP_COMPLEX_cdouble(type, op, x, y)  NANOS_DWCAS_ATOMIC(type, x, y, op)
 #define NANOS_PERFORM_ATOMIC_OP_COMPLEX_cldouble(type, op, x, y) NANOS_LOCK_UPDATE(type, x, y, op)
 
 // Expression used by each operation in the CAS (compare-and-swap) template below
@@ -267,6 +357,31 @@ NANOS_API_DEF(void, nanos_atomic_##op##_##type_name, (volatile type * x, type y)
     } while (!__sync_bool_compare_and_swap((atomic_int_t*)x, old.v, new_.v)); \
 }
 
+// CAS template for types whose alignment may be smaller than their size (_Complex float):
+// misaligned objects would need split locked accesses, they take the lock instead
+#define NANOS_ALIGNED_CAS_ATOMIC(type, x, y, op) \
+{ \
+    if ( ( ( (uintptr_t) x ) & ( sizeof(type) - 1 ) ) == 0 ) \
+        NANOS_CAS_ATOMIC(type, x, y, op) \
+    else \
+        NANOS_LOCK_UPDATE(type, x, y, op) \
+}
+
+// Template for double-width CAS, falls back to the lock when it cannot be used.
+// The new value starts as a copy of the old one so padding bytes (long double) are kept.
+#define NANOS_DWCAS_ATOMIC(type, x, y, op) \
+{ \
+    if ( sizeof(type) == sizeof(dwcas_t) && dwcas_usable(x) ) { \
+        union U { type val; dwcas_t raw; } old, new_; \
+        old.raw = dwcas_read(x); \
+        do { \
+            new_.raw = old.raw; \
+            new_.val = NANOS_CAS_BIN_OP_##op(old.val, y); \
+        } while (!dwcas(x, old.raw, new_.raw)); \
+    } else \
+        NANOS_LOCK_UPDATE(type, x, y, op) \
+}
+
 // Template for lock implementation
 #define NANOS_LOCK_UPDATE(type, x, y, op) \
 { \
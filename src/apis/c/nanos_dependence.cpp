@@ -25,6 +25,7 @@
 #include "instrumentationmodule_decl.hpp"
 #include "basethread.hpp"
 #include "workdescriptor.hpp"
+#include "taskgraph.hpp"
 
 /*! \defgroup capi_dependence Dependence services.
  *  \ingroup capi
@@ -83,6 +84,103 @@ NANOS_API_DEF(nanos_err_t, nanos_dependence_create, ( nanos_wd_t pred, nanos_wd_
    }
    return NANOS_OK;
 }
+
+//! \brief Starts recording the graph of the tasks submitted by the current WorkDescriptor
+//!
+//! Every task submitted until nanos_task_graph_record_end() becomes a node of the graph and
+//! the edges are computed from their data accesses. Tasks are executed as usual meanwhile.
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_record_begin, ( void ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_record_begin",NANOS_RUNTIME) );
+   try {
+      if ( !myThread->getCurrentWD()->getDependenciesDomain().startTaskGraphRecording() ) return NANOS_INVALID_REQUEST;
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
+//! \brief Stops recording and returns the recorded graph
+//!
+//! \param [out] graph is the recorded graph, to be released with nanos_task_graph_destroy()
+//! \return NANOS_INVALID_REQUEST if no graph was being recorded or the recorded tasks cannot be
+//! replayed (commutative or concurrent accesses, waits on dependencies)
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_record_end, ( nanos_task_graph_t *graph ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_record_end",NANOS_RUNTIME) );
+   try {
+      if ( graph == NULL ) return NANOS_INVALID_PARAM;
+
+      DependenciesDomain &domain = myThread->getCurrentWD()->getDependenciesDomain();
+      if ( !domain.isRecordingTaskGraph() ) return NANOS_INVALID_REQUEST;
+
+      *graph = (nanos_task_graph_t) domain.stopTaskGraphRecording();
+      if ( *graph == NULL ) return NANOS_INVALID_REQUEST;
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
+//! \brief Replays a recorded graph with the next tasks submitted by the current WorkDescriptor
+//!
+//! Waits first for the children that have not finished. The n-th submitted task becomes the n-th
+//! node of the graph and waits only for its predecessors in it, until nanos_task_graph_replay_end().
+//!
+//! \param [in] graph is a graph returned by nanos_task_graph_record_end()
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_replay_begin, ( nanos_task_graph_t graph ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_replay_begin",NANOS_RUNTIME) );
+   try {
+      if ( graph == NULL ) return NANOS_INVALID_PARAM;
+      if ( !myThread->getCurrentWD()->startTaskGraphReplay( *(TaskGraph *) graph ) ) return NANOS_INVALID_REQUEST;
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
+//! \brief Ends the submission of the tasks of a replay, all the recorded tasks must have been submitted
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_replay_end, ( void ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_replay_end",NANOS_RUNTIME) );
+   try {
+      if ( !myThread->getCurrentWD()->getDependenciesDomain().stopTaskGraphReplay() ) return NANOS_INVALID_REQUEST;
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
+//! \brief Releases a recorded graph, replays in progress keep their own reference
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_destroy, ( nanos_task_graph_t graph ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_destroy",NANOS_RUNTIME) );
+   try {
+      if ( graph == NULL ) return NANOS_INVALID_PARAM;
+      ( (TaskGraph *) graph )->unreference();
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
+//! \brief Returns the number of tasks and edges of a recorded graph
+NANOS_API_DEF(nanos_err_t, nanos_task_graph_get_size, ( nanos_task_graph_t graph, unsigned int *num_tasks, unsigned int *num_edges ) )
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","task_graph_get_size",NANOS_RUNTIME) );
+   try {
+      if ( graph == NULL ) return NANOS_INVALID_PARAM;
+
+      TaskGraph &taskGraph = *(TaskGraph *) graph;
+      if ( num_tasks != NULL ) *num_tasks = taskGraph.getNumNodes();
+      if ( num_edges != NULL ) *num_edges = taskGraph.getNumEdges();
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+   return NANOS_OK;
+}
+
 /*!
  * \}
  */ 
@@ -25,6 +25,7 @@
 #include "schedule.hpp"
 #include "system.hpp"
 #include "atomic.hpp"
+#include "queuelock.hpp"
 #include "synchronizedcondition.hpp"
 #include "instrumentationmodule_decl.hpp"
 #include "instrumentation.hpp"
@@ -185,7 +186,9 @@ NANOS_API_DEF(nanos_err_t, nanos_init_lock, ( nanos_lock_t **lock ))
    NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(1, &Keys, &Values); )
 
    try {
-      *lock = NEW Lock();
+      // Only locks allocated here can be queue locks: a nanos_lock_t is too small for one
+      if ( sys.getUserLockKind() == System::QUEUE_LOCK ) *lock = NEW QueueLock();
+      else *lock = NEW Lock();
    } catch ( nanos_err_t e) {
       return e;
    }
@@ -223,8 +226,13 @@ NANOS_API_DEF(nanos_err_t, nanos_set_lock, ( nanos_lock_t *lock ))
    NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(1, &Keys, &Values); )
 
    try {
-      Lock &l = *( Lock * ) lock;
-      l++;
+      if ( QueueLock::isQueueLock( lock ) ) {
+         QueueLock &l = *( QueueLock * ) lock;
+         l++;
+      } else {
+         Lock &l = *( Lock * ) lock;
+         l++;
+      }
    } catch ( nanos_err_t e) {
       return e;
    }
@@ -243,8 +251,13 @@ NANOS_API_DEF(nanos_err_t, nanos_unset_lock, ( nanos_lock_t *lock ))
    NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(1, &Keys, &Values); )
 
    try {
-      Lock &l = *( Lock * ) lock;
-      l--;
+      if ( QueueLock::isQueueLock( lock ) ) {
+         QueueLock &l = *( QueueLock * ) lock;
+         l--;
+      } else {
+         Lock &l = *( Lock * ) lock;
+         l--;
+      }
    } catch ( nanos_err_t e) {
       return e;
    }
@@ -263,9 +276,13 @@ NANOS_API_DEF(nanos_err_t, nanos_try_lock, ( nanos_lock_t *lock, bool *result ))
    NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(1, &Keys, &Values); )
 
    try {
-      Lock &l = *( Lock * ) lock;
-
-      *result = l.tryAcquire();
+      if ( QueueLock::isQueueLock( lock ) ) {
+         QueueLock &l = *( QueueLock * ) lock;
+         *result = l.tryAcquire();
+      } else {
+         Lock &l = *( Lock * ) lock;
+         *result = l.tryAcquire();
+      }
    } catch ( nanos_err_t e) {
       return e;
    }
@@ -284,7 +301,8 @@ NANOS_API_DEF(nanos_err_t, nanos_destroy_lock, ( nanos_lock_t *lock ))
    NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(1, &Keys, &Values); )
 
    try {
-      delete ( Lock * )lock;
+      if ( QueueLock::isQueueLock( lock ) ) delete ( QueueLock * )lock;
+      else delete ( Lock * )lock;
    } catch ( nanos_err_t e) {
       return e;
    }
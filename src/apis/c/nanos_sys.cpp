@@ -44,6 +44,11 @@ NANOS_API_DEF(const char *, nanos_get_pm, ())
    return (sys.getPMInterface()).getDescription().c_str();
 }
 
+NANOS_API_DEF(const char *, nanos_get_default_dependencies_manager, ())
+{
+   return (sys.getDefaultDependenciesManager()).c_str();
+}
+
 NANOS_API_DEF(nanos_err_t, nanos_get_default_binding, ( bool *res ))
 {
    try {
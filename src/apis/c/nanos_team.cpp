@@ -182,6 +182,19 @@ NANOS_API_DEF(nanos_err_t, nanos_team_barrier, ( void ))
    return NANOS_OK;
 }
 
+NANOS_API_DEF(nanos_err_t, nanos_team_get_num_threads, ( int *n ))
+{
+   NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","team_get_num_threads",NANOS_RUNTIME) );
+
+   try {
+      *n = myThread->getTeam()->size();
+   } catch ( nanos_err_t e) {
+      return e;
+   }
+
+   return NANOS_OK;
+}
+
 NANOS_API_DEF(nanos_err_t, nanos_team_get_num_supporting_threads, ( int *n ))
 {
    NANOS_INSTRUMENT( InstrumentStateAndBurst inst("api","get_num_supporting_threads",NANOS_RUNTIME) );
@@ -25,6 +25,7 @@
 #include "network_decl.hpp"
 #include "clusternode_decl.hpp"
 #include "deviceops.hpp"
+#include "stridedcopy.hpp"
 #include <iostream>
 
 using namespace nanos;
@@ -104,9 +105,7 @@ void ClusterDevice::_copyInStrided1D( uint64_t devAddr, uint64_t hostAddr, std::
       //*myThread->_file << "Got address " << (void *)packedAddr << std::endl;
 
    if ( packedAddr != NULL) { 
-      for ( unsigned int i = 0; i < count; i += 1 ) {
-         ::memcpy( &packedAddr[ i * len ], &hostAddrPtr[ i * ld ], len );
-      }
+      StridedCopy::pack( packedAddr, hostAddrPtr, len, count, ld );
    } else { std::cerr << "copyInStrided ERROR!!! could not get a packet to gather data." << std::endl; }
    //NANOS_INSTRUMENT( inst2.close(); );
    sys.getNetwork()->putStrided1D( mem.getNodeNumber(),  devAddr, ( void * ) hostAddr, packedAddr, len, count, ld, wd->getId(), wd, hostObject, hostRegionId );
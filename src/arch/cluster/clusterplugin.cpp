@@ -19,7 +19,11 @@
 
 #include "plugin.hpp"
 #include "system.hpp"
+#ifdef NANOX_CLUSTER_SHM
+#include "shmapi_decl.hpp"
+#else
 #include "gasnetapi_decl.hpp"
+#endif
 #include "clusterplugin_decl.hpp"
 #include "clusternode_decl.hpp"
 #include "remoteworkdescriptor_decl.hpp"
@@ -58,12 +62,17 @@ namespace nanos {
 namespace ext {
 
 ClusterPlugin::ClusterPlugin() : ArchPlugin( "Cluster PE Plugin", 1 ),
-   _gasnetApi( NEW GASNetAPI() ), _numPinnedSegments( 0 ), _pinnedSegmentAddrList( NULL ),
+   _netApi( NEW ClusterNetworkAPI() ), _numPinnedSegments( 0 ), _pinnedSegmentAddrList( NULL ),
    _pinnedSegmentLenList( NULL ), _extraPEsCount( 0 ), _conduit(""),
    _nodeMem( DEFAULT_NODE_MEM ), _allocFit( false ), _allowSharedThd( false ),
    _unalignedNodeMem( false ), _gpuPresend( 1 ), _smpPresend( 1 ),
    _cachePolicy( System::DEFAULT ), _remoteNodes( NULL ), _cpu( NULL ),
-   _clusterThread( NULL ), _gasnetSegmentSize( 0 ) {
+   _clusterThread( NULL ), _gasnetSegmentSize( 0 ), _aggregation( false ),
+   _aggregationSize( 8192 ), _aggregationTime( 50 )
+#ifdef NANOX_CLUSTER_SHM
+   , _shmNodes( 2 )
+#endif
+{
 }
 
 void ClusterPlugin::config( Config& cfg )
@@ -74,18 +83,25 @@ void ClusterPlugin::config( Config& cfg )
 
 void ClusterPlugin::init()
 {
-   _gasnetApi->initialize( sys.getNetwork() );
-   //sys.getNetwork()->setAPI(_gasnetApi);
-   _gasnetApi->setGASNetSegmentSize( _gasnetSegmentSize );
-   _gasnetApi->setUnalignedNodeMemory( _unalignedNodeMem );
-   sys.getNetwork()->initialize( _gasnetApi );
+   /* segment size must be known before initialize() maps the segments */
+#ifdef NANOX_CLUSTER_SHM
+   _netApi->setNumNodes( ( unsigned int ) _shmNodes );
+   _netApi->setSegmentSize( _gasnetSegmentSize );
+#else
+   _netApi->setGASNetSegmentSize( _gasnetSegmentSize );
+#endif
+   _netApi->setUnalignedNodeMemory( _unalignedNodeMem );
+   _netApi->initialize( sys.getNetwork() );
+   //sys.getNetwork()->setAPI(_netApi);
+   sys.getNetwork()->setAggregation( _aggregation, _aggregationSize, _aggregationTime );
+   sys.getNetwork()->initialize( _netApi );
    sys.getNetwork()->setGpuPresend(this->getGpuPresend() );
    sys.getNetwork()->setSmpPresend(this->getSmpPresend() );
 
-   unsigned int nodes = _gasnetApi->getNumNodes();
+   unsigned int nodes = _netApi->getNumNodes();
 
    if ( nodes > 1 ) {
-      if ( _gasnetApi->getNodeNum() == 0 ) {
+      if ( _netApi->getNodeNum() == 0 ) {
          void *segmentAddr[ nodes ];
          sys.getNetwork()->mallocSlaves( &segmentAddr[ 1 ], _nodeMem );
          segmentAddr[ 0 ] = NULL;
@@ -114,7 +130,7 @@ void ClusterPlugin::init()
          _remoteNodes = NEW std::vector<nanos::ext::ClusterNode *>(nodes - 1, (nanos::ext::ClusterNode *) NULL); 
          unsigned int node_index = 0;
          for ( unsigned int nodeC = 0; nodeC < nodes; nodeC++ ) {
-            if ( nodeC != _gasnetApi->getNodeNum() ) {
+            if ( nodeC != _netApi->getNodeNum() ) {
                memory_space_id_t id = sys.addSeparateMemoryAddressSpace( ext::Cluster, !( getAllocFit() ), 0 );
                SeparateMemoryAddressSpace &nodeMemory = sys.getSeparateMemory( id );
                nodeMemory.setSpecificData( NEW SimpleAllocator( ( uintptr_t ) segmentAddr[ nodeC ], _nodeMem ) );
@@ -226,6 +242,24 @@ void ClusterPlugin::prepare( Config& cfg ) {
    cfg.registerArgOption ( "gasnet-segment", "gasnet-segment-size" );
    cfg.registerEnvOption ( "gasnet-segment", "NX_GASNET_SEGMENT_SIZE" );
 
+   cfg.registerConfigOption ( "cluster-aggregation", NEW Config::FlagOption ( _aggregation ), "Aggregate small messages sent to the same node (disabled by default)." );
+   cfg.registerArgOption ( "cluster-aggregation", "cluster-aggregation" );
+   cfg.registerEnvOption ( "cluster-aggregation", "NX_CLUSTER_AGGREGATION" );
+
+   cfg.registerConfigOption ( "cluster-aggregation-size", NEW Config::SizeVar ( _aggregationSize ), "Bytes after which an aggregated batch is sent (8K by default)." );
+   cfg.registerArgOption ( "cluster-aggregation-size", "cluster-aggregation-size" );
+   cfg.registerEnvOption ( "cluster-aggregation-size", "NX_CLUSTER_AGGREGATION_SIZE" );
+
+   cfg.registerConfigOption ( "cluster-aggregation-time", NEW Config::PositiveVar ( _aggregationTime ), "Microseconds a message may wait in an aggregated batch (50 by default)." );
+   cfg.registerArgOption ( "cluster-aggregation-time", "cluster-aggregation-time" );
+   cfg.registerEnvOption ( "cluster-aggregation-time", "NX_CLUSTER_AGGREGATION_TIME" );
+
+#ifdef NANOX_CLUSTER_SHM
+   cfg.registerConfigOption ( "cluster-shm-nodes", NEW Config::PositiveVar ( _shmNodes ), "Number of node processes started by the shared memory network (2 by default)." );
+   cfg.registerArgOption ( "cluster-shm-nodes", "cluster-shm-nodes" );
+   cfg.registerEnvOption ( "cluster-shm-nodes", "NX_CLUSTER_SHM_NODES" );
+#endif
+
 }
 
 ProcessingElement * ClusterPlugin::createPE( unsigned id, unsigned uid ){
@@ -237,10 +271,10 @@ unsigned ClusterPlugin::getNumThreads() const {
 }
 
 void ClusterPlugin::startSupportThreads() {
-   if ( _gasnetApi->getNumNodes() > 1 )
+   if ( _netApi->getNumNodes() > 1 )
    {
-      if ( _gasnetApi->getNodeNum() == 0 ) {
-         _clusterThread = dynamic_cast<ext::SMPMultiThread *>( &_cpu->startMultiWorker( _gasnetApi->getNumNodes() - 1, (ProcessingElement **) &(*_remoteNodes)[0] ) );
+      if ( _netApi->getNodeNum() == 0 ) {
+         _clusterThread = dynamic_cast<ext::SMPMultiThread *>( &_cpu->startMultiWorker( _netApi->getNumNodes() - 1, (ProcessingElement **) &(*_remoteNodes)[0] ) );
       } else {
          _clusterThread = dynamic_cast<ext::SMPMultiThread *>( &_cpu->startMultiWorker( 0, NULL ) );
          if ( sys.getPMInterface().getInternalDataSize() > 0 )
@@ -252,17 +286,17 @@ void ClusterPlugin::startSupportThreads() {
             sys.getNetwork()->enableCheckingForDataInOtherAddressSpaces();
          }
 
-         _gasnetApi->_rwgs = (GASNetAPI::ArchRWDs *) NEW GASNetAPI::ArchRWDs();
-         _gasnetApi->_rwgs[0][0] = getRemoteWorkDescriptor(0);
-         _gasnetApi->_rwgs[0][1] = getRemoteWorkDescriptor(1);
-         _gasnetApi->_rwgs[0][2] = getRemoteWorkDescriptor(2);
-         _gasnetApi->_rwgs[0][3] = getRemoteWorkDescriptor(3);
+         _netApi->_rwgs = (ClusterNetworkAPI::ArchRWDs *) NEW ClusterNetworkAPI::ArchRWDs();
+         _netApi->_rwgs[0][0] = getRemoteWorkDescriptor(0);
+         _netApi->_rwgs[0][1] = getRemoteWorkDescriptor(1);
+         _netApi->_rwgs[0][2] = getRemoteWorkDescriptor(2);
+         _netApi->_rwgs[0][3] = getRemoteWorkDescriptor(3);
       }
    }
 }
 
 void ClusterPlugin::startWorkerThreads( std::map<unsigned int, BaseThread *> &workers ) {
-   if ( _gasnetApi->getNodeNum() == 0 )
+   if ( _netApi->getNodeNum() == 0 )
    {
       if ( _clusterThread ) {
          for ( unsigned int thdIndex = 0; thdIndex < _clusterThread->getNumThreads(); thdIndex += 1 )
@@ -277,7 +311,7 @@ void ClusterPlugin::startWorkerThreads( std::map<unsigned int, BaseThread *> &wo
 }
 
 void ClusterPlugin::finalize() {
-   if ( _gasnetApi->getNodeNum() == 0 ) {
+   if ( _netApi->getNodeNum() == 0 ) {
       //message0("Master: Created " << createdWds << " WDs.");
       //message0("Master: Failed to correctly schedule " << sys.getAffinityFailureCount() << " WDs.");
       int soft_inv = 0;
@@ -23,14 +23,23 @@
 #include "plugin.hpp"
 #include "system_decl.hpp"
 #include "clusternode_decl.hpp"
+#ifdef NANOX_CLUSTER_SHM
+#include "shmapi_fwd.hpp"
+#else
 #include "gasnetapi_fwd.hpp"
+#endif
 
 namespace nanos {
 namespace ext {
 
 class ClusterPlugin : public ArchPlugin
 {
-      GASNetAPI *_gasnetApi;
+#ifdef NANOX_CLUSTER_SHM
+      typedef SHMAPI ClusterNetworkAPI;
+#else
+      typedef GASNetAPI ClusterNetworkAPI;
+#endif
+      ClusterNetworkAPI *_netApi;
 
       unsigned int _numPinnedSegments;
       void ** _pinnedSegmentAddrList;
@@ -48,6 +57,12 @@ class ClusterPlugin : public ArchPlugin
       ext::SMPProcessor *_cpu;
       ext::SMPMultiThread *_clusterThread;
       std::size_t _gasnetSegmentSize;
+      bool _aggregation;
+      std::size_t _aggregationSize;
+      int _aggregationTime;
+#ifdef NANOX_CLUSTER_SHM
+      int _shmNodes;
+#endif
 
    public:
       ClusterPlugin();
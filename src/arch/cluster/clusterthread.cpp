@@ -26,6 +26,7 @@
 #include "basethread.hpp"
 #include "smpthread.hpp"
 #include "netwd_decl.hpp"
+#include "allocator.hpp"
 #ifdef OpenCL_DEV
 #include "opencldd.hpp"
 #endif
@@ -54,19 +55,19 @@ unsigned int ClusterThread::RunningWDQueue::numRunningWDs() const {
    return _numRunning.value();
 }
 
+/* Compare the counters, not their slots: with MAX_PRESEND completed WDs
+ * pending both point to the same slot and the queue would look empty.
+ */
 void ClusterThread::RunningWDQueue::clearCompletedWDs( ClusterThread *self ) {
-   unsigned int lowval = _completedTail % MAX_PRESEND;
-   unsigned int highval = ( _completedHead2.value() ) % MAX_PRESEND;
-   unsigned int pos = lowval;
-   if ( lowval > highval ) highval +=MAX_PRESEND;
-   while ( lowval < highval )
+   unsigned int head = _completedHead2.value();
+   while ( _completedTail != head )
    {
+      unsigned int pos = _completedTail % MAX_PRESEND;
       WD *completedWD = _completedWDs[pos];
       Scheduler::postOutlineWork( completedWD, false, self );
-      delete[] (char *) completedWD;
+      if ( completedWD->isChunkPooled() ) Allocator::deallocate( completedWD );
+      else delete[] (char *) completedWD;
       _completedWDs[pos] =(WD *) 0xdeadbeef;
-      pos = (pos+1) % MAX_PRESEND;
-      lowval += 1;
       _completedTail += 1;
    }
 }
@@ -35,6 +35,7 @@
 #include "requestqueue.hpp"
 #include "atomic.hpp"
 #include "netwd_decl.hpp"
+#include "stridedcopy.hpp"
 #include <cstddef>
 
 //#define HALF_PRESEND
@@ -696,10 +697,7 @@ void GASNetAPI::amPutStrided1D( gasnet_token_t token,
       char* realAddrPtr = (char *) realTag;
       char* localAddrPtr = ( (char *) ( ( ( uintptr_t ) buf ) + ( ( uintptr_t ) len ) - ( uintptr_t ) totalLen ) );
       //NANOS_INSTRUMENT( InstrumentState inst2(NANOS_STRIDED_COPY_UNPACK); );
-      for ( int i = 0; i < count; i += 1 ) {
-         ::memcpy( &realAddrPtr[ i * ld ], &localAddrPtr[ i * size ], size );
-         //if (i == 0)fprintf(stderr, "[%d] amPutStrided1D from %d: dst[%p]=%f buff[%p]=%f\n", gasnet_mynode(), src_node, &realAddrPtr[ i * ld], *((double*)&realAddrPtr[i*ld]), &localAddrPtr[i*size], *((double*)&localAddrPtr[i*size]) );
-      }
+      StridedCopy::unpack( realAddrPtr, localAddrPtr, size, count, ld );
       //NANOS_INSTRUMENT( inst2.close(); );
       uintptr_t localAddr = ( ( uintptr_t ) buf ) + ( ( uintptr_t ) len ) - ( uintptr_t ) totalLen;
       getInstance()->enqueueFreeBufferNotify( issueNode, ( void * ) localAddr, wd );
@@ -998,6 +996,19 @@ void GASNetAPI::amIdle( gasnet_token_t token ) {
    getInstance()->_net->notifyIdle( src_node );
 }
 
+void GASNetAPI::amBatch( gasnet_token_t token, void *buf, std::size_t len ) {
+   DisableAM c;
+   gasnet_node_t src_node;
+   if (gasnet_AMGetMsgSource(token, &src_node) != GASNET_OK)
+   {
+      fprintf(stderr, "gasnet: Error obtaining node information.\n");
+   }
+   VERBOSE_AM( (myThread != NULL ? (*myThread->_file) : std::cerr) << __FUNCTION__ << " from " << src_node << " len " << len << std::endl; );
+   getInstance()->_rxBytes += len;
+   getInstance()->_net->notifyBatch( src_node, buf, len );
+   VERBOSE_AM( (myThread != NULL ? (*myThread->_file) : std::cerr) << __FUNCTION__ << " done." << std::endl; );
+}
+
 void GASNetAPI::initialize ( Network *net )
 {
    int my_argc = OS::getArgc();
@@ -1030,7 +1041,8 @@ void GASNetAPI::initialize ( Network *net )
       { 223, (void (*)()) amGetReplyStrided1D },
       { 224, (void (*)()) amRegionMetadata },
       { 225, (void (*)()) amSynchronizeDirectory },
-      { 226, (void (*)()) amIdle }
+      { 226, (void (*)()) amIdle },
+      { 227, (void (*)()) amBatch }
    };
 
    gasnet_init( &my_argc, &my_argv );
@@ -1205,6 +1217,7 @@ void GASNetAPI::sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr )
 
 void GASNetAPI::_sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr )
 {
+   if ( _net->batchWorkDone( dest, remoteWdAddr ) ) return;
    if ( _emitPtPEvents ) {
       NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
       NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( remoteWdAddr ) ; )
@@ -1652,6 +1665,20 @@ void GASNetAPI::broadcastIdle() {
    }
 }
 
+void GASNetAPI::sendBatch( unsigned int dest, void const *buf, std::size_t len ) {
+   _txBytes += len;
+   VERBOSE_AM( (myThread != NULL ? (*myThread->_file) : std::cerr) << __FUNCTION__ << " send amBatch to node " << dest << " len " << len << std::endl; );
+   if ( gasnet_AMRequestMedium0( dest, 227, (void *) buf, len ) != GASNET_OK )
+   {
+      fprintf(stderr, "gasnet: Error sending a message to node %d.\n", dest);
+   }
+   VERBOSE_AM( (myThread != NULL ? (*myThread->_file) : std::cerr) << __FUNCTION__ << " send amBatch done" << std::endl; );
+}
+
+std::size_t GASNetAPI::getMaxBatchLen() const {
+   return gasnet_AMMaxMedium();
+}
+
 std::size_t GASNetAPI::getRxBytes()
 {
    return _rxBytes;
@@ -205,6 +205,8 @@ namespace ext {
          unsigned int getNodeNum() const;
          void synchronizeDirectory( unsigned int dest, void *addr );
          void broadcastIdle();
+         void sendBatch( unsigned int dest, void const *buf, std::size_t len );
+         std::size_t getMaxBatchLen() const;
 
 
          void setGASNetSegmentSize(std::size_t segmentSize);
@@ -313,6 +315,7 @@ namespace ext {
                void *arg, std::size_t argSize, gasnet_handlerarg_t seq );
          static void amSynchronizeDirectory(gasnet_token_t token, gasnet_handlerarg_t addrLo, gasnet_handlerarg_t addrHi);
          static void amIdle(gasnet_token_t token);
+         static void amBatch(gasnet_token_t token, void *buf, std::size_t len );
    };
 } // namespace ext
 } // namespace nanos
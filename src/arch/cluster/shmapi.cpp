@@ -0,0 +1,1087 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "shmapi_decl.hpp"
+#include "system.hpp"
+#include "os.hpp"
+#include "instrumentation.hpp"
+#include "osallocator_decl.hpp"
+#include "requestqueue.hpp"
+#include "atomic.hpp"
+#include "lock.hpp"
+#include "netwd_decl.hpp"
+#include "stridedcopy.hpp"
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstddef>
+#include <cstring>
+
+#ifndef __SIZEOF_POINTER__
+#   error This compiler does not define __SIZEOF_POINTER__ :( 
+#else
+#   if __SIZEOF_POINTER__ == 8
+#      define DEFAULT_SEGMENT_SIZE ( 1024UL * 1024UL * 1024UL )
+#   else
+#      define DEFAULT_SEGMENT_SIZE ( 64UL * 1024UL * 1024UL )
+#   endif
+#endif
+
+#define PTR_ARG( _Ptr ) ( ( uint64_t ) ( uintptr_t ) ( _Ptr ) )
+#define ARG_PTR( _Type, _Arg ) ( ( _Type ) ( uintptr_t ) ( _Arg ) )
+#define ALIGN_UP( _Len, _Align ) ( ( ( _Len ) + ( _Align ) - 1 ) & ~( ( std::size_t ) ( _Align ) - 1 ) )
+
+using namespace nanos;
+using namespace ext;
+
+#define _emitPtPEvents 1
+
+
+SHMAPI::WorkBufferManager::WorkBufferManager() : _buffers(), _lock() {
+}
+
+char * SHMAPI::WorkBufferManager::_add(unsigned int wdId, unsigned int num, std::size_t totalLen, std::size_t thisLen, char *buff ) {
+   char *ret = NULL;
+   _lock.acquire();
+   std::map<unsigned int, char *>::iterator it = _buffers.lower_bound( wdId );
+   if ( it == _buffers.end() || _buffers.key_comp()( wdId, it->first ) ) {
+      it = _buffers.insert( it, std::make_pair( wdId, NEW char[ totalLen ] ) );
+   }
+   memcpy( &(it->second[ num * MAX_MEDIUM ]), buff, thisLen );
+   ret = it->second;
+   if ( num * MAX_MEDIUM + thisLen == totalLen ) {
+      /* last piece, the caller takes ownership of the buffer */
+      _buffers.erase( it );
+   }
+   _lock.release();
+   return ret;
+}
+
+char *SHMAPI::WorkBufferManager::get(unsigned int wdId, std::size_t totalLen, std::size_t thisLen, char *buff ) {
+   char *data = NULL;
+   if ( totalLen == thisLen ) {
+      data = NEW char[ thisLen ];
+      memcpy( data, buff, thisLen );
+   } else {
+      /* the work message carries the last piece of the buffer */
+      unsigned int num = ( totalLen - thisLen ) / MAX_MEDIUM;
+      data = this->_add(wdId, num, totalLen, thisLen, buff);
+   }
+   return data;
+}
+
+SHMAPI *SHMAPI::_instance = 0;
+__thread bool SHMAPI::_polling = false;
+
+SHMAPI *SHMAPI::getInstance() {
+   return _instance;
+}
+
+SHMAPI::MessageHandler SHMAPI::_handlers[ SHMAPI::MSG_COUNT ] = {
+   NULL,                     /* MSG_PAD */
+   amFinalize,               /* MSG_FINALIZE */
+   amWork,                   /* MSG_WORK */
+   amWorkData,               /* MSG_WORK_DATA */
+   amWorkDone,               /* MSG_WORK_DONE */
+   amMalloc,                 /* MSG_MALLOC */
+   amMallocReply,            /* MSG_MALLOC_REPLY */
+   amMasterHostname,         /* MSG_MASTER_HOSTNAME */
+   amPut,                    /* MSG_PUT */
+   amGet,                    /* MSG_GET */
+   amGetReply,               /* MSG_GET_REPLY */
+   amRequestPut,             /* MSG_REQUEST_PUT */
+   amWaitRequestPut,         /* MSG_WAIT_REQUEST_PUT */
+   amFree,                   /* MSG_FREE */
+   amRealloc,                /* MSG_REALLOC */
+   amFreeTmpBuffer,          /* MSG_FREE_TMP_BUFFER */
+   amRegionMetadata,         /* MSG_REGION_METADATA */
+   amSynchronizeDirectory,   /* MSG_SYNCHRONIZE_DIRECTORY */
+   amIdle,                   /* MSG_IDLE */
+   amBatch                   /* MSG_BATCH */
+};
+
+SHMAPI::SHMAPI() : _net( 0 ), _numNodes( 1 ), _nodeNum( 0 ), _nodePids(),
+   _sharedArea( NULL ), _sharedAreaSize( 0 ), _control( NULL ), _rings( NULL ), _segments( NULL ),
+   _segmentSize( 0 ), _sendLocks(), _pollLock(), _pollTails(), _pendingMessages(), _thisNodeSegment( 0 ), _packSegment( 0 ),
+   _pinnedAllocators(), _pinnedAllocatorsLocks(), _receiveMemoryLock(), _seqN( 0 ),
+   _dataSendRequests(), _freeBufferReqs(), _workDoneReqs(), _rxBytes( 0 ), _txBytes( 0 ), _totalBytes( 0 ),
+   _incomingWorkBuffers(), _unalignedNodeMemory( false ), _rwgs( 0 ) {
+   _instance = this;
+}
+
+SHMAPI::~SHMAPI() {
+}
+
+SHMAPI::SendDataPutRequestPayload::SendDataPutRequestPayload( unsigned int issueNode, unsigned int seqNumber, void *origAddr,
+      void *dstAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int dest, unsigned int wdId, void *tmpBuffer,
+      WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq ) : _issueNode( issueNode ), _seqNumber( seqNumber ),
+   _origAddr( origAddr ), _destAddr( dstAddr ), _len( len ), _count( count ), _ld( ld ), _destination( dest ), _wdId( wdId ),
+   _tmpBuffer( tmpBuffer ), _wd( wd ), _hostObject( hostObject ), _hostRegId( hostRegId ), _metaSeq( metaSeq ) {
+}
+
+SHMAPI::SendDataGetRequestPayload::SendDataGetRequestPayload( unsigned int seqNumber, void *origAddr, void *dstAddr, std::size_t len,
+   std::size_t count, std::size_t ld, GetRequest *req, CopyData const &cd ) :
+   _seqNumber( seqNumber ), _origAddr( origAddr ), _destAddr( dstAddr ), _len( len ), _count( count ), _ld( ld ), _req( req ),
+   _cd( cd ) {
+}
+
+SHMAPI::SHMSendDataRequest::SHMSendDataRequest( SHMAPI *api, unsigned int issueNode, unsigned int seqNumber, void *origAddr, void *destAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int dst, unsigned int wdId, void *hostObject, reg_t hostRegId, unsigned int metaSeq ) :
+   SendDataRequest( api, issueNode, seqNumber, origAddr, destAddr, len, count, ld, dst, wdId, hostObject, hostRegId, metaSeq ), _shmApi( api ) {
+}
+
+SHMAPI::SendDataPutRequest::SendDataPutRequest( SHMAPI *api, SendDataPutRequestPayload *msg ) :
+   SHMSendDataRequest( api, msg->_issueNode, msg->_seqNumber, msg->_origAddr, msg->_destAddr, msg->_len, msg->_count, msg->_ld, msg->_destination, msg->_wdId, msg->_hostObject, msg->_hostRegId, msg->_metaSeq ), _tmpBuffer( msg->_tmpBuffer ), _wd( msg->_wd ) {
+}
+
+SHMAPI::SendDataPutRequest::~SendDataPutRequest() {
+}
+
+void SHMAPI::SendDataPutRequest::doSingleChunk() {
+   _shmApi->_put( getIssueNode(), getDestination(), (uint64_t) _destAddr, _origAddr, _len, _tmpBuffer, _wdId, _wd, _hostObject, _hostRegId, _metaSeq );
+}
+
+void SHMAPI::SendDataPutRequest::doStrided( void *localAddr ) {
+   _shmApi->_putStrided1D( getIssueNode(), getDestination(), (uint64_t) _destAddr, _origAddr, localAddr, _len, _count, _ld, _tmpBuffer, _wdId, _wd, _hostObject, _hostRegId, _metaSeq );
+}
+
+SHMAPI::SendDataGetRequest::SendDataGetRequest( SHMAPI *api, unsigned int seqNumber, unsigned int dest, void *origAddr, void *destAddr, std::size_t len, std::size_t count, std::size_t ld, GetRequest *req, CopyData const &cd, nanos_region_dimension_internal_t *dims ) :
+   SHMSendDataRequest( api, dest, seqNumber, origAddr, destAddr, len, count, ld, dest, 0, (void *) cd.getHostBaseAddress(),
+   cd.getHostRegionId(), 0 /* metaSeq is unused in this context */ ), _req( req ), _cd( cd ) {
+   nanos_region_dimension_internal_t *cd_dims = NEW nanos_region_dimension_internal_t[ _cd.getNumDimensions() ];
+   ::memcpy( cd_dims, dims, sizeof(nanos_region_dimension_internal_t) * _cd.getNumDimensions());
+   _cd.setDimensions( cd_dims );
+}
+
+SHMAPI::SendDataGetRequest::~SendDataGetRequest() {
+   delete[] _cd.getDimensions();
+}
+
+void SHMAPI::SendDataGetRequest::doSingleChunk() {
+   uint64_t args[] = { PTR_ARG( _req ) };
+   _shmApi->sendMessage( _destination, MSG_GET_REPLY, args, 1, _origAddr, _len, _destAddr );
+}
+
+void SHMAPI::SendDataGetRequest::doStrided( void *localAddr ) {
+   uint64_t args[] = { PTR_ARG( _req ) };
+   _shmApi->sendMessage( _destination, MSG_GET_REPLY, args, 1, localAddr, _len * _count, _destAddr );
+}
+
+SHMAPI::FreeBufferRequest::FreeBufferRequest(unsigned int dest, void *addr, WD const *w ) : destination( dest ), address( addr ), wd ( w ) {
+}
+
+SHMAPI::MessageRing &SHMAPI::getRing( unsigned int src, unsigned int dest ) const {
+   std::size_t stride = sizeof( MessageRing ) + RING_SIZE;
+   return *( ( MessageRing * ) &_rings[ ( src * _numNodes + dest ) * stride ] );
+}
+
+char *SHMAPI::getRingData( MessageRing &ring ) const {
+   return ( ( char * ) &ring ) + sizeof( MessageRing );
+}
+
+/* Only the node that owns a ring's source end writes into it, and _sendLocks
+ * serializes the threads of that node, so every ring has exactly one producer.
+ * A record never wraps around the end of the buffer: if it does not fit in the
+ * remaining space, that space is skipped (marked with MSG_PAD when a header
+ * fits there) and the record is written at the start of the buffer.
+ */
+void SHMAPI::sendMessage( unsigned int dest, MessageId id, uint64_t const *args, unsigned int numArgs,
+      void const *buf, std::size_t len, void *longAddr )
+{
+   std::size_t inlineLen = ( longAddr == NULL ) ? len : 0;
+   std::size_t recordLen = ALIGN_UP( sizeof( MessageHeader ) + numArgs * sizeof( uint64_t ) + inlineLen, sizeof( uint64_t ) );
+   ensure( recordLen <= RING_SIZE / 2, "Message too large for the shared memory ring." );
+
+   if ( longAddr != NULL && len > 0 ) {
+      ::memcpy( longAddr, buf, len );
+   }
+
+   MessageRing &ring = getRing( _nodeNum, dest );
+   char *data = getRingData( ring );
+   for (;;) {
+      _sendLocks[ dest ]->acquire();
+      std::size_t tail = ring._tail;
+      std::size_t offset = tail % RING_SIZE;
+      std::size_t contiguous = RING_SIZE - offset;
+      std::size_t needed = ( contiguous < recordLen ) ? contiguous + recordLen : recordLen;
+      if ( RING_SIZE - ( tail - ring._head ) >= needed ) {
+         if ( contiguous < recordLen ) {
+            if ( contiguous >= sizeof( MessageHeader ) ) {
+               ( ( MessageHeader * ) &data[ offset ] )->_id = MSG_PAD;
+            }
+            tail += contiguous;
+            offset = 0;
+         }
+         MessageHeader *header = ( MessageHeader * ) &data[ offset ];
+         header->_id = id;
+         header->_numArgs = numArgs;
+         header->_len = len;
+         header->_longAddr = PTR_ARG( longAddr );
+         uint64_t *recordArgs = ( uint64_t * ) ( header + 1 );
+         ::memcpy( recordArgs, args, numArgs * sizeof( uint64_t ) );
+         if ( inlineLen > 0 ) {
+            ::memcpy( &recordArgs[ numArgs ], buf, inlineLen );
+         }
+         memoryFence();
+         ring._tail = tail + recordLen;
+         _sendLocks[ dest ]->release();
+         return;
+      }
+      _sendLocks[ dest ]->release();
+      /* The ring is full and its consumer may be waiting to send to us, so
+       * keep our own rings moving. Handlers cannot run here when active
+       * messages are disabled (we may be inside one), but their records can
+       * still be copied out of the rings to free space for the producers.
+       */
+      if ( _polling ) {
+         drainRings();
+      } else if ( myThread == NULL || myThread->_gasnetAllowAM ) {
+         pollMessages();
+      } else if ( _pollLock.tryAcquire() ) {
+         drainRings();
+         _pollLock.release();
+      }
+   }
+}
+
+/* Copies every record published in the incoming rings to _pendingMessages and
+ * gives their space back to the producers. The caller must hold _pollLock.
+ * Ring tails are read from the last node down to the master before any record
+ * is copied. Region metadata always comes from the master, so a put from
+ * another node that depends on it (it spins on the metadata sequence number)
+ * is never queued before the metadata itself.
+ */
+void SHMAPI::drainRings()
+{
+   for ( unsigned int src = _numNodes; src > 0; src -= 1 ) {
+      _pollTails[ src - 1 ] = getRing( src - 1, _nodeNum )._tail;
+      memoryFence();
+   }
+   for ( unsigned int src = 0; src < _numNodes; src += 1 ) {
+      MessageRing &ring = getRing( src, _nodeNum );
+      char *data = getRingData( ring );
+      std::size_t head = ring._head;
+      std::size_t tail = _pollTails[ src ];
+      while ( head != tail ) {
+         std::size_t offset = head % RING_SIZE;
+         std::size_t contiguous = RING_SIZE - offset;
+         MessageHeader *header = ( MessageHeader * ) &data[ offset ];
+         if ( contiguous < sizeof( MessageHeader ) || header->_id == MSG_PAD ) {
+            head += contiguous;
+         } else {
+            std::size_t inlineLen = ( header->_longAddr != 0 ) ? 0 : header->_len;
+            std::size_t recordLen = ALIGN_UP( sizeof( MessageHeader ) + header->_numArgs * sizeof( uint64_t ) + inlineLen, sizeof( uint64_t ) );
+            char *record = NEW char[ recordLen ];
+            ::memcpy( record, header, recordLen );
+            _pendingMessages.push_back( std::make_pair( src, record ) );
+            head += recordLen;
+         }
+         memoryFence();
+         ring._head = head;
+      }
+   }
+}
+
+/* Handlers run on a copy of their record, so one that has to wait for ring
+ * space (see sendMessage) can drain the rings again. Records queued that way
+ * are handled by this same loop, after the ones queued before them.
+ */
+void SHMAPI::pollMessages()
+{
+   if ( !_pollLock.tryAcquire() ) return;
+   _polling = true;
+   drainRings();
+   while ( !_pendingMessages.empty() ) {
+      std::pair< unsigned int, char * > msg = _pendingMessages.front();
+      _pendingMessages.pop_front();
+      MessageHeader *header = ( MessageHeader * ) msg.second;
+      uint64_t const *args = ( uint64_t const * ) ( header + 1 );
+      void *buf = ( header->_longAddr != 0 ) ? ARG_PTR( void *, header->_longAddr ) : ( void * ) &args[ header->_numArgs ];
+      _handlers[ header->_id ]( msg.first, args, buf, header->_len );
+      delete[] msg.second;
+   }
+   _polling = false;
+   _pollLock.release();
+}
+
+void SHMAPI::processSendDataRequest( SendDataRequest *req ) {
+   _dataSendRequests.add( req );
+}
+
+void SHMAPI::checkForPutReqs()
+{
+   SendDataRequest *req = _dataSendRequests.tryFetch();
+   if ( req != NULL ) {
+      req->doSend();
+      delete req;
+   }
+}
+
+void SHMAPI::enqueueFreeBufferNotify( unsigned int dest, void *tmpBuffer, WD const *wd )
+{
+   FreeBufferRequest *addrWd = NEW FreeBufferRequest( dest, tmpBuffer, wd );
+   _freeBufferReqs.add( addrWd );
+}
+
+void SHMAPI::checkForFreeBufferReqs()
+{
+   FreeBufferRequest *req = _freeBufferReqs.tryFetch();
+   if ( req != NULL ) {
+      sendFreeTmpBuffer( req->destination, req->address, req->wd );
+      delete req;
+   }
+}
+
+void SHMAPI::checkWorkDoneReqs()
+{
+   std::pair<void const *, unsigned int> *rwd = _workDoneReqs.tryFetch();
+   if ( rwd != NULL ) {
+      _sendWorkDoneMsg( rwd->second, rwd->first );
+      delete rwd;
+   }
+}
+
+void SHMAPI::amFinalize( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   sys.stopFirstThread();
+}
+
+void SHMAPI::amWork( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   unsigned int wdId = ( unsigned int ) args[0];
+   std::size_t totalArgSize = ( std::size_t ) args[1];
+   std::size_t expectedData = ( std::size_t ) args[2];
+   unsigned int seq = ( unsigned int ) args[3];
+
+   char *work_data = getInstance()->_incomingWorkBuffers.get( wdId, totalArgSize, len, (char *) buf );
+   Net2WD nwd( work_data, totalArgSize, getInstance()->_rwgs[src] );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( nwd.getWD()->getRemoteAddr() ) ; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent( NANOS_AM_WORK, id, 0, 0, src ); )
+   }
+
+   getInstance()->_net->notifyWork( expectedData, nwd.getWD(), seq );
+
+   delete[] work_data;
+}
+
+void SHMAPI::amWorkData( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   getInstance()->_incomingWorkBuffers._add( ( unsigned int ) args[0], ( unsigned int ) args[1], ( std::size_t ) args[2], len, (char *) buf );
+}
+
+void SHMAPI::amWorkDone( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   void *addr = ARG_PTR( void *, args[0] );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( addr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent( NANOS_AM_WORK_DONE, id, 0, 0, src ); )
+   }
+
+   sys.getNetwork()->notifyWorkDone( src, addr, 0 );
+}
+
+void SHMAPI::amMalloc( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   void *addr = NULL;
+   std::size_t size = ( std::size_t ) args[0];
+
+   if ( getInstance()->_unalignedNodeMemory ) {
+      addr = (void *) NEW char[ size ];
+   } else {
+      OSAllocator a;
+      addr = a.allocate( size );
+   }
+   if ( addr == NULL )
+   {
+      message0 ( "I could not allocate " << (std::size_t) size << " bytes of memory on node " << getInstance()->_nodeNum << ". Try setting NX_CLUSTER_NODE_MEMORY to a lower value." );
+      fatal0 ("I can not continue." );
+   }
+   uint64_t reply[] = { PTR_ARG( addr ), args[1] };
+   getInstance()->sendMessage( src, MSG_MALLOC_REPLY, reply, 2 );
+}
+
+void SHMAPI::amMallocReply( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   sys.getNetwork()->notifyMalloc( src, ARG_PTR( void *, args[0] ), ARG_PTR( Network::mallocWaitObj *, args[1] ) );
+}
+
+void SHMAPI::amFree( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   free( ARG_PTR( void *, args[0] ) );
+}
+
+void SHMAPI::amRealloc( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   std::memcpy( ARG_PTR( void *, args[2] ), ARG_PTR( void *, args[0] ), ( std::size_t ) args[1] );
+}
+
+void SHMAPI::amMasterHostname( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   /* for now we only allow this at node 0 */
+   if ( src == 0 )
+   {
+      sys.getNetwork()->setMasterHostname( ( char  *) buf );
+   }
+}
+
+/* Both contiguous and strided puts land here: the data is already in our
+ * segment (tmp buffer) and gets unpacked to its final address. */
+void SHMAPI::amPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   char *realTag = ARG_PTR( char *, args[0] );
+   std::size_t size = ( std::size_t ) args[1];
+   std::size_t count = ( std::size_t ) args[2];
+   std::size_t ld = ( std::size_t ) args[3];
+   unsigned int wdId = ( unsigned int ) args[4];
+   WD *wd = ARG_PTR( WD *, args[5] );
+   unsigned int seq = ( unsigned int ) args[6];
+   void *hostObject = ARG_PTR( void *, args[7] );
+   reg_t hostRegId = ( reg_t ) args[8];
+   unsigned int issueNode = ( unsigned int ) args[9];
+
+   getInstance()->_rxBytes += len;
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = len; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( buf ) ; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent( NANOS_XFER_DATA, id, sizeKey, xferSize, src ); )
+   }
+
+   StridedCopy::unpack( realTag, ( char const * ) buf, size, count, ld );
+   getInstance()->enqueueFreeBufferNotify( issueNode, buf, wd );
+   getInstance()->_net->notifyPut( src, wdId, size, count, ld, (uint64_t) realTag, hostObject, hostRegId, seq );
+}
+
+void SHMAPI::amGetReply( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   GetRequest *req = ARG_PTR( GetRequest *, args[0] );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = len; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) buf; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent ( NANOS_XFER_DATA, id, sizeKey, xferSize, src ); )
+   }
+
+   if ( req != NULL )
+   {
+      req->complete();
+   }
+}
+
+void SHMAPI::amGet( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   SendDataGetRequestPayload *msg = ( SendDataGetRequestPayload * ) buf;
+   nanos_region_dimension_internal_t *dims = (nanos_region_dimension_internal_t *)( ((char *)buf)+ sizeof( SendDataGetRequestPayload ) );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) msg->_req; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent ( NANOS_XFER_REQ, id, sizeKey, xferSize, src ); )
+   }
+
+   getInstance()->_txBytes += msg->_len * msg->_count;
+
+   SendDataGetRequest *req = NEW SendDataGetRequest( getInstance(), msg->_seqNumber, src, msg->_destAddr, msg->_origAddr, msg->_len, msg->_count, msg->_ld, msg->_req, msg->_cd, dims );
+   getInstance()->_net->notifyRegionMetaData( &( req->_cd ), 0 );
+   getInstance()->_net->notifyGet( req );
+}
+
+void SHMAPI::amRequestPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   SendDataPutRequestPayload *msg = ( SendDataPutRequestPayload * ) buf;
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) msg->_tmpBuffer; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent ( NANOS_XFER_REQ, id, sizeKey, xferSize, src ); )
+   }
+
+   SendDataPutRequest *req = NEW SendDataPutRequest( getInstance(), msg );
+   getInstance()->_net->notifyRequestPut( req );
+}
+
+void SHMAPI::amWaitRequestPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   void *addr = ARG_PTR( void *, args[0] );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( addr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent( NANOS_XFER_WAIT_REQ_PUT, id, sizeKey, xferSize, src ); )
+   }
+
+   getInstance()->_net->notifyWaitRequestPut( addr, ( unsigned int ) args[1], ( unsigned int ) args[2] );
+}
+
+void SHMAPI::amFreeTmpBuffer( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   void *addr = ARG_PTR( void *, args[0] );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( addr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseClosePtPEvent( NANOS_XFER_FREE_TMP_BUFF, id, sizeKey, xferSize, src ); )
+   }
+   getInstance()->_pinnedAllocatorsLocks[ src ]->acquire();
+   getInstance()->_pinnedAllocators[ src ]->free( addr );
+   getInstance()->_pinnedAllocatorsLocks[ src ]->release();
+}
+
+void SHMAPI::amRegionMetadata( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   CopyData *cd = (CopyData *) buf;
+   cd->setDimensions( (nanos_region_dimension_internal_t *) ( ((char*)buf) + sizeof(CopyData) ) );
+   getInstance()->_net->notifyRegionMetaData( cd, (unsigned int) args[0] );
+}
+
+void SHMAPI::amSynchronizeDirectory( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   WorkDescriptor *wds[4];
+   unsigned int numWDs = 0;
+
+   wds[numWDs] = getInstance()->_rwgs[src][0];
+   numWDs += 1;
+#ifdef GPU_DEV
+   wds[numWDs] = getInstance()->_rwgs[src][1];
+   numWDs += 1;
+#endif
+#ifdef OpenCL_DEV
+   wds[numWDs] = getInstance()->_rwgs[src][2];
+   numWDs += 1;
+#endif
+#ifdef FPGA_DEV
+   wds[numWDs] = getInstance()->_rwgs[src][3];
+   numWDs += 1;
+#endif
+   getInstance()->_net->notifySynchronizeDirectory( numWDs, wds, ARG_PTR( void *, args[0] ) );
+}
+
+void SHMAPI::amIdle( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   getInstance()->_net->notifyIdle( src );
+}
+
+void SHMAPI::amBatch( unsigned int src, uint64_t const *args, void *buf, std::size_t len )
+{
+   DisableAM c;
+   getInstance()->_net->notifyBatch( src, buf, len );
+}
+
+void SHMAPI::initialize ( Network *net )
+{
+   _net = net;
+   if ( _numNodes == 0 ) _numNodes = 1;
+   if ( _segmentSize == 0 ) _segmentSize = DEFAULT_SEGMENT_SIZE;
+
+   std::size_t pageSize = ( std::size_t ) sysconf( _SC_PAGESIZE );
+   std::size_t controlSize = ALIGN_UP( sizeof( SharedControl ), NANOS_CACHELINE );
+   std::size_t ringsSize = ALIGN_UP( ( sizeof( MessageRing ) + RING_SIZE ) * _numNodes * _numNodes, pageSize );
+   _segmentSize = ALIGN_UP( _segmentSize, pageSize );
+   _sharedAreaSize = ALIGN_UP( controlSize, pageSize ) + ringsSize + _segmentSize * _numNodes;
+
+   /* Created before forking so every node sees it at the same address;
+    * anonymous mappings are zero filled, so rings start empty. */
+   void *area = mmap( NULL, _sharedAreaSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+   fatal_cond0( area == MAP_FAILED, "Could not map the shared memory cluster segments (" << _sharedAreaSize << " bytes). Try a smaller NX_GASNET_SEGMENT_SIZE." );
+   _sharedArea = ( char * ) area;
+   _control = new ( _sharedArea ) SharedControl();
+   _control->_barrierArrived = 0;
+   _control->_barrierGeneration = 0;
+   _rings = _sharedArea + ALIGN_UP( controlSize, pageSize );
+   _segments = _rings + ringsSize;
+
+   _pollTails.resize( _numNodes, 0 );
+   _sendLocks.reserve( _numNodes );
+   for ( unsigned int idx = 0; idx < _numNodes; idx += 1 ) {
+      _sendLocks.push_back( NEW Lock() );
+   }
+
+   std::fflush( NULL );
+   _nodeNum = 0;
+   for ( unsigned int node = 1; node < _numNodes; node += 1 ) {
+      pid_t pid = fork();
+      fatal_cond0( pid < 0, "Could not start cluster node " << node << "." );
+      if ( pid == 0 ) {
+         _nodeNum = node;
+         _nodePids.clear();
+         break;
+      }
+      _nodePids.push_back( pid );
+   }
+
+   _net->setNumNodes( _numNodes );
+   _net->setNodeNum( _nodeNum );
+
+   nodeBarrier();
+
+   {
+      unsigned int i;
+      char myHostname[256];
+      if ( gethostname( myHostname, 256 ) != 0 )
+      {
+         fprintf(stderr, "os: Error getting the hostname.\n");
+      }
+
+      if ( _nodeNum == 0 )
+      {
+         sys.getNetwork()->setMasterHostname( (char *) myHostname );
+
+         for ( i = 1; i < _numNodes ; i++ )
+         {
+            sendMyHostName( i );
+         }
+      }
+   }
+
+   nodeBarrier();
+
+   _seqN = NEW Atomic<unsigned int>[ _numNodes ];
+   _pinnedAllocators.reserve( _numNodes );
+   _pinnedAllocatorsLocks.reserve( _numNodes );
+   for ( unsigned int idx = 0; idx < _numNodes; idx += 1 )
+   {
+      new (&_seqN[idx]) Atomic<unsigned int >( 0 );
+      _pinnedAllocators.push_back( NEW SimpleAllocator( ( uintptr_t ) &_segments[ idx * _segmentSize ], _segmentSize / 2 ) );
+      _pinnedAllocatorsLocks.push_back( NEW Lock( ) );
+   }
+   _thisNodeSegment = _pinnedAllocators[0];
+
+   _packSegment = NEW SimpleAllocator( ( uintptr_t ) &_segments[ _nodeNum * _segmentSize + _segmentSize / 2 ], _segmentSize / 2 );
+}
+
+void SHMAPI::waitForNodes ()
+{
+   for ( unsigned int idx = 0; idx < _nodePids.size(); idx += 1 ) {
+      int status = 0;
+      if ( waitpid( _nodePids[ idx ], &status, 0 ) < 0 || !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+         warning0( "Cluster node " << idx + 1 << " did not finish cleanly." );
+      }
+   }
+   _nodePids.clear();
+}
+
+/* Slave nodes leave here; the master reaps them and returns, so the exit
+ * status of the application is preserved. */
+void SHMAPI::finalize ()
+{
+   nodeBarrier();
+   if ( _nodeNum != 0 ) {
+      std::fflush( NULL );
+      _exit( 0 );
+   }
+   waitForNodes();
+}
+
+void SHMAPI::finalizeNoBarrier ()
+{
+   std::fflush( NULL );
+   if ( _nodeNum != 0 ) {
+      _exit( 0 );
+   }
+   for ( unsigned int idx = 0; idx < _nodePids.size(); idx += 1 ) {
+      kill( _nodePids[ idx ], SIGTERM );
+   }
+   waitForNodes();
+}
+
+void SHMAPI::poll ()
+{
+   if (myThread != NULL && myThread->_gasnetAllowAM)
+   {
+      pollMessages();
+      checkForPutReqs();
+      checkForFreeBufferReqs();
+      checkWorkDoneReqs();
+   } else if ( myThread == NULL ) {
+      pollMessages();
+   }
+}
+
+void SHMAPI::sendExitMsg ( unsigned int dest )
+{
+   sendMessage( dest, MSG_FINALIZE, NULL, 0 );
+}
+
+void SHMAPI::sendWorkMsg ( unsigned int dest, WorkDescriptor const &wd, std::size_t expectedData )
+{
+   std::size_t sent = 0;
+   unsigned int msgCount = 0;
+
+   WD2Net nwd( wd );
+
+   while ( (nwd.getBufferSize() - sent) > MAX_MEDIUM )
+   {
+      uint64_t args[] = { ( unsigned int ) wd.getId(), msgCount, nwd.getBufferSize() };
+      sendMessage( dest, MSG_WORK_DATA, args, 3, &(nwd.getBuffer()[ sent ]), MAX_MEDIUM );
+      msgCount++;
+      sent += MAX_MEDIUM;
+   }
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( &wd ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_AM_WORK, id, 0, 0, dest ); )
+   }
+
+   uint64_t args[] = { ( unsigned int ) wd.getId(), nwd.getBufferSize(), expectedData, _seqN[dest]++ };
+   sendMessage( dest, MSG_WORK, args, 4, &(nwd.getBuffer()[ sent ]), nwd.getBufferSize() - sent );
+}
+
+void SHMAPI::sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr )
+{
+   std::pair<void const *, unsigned int> *rwd = NEW std::pair<void const *, unsigned int> ( remoteWdAddr, dest );
+   _workDoneReqs.add( rwd );
+}
+
+void SHMAPI::_sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr )
+{
+   if ( _net->batchWorkDone( dest, remoteWdAddr ) ) return;
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( remoteWdAddr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_AM_WORK_DONE, id, 0, 0, dest ); )
+   }
+   uint64_t args[] = { PTR_ARG( remoteWdAddr ) };
+   sendMessage( dest, MSG_WORK_DONE, args, 1 );
+}
+
+void SHMAPI::_put ( unsigned int issueNode, unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, std::size_t size, void *remoteTmpBuffer, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   _putStrided1D( issueNode, remoteNode, remoteAddr, localAddr, localAddr, size, 1, 0, remoteTmpBuffer, wdId, wd, hostObject, hostRegId, metaSeq );
+}
+
+void SHMAPI::_putStrided1D ( unsigned int issueNode, unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, void *localPack, std::size_t size, std::size_t count, std::size_t ld, void *remoteTmpBuffer, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   std::size_t realSize = size * count;
+   _txBytes += realSize;
+   _totalBytes += realSize;
+   NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+   NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+   NANOS_INSTRUMENT ( static nanos_event_key_t network_transfer_key = ID->getEventKey("network-transfer"); )
+   NANOS_INSTRUMENT( instr->raiseOpenBurstEvent( network_transfer_key, (nanos_event_value_t) remoteNode+1 ); )
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = realSize; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( remoteTmpBuffer ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_XFER_DATA, id, sizeKey, xferSize, remoteNode ); )
+   }
+   uint64_t args[] = { remoteAddr, size, count, ld, wdId, PTR_ARG( wd ), metaSeq, PTR_ARG( hostObject ), hostRegId, issueNode };
+   sendMessage( remoteNode, MSG_PUT, args, 10, localPack, realSize, remoteTmpBuffer );
+   NANOS_INSTRUMENT( sys.getInstrumentation()->raiseCloseBurstEvent( network_transfer_key, 0 ); )
+}
+
+void *SHMAPI::allocateTmpBuffer( unsigned int dest, std::size_t len )
+{
+   void *tmp = NULL;
+   while ( tmp == NULL ) {
+      _pinnedAllocatorsLocks[ dest ]->acquire();
+      tmp = _pinnedAllocators[ dest ]->allocate( len );
+      _pinnedAllocatorsLocks[ dest ]->release();
+      if ( tmp == NULL ) _net->poll(0);
+   }
+   return tmp;
+}
+
+void SHMAPI::putStrided1D ( unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, void *localPack, std::size_t size, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   void *tmp = allocateTmpBuffer( remoteNode, size * count );
+   _putStrided1D( _nodeNum, remoteNode, remoteAddr, localAddr, localPack, size, count, ld, tmp, wdId, wd, hostObject, hostRegId, metaSeq );
+}
+
+void SHMAPI::put ( unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, std::size_t size, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   void *tmp = allocateTmpBuffer( remoteNode, size );
+   _put( _nodeNum, remoteNode, remoteAddr, localAddr, size, tmp, wdId, wd, hostObject, hostRegId, metaSeq );
+}
+
+void SHMAPI::get ( void *localAddr, unsigned int remoteNode, uint64_t remoteAddr, std::size_t size, GetRequest *req, CopyData const &cd )
+{
+   getStrided1D( localAddr, remoteNode, remoteAddr, remoteAddr, size, 1, 0, ( GetRequestStrided * ) req, cd );
+}
+
+std::size_t SHMAPI::getMaxGetStridedLen() const {
+   return _segmentSize / 2;
+}
+
+void SHMAPI::getStrided1D ( void *packedAddr, unsigned int remoteNode, uint64_t remoteTag, uint64_t remoteAddr, std::size_t size, std::size_t count, std::size_t ld, GetRequestStrided *req, CopyData const &cd )
+{
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) req ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent ( NANOS_XFER_REQ, id, sizeKey, xferSize, remoteNode ); )
+   }
+
+   unsigned int seq_number = sys.getNetwork()->getPutRequestSequenceNumber( remoteNode );
+
+   std::size_t buffer_size = sizeof( SendDataGetRequestPayload ) + sizeof( nanos_region_dimension_internal_t ) * cd.getNumDimensions();
+   char *buffer = (char *) alloca( buffer_size );
+   new ( buffer ) SendDataGetRequestPayload( seq_number, packedAddr, (void *)remoteAddr, size, count, ld, req, cd );
+   nanos_region_dimension_internal_t *dims = ( nanos_region_dimension_internal_t * ) ( buffer + sizeof( SendDataGetRequestPayload ) );
+   ::memcpy( dims, cd.getDimensions(), sizeof( nanos_region_dimension_internal_t ) * cd.getNumDimensions() );
+
+   sendMessage( remoteNode, MSG_GET, NULL, 0, buffer, buffer_size );
+
+   _rxBytes += size * count;
+   _totalBytes += size * count;
+}
+
+void SHMAPI::malloc ( unsigned int remoteNode, std::size_t size, void * waitObjAddr )
+{
+   uint64_t args[] = { size, PTR_ARG( waitObjAddr ) };
+   sendMessage( remoteNode, MSG_MALLOC, args, 2 );
+}
+
+void SHMAPI::memRealloc ( unsigned int remoteNode, void *oldAddr, std::size_t oldSize, void *newAddr, std::size_t newSize )
+{
+   uint64_t args[] = { PTR_ARG( oldAddr ), oldSize, PTR_ARG( newAddr ), newSize };
+   sendMessage( remoteNode, MSG_REALLOC, args, 4 );
+}
+
+void SHMAPI::memFree ( unsigned int remoteNode, void *addr )
+{
+   uint64_t args[] = { PTR_ARG( addr ) };
+   sendMessage( remoteNode, MSG_FREE, args, 1 );
+}
+
+/* Sense-reversing barrier over the shared control block: the last node to
+ * arrive resets the counter and opens the next generation. Waiting nodes keep
+ * serving messages, like GASNet does while in a barrier. */
+void SHMAPI::nodeBarrier()
+{
+   unsigned int generation = _control->_barrierGeneration;
+   memoryFence();
+   if ( ++_control->_barrierArrived == _numNodes ) {
+      _control->_barrierArrived = 0;
+      memoryFence();
+      _control->_barrierGeneration = generation + 1;
+   } else {
+      while ( _control->_barrierGeneration == generation ) {
+         if ( myThread == NULL || myThread->_gasnetAllowAM ) {
+            pollMessages();
+         }
+      }
+   }
+   memoryFence();
+}
+
+void SHMAPI::sendMyHostName( unsigned int dest )
+{
+   const char *masterHostname = sys.getNetwork()->getMasterHostname();
+
+   if ( masterHostname == NULL )
+      fprintf(stderr, "Error, master hostname not set!\n" );
+
+   sendMessage( dest, MSG_MASTER_HOSTNAME, NULL, 0, masterHostname, ::strlen( masterHostname ) + 1 ); //+1 to add the last \0 character
+}
+
+void SHMAPI::sendRequestPut( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   sendRequestPutStrided1D( dest, origAddr, dataDest, dstAddr, len, 1, 0, wdId, wd, hostObject, hostRegId, metaSeq );
+}
+
+void SHMAPI::sendRequestPutStrided1D( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq )
+{
+   _totalBytes += ( len * count );
+   sendWaitForRequestPut( dataDest, dstAddr, wd->getHostId() );
+   unsigned int seq_number = sys.getNetwork()->getPutRequestSequenceNumber( dest );
+
+   void *tmpBuffer = allocateTmpBuffer( dataDest, len * count );
+
+   SendDataPutRequestPayload msg( _nodeNum, seq_number, (void *) origAddr, (void *) dstAddr, len, count, ld, dataDest, wdId, tmpBuffer, wd, hostObject, hostRegId, metaSeq );
+
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( ((uint64_t)tmpBuffer) ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_XFER_REQ, id, sizeKey, xferSize, dest ); )
+   }
+   sendMessage( dest, MSG_REQUEST_PUT, NULL, 0, &msg, sizeof( msg ) );
+}
+
+void SHMAPI::sendWaitForRequestPut( unsigned int dest, uint64_t addr, unsigned int wdId )
+{
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( addr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_XFER_WAIT_REQ_PUT, id, sizeKey, xferSize, dest ); )
+   }
+
+   unsigned int seq_number = sys.getNetwork()->getPutRequestSequenceNumber( dest );
+   uint64_t args[] = { addr, wdId, seq_number };
+   sendMessage( dest, MSG_WAIT_REQUEST_PUT, args, 3 );
+}
+
+void SHMAPI::sendFreeTmpBuffer( unsigned int dest, void *addr, WD const *wd )
+{
+   if ( _emitPtPEvents ) {
+      NANOS_INSTRUMENT ( static Instrumentation *instr = sys.getInstrumentation(); )
+      NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = instr->getInstrumentationDictionary(); )
+      NANOS_INSTRUMENT ( static nanos_event_key_t sizeKey = ID->getEventKey("xfer-size"); )
+      NANOS_INSTRUMENT ( nanos_event_value_t xferSize = 0; )
+      NANOS_INSTRUMENT ( nanos_event_id_t id = (nanos_event_id_t) ( addr ) ; )
+      NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_XFER_FREE_TMP_BUFF, id, sizeKey, xferSize, 0 ); )
+   }
+   uint64_t args[] = { PTR_ARG( addr ), PTR_ARG( wd ) };
+   sendMessage( dest, MSG_FREE_TMP_BUFFER, args, 2 );
+}
+
+void SHMAPI::sendRegionMetadata( unsigned int dest, CopyData *cd, unsigned int seq )
+{
+   std::size_t data_size = sizeof(CopyData) + cd->getNumDimensions() * sizeof(nanos_region_dimension_internal_t);
+   char *buffer = (char *) alloca(data_size);
+
+   ::memcpy(buffer, cd, sizeof(CopyData) );
+   ::memcpy(buffer + sizeof(CopyData), cd->getDimensions(), cd->getNumDimensions() * sizeof(nanos_region_dimension_internal_t));
+
+   uint64_t args[] = { seq };
+   sendMessage( dest, MSG_REGION_METADATA, args, 1, buffer, data_size );
+}
+
+void SHMAPI::sendBatch( unsigned int dest, void const *buf, std::size_t len )
+{
+   sendMessage( dest, MSG_BATCH, NULL, 0, buf, len );
+   _txBytes += len;
+}
+
+std::size_t SHMAPI::getMaxBatchLen() const
+{
+   return MAX_MEDIUM;
+}
+
+void SHMAPI::synchronizeDirectory( unsigned int dest, void *addr )
+{
+   uint64_t args[] = { PTR_ARG( addr ) };
+   sendMessage( dest, MSG_SYNCHRONIZE_DIRECTORY, args, 1 );
+}
+
+void SHMAPI::broadcastIdle()
+{
+   for ( unsigned int node = 0; node < _numNodes; node += 1 )
+   {
+      if ( node != _nodeNum )
+      {
+         sendMessage( node, MSG_IDLE, NULL, 0 );
+      }
+   }
+}
+
+std::size_t SHMAPI::getRxBytes()
+{
+   return _rxBytes;
+}
+
+std::size_t SHMAPI::getTxBytes()
+{
+   return _txBytes;
+}
+
+std::size_t SHMAPI::getTotalBytes()
+{
+   return _totalBytes;
+}
+
+SimpleAllocator *SHMAPI::getPackSegment() const {
+   return _packSegment;
+}
+
+void *SHMAPI::allocateReceiveMemory( std::size_t len ) {
+   void *addr = NULL;
+   do {
+      _receiveMemoryLock.acquire();
+      addr = _thisNodeSegment->allocate( len );
+      _receiveMemoryLock.release();
+      if ( addr == NULL ) myThread->idle();
+   } while (addr == NULL);
+   return addr;
+}
+
+void SHMAPI::freeReceiveMemory( void * addr ) {
+   _receiveMemoryLock.acquire();
+   _thisNodeSegment->free( addr );
+   _receiveMemoryLock.release();
+}
+
+unsigned int SHMAPI::getNumNodes() const {
+   return _numNodes;
+}
+
+unsigned int SHMAPI::getNodeNum() const {
+   return _nodeNum;
+}
+
+void SHMAPI::setNumNodes( unsigned int numNodes ) {
+   _numNodes = numNodes;
+}
+
+void SHMAPI::setSegmentSize( std::size_t segmentSize ) {
+   _segmentSize = segmentSize;
+}
+
+void SHMAPI::setUnalignedNodeMemory( bool flag ) {
+   _unalignedNodeMemory = flag;
+}
@@ -0,0 +1,338 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+
+#ifndef _SHMAPI_DECL
+#define _SHMAPI_DECL
+
+#include "basethread_decl.hpp"
+#include "networkapi.hpp"
+#include "network_decl.hpp"
+#include "simpleallocator_decl.hpp"
+#include "requestqueue_decl.hpp"
+#include "remoteworkdescriptor_decl.hpp"
+#include "atomic_decl.hpp"
+#include "lock_decl.hpp"
+#include <sys/types.h>
+#include <vector>
+#include <deque>
+#include <map>
+
+namespace nanos {
+namespace ext {
+
+   /*! \brief NetworkAPI that runs every cluster node as a process of the same host.
+    *
+    *  At initialization the process forks one child per extra node. All of them
+    *  share an anonymous mapping created before the fork, so it is placed at the
+    *  same address everywhere and segment addresses can be exchanged as they are
+    *  with GASNet. The mapping holds a node barrier, one single-producer /
+    *  single-consumer message ring per ordered pair of nodes and the
+    *  communication segment of each node. Messages mirror the GASNet active
+    *  messages: short and medium ones are copied into the ring, long ones copy
+    *  their data straight into the destination segment and only the header
+    *  travels through the ring.
+    */
+   class SHMAPI : public NetworkAPI
+   {
+      private:
+         static SHMAPI *_instance;
+         static SHMAPI *getInstance();
+
+         class DisableAM {
+            public:
+            DisableAM() {
+               if ( myThread != NULL ) {
+                  myThread->_gasnetAllowAM = false;
+               }
+            }
+            ~DisableAM() {
+               if ( myThread != NULL ) {
+                  myThread->_gasnetAllowAM = true;
+               }
+            }
+         };
+
+         enum MessageId {
+            MSG_PAD = 0,
+            MSG_FINALIZE,
+            MSG_WORK,
+            MSG_WORK_DATA,
+            MSG_WORK_DONE,
+            MSG_MALLOC,
+            MSG_MALLOC_REPLY,
+            MSG_MASTER_HOSTNAME,
+            MSG_PUT,
+            MSG_GET,
+            MSG_GET_REPLY,
+            MSG_REQUEST_PUT,
+            MSG_WAIT_REQUEST_PUT,
+            MSG_FREE,
+            MSG_REALLOC,
+            MSG_FREE_TMP_BUFFER,
+            MSG_REGION_METADATA,
+            MSG_SYNCHRONIZE_DIRECTORY,
+            MSG_IDLE,
+            MSG_BATCH,
+            MSG_COUNT
+         };
+
+         enum {
+            RING_SIZE = 1024 * 1024,  //!< Bytes of each message ring
+            MAX_MEDIUM = 64 * 1024    //!< Largest payload copied into a ring
+         };
+
+         typedef void ( *MessageHandler )( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+
+         //! Every ring record starts with this header, followed by the arguments and, for medium messages, the payload.
+         struct MessageHeader {
+            uint32_t _id;
+            uint32_t _numArgs;
+            uint64_t _len;
+            uint64_t _longAddr; //!< Destination of a long message payload, 0 otherwise
+         };
+
+         //! Ring positions only grow; the consumer owns _head and the producer owns _tail.
+         struct MessageRing {
+            volatile std::size_t _head;
+            char _headPad[ NANOS_CACHELINE - sizeof( std::size_t ) ];
+            volatile std::size_t _tail;
+            char _tailPad[ NANOS_CACHELINE - sizeof( std::size_t ) ];
+         };
+
+         struct SharedControl {
+            Atomic<unsigned int> _barrierArrived;
+            char _arrivedPad[ NANOS_CACHELINE - sizeof( Atomic<unsigned int> ) ];
+            volatile unsigned int _barrierGeneration;
+         };
+
+         class WorkBufferManager {
+            std::map<unsigned int, char *> _buffers;
+            Lock _lock;
+
+            public:
+            WorkBufferManager();
+            char *_add(unsigned int wdId, unsigned int num, std::size_t totalLen, std::size_t thisLen, char *buff );
+            char *get(unsigned int wdId, std::size_t totalLen, std::size_t thisLen, char *buff );
+         };
+
+         class SHMSendDataRequest : public SendDataRequest {
+            protected:
+            SHMAPI *_shmApi;
+            public:
+            SHMSendDataRequest( SHMAPI *api, unsigned int issueNode, unsigned int seqNumber, void *origAddr,
+                  void *destAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int dst, unsigned int wdId,
+                  void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         };
+
+         struct SendDataPutRequestPayload {
+            unsigned int  _issueNode;
+            unsigned int  _seqNumber;
+            void         *_origAddr;
+            void         *_destAddr;
+            std::size_t   _len;
+            std::size_t   _count;
+            std::size_t   _ld;
+            unsigned int  _destination;
+            unsigned int  _wdId;
+
+            void         *_tmpBuffer;
+            WD const     *_wd;
+            void         *_hostObject;
+            reg_t         _hostRegId;
+            unsigned int  _metaSeq;
+
+            SendDataPutRequestPayload ( unsigned int issueNode, unsigned int seqNumber,
+                  void *origAddr, void *dstAddr, std::size_t len, std::size_t count,
+                  std::size_t ld, unsigned int dest, unsigned int wdId, void *tmpBuffer,
+                  WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         };
+
+         struct SendDataGetRequestPayload {
+            unsigned int  _seqNumber;
+            void         *_origAddr;
+            void         *_destAddr;
+            std::size_t   _len;
+            std::size_t   _count;
+            std::size_t   _ld;
+            GetRequest   *_req;
+            CopyData      _cd;
+
+            SendDataGetRequestPayload ( unsigned int seqNumber, void *origAddr, void *dstAddr, std::size_t len, std::size_t count,
+               std::size_t ld, GetRequest *req, CopyData const &cd );
+         };
+
+         class SendDataPutRequest : public SHMSendDataRequest {
+            void *_tmpBuffer;
+            WD const *_wd;
+            public:
+            SendDataPutRequest( SHMAPI *api, SendDataPutRequestPayload *msg );
+            virtual ~SendDataPutRequest();
+            virtual void doSingleChunk();
+            virtual void doStrided( void *localAddr );
+         };
+
+         class SendDataGetRequest : public SHMSendDataRequest {
+            GetRequest *_req;
+            public:
+            CopyData _cd;
+            SendDataGetRequest( SHMAPI *api, unsigned int seqNumber, unsigned int dest, void *origAddr, void *destAddr, std::size_t len,
+            std::size_t count, std::size_t ld, GetRequest *req, CopyData const &cd, nanos_region_dimension_internal_t *dims );
+            virtual ~SendDataGetRequest();
+            virtual void doSingleChunk();
+            virtual void doStrided( void *localAddr );
+         };
+
+         struct FreeBufferRequest {
+            FreeBufferRequest(unsigned int dest, void *addr, WD const *w );
+            unsigned int destination;
+            void *address;
+            WD const * wd;
+         };
+
+         static MessageHandler _handlers[ MSG_COUNT ];
+
+         Network *_net;
+         unsigned int _numNodes;
+         unsigned int _nodeNum;
+         std::vector< pid_t > _nodePids;
+
+         char *_sharedArea;
+         std::size_t _sharedAreaSize;
+         SharedControl *_control;
+         char *_rings;
+         char *_segments;
+         std::size_t _segmentSize;
+         std::vector< Lock * > _sendLocks;
+         Lock _pollLock;
+         std::vector< std::size_t > _pollTails; //!< Snapshot of the incoming ring tails, guarded by _pollLock
+         std::deque< std::pair< unsigned int, char * > > _pendingMessages; //!< Records copied out of the rings and not handled yet, guarded by _pollLock
+         static __thread bool _polling; //!< The calling thread holds _pollLock and is running message handlers
+
+         SimpleAllocator *_thisNodeSegment;
+         SimpleAllocator *_packSegment;
+         std::vector< SimpleAllocator * > _pinnedAllocators;
+         std::vector< Lock * > _pinnedAllocatorsLocks;
+         Lock _receiveMemoryLock;
+         Atomic<unsigned int> *_seqN;
+
+         RequestQueue< SendDataRequest > _dataSendRequests;
+         RequestQueue< FreeBufferRequest > _freeBufferReqs;
+         RequestQueue< std::pair< void const *, unsigned int > > _workDoneReqs;
+
+         std::size_t _rxBytes;
+         std::size_t _txBytes;
+         std::size_t _totalBytes;
+
+         WorkBufferManager _incomingWorkBuffers;
+         bool _unalignedNodeMemory;
+
+      public:
+         typedef RemoteWorkDescriptor *ArchRWDs[4]; //0: smp, 1: cuda, 2: opencl, 3: fpga
+         ArchRWDs *_rwgs; //archs
+
+         SHMAPI();
+         ~SHMAPI();
+         void initialize ( Network *net );
+         void finalize ();
+         void finalizeNoBarrier ();
+         void poll ();
+         void sendExitMsg ( unsigned int dest );
+         void sendWorkMsg ( unsigned int dest, WorkDescriptor const &wd, std::size_t expectedData );
+         void sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr );
+         void put ( unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, std::size_t size, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void putStrided1D ( unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, void *localPack, std::size_t size, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void get ( void *localAddr, unsigned int remoteNode, uint64_t remoteAddr, std::size_t size, GetRequest *req, CopyData const &cd );
+         void getStrided1D ( void *packedAddr, unsigned int remoteNode, uint64_t remoteTag, uint64_t remoteAddr, std::size_t size, std::size_t count, std::size_t ld, GetRequestStrided *req, CopyData const &cd );
+         void malloc ( unsigned int remoteNode, std::size_t size, void *waitObjAddr );
+         void memFree ( unsigned int remoteNode, void *addr );
+         void memRealloc ( unsigned int remoteNode, void *oldAddr, std::size_t oldSize, void *newAddr, std::size_t newSize );
+         void nodeBarrier( void );
+
+         void sendMyHostName( unsigned int dest );
+         void sendRequestPut( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void sendRequestPutStrided1D( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void sendRegionMetadata( unsigned int dest, CopyData *cd, unsigned int seq );
+         void sendBatch( unsigned int dest, void const *buf, std::size_t len );
+         std::size_t getMaxBatchLen() const;
+
+         std::size_t getMaxGetStridedLen() const;
+         std::size_t getTotalBytes();
+         std::size_t getRxBytes();
+         std::size_t getTxBytes();
+         SimpleAllocator *getPackSegment() const;
+         void *allocateReceiveMemory( std::size_t len );
+         void freeReceiveMemory( void * addr );
+         void processSendDataRequest( SendDataRequest *req );
+         unsigned int getNumNodes() const;
+         unsigned int getNodeNum() const;
+         void synchronizeDirectory( unsigned int dest, void *addr );
+         void broadcastIdle();
+
+         //! Number of node processes to run, must be set before initialize()
+         void setNumNodes( unsigned int numNodes );
+         //! Communication segment size of each node, must be set before initialize()
+         void setSegmentSize( std::size_t segmentSize );
+         void setUnalignedNodeMemory( bool flag );
+
+      private:
+         MessageRing &getRing( unsigned int src, unsigned int dest ) const;
+         char *getRingData( MessageRing &ring ) const;
+         void sendMessage( unsigned int dest, MessageId id, uint64_t const *args, unsigned int numArgs,
+               void const *buf = NULL, std::size_t len = 0, void *longAddr = NULL );
+         void pollMessages();
+         void drainRings();
+         void waitForNodes();
+
+         void _put ( unsigned int issueNode, unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, std::size_t size, void *remoteTmpBuffer, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void _putStrided1D ( unsigned int issueNode, unsigned int remoteNode, uint64_t remoteAddr, void *localAddr, void *localPack, std::size_t size, std::size_t count, std::size_t ld, void *remoteTmpBuffer, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId, unsigned int metaSeq );
+         void _sendWorkDoneMsg ( unsigned int dest, void const *remoteWdAddr );
+         void *allocateTmpBuffer( unsigned int dest, std::size_t len );
+         void sendFreeTmpBuffer( unsigned int dest, void *addr, WD const *wd );
+         void sendWaitForRequestPut( unsigned int dest, uint64_t addr, unsigned int wdId );
+         void enqueueFreeBufferNotify( unsigned int dest, void *bufferAddr, WD const *wd );
+         void checkForPutReqs();
+         void checkForFreeBufferReqs();
+         void checkWorkDoneReqs();
+
+         // Message handlers
+         static void amFinalize( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amWork( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amWorkData( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amWorkDone( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amMalloc( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amMallocReply( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amMasterHostname( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amGet( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amGetReply( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amRequestPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amWaitRequestPut( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amFree( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amRealloc( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amFreeTmpBuffer( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amRegionMetadata( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amSynchronizeDirectory( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amIdle( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+         static void amBatch( unsigned int src, uint64_t const *args, void *buf, std::size_t len );
+   };
+} // namespace ext
+} // namespace nanos
+
+#endif /* _SHMAPI_DECL */
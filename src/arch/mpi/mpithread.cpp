@@ -158,8 +158,7 @@ bool MPIThread::deleteWd(WD* wd, bool markToDelete) {
     }
     //Delete the WD (only if we are not executing it, this should be mostly always)
     if (removable) {
-        wd->~WorkDescriptor();
-        delete[] (char *)wd;
+        sys.deleteWD( wd );
     } else if (markToDelete) {
         _wdMarkedToDelete.push_back(wd);
     }
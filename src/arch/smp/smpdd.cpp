@@ -25,6 +25,7 @@
 #include "taskexecutionexception.hpp"
 #include "smpdevice.hpp"
 #include "schedule.hpp"
+#include "smpstackpool.hpp"
 #include <string>
 
 using namespace nanos;
@@ -50,6 +51,8 @@ void SMPDD::prepareConfig ( Config &config )
    //! \note Get the stack size for this specific device
    config.registerConfigOption ( "smp-stack-size", NEW Config::SizeVar( _stackSize ), "Defines SMP::task stack size" );
    config.registerArgOption("smp-stack-size", "smp-stack-size");
+
+   SMPStackPool::prepareConfig( config );
 }
 
 void SMPDD::initStack ( WD *wd )
@@ -78,8 +81,8 @@ void SMPDD::lazyInit ( WD &wd, bool isUserLevelThread, WD *previous )
    verbose0("Task " << wd.getId() << " initialization"); 
    if (isUserLevelThread) {
       if (previous == NULL) {
-         _stack = (void *) NEW char[_stackSize];
-         verbose0("   new stack created: " << _stackSize << " bytes");
+         _stack = SMPStackPool::acquire( _stackSize );
+         verbose0("   new stack acquired: " << _stackSize << " bytes");
       } else {
          verbose0("   reusing stacks");
          SMPDD &oldDD = (SMPDD &) previous->getActiveDevice();
@@ -89,6 +92,11 @@ void SMPDD::lazyInit ( WD &wd, bool isUserLevelThread, WD *previous )
    }
 }
 
+SMPDD::~SMPDD()
+{
+   if ( _stack ) SMPStackPool::release( _stack, _stackSize );
+}
+
 SMPDD * SMPDD::copyTo ( void *toAddr )
 {
    SMPDD *dd = new (toAddr) SMPDD(*this);
@@ -27,13 +27,14 @@
 #include "processingelement_fwd.hpp"
 #include "copydescriptor.hpp"
 #include "system_decl.hpp"
-#include "smptransferqueue.hpp"
+#include "deviceops.hpp"
+#include "stridedcopy.hpp"
 #include "globalregt.hpp"
 
 namespace nanos {
 
-SMPDevice::SMPDevice ( const char *n ) : Device ( n ), _transferQueue() {}
-SMPDevice::SMPDevice ( const SMPDevice &arch ) : Device ( arch ), _transferQueue() {}
+SMPDevice::SMPDevice ( const char *n ) : Device ( n ), _transferEngine() {}
+SMPDevice::SMPDevice ( const SMPDevice &arch ) : Device ( arch ), _transferEngine() {}
 
 /*! \brief SMPDevice destructor
  */
@@ -68,7 +69,8 @@ std::size_t SMPDevice::getMemCapacity( SeparateMemoryAddressSpace &mem ) {
 
 void SMPDevice::_copyIn( uint64_t devAddr, uint64_t hostAddr, std::size_t len, SeparateMemoryAddressSpace &mem, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) devAddr), ((char *) hostAddr), len, 1, 0, true );
+      _transferEngine.addTransfer( ops, ((char *) devAddr), ((char *) hostAddr), len, 1, 0, SMPTransferEngine::COPY_IN,
+            _transferEngine.getMemorySpaceNumaNode( mem.getMemorySpaceId() ) );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
@@ -87,7 +89,7 @@ void SMPDevice::_copyIn( uint64_t devAddr, uint64_t hostAddr, std::size_t len, S
 
 void SMPDevice::_copyOut( uint64_t hostAddr, uint64_t devAddr, std::size_t len, SeparateMemoryAddressSpace &mem, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) hostAddr), ((char *) devAddr), len, 1, 0, true );
+      _transferEngine.addTransfer( ops, ((char *) hostAddr), ((char *) devAddr), len, 1, 0, SMPTransferEngine::COPY_OUT, -1 );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
@@ -111,7 +113,8 @@ void SMPDevice::_copyOut( uint64_t hostAddr, uint64_t devAddr, std::size_t len,
 
 bool SMPDevice::_copyDevToDev( uint64_t devDestAddr, uint64_t devOrigAddr, std::size_t len, SeparateMemoryAddressSpace &memDest, SeparateMemoryAddressSpace &memorig, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) devDestAddr), ((char *) devOrigAddr), len, 1, 0, true );
+      _transferEngine.addTransfer( ops, ((char *) devDestAddr), ((char *) devOrigAddr), len, 1, 0, SMPTransferEngine::COPY_DEV_TO_DEV,
+            _transferEngine.getMemorySpaceNumaNode( memDest.getMemorySpaceId() ) );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
@@ -134,15 +137,14 @@ bool SMPDevice::_copyDevToDev( uint64_t devDestAddr, uint64_t devOrigAddr, std::
 
 void SMPDevice::_copyInStrided1D( uint64_t devAddr, uint64_t hostAddr, std::size_t len, std::size_t numChunks, std::size_t ld, SeparateMemoryAddressSpace &mem, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) devAddr), ((char *) hostAddr), len, numChunks, ld, true );
+      _transferEngine.addTransfer( ops, ((char *) devAddr), ((char *) hostAddr), len, numChunks, ld, SMPTransferEngine::COPY_IN,
+            _transferEngine.getMemorySpaceNumaNode( mem.getMemorySpaceId() ) );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
       NANOS_INSTRUMENT ( static nanos_event_key_t key = ID->getEventKey("cache-copy-in"); )
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) 2 ); )
-      for ( std::size_t count = 0; count < numChunks; count += 1) {
-         ::memcpy( ((char *) devAddr) + count * ld, ((char *) hostAddr) + count * ld, len );
-      }
+      StridedCopy::copy( (void *) devAddr, ld, (void const *) hostAddr, ld, len, numChunks );
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseCloseBurstEvent( key, (nanos_event_value_t) 0 ); )
       ops->completeOp();
    }
@@ -150,15 +152,13 @@ void SMPDevice::_copyInStrided1D( uint64_t devAddr, uint64_t hostAddr, std::size
 
 void SMPDevice::_copyOutStrided1D( uint64_t hostAddr, uint64_t devAddr, std::size_t len, std::size_t numChunks, std::size_t ld, SeparateMemoryAddressSpace &mem, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) hostAddr), ((char *) devAddr), len, numChunks, ld, false );
+      _transferEngine.addTransfer( ops, ((char *) hostAddr), ((char *) devAddr), len, numChunks, ld, SMPTransferEngine::COPY_OUT, -1 );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
       NANOS_INSTRUMENT ( static nanos_event_key_t key = ID->getEventKey("cache-copy-out"); )
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) 2 ); )
-      for ( std::size_t count = 0; count < numChunks; count += 1) {
-         ::memcpy( ((char *) hostAddr) + count * ld, ((char *) devAddr) + count * ld, len );
-      }
+      StridedCopy::copy( (void *) hostAddr, ld, (void const *) devAddr, ld, len, numChunks );
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseCloseBurstEvent( key, (nanos_event_value_t) 0 ); )
       ops->completeOp();
    }
@@ -166,15 +166,14 @@ void SMPDevice::_copyOutStrided1D( uint64_t hostAddr, uint64_t devAddr, std::siz
 
 bool SMPDevice::_copyDevToDevStrided1D( uint64_t devDestAddr, uint64_t devOrigAddr, std::size_t len, std::size_t numChunks, std::size_t ld, SeparateMemoryAddressSpace &memDest, SeparateMemoryAddressSpace &memOrig, DeviceOps *ops, WD const *wd, void *hostObject, reg_t hostRegionId ) {
    if ( sys.getSMPPlugin()->asyncTransfersEnabled() ) {
-      _transferQueue.addTransfer( ops, ((char *) devDestAddr), ((char *) devOrigAddr), len, numChunks, ld, true );
+      _transferEngine.addTransfer( ops, ((char *) devDestAddr), ((char *) devOrigAddr), len, numChunks, ld, SMPTransferEngine::COPY_DEV_TO_DEV,
+            _transferEngine.getMemorySpaceNumaNode( memDest.getMemorySpaceId() ) );
    } else {
       ops->addOp();
       NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
       NANOS_INSTRUMENT ( static nanos_event_key_t key = ID->getEventKey("cache-copy-in"); )
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) 2 ); )
-      for ( std::size_t count = 0; count < numChunks; count += 1) {
-         ::memcpy( ((char *) devDestAddr) + count * ld, ((char *) devOrigAddr) + count * ld, len );
-      }
+      StridedCopy::copy( (void *) devDestAddr, ld, (void const *) devOrigAddr, ld, len, numChunks );
       NANOS_INSTRUMENT( sys.getInstrumentation()->raiseCloseBurstEvent( key, (nanos_event_value_t) 0 ); )
       ops->completeOp();
    }
@@ -187,7 +186,11 @@ void SMPDevice::_getFreeMemoryChunksList( SeparateMemoryAddressSpace &mem, Simpl
 }
 
 void SMPDevice::tryExecuteTransfer() {
-   _transferQueue.tryExecuteOne();
+   _transferEngine.tryExecuteChunk();
+}
+
+SMPTransferEngine &SMPDevice::getTransferEngine() {
+   return _transferEngine;
 }
 
 } // namespace nanos
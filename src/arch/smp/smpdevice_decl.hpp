@@ -26,7 +26,7 @@
 #include "workdescriptor_decl.hpp"
 #include "processingelement_fwd.hpp"
 #include "copydescriptor.hpp"
-#include "smptransferqueue_decl.hpp"
+#include "smptransferengine_decl.hpp"
 
 namespace nanos {
 
@@ -35,7 +35,7 @@ namespace nanos {
    */
    class SMPDevice : public Device
    {
-      SMPTransferQueue _transferQueue;
+      SMPTransferEngine _transferEngine;
       public:
          /*! \brief SMPDevice constructor
           */
@@ -73,6 +73,8 @@ namespace nanos {
 
          void tryExecuteTransfer();
 
+         SMPTransferEngine &getTransferEngine();
+
    };
 } // namespace nanos
 
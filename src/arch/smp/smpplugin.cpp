@@ -26,6 +26,8 @@
 // #include "smpbaseplugin_decl.hpp"
 // #include "plugin.hpp"
 #include "smpprocessor.hpp"
+#include "smpstackpool.hpp"
+#include "smpdevice_decl.hpp"
 #include "os.hpp"
 #include "osallocator_decl.hpp"
 
@@ -70,6 +72,8 @@ nanos::PE * smpProcessorFactory ( int id, int uid )
                  , _memkindSupport( false )
                  , _memkindMemorySize( 1024*1024*1024 ) // 1Gb
                  , _asyncSMPTransfers( true )
+                 , _transferChunkSize( 64 * 1024 )
+                 , _transferStreamingThreshold( 0 )
    {}
 
    SMPPlugin::~SMPPlugin() {
@@ -152,12 +156,23 @@ nanos::PE * smpProcessorFactory ( int id, int uid )
             "SMP sync transfers." );
       cfg.registerArgOption( "smp-sync-transfers", "smp-sync-transfers" );
       cfg.registerEnvOption( "smp-sync-transfers", "NX_SMP_SYNC_TRANSFERS" );
+
+      cfg.registerConfigOption( "smp-transfer-chunk-size", NEW Config::SizeVar( _transferChunkSize ),
+            "Size of the pieces in which asynchronous SMP transfers are split among idle threads." );
+      cfg.registerArgOption( "smp-transfer-chunk-size", "smp-transfer-chunk-size" );
+      cfg.registerEnvOption( "smp-transfer-chunk-size", "NX_SMP_TRANSFER_CHUNK_SIZE" );
+
+      cfg.registerConfigOption( "smp-transfer-streaming-threshold", NEW Config::SizeVar( _transferStreamingThreshold ),
+            "SMP transfers of at least this size use non-temporal stores (default: size of the last level cache)." );
+      cfg.registerArgOption( "smp-transfer-streaming-threshold", "smp-transfer-streaming-threshold" );
+      cfg.registerEnvOption( "smp-transfer-streaming-threshold", "NX_SMP_TRANSFER_STREAMING_THRESHOLD" );
    }
 
    void SMPPlugin::init()
    {
       sys.setHostFactory( smpProcessorFactory );
       sys.setSMPPlugin( this );
+      ext::getSMPDevice().getTransferEngine().configure( _transferChunkSize, _transferStreamingThreshold );
 
       //! \note Set initial CPU architecture variables
       _cpuSystemMask = OS::getSystemAffinity();
@@ -256,6 +271,7 @@ nanos::PE * smpProcessorFactory ( int id, int uid )
             SeparateMemoryAddressSpace &numaMem = sys.getSeparateMemory( id );
             numaMem.setSpecificData( NEW SimpleAllocator( ( uintptr_t ) a.allocate(_smpPrivateMemorySize), _smpPrivateMemorySize ) );
             numaMem.setAcceleratorNumber( sys.getNewAcceleratorId() );
+            ext::getSMPDevice().getTransferEngine().setMemorySpaceNumaNode( id, numaNode );
             cpu = NEW SMPProcessor( *it, id, active, numaNode, socket );
          } else {
 
@@ -334,6 +350,9 @@ nanos::PE * smpProcessorFactory ( int id, int uid )
    void SMPPlugin::initialize() { }
 
    void SMPPlugin::finalize() {
+      if ( sys.isSummaryEnabled() ) SMPStackPool::printStats();
+      SMPStackPool::finalize();
+
       if ( _memkindSupport ) {
          SeparateMemoryAddressSpace &mem = sys.getSeparateMemory( 1 );
          std::cerr << "memkind: SMP soft replacements: " << mem.getSoftInvalidationCount() << std::endl;
@@ -365,6 +384,9 @@ nanos::PE * smpProcessorFactory ( int id, int uid )
          std::cerr << "Total IN bytes: " << total_in << std::endl;
          std::cerr << "Total OUT bytes: " << total_out << std::endl;
       }
+      if ( ( _memkindSupport || _smpPrivateMemory ) && _asyncSMPTransfers ) {
+         ext::getSMPDevice().getTransferEngine().printStats( std::cerr );
+      }
    }
 
    void SMPPlugin::addPEs( std::map<unsigned int, ProcessingElement *> &pes ) const
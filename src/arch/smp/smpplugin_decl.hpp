@@ -83,6 +83,8 @@ class SMPPlugin : public SMPBasePlugin
    bool                         _memkindSupport;
    std::size_t                  _memkindMemorySize;
    bool                         _asyncSMPTransfers;
+   std::size_t                  _transferChunkSize;
+   std::size_t                  _transferStreamingThreshold;
 
    public:
    SMPPlugin();
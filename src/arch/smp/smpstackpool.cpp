@@ -0,0 +1,147 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "smpstackpool.hpp"
+#include "config.hpp"
+#include "debug.hpp"
+#include "system.hpp"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+using namespace nanos;
+using namespace nanos::ext;
+
+bool SMPStackPool::_enabled = true;
+int SMPStackPool::_hotStacks = 16;
+// Set by prepareConfig(): the runtime starts from the constructor of sys, which may run
+// before the dynamic initializers of this file
+size_t SMPStackPool::_pageSize = 0;
+size_t SMPStackPool::_guardSize = 0;
+
+__thread SMPStackPool * SMPStackPool::_myPool = NULL;
+
+// Zero-initialized, for the same reason
+Atomic<SMPStackPool *> SMPStackPool::_pools;
+Atomic<int> SMPStackPool::_totalInUse;
+Atomic<int> SMPStackPool::_peakInUse;
+
+void SMPStackPool::prepareConfig ( Config &config )
+{
+   _pageSize = (size_t) sysconf( _SC_PAGESIZE );
+   _guardSize = _pageSize;
+
+   config.registerConfigOption ( "smp-stack-pool", NEW Config::FlagOption( _enabled ),
+                                 "Allocates SMP task stacks from per-thread pools of guarded mmap'd stacks" );
+   config.registerArgOption( "smp-stack-pool", "smp-stack-pool" );
+
+   config.registerConfigOption ( "smp-stack-pool-hot", NEW Config::IntegerVar( _hotStacks ),
+                                 "Free stacks each thread keeps committed; pages of older ones are returned to the OS" );
+   config.registerArgOption( "smp-stack-pool-hot", "smp-stack-pool-hot" );
+}
+
+void * SMPStackPool::map ( size_t size )
+{
+   // MAP_NORESERVE: pages are committed as the task touches them
+   char *addr = (char *) mmap( NULL, size + _guardSize, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+   if ( addr == MAP_FAILED ) fatal( "Could not map a task stack of " << size << " bytes: " << strerror( errno ) );
+
+   // Stacks grow downwards: the guard page sits at the lowest address
+   if ( mprotect( addr, _guardSize, PROT_NONE ) != 0 ) {
+      warning0( "Could not protect the guard page of a task stack: " << strerror( errno ) );
+   }
+
+   return addr + _guardSize;
+}
+
+void SMPStackPool::updatePeak ( int inUse )
+{
+   int peak = _peakInUse.value();
+   while ( inUse > peak && !_peakInUse.cswap( peak, inUse ) ) {
+      peak = _peakInUse.value();
+   }
+}
+
+void * SMPStackPool::get ( size_t size )
+{
+   void *stack;
+
+   if ( !_free.empty() ) {
+      stack = _free.back()._stack;
+      _free.pop_back();
+      _recycled++;
+   } else {
+      stack = map( size );
+      _created++;
+   }
+
+   _inUse++;
+   if ( sys.isSummaryEnabled() ) updatePeak( ++_totalInUse );
+   return stack;
+}
+
+void SMPStackPool::put ( void *stack, size_t size )
+{
+   _inUse--;
+   if ( sys.isSummaryEnabled() ) _totalInUse--;
+   _free.push_back( FreeStack( stack, size ) );
+
+   // The stack that has just left the hot part of the pool gives its pages back
+   if ( _hotStacks >= 0 && _free.size() > (size_t) _hotStacks ) {
+      FreeStack &cold = _free[ _free.size() - 1 - _hotStacks ];
+      if ( !cold._cold ) {
+         madvise( cold._stack, size, MADV_DONTNEED );
+         cold._cold = true;
+         _trimmed++;
+      }
+   }
+}
+
+void SMPStackPool::printStats ( void )
+{
+   if ( !_enabled ) return;
+
+   int created = 0, recycled = 0, trimmed = 0, in_use = 0;
+   for ( SMPStackPool *pool = _pools.value(); pool != NULL; pool = pool->_next ) {
+      created += pool->_created;
+      recycled += pool->_recycled;
+      trimmed += pool->_trimmed;
+      in_use += pool->_inUse;
+   }
+   int acquired = created + recycled;
+
+   message0( "=== SMP task stacks: " << created << " mapped, " << _peakInUse.value() << " peak in use, "
+             << in_use << " in use at exit" );
+   message0( "=== SMP task stacks: " << recycled << "/" << acquired << " acquisitions recycled ("
+             << ( acquired > 0 ? ( 100.0 * recycled ) / acquired : 0.0 ) << "%), "
+             << trimmed << " returned to the OS" );
+}
+
+void SMPStackPool::finalize ( void )
+{
+   // Pools are kept: stacks still in use may be released later on
+   for ( SMPStackPool *pool = _pools.value(); pool != NULL; pool = pool->_next ) {
+      for ( FreeList::iterator it = pool->_free.begin(); it != pool->_free.end(); it++ ) {
+         munmap( ( char * ) it->_stack - _guardSize, it->_size + _guardSize );
+      }
+      pool->_free.clear();
+   }
+}
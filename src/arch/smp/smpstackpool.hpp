@@ -0,0 +1,65 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SMP_STACK_POOL
+#define _NANOS_SMP_STACK_POOL
+
+#include "smpstackpool_decl.hpp"
+#include "atomic.hpp"
+#include "new_decl.hpp"
+
+namespace nanos {
+namespace ext {
+
+inline SMPStackPool & SMPStackPool::myPool ( void )
+{
+   if ( _myPool == NULL ) {
+      SMPStackPool *pool = NEW SMPStackPool();
+      do {
+         pool->_next = _pools.value();
+      } while ( !_pools.cswap( pool->_next, pool ) );
+      _myPool = pool;
+   }
+   return *_myPool;
+}
+
+inline size_t SMPStackPool::roundSize ( size_t size )
+{
+   return ( size + _pageSize - 1 ) & ~( _pageSize - 1 );
+}
+
+inline void * SMPStackPool::acquire ( size_t size )
+{
+   if ( !_enabled ) return (void *) NEW char[size];
+   return myPool().get( roundSize( size ) );
+}
+
+inline void SMPStackPool::release ( void *stack, size_t size )
+{
+   if ( !_enabled ) {
+      delete[] (char *) stack;
+      return;
+   }
+   myPool().put( stack, roundSize( size ) );
+}
+
+} // namespace ext
+} // namespace nanos
+
+#endif
@@ -0,0 +1,114 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SMP_STACK_POOL_DECL
+#define _NANOS_SMP_STACK_POOL_DECL
+
+#include <stddef.h>
+#include <vector>
+#include "atomic_decl.hpp"
+#include "config_fwd.hpp"
+
+namespace nanos {
+namespace ext {
+
+   /*! \class SMPStackPool
+    *  \brief Per-thread pool of user-level thread stacks.
+    *
+    *  Stacks are reserved with mmap and carry a PROT_NONE guard page below their usable area,
+    *  so an overflow faults instead of corrupting a neighbour. Pages are only committed when
+    *  the task touches them. Released stacks go to the pool of the releasing thread and are
+    *  handed out again in LIFO order, so the next task gets the stack whose pages are most
+    *  likely still cached. Stacks that sink below the hot limit of a pool are given back to the
+    *  OS with madvise(MADV_DONTNEED) while keeping their mapping for later reuse.
+    *
+    *  Statistics are kept per pool and only added up by printStats(). Stacks in use are also
+    *  counted globally (to get their peak) in summary mode only.
+    */
+   class SMPStackPool
+   {
+      private:
+         struct FreeStack
+         {
+            void  *_stack;   /**< Usable base of the stack */
+            size_t _size;    /**< Usable size of the stack */
+            bool   _cold;    /**< Pages already returned to the OS */
+
+            FreeStack ( void *stack, size_t size ) : _stack( stack ), _size( size ), _cold( false ) {}
+         };
+
+         typedef std::vector<FreeStack> FreeList;
+
+         FreeList             _free;          /**< Released stacks, hottest at the back */
+         SMPStackPool        *_next;          /**< Next pool in the list of all the pools */
+         int                  _inUse;         /**< Stacks acquired minus stacks released through this pool */
+         int                  _created;       /**< Stacks mapped by this pool */
+         int                  _recycled;      /**< Acquisitions served from this pool */
+         int                  _trimmed;       /**< Stacks whose pages were returned to the OS */
+
+         static bool          _enabled;       /**< Use mmap'd pooled stacks (heap stacks otherwise) */
+         static int           _hotStacks;     /**< Free stacks kept committed per thread */
+         static size_t        _pageSize;
+         static size_t        _guardSize;
+
+         static __thread SMPStackPool *_myPool;
+         static Atomic<SMPStackPool *> _pools; /**< List of all the pools */
+
+         static Atomic<int>   _totalInUse;    /**< Stacks currently owned by a task (summary mode only) */
+         static Atomic<int>   _peakInUse;
+
+         // disable copy constructor and assignment operator
+         SMPStackPool ( const SMPStackPool & );
+         const SMPStackPool & operator= ( const SMPStackPool & );
+
+         SMPStackPool () : _free(), _next( NULL ), _inUse( 0 ), _created( 0 ), _recycled( 0 ), _trimmed( 0 ) {}
+
+         /*! \brief Returns the pool of the calling thread, creating it on first use */
+         static SMPStackPool & myPool ( void );
+
+         void * get ( size_t size );
+         void put ( void *stack, size_t size );
+
+         /*! \brief Rounds a stack size up to whole pages */
+         static size_t roundSize ( size_t size );
+         static void * map ( size_t size );
+         static void updatePeak ( int inUse );
+
+      public:
+         /*! \brief Registers the pool configuration options */
+         static void prepareConfig ( Config &config );
+
+         /*! \brief Returns a stack of (at least) size bytes */
+         static void * acquire ( size_t size );
+         /*! \brief Gives back a stack obtained from acquire() with the same size */
+         static void release ( void *stack, size_t size );
+
+         /*! \brief Prints the pool statistics */
+         static void printStats ( void );
+         /*! \brief Unmaps the free stacks of all the pools
+          *
+          *  Threads must not be using the pools anymore (e.g. they have already been joined).
+          */
+         static void finalize ( void );
+   };
+
+} // namespace ext
+} // namespace nanos
+
+#endif
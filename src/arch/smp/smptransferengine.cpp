@@ -0,0 +1,262 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include <unistd.h>
+#include <iomanip>
+#include <algorithm>
+#include "smptransferengine_decl.hpp"
+#include "atomic.hpp"
+#include "lock.hpp"
+#include "deviceops.hpp"
+#include "system.hpp"
+#include "basethread.hpp"
+#include "processingelement.hpp"
+#include "location.hpp"
+#include "instrumentation.hpp"
+#include "stridedcopy.hpp"
+#include "os.hpp"
+
+using namespace nanos;
+
+namespace {
+
+/* Time a transfer waits for a worker of its NUMA node before any worker may take it */
+const double STEAL_DELAY = 20e-6;
+
+const char *directionName[ SMPTransferEngine::DIRECTIONS ] = { "IN", "OUT", "DEV2DEV" };
+
+void copyVerbose ( char *dst, char *src, std::size_t len, std::size_t count, std::size_t ld )
+{
+   for ( std::size_t idx = 0; idx < count; idx += 1 ) {
+      char *rowDst = dst + idx * ld;
+      char *rowSrc = src + idx * ld;
+      if ( sys.getVerboseDevOps() ) {
+         std::cerr << "memcpy( " << (void *) rowDst << ", " << (void *) rowSrc << ", " << len << " ) [ld= " << ld << " count= " << count << " _dst= " << (void *) dst << " _src= " << (void *) src << " ]" << std::endl;
+      }
+      if ( sys._watchAddr != NULL ) {
+         if ( (uint64_t) sys._watchAddr >= (uint64_t) rowDst && (uint64_t) sys._watchAddr < (uint64_t) ( rowDst + len ) ) {
+            *myThread->_file << "WATCH update: old value " << *( (double *) sys._watchAddr ) << std::endl;
+         }
+         if ( (uint64_t) sys._watchAddr >= (uint64_t) rowSrc && (uint64_t) sys._watchAddr < (uint64_t) ( rowSrc + len ) ) {
+            *myThread->_file << "WATCH read: value " << *( (double *) sys._watchAddr ) << std::endl;
+         }
+      }
+      ::memcpy( rowDst, rowSrc, len );
+      if ( sys._watchAddr != NULL ) {
+         if ( (uint64_t) sys._watchAddr >= (uint64_t) rowDst && (uint64_t) sys._watchAddr < (uint64_t) ( rowDst + len ) ) {
+            *myThread->_file << "WATCH update: new value " << *( (double *) sys._watchAddr ) << std::endl;
+         }
+      }
+   }
+}
+
+} // namespace
+
+SMPTransferEngine::SMPTransferEngine () : _lock(), _jobs(), _numJobs( 0 ), _chunkSize( 64 * 1024 ),
+   _streamingThreshold( 0 ), _memorySpaceNodes()
+{
+}
+
+SMPTransferEngine::~SMPTransferEngine ()
+{
+   for ( JobList::iterator it = _jobs.begin(); it != _jobs.end(); it++ ) {
+      delete *it;
+   }
+}
+
+void SMPTransferEngine::configure ( std::size_t chunkSize, std::size_t streamingThreshold )
+{
+   _chunkSize = chunkSize > 0 ? chunkSize : 64 * 1024;
+   _streamingThreshold = streamingThreshold > 0 ? streamingThreshold : getLastLevelCacheSize();
+}
+
+void SMPTransferEngine::setMemorySpaceNumaNode ( memory_space_id_t id, int node )
+{
+   if ( id >= _memorySpaceNodes.size() ) {
+      _memorySpaceNodes.resize( id + 1, -1 );
+   }
+   _memorySpaceNodes[ id ] = node;
+}
+
+int SMPTransferEngine::getMemorySpaceNumaNode ( memory_space_id_t id ) const
+{
+   return id < _memorySpaceNodes.size() ? _memorySpaceNodes[ id ] : -1;
+}
+
+void SMPTransferEngine::addTransfer ( DeviceOps *ops, char *dst, char *src, std::size_t len, std::size_t count, std::size_t ld,
+      Direction direction, int numaNode )
+{
+   ops->addOp();
+
+   Job *job = NEW Job;
+   job->_ops = ops;
+   job->_dst = dst;
+   job->_src = src;
+   job->_len = len;
+   job->_count = count;
+   job->_ld = ld;
+   job->_direction = direction;
+   job->_numaNode = numaNode;
+   job->_streaming = _streamingThreshold > 0 && len * count >= _streamingThreshold;
+   if ( count == 1 ) {
+      job->_chunkLen = _chunkSize;
+      job->_numChunks = ( len + _chunkSize - 1 ) / _chunkSize;
+   } else {
+      job->_chunkLen = len >= _chunkSize ? 1 : _chunkSize / len;
+      job->_numChunks = ( count + job->_chunkLen - 1 ) / job->_chunkLen;
+   }
+   if ( job->_numChunks == 0 ) job->_numChunks = 1;
+   job->_nextChunk = 0;
+   job->_pendingChunks = job->_numChunks;
+   job->_enqueueTime = OS::getMonotonicTime();
+   job->_startTime = 0.0;
+
+   _lock.acquire();
+   _jobs.push_back( job );
+   _numJobs++;
+   _lock.release();
+}
+
+bool SMPTransferEngine::tryExecuteChunk ()
+{
+   if ( _numJobs.value() == 0 ) return false;
+
+   int myNode = (int) myThread->runningOn()->getNumaNode();
+   Job *job = NULL;
+   unsigned int chunk = 0;
+   bool remote = false;
+
+   _lock.acquire();
+   JobList::iterator it;
+   for ( it = _jobs.begin(); it != _jobs.end(); it++ ) {
+      if ( (*it)->_numaNode < 0 || (*it)->_numaNode == myNode ) break;
+   }
+   if ( it == _jobs.end() && !_jobs.empty() ) {
+      double now = OS::getMonotonicTime();
+      for ( it = _jobs.begin(); it != _jobs.end(); it++ ) {
+         if ( now - (*it)->_enqueueTime >= STEAL_DELAY ) {
+            remote = true;
+            break;
+         }
+      }
+   }
+   if ( it != _jobs.end() ) {
+      job = *it;
+      chunk = job->_nextChunk++;
+      if ( chunk == 0 ) {
+         job->_startTime = OS::getMonotonicTime();
+      }
+      if ( job->_nextChunk == job->_numChunks ) {
+         _jobs.erase( it );
+         _numJobs--;
+      }
+   }
+   _lock.release();
+
+   if ( job == NULL ) return false;
+
+   DirectionStats &stats = _stats[ job->_direction ];
+   executeChunk( *job, chunk );
+   stats._chunks++;
+   if ( remote ) stats._remoteChunks++;
+
+   // Only the worker that copies the last chunk may touch the job afterwards
+   if ( --job->_pendingChunks == 0 ) {
+      completeJob( *job );
+   }
+   return true;
+}
+
+void SMPTransferEngine::executeChunk ( Job &job, unsigned int chunk )
+{
+   char *dst, *src;
+   std::size_t len, count;
+
+   if ( job._count == 1 ) {
+      std::size_t offset = chunk * job._chunkLen;
+      dst = job._dst + offset;
+      src = job._src + offset;
+      len = std::min( job._chunkLen, job._len - offset );
+      count = 1;
+   } else {
+      std::size_t row = chunk * job._chunkLen;
+      dst = job._dst + row * job._ld;
+      src = job._src + row * job._ld;
+      len = job._len;
+      count = std::min( job._chunkLen, job._count - row );
+   }
+
+   NANOS_INSTRUMENT ( static InstrumentationDictionary *ID = sys.getInstrumentation()->getInstrumentationDictionary(); )
+   NANOS_INSTRUMENT ( static nanos_event_key_t key_in = ID->getEventKey("cache-copy-in"); )
+   NANOS_INSTRUMENT ( static nanos_event_key_t key_out = ID->getEventKey("cache-copy-out"); )
+   NANOS_INSTRUMENT ( nanos_event_key_t key = job._direction == COPY_OUT ? key_out : key_in; )
+   NANOS_INSTRUMENT( sys.getInstrumentation()->raiseOpenBurstEvent( key, (nanos_event_value_t) len * count ); )
+   if ( sys.getVerboseDevOps() || sys._watchAddr != NULL ) {
+      copyVerbose( dst, src, len, count, job._ld );
+   } else if ( job._streaming ) {
+      StridedCopy::copyStreaming( dst, job._ld, src, job._ld, len, count );
+   } else {
+      StridedCopy::copy( dst, job._ld, src, job._ld, len, count );
+   }
+   NANOS_INSTRUMENT( sys.getInstrumentation()->raiseCloseBurstEvent( key, (nanos_event_value_t) 0 ); )
+}
+
+void SMPTransferEngine::completeJob ( Job &job )
+{
+   DirectionStats &stats = _stats[ job._direction ];
+   std::size_t bytes = job._len * job._count;
+   stats._transfers++;
+   stats._bytes += bytes;
+   if ( job._streaming ) stats._streamedBytes += bytes;
+   stats._busyNs += (uint64_t) ( ( OS::getMonotonicTime() - job._startTime ) * 1e9 );
+
+   job._ops->completeOp();
+   delete &job;
+}
+
+void SMPTransferEngine::printStats ( std::ostream &o ) const
+{
+   std::ios_base::fmtflags flags = o.flags();
+   std::streamsize precision = o.precision();
+   for ( unsigned int dir = 0; dir < DIRECTIONS; dir += 1 ) {
+      DirectionStats const &stats = _stats[ dir ];
+      uint64_t bytes = stats._bytes.value();
+      if ( bytes == 0 ) continue;
+      double seconds = (double) stats._busyNs.value() * 1e-9;
+      o << "SMP transfers " << directionName[ dir ] << ": " << stats._transfers.value() << " transfers, "
+        << bytes << " bytes (" << stats._streamedBytes.value() << " streamed), "
+        << stats._chunks.value() << " chunks (" << stats._remoteChunks.value() << " by remote NUMA workers), "
+        << std::fixed << std::setprecision( 1 ) << ( seconds > 0.0 ? (double) bytes / seconds / 1e6 : 0.0 ) << " MB/s"
+        << std::endl;
+   }
+   o.flags( flags );
+   o.precision( precision );
+}
+
+std::size_t SMPTransferEngine::getLastLevelCacheSize ()
+{
+   long size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+   size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+#endif
+#ifdef _SC_LEVEL2_CACHE_SIZE
+   if ( size <= 0 ) size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+   return size > 0 ? (std::size_t) size : 8 * 1024 * 1024;
+}
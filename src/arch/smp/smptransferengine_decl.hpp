@@ -0,0 +1,131 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SMP_TRANSFER_ENGINE_DECL
+#define _NANOS_SMP_TRANSFER_ENGINE_DECL
+
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <vector>
+#include <ostream>
+#include "atomic_decl.hpp"
+#include "lock_decl.hpp"
+#include "deviceops_fwd.hpp"
+#include "nanos-int.h"
+
+namespace nanos {
+
+   /*! \class SMPTransferEngine
+    *  \brief Asynchronous copies between SMP memory spaces, executed by idle worker threads.
+    *
+    *  Every transfer is split in chunks (contiguous pieces, or groups of rows for strided
+    *  copies) that idle workers claim one at a time, so a large copy is moved by as many
+    *  threads as are idle. A transfer whose destination lives on a known NUMA node is
+    *  only served by workers of that node, which also makes the first touch of private
+    *  memory land there; workers of other nodes help once it has waited for longer than a
+    *  short grace period. Transfers larger than the last level cache are written with
+    *  non-temporal stores. The DeviceOps of a transfer is completed by the worker that
+    *  finishes its last chunk.
+    */
+   class SMPTransferEngine
+   {
+      public:
+         enum Direction { COPY_IN = 0, COPY_OUT, COPY_DEV_TO_DEV, DIRECTIONS };
+
+      private:
+         struct Job
+         {
+            DeviceOps        *_ops;
+            char             *_dst;
+            char             *_src;
+            std::size_t       _len;
+            std::size_t       _count;
+            std::size_t       _ld;
+            Direction         _direction;
+            int               _numaNode;      /**< NUMA node of the destination, -1 if any node is fine */
+            bool              _streaming;     /**< Write with non-temporal stores */
+            std::size_t       _chunkLen;      /**< Bytes per chunk (count == 1) or rows per chunk (count > 1) */
+            unsigned int      _numChunks;
+            unsigned int      _nextChunk;     /**< Next chunk to be claimed, protected by the engine lock */
+            Atomic<unsigned int> _pendingChunks; /**< Chunks not yet copied */
+            double            _enqueueTime;
+            double            _startTime;     /**< Time the first chunk was claimed */
+         };
+
+         struct DirectionStats
+         {
+            Atomic<uint64_t>  _transfers;
+            Atomic<uint64_t>  _bytes;
+            Atomic<uint64_t>  _chunks;
+            Atomic<uint64_t>  _remoteChunks;  /**< Chunks copied by a worker of another NUMA node */
+            Atomic<uint64_t>  _streamedBytes;
+            Atomic<uint64_t>  _busyNs;        /**< Sum of the time from first claim to completion of every transfer */
+
+            DirectionStats () : _transfers( 0 ), _bytes( 0 ), _chunks( 0 ), _remoteChunks( 0 ), _streamedBytes( 0 ), _busyNs( 0 ) {}
+         };
+
+         typedef std::list<Job *> JobList;
+
+         Lock                 _lock;
+         JobList              _jobs;               /**< Transfers with chunks left to claim */
+         Atomic<unsigned int> _numJobs;
+         std::size_t          _chunkSize;
+         std::size_t          _streamingThreshold; /**< Transfers of at least this size use non-temporal stores */
+         std::vector<int>     _memorySpaceNodes;   /**< NUMA node of each SMP private memory space */
+         DirectionStats       _stats[DIRECTIONS];
+
+         // disable copy constructor and assignment operator
+         SMPTransferEngine ( const SMPTransferEngine & );
+         const SMPTransferEngine & operator= ( const SMPTransferEngine & );
+
+         void executeChunk ( Job &job, unsigned int chunk );
+         void completeJob ( Job &job );
+
+      public:
+         SMPTransferEngine ();
+         ~SMPTransferEngine ();
+
+         /*! \brief Sets the chunk size and the size above which non-temporal stores are used
+          *  (0 selects the size of the last level cache)
+          */
+         void configure ( std::size_t chunkSize, std::size_t streamingThreshold );
+
+         /*! \brief Records the NUMA node that holds the memory space \a id */
+         void setMemorySpaceNumaNode ( memory_space_id_t id, int node );
+         int getMemorySpaceNumaNode ( memory_space_id_t id ) const;
+
+         void addTransfer ( DeviceOps *ops, char *dst, char *src, std::size_t len, std::size_t count, std::size_t ld,
+                            Direction direction, int numaNode );
+
+         /*! \brief Copies one chunk of a pending transfer, if the calling thread may take any
+          *  \return true if a chunk was copied
+          */
+         bool tryExecuteChunk ();
+
+         /*! \brief Prints the volume and bandwidth of the transfers of each direction */
+         void printStats ( std::ostream &o ) const;
+
+         /*! \brief Returns the size in bytes of the last level cache, or a conservative guess */
+         static std::size_t getLastLevelCacheSize ();
+   };
+
+} // namespace nanos
+
+#endif
@@ -34,7 +34,10 @@ _switchStacks:
 	movq    %rax, %rsp
 	
 	/* arguments in %rdi=arg1, %rsi=arg2, %rdx=new sp */
+	/* saved contexts leave %rsp at 8 mod 16: keep the ABI alignment for the helper */
+	subq	$8, %rsp
 	call	*%rcx
+	addq	$8, %rsp
 	
 	popq	%rbx
 	popq	%r12
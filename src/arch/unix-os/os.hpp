@@ -106,6 +106,7 @@ namespace nanos {
 
          static double getMonotonicTime ();
          static double getMonotonicTimeUs ();
+         static unsigned long long getMonotonicTimeNs ();
          static double getMonotonicTimeResolution ();
 
          static int nanosleep ( unsigned long long nanoseconds );
@@ -152,6 +153,15 @@ namespace nanos {
       return t;
    }
 
+   inline unsigned long long OS::getMonotonicTimeNs ()
+   {
+      struct timespec ts;
+
+      clock_gettime( CLOCK_MONOTONIC, &ts );
+
+      return ( unsigned long long ) ts.tv_sec * 1000000000ULL + ( unsigned long long ) ts.tv_nsec;
+   }
+
    inline double OS::getMonotonicTimeResolution ()
    {
       struct timespec ts;
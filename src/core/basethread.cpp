@@ -140,13 +140,18 @@ void BaseThread::leaveTeam()
    if ( _teamData )
    {
       TeamData *td = _teamData;
-      debug( "removing thread " << this << " with id " << toString<int>(getTeamId()) << " from " << _teamData->getTeam() );
-
-      td->getTeam()->removeThread( getTeamId() );
-      _teamData = _teamData->getParentTeamData();
+      TeamData *parent = td->getParentTeamData();
+      ThreadTeam *team = td->getTeam();
+      unsigned id = td->getId();
+      debug( "removing thread " << this << " with id " << toString<int>(id) << " from " << team );
+
+      // The team keeps td for the next member with this id, and may be recycled
+      // as soon as we are removed from it: td must not be used afterwards
+      team->releaseTeamData( td );
+      team->removeThread( id );
+      _teamData = parent;
       _status.has_team = _teamData != NULL;
       _status.must_leave_team = false;
-      delete td;
    }
 }
 
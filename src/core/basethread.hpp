@@ -111,7 +111,7 @@ namespace nanos {
    inline BaseThread::BaseThread ( unsigned int osId, WD &wd, ProcessingElement *creator, ext::SMPMultiThread *parent ) :
       _id( sys.nextThreadId() ), _osId( osId ), _maxPrefetch( 1 ), _status( ), _parent( parent ), _pe( creator ), _mlock( ),
       _threadWD( wd ), _currentWD( NULL ), _heldWD( NULL ), _nextWDs( /* enableDeviceCounter */ false ), _teamData( NULL ), _nextTeamData( NULL ),
-      _name( "Thread" ), _description( "" ), _allocator( ), _steps(0), _bpCallBack( NULL ), _nextTeam( NULL ), _gasnetAllowAM( true ), _pendingRequests()
+      _name( "Thread" ), _description( "" ), _allocator( Allocator::create() ), _steps(0), _bpCallBack( NULL ), _nextTeam( NULL ), _gasnetAllowAM( true ), _pendingRequests()
    {
          if ( sys.getSplitOutputForThreads() ) {
             if ( _parent != NULL ) {
@@ -258,7 +258,7 @@ namespace nanos {
 
    inline void BaseThread::setStar ( bool v ) { if ( _teamData ) _teamData->setStar ( v ); }
 
-   inline Allocator & BaseThread::getAllocator() { return _allocator; }
+   inline Allocator & BaseThread::getAllocator() { return *_allocator; }
 
    inline void BaseThread::rename ( const char *name ) { _name = name; }
  
@@ -72,6 +72,12 @@ namespace nanos {
          */
          ~TeamData ();
 
+        /*! \brief Resets the data of a former team member so it can be reused by a new one
+         *
+         *  Id, team and schedule data are kept: they belong to the team slot, not to the thread.
+         */
+         void reset () { _singleCount = 0; _parentData = NULL; _wsDescriptor = NULL; _star = false; _creator = false; }
+
          unsigned getId() const { return _id; }
          ThreadTeam *getTeam() const { return _team; }
          unsigned getSingleCount() const { return _singleCount; }
@@ -196,7 +202,7 @@ namespace nanos {
          std::string             _name;          /**< Thread name */
          std::string             _description;   /**< Thread description */
          // Allocator:
-         Allocator               _allocator;     /**< Per thread allocator */
+         Allocator              *_allocator;     /**< Per thread allocator (outlives the thread, see Allocator::create) */
          unsigned short          _steps;         //!< Number of scheduler steps (zero means infinite)
          callback_t              _bpCallBack;    //!< Break point callback. We call it after _steps scheduler ops
          ThreadTeam             *_nextTeam;      //!< If thread has no team, which team should it join
@@ -72,27 +72,27 @@ void DependableObject::finished ( )
       // use it.
       if ( succ.size() > 1 )
       {
-         // Construct list of successors to be released immediately.
+         // Collect the successors released by this object and submit them
+         // all at once, so the scheduling policy takes its queue lock only
+         // once instead of once per successor.
          // Allocate as many elements as we have in the successor list
          WD** immediateSucc = (WD**) alloca( sizeof(WD*) * succ.size() );
          WD** pIS = immediateSucc;
          
          for ( DependableObject::DependableObjectVector::iterator it = succ.begin(); it != succ.end(); it++ ) {
             NANOS_INSTRUMENT ( instrument ( *(it->second) ); ) 
+            DependableObject& dSucc = *it->second;
+
             // If this dependable object can't be released in batch
-            if ( !it->second->canBeBatchReleased() )
+            if ( !dSucc.canBeBatchReleased() )
             {
-               it->second->decreasePredecessors( NULL, this, false, false );
+               dSucc.decreasePredecessors( NULL, this, false, false );
                continue;
             }
             
-            // Release this Dependable Object without triggering submission
-            DependableObject& dSucc = *it->second;
-            // Decrease predecessors
-            int numPred = dSucc.decreasePredecessors( NULL, this, true, false );
-            
-            // If after decreasing the predecessors it's not 0, fatal_cond
-            fatal_cond( numPred != 0, "Num predecessors is not 0" );
+            // Decrease predecessors without triggering submission. Only the
+            // predecessor that brings the counter down to 0 releases it.
+            if ( dSucc.decreasePredecessors( NULL, this, true, false ) != 0 ) continue;
             
             // dependenciesSatisfied code
             dSucc.dependenciesSatisfiedNoSubmit();
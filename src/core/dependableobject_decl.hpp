@@ -168,8 +168,9 @@ namespace nanos {
           */
          virtual const void * getRelatedObject ( ) const;
          
-         /*! \brief Checks if this class supports batch release and, if so, if
-          *  it has only one predecessor.
+         /*! \brief Checks if this class supports batch release, i.e. if it can be
+          *  collected by a finishing predecessor and submitted together with its
+          *  siblings once its last predecessor is gone.
           */
          virtual bool canBeBatchReleased ( ) const;
 
@@ -307,7 +308,7 @@ namespace nanos {
          *  \param desObj Dependable Object that finished
          *  \sa DependableObject
          */
-         void finished ( );
+         virtual void finished ( );
          
          
          
@@ -44,7 +44,7 @@ void DOSubmit::dependenciesSatisfiedNoSubmit( )
 
 bool DOSubmit::canBeBatchReleased ( ) const
 {
-   return numPredecessors() == 1 && sys.getDefaultSchedulePolicy()->isValidForBatch( getWD() ) && needsSubmission();
+   return needsSubmission() && getWD()->getSlicer() == NULL && sys.getDefaultSchedulePolicy()->isValidForBatch( getWD() );
 }
 
 unsigned long DOSubmit::getDescription ( )
@@ -65,7 +65,8 @@ namespace nanos {
           */
          virtual void dependenciesSatisfiedNoSubmit ( );
          
-         /*! \brief Checks if it has only one predecessor.
+         /*! \brief Checks if the WD can go through the batch submission path
+          *  (it needs submission, has no slicer and the policy accepts it).
           */
          virtual bool canBeBatchReleased ( ) const;
 
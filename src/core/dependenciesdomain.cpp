@@ -24,6 +24,7 @@
 #include "system.hpp"
 #include "instrumentation.hpp"
 #include "dataaccess.hpp"
+#include "taskgraph.hpp"
 
 
 namespace nanos {
@@ -34,6 +35,12 @@ Lock DependenciesDomain::_lock;
 
 using namespace dependencies_domain_internal;
 
+DependenciesDomain::~DependenciesDomain ( )
+{
+   delete _graphRecorder;
+   if ( _graphReplay != NULL ) _graphReplay->unreference();
+}
+
 void DependenciesDomain::increaseTasksInGraph( size_t num )
 {
    NANOS_INSTRUMENT(lock();)
@@ -52,4 +59,74 @@ void DependenciesDomain::decreaseTasksInGraph( size_t num )
    NANOS_INSTRUMENT(sys.getInstrumentation()->raisePointEvents(1, &key, (nanos_event_value_t *) &tasks );)
    NANOS_INSTRUMENT(unlock();)
 }
+bool DependenciesDomain::startTaskGraphRecording ()
+{
+   if ( _graphRecorder != NULL || _replaying ) return false;
+
+   _graphRecorder = NEW TaskGraphBuilder();
+   return true;
+}
+
+TaskGraph * DependenciesDomain::stopTaskGraphRecording ()
+{
+   if ( _graphRecorder == NULL ) return NULL;
+
+   TaskGraph *graph = NULL;
+   if ( _graphRecorder->isValid() ) {
+      graph = _graphRecorder->build();
+   } else {
+      warning0( "The recorded task graph cannot be replayed: " << _graphRecorder->getInvalidReason() );
+   }
+
+   delete _graphRecorder;
+   _graphRecorder = NULL;
+   return graph;
+}
+
+bool DependenciesDomain::startTaskGraphReplay ( TaskGraph &graph )
+{
+   if ( _graphRecorder != NULL || _replaying ) return false;
+
+   clearTaskGraphReplay();
+   _graphReplay = NEW TaskGraphReplay( graph, sys.verifyTaskGraphs() );
+   _replaying = true;
+   return true;
+}
+
+bool DependenciesDomain::stopTaskGraphReplay ()
+{
+   if ( !_replaying ) return false;
+
+   _graphReplay->stop();
+   _replaying = false;
+   return true;
+}
+
+void DependenciesDomain::clearTaskGraphReplay ()
+{
+   // The replay is still needed to order the tasks submitted after it
+   if ( _graphReplay == NULL || _replaying ) return;
+
+   _graphReplay->unreference();
+   _graphReplay = NULL;
+}
+
+void DependenciesDomain::prepareTaskGraphSubmission ( DependableObject &depObj, size_t numDeps, DataAccess const *deps )
+{
+   if ( _graphRecorder != NULL ) _graphRecorder->addTask( numDeps, deps );
+
+   // Replayed tasks are not in the plugin data, every task submitted after them waits for the
+   // sinks of the graph. depObj has not been submitted yet, so this cannot release it.
+   if ( _graphReplay != NULL ) _graphReplay->orderAfter( depObj );
+}
+
+bool DependenciesDomain::prepareTaskGraphWait ()
+{
+   if ( _replaying ) fatal0( "Waiting on dependencies is not supported while replaying a task graph" );
+
+   if ( _graphRecorder != NULL ) _graphRecorder->invalidate( "waits on dependencies cannot be recorded" );
+
+   return _graphReplay != NULL;
+}
+
 } // namespace nanos
@@ -35,10 +35,6 @@
 
 namespace nanos {
 
-inline DependenciesDomain::~DependenciesDomain ( )
-{
-}
-
 inline RecursiveLock& DependenciesDomain::getInstanceLock()
 {
    return _instanceLock;
@@ -77,6 +73,26 @@ inline void DependenciesDomain::finalizeAllReductions ( void )
 
 inline void DependenciesDomain::clearDependenciesDomain ( void ) { }
 
+inline bool DependenciesDomain::hasTaskGraphState () const
+{
+   return _graphRecorder != NULL || _graphReplay != NULL;
+}
+
+inline bool DependenciesDomain::isRecordingTaskGraph () const
+{
+   return _graphRecorder != NULL;
+}
+
+inline bool DependenciesDomain::isReplayingTaskGraph () const
+{
+   return _replaying;
+}
+
+inline TaskGraphReplay & DependenciesDomain::getTaskGraphReplay ()
+{
+   return *_graphReplay;
+}
+
 } // namespace nanos
 
 #endif
@@ -57,6 +57,7 @@
 
 #include "commutationdepobj_fwd.hpp"
 #include "dependableobject_fwd.hpp"
+#include "taskgraph_fwd.hpp"
 #include "schedule_fwd.hpp"
 
 #include <stdlib.h>
@@ -98,6 +99,9 @@ using namespace dependencies_domain_internal;
          RecursiveLock        _instanceLock;         /**< Needed to access _addressDependencyMap */
          static Atomic<int>   _tasksInGraph;         /**< Current number of tasks in the graph */
          static Lock          _lock;
+         TaskGraphBuilder    *_graphRecorder;        /**< Builds the graph of the submitted tasks while recording */
+         TaskGraphReplay     *_graphReplay;          /**< Last task graph replayed in the domain, until the next taskwait */
+         bool                 _replaying;            /**< Are submitted tasks nodes of _graphReplay? */
 
       private:
         /*! \brief DependenciesDomain copy assignment operator (private)
@@ -106,12 +110,12 @@ using namespace dependencies_domain_internal;
       public:
         /*! \brief DependenciesDomain default constructor
          */
-         DependenciesDomain ( ) :  _id( _atomicSeed++ ) {}
+         DependenciesDomain ( ) :  _id( _atomicSeed++ ), _graphRecorder( NULL ), _graphReplay( NULL ), _replaying( false ) {}
 
         /*! \brief DependenciesDomain copy constructor
          */
          DependenciesDomain ( const DependenciesDomain &depDomain )
-            : _id( _atomicSeed++ ) {}
+            : _id( _atomicSeed++ ), _graphRecorder( NULL ), _graphReplay( NULL ), _replaying( false ) {}
 
         /*! \brief DependenciesDomain destructor
          */
@@ -196,6 +200,46 @@ using namespace dependencies_domain_internal;
 
          //! \brief Clear all pendants references
          virtual void clearDependenciesDomain ( void ) ;
+
+         /*! \name Task graph record and replay, see TaskGraph.
+          *  \{
+          */
+         //! \brief Is the domain recording a task graph or ordering tasks after a replay?
+         bool hasTaskGraphState () const;
+
+         //! \brief Starts recording the graph of the tasks submitted to the domain
+         bool startTaskGraphRecording ();
+
+         /*! \brief Stops recording
+          *  \return the recorded graph, or NULL if the submitted tasks cannot be replayed
+          */
+         TaskGraph * stopTaskGraphRecording ();
+
+         bool isRecordingTaskGraph () const;
+
+         /*! \brief Makes the next tasks submitted to the domain the nodes of graph
+          *  The domain must not have unfinished tasks that were submitted before.
+          */
+         bool startTaskGraphReplay ( TaskGraph &graph );
+
+         //! \brief Ends the submission of the replayed tasks
+         bool stopTaskGraphReplay ();
+
+         bool isReplayingTaskGraph () const;
+         TaskGraphReplay & getTaskGraphReplay ();
+
+         //! \brief Forgets the last replay, once all the tasks of the domain have finished
+         void clearTaskGraphReplay ();
+
+         //! \brief Records a task submitted outside a replay and orders it after the last replay
+         void prepareTaskGraphSubmission ( DependableObject &depObj, size_t numDeps, DataAccess const *deps );
+
+         /*! \brief Called before waiting on dependencies outside a replay
+          *  \return true if the tasks of the last replay must be waited for first
+          */
+         bool prepareTaskGraphWait ();
+         /*! \}
+          */
    };
    
    /*! \class DependenciesManager.
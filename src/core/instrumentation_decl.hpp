@@ -426,6 +426,7 @@ namespace nanos {
             registerEventValue("api","omp_barrier","nanos_omp_barrier()");
             registerEventValue("api","get_starring_threads","nanos_get_implicit_threads()");
             registerEventValue("api","get_supporting_threads","nanos_get_nonimplicit_threads()");
+            registerEventValue("api","team_get_num_threads","nanos_team_get_num_threads()");
             registerEventValue("api","omp_find_worksharing","nanos_omp_find_worksharing()");
             registerEventValue("api","omp_get_schedule","nanos_omp_get_schedule()");
             registerEventValue("api","malloc","nanos_malloc()");
@@ -445,6 +446,12 @@ namespace nanos {
             registerEventValue("api","stick_to_producer","nanos_stick_to_producer()");
             registerEventValue("api","task_reduction_register","nanos_task_reduction_register()");
             registerEventValue("api","task_reduction_get_thread_storage","nanos_task_reduction_get_thread_storage()");
+            registerEventValue("api","task_graph_record_begin","nanos_task_graph_record_begin()");
+            registerEventValue("api","task_graph_record_end","nanos_task_graph_record_end()");
+            registerEventValue("api","task_graph_replay_begin","nanos_task_graph_replay_begin()");
+            registerEventValue("api","task_graph_replay_end","nanos_task_graph_replay_end()");
+            registerEventValue("api","task_graph_destroy","nanos_task_graph_destroy()");
+            registerEventValue("api","task_graph_get_size","nanos_task_graph_get_size()");
 
             /* 02 */ registerEventKey("wd-id","Work Descriptor id:", true, EVENT_DEVELOPER, true);
 
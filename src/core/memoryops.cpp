@@ -189,10 +189,8 @@ void BaseAddressSpaceInOps::addOp( SeparateMemoryAddressSpace *from, global_reg_
       printBt( *myThread->_file );
    }
    if ( _lockedChunks.count( sourceChunk ) == 0 ) {
-      sourceChunk->lock();
       sourceChunk->addReference( wd, 133 ); //Out addOp( with chunk )
       _lockedChunks.insert( sourceChunk );
-      sourceChunk->unlock();
    }
    list.push_back( TransferListEntry( reg, version, NULL, destinationChunk, sourceChunk, copyIdx ) );
 }
@@ -305,10 +303,8 @@ SeparateAddressSpaceOutOps::~SeparateAddressSpaceOutOps() {
 void SeparateAddressSpaceOutOps::addOutOp( memory_space_id_t to, memory_space_id_t from, global_reg_t const &reg, unsigned int version, DeviceOps *ops, AllocatedChunk *chunk, WD const &wd, unsigned int copyIdx ) {
    TransferList &list = _transfers[ std::make_pair(to, from) ];
    if ( _lockedChunks.count( chunk ) == 0 ) {
-      chunk->lock();
       chunk->addReference( wd, 2 ); //Out addOp( with chunk )
       _lockedChunks.insert( chunk );
-      chunk->unlock();
    }
    list.push_back( TransferListEntry( reg, version, ops, /* destination */ (AllocatedChunk *) NULL, chunk, copyIdx ) );
 }
@@ -317,9 +313,9 @@ void SeparateAddressSpaceOutOps::addOutOp( memory_space_id_t to, memory_space_id
 
    TransferList &list = _transfers[ std::make_pair(to, from) ];
    SeparateAddressSpace &sas = sys.getSeparateMemory( from );
-   sas.getCache().lock();
+   sas.getCache().readLock();
    sas.getCache()._prepareRegionToBeCopied( reg, version, _lockedChunks, wd, copyIdx );
-   sas.getCache().unlock();
+   sas.getCache().readUnlock();
    AllocatedChunk *chunk = sas.getCache()._getAllocatedChunk( reg, false, false, wd, copyIdx );
    list.push_back( TransferListEntry( reg, version, ops, /* destination */ (AllocatedChunk *) NULL, chunk, copyIdx ) );
 }
@@ -31,6 +31,8 @@
 #include "version.hpp"
 #include "addressspace.hpp"
 #include "globalregt.hpp"
+#include "os.hpp"
+#include "stridedcopy.hpp"
 
 #include <limits>
 #include <iomanip>
@@ -51,7 +53,8 @@ Network::Network () : _numNodes(1), _api((NetworkAPI *) 0), _nodeNum(0),
    _delayedBySeqNumberPutReqs(), _delayedBySeqNumberPutReqsLock(),
    _forwardedRegions(NULL),_gpuPresend(1), _smpPresend(1),
    _metadataSequenceNumbers(NULL), _recvMetadataSeq(1), _syncReqs(),
-   _syncReqsLock(), _nodeBarrierCounter(0), _parentWD(NULL) {}
+   _syncReqsLock(), _aggregation(false), _aggregationSize(8192), _aggregationTime(50e-6),
+   _maxBatchLen(0), _batchBuffers(NULL), _nodeBarrierCounter(0), _parentWD(NULL) {}
 
 Network::~Network () {}
 
@@ -100,12 +103,23 @@ void Network::initialize( NetworkAPI *api )
    }
 
    _forwardedRegions = NEW RegionsForwarded[ getNumNodes()-1 ];
+
+   if ( _aggregation ) {
+      _maxBatchLen = _api->getMaxBatchLen() & ~( ( std::size_t ) 7 );
+      if ( _aggregationSize > _maxBatchLen ) _aggregationSize = _maxBatchLen;
+      _batchBuffers = NEW BatchBuffer[ getNumNodes() ];
+      for ( unsigned int i = 0; i < getNumNodes(); i += 1 ) {
+         _batchBuffers[ i ]._buffer = NEW char[ _maxBatchLen ];
+      }
+   }
 }
 
 void Network::finalize()
 {
    if ( _api != NULL )
    {
+      flushBatches( FLUSH_EXPLICIT );
+      printAggregationStats();
       _api->finalize();
    }
 }
@@ -114,6 +128,7 @@ void Network::finalizeNoBarrier()
 {
    if ( _api != NULL )
    {
+      flushBatches( FLUSH_EXPLICIT );
       _api->finalizeNoBarrier();
    }
 }
@@ -122,6 +137,7 @@ void Network::poll( unsigned int id)
 {
    if ( _api != NULL ) {
       //   ensure ( _api != NULL, "No network api loaded." );
+      flushExpiredBatches();
       checkDeferredWorkReqs();
       processRequestsDelayedBySeqNumber();
       if ( _nodeNum != MASTER_NODE_NUM && myThread->getId() == 0 ) {
@@ -140,6 +156,7 @@ void Network::sendExitMsg( unsigned int nodeNum )
    //  ensure ( _api != NULL, "No network api loaded." );
    if ( _nodeNum == MASTER_NODE_NUM )
    {
+      flushBatch( nodeNum, FLUSH_ORDER );
       _api->sendExitMsg( nodeNum );
    }
 }
@@ -154,6 +171,7 @@ void Network::sendWorkMsg( unsigned int dest, WorkDescriptor const &wd )
       NANOS_INSTRUMENT ( instr->raiseOpenPtPEvent( NANOS_WD_REMOTE, id, 0, 0, dest ); )
 
       std::size_t expectedData = _sentWdData.getSentData( wd.getId() );
+      flushBatch( dest, FLUSH_ORDER );
       _api->sendWorkMsg( dest, wd, expectedData );
    }
 }
@@ -168,6 +186,7 @@ void Network::sendWorkDoneMsg( unsigned int nodeNum, void const *remoteWdAddr )
       //NANOS_INSTRUMENT ( instr->raiseOpenPtPEventNkvs( NANOS_WD_REMOTE, id, 0, NULL, NULL, 0 ); )
       if ( _nodeNum != MASTER_NODE_NUM )
       {
+         /* deferred by the backend, which batches it with batchWorkDone */
          _api->sendWorkDoneMsg( nodeNum, remoteWdAddr );
       }
    }
@@ -187,6 +206,8 @@ void Network::put ( unsigned int remoteNode, uint64_t remoteAddr, void *localAdd
    if ( _api != NULL )
    {
       unsigned int seq = 0;
+      bool batched = canBatch( size );
+      if ( !batched ) flushBatch( remoteNode, FLUSH_ORDER );
       _sentWdData.addSentData( wdId, size );
       reg_key_t obj = sys.getHostMemory().getRegionDirectoryKey( (uint64_t) hostObject );
       if ( !_forwardedRegions[remoteNode-1].isRegionForwarded( global_reg_t( hostRegId, obj ) ) ) {
@@ -199,14 +220,22 @@ void Network::put ( unsigned int remoteNode, uint64_t remoteAddr, void *localAdd
          cd.setHostRegionId( hostRegId );
 
          seq = getMetadataSequenceNumber( remoteNode );
-         _api->sendRegionMetadata( remoteNode, &cd, seq );
+         if ( batched ) {
+            batchRegionMetadata( remoteNode, cd, seq );
+         } else {
+            _api->sendRegionMetadata( remoteNode, &cd, seq );
+         }
          seq += 1;
          _forwardedRegions[remoteNode-1].addForwardedRegion( reg );
       } else {
          seq = checkMetadataSequenceNumber( remoteNode );
       }
       //std::cerr << " send put with seq " << seq << std::endl;
-      _api->put( remoteNode, remoteAddr, localAddr, size, wdId, wd, hostObject, hostRegId, seq );
+      if ( batched ) {
+         batchPut( remoteNode, remoteAddr, localAddr, size, 1, 0, wdId, hostObject, hostRegId, seq, true );
+      } else {
+         _api->put( remoteNode, remoteAddr, localAddr, size, wdId, wd, hostObject, hostRegId, seq );
+      }
    }
 }
 
@@ -215,6 +244,8 @@ void Network::putStrided1D ( unsigned int remoteNode, uint64_t remoteAddr, void
    if ( _api != NULL )
    {
       unsigned int seq = 0;
+      bool batched = canBatch( size * count );
+      if ( !batched ) flushBatch( remoteNode, FLUSH_ORDER );
       _sentWdData.addSentData( wdId, size * count );
       reg_key_t obj = sys.getHostMemory().getRegionDirectoryKey( (uint64_t) hostObject );
       if ( !_forwardedRegions[remoteNode-1].isRegionForwarded( global_reg_t( hostRegId, obj ) ) ) {
@@ -227,13 +258,21 @@ void Network::putStrided1D ( unsigned int remoteNode, uint64_t remoteAddr, void
          cd.setHostRegionId( hostRegId );
 
          seq = getMetadataSequenceNumber( remoteNode );
-         _api->sendRegionMetadata( remoteNode, &cd, seq );
+         if ( batched ) {
+            batchRegionMetadata( remoteNode, cd, seq );
+         } else {
+            _api->sendRegionMetadata( remoteNode, &cd, seq );
+         }
          seq += 1;
          _forwardedRegions[remoteNode-1].addForwardedRegion( reg );
       } else {
          seq = checkMetadataSequenceNumber( remoteNode );
       }
-      _api->putStrided1D( remoteNode, remoteAddr, localAddr, localPack, size, count, ld, wdId, wd, hostObject, hostRegId, seq );
+      if ( batched ) {
+         batchPut( remoteNode, remoteAddr, localPack, size, count, ld, wdId, hostObject, hostRegId, seq, false );
+      } else {
+         _api->putStrided1D( remoteNode, remoteAddr, localAddr, localPack, size, count, ld, wdId, wd, hostObject, hostRegId, seq );
+      }
    }
 }
 
@@ -251,6 +290,7 @@ void Network::get ( void *localAddr, unsigned int remoteNode, uint64_t remoteAdd
       cd.setHostRegionId( hostRegId );
       _forwardedRegions[remoteNode-1].addForwardedRegion( reg );
 
+      flushBatch( remoteNode, FLUSH_ORDER );
       _api->get( localAddr, remoteNode, remoteAddr, size, req, cd );
    }
 }
@@ -269,6 +309,7 @@ void Network::getStrided1D ( void *packedAddr, unsigned int remoteNode, uint64_t
       cd.setHostRegionId( hostRegId );
       _forwardedRegions[remoteNode-1].addForwardedRegion( reg );
 
+      flushBatch( remoteNode, FLUSH_ORDER );
       _api->getStrided1D( packedAddr, remoteNode, remoteTag, remoteAddr, size, count, ld, req, cd );
    }
 }
@@ -282,6 +323,7 @@ void * Network::malloc ( unsigned int remoteNode, std::size_t size )
 
    if ( _api != NULL )
    {
+      flushBatch( remoteNode, FLUSH_ORDER );
       _api->malloc( remoteNode, size, ( void * ) &request );
 
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
@@ -331,6 +373,7 @@ void Network::memFree ( unsigned int remoteNode, void *addr )
 {
    if ( _api != NULL )
    {
+      flushBatch( remoteNode, FLUSH_ORDER );
       _api->memFree( remoteNode, addr );
    }
 }
@@ -339,6 +382,7 @@ void Network::memRealloc ( unsigned int remoteNode, void *oldAddr, std::size_t o
 {
    if ( _api != NULL )
    {
+      flushBatch( remoteNode, FLUSH_ORDER );
       _api->memRealloc( remoteNode, oldAddr, oldSize, newAddr, newSize );
    }
 }
@@ -354,6 +398,7 @@ void Network::nodeBarrier()
 {
    if ( _api != NULL )
    {
+      flushBatches( FLUSH_EXPLICIT );
       _api->nodeBarrier();
       _nodeBarrierCounter += 1;
    }
@@ -380,6 +425,11 @@ void Network::sendRequestPut( unsigned int dest, uint64_t origAddr, unsigned int
 {
    if ( _api != NULL )
    {
+      bool batched = canBatch( len );
+      if ( !batched ) {
+         flushBatch( dest, FLUSH_ORDER );
+         flushBatch( dataDest, FLUSH_ORDER );
+      }
       _sentWdData.addSentData( wdId, len );
       //(*myThread->_file) << __func__ << " hostObject " << (void *) hostObject << " from node " << dest << " to node " << dataDest << std::endl;
       // added
@@ -395,14 +445,22 @@ void Network::sendRequestPut( unsigned int dest, uint64_t origAddr, unsigned int
          cd.setHostRegionId( hostRegId );
 
          seq = getMetadataSequenceNumber( dataDest );
-         _api->sendRegionMetadata( dataDest, &cd, seq );
+         if ( batched ) {
+            batchRegionMetadata( dataDest, cd, seq );
+         } else {
+            _api->sendRegionMetadata( dataDest, &cd, seq );
+         }
          seq += 1;
          _forwardedRegions[dataDest-1].addForwardedRegion( reg );
       } else {
          seq = checkMetadataSequenceNumber( dataDest );
       }
       // added
-      _api->sendRequestPut( dest, origAddr, dataDest, dstAddr, len, wdId, wd, hostObject, hostRegId, 0 );
+      if ( batched ) {
+         batchRequestPut( dest, origAddr, dataDest, dstAddr, len, 1, 0, wdId, wd, hostObject, hostRegId );
+      } else {
+         _api->sendRequestPut( dest, origAddr, dataDest, dstAddr, len, wdId, wd, hostObject, hostRegId, 0 );
+      }
    }
 }
 
@@ -410,6 +468,11 @@ void Network::sendRequestPutStrided1D( unsigned int dest, uint64_t origAddr, uns
 {
    if ( _api != NULL )
    {
+      bool batched = canBatch( len * count );
+      if ( !batched ) {
+         flushBatch( dest, FLUSH_ORDER );
+         flushBatch( dataDest, FLUSH_ORDER );
+      }
       _sentWdData.addSentData( wdId, len * count );
       unsigned int seq = 0;
       reg_key_t obj = sys.getHostMemory().getRegionDirectoryKey( (uint64_t) hostObject );
@@ -423,13 +486,21 @@ void Network::sendRequestPutStrided1D( unsigned int dest, uint64_t origAddr, uns
          cd.setHostRegionId( hostRegId );
 
          seq = getMetadataSequenceNumber( dataDest );
-         _api->sendRegionMetadata( dataDest, &cd, seq );
+         if ( batched ) {
+            batchRegionMetadata( dataDest, cd, seq );
+         } else {
+            _api->sendRegionMetadata( dataDest, &cd, seq );
+         }
          seq += 1;
          _forwardedRegions[dataDest-1].addForwardedRegion( reg );
       } else {
          seq = checkMetadataSequenceNumber( dataDest );
       }
-      _api->sendRequestPutStrided1D( dest, origAddr, dataDest, dstAddr, len, count, ld, wdId, wd, hostObject, hostRegId, 0 );
+      if ( batched ) {
+         batchRequestPut( dest, origAddr, dataDest, dstAddr, len, count, ld, wdId, wd, hostObject, hostRegId );
+      } else {
+         _api->sendRequestPutStrided1D( dest, origAddr, dataDest, dstAddr, len, count, ld, wdId, wd, hostObject, hostRegId, 0 );
+      }
    }
 }
 
@@ -757,9 +828,7 @@ void SendDataRequest::doSend() {
       if ( localPack == NULL ) { fprintf(stderr, "ERROR!!! could not get an addr to pack strided data\n" ); }
       _api->getPackSegment()->unlock();
 
-      for ( unsigned int i = 0; i < _count; i += 1 ) {
-         memcpy( &localPack[ i * _len ], &origAddrPtr[ i * _ld ], _len );
-      }
+      StridedCopy::pack( localPack, origAddrPtr, _len, _count, _ld );
       //NANOS_INSTRUMENT( inst2.close(); );
 
       doStrided( localPack );
@@ -769,6 +838,22 @@ void SendDataRequest::doSend() {
       _api->getPackSegment()->unlock();
    }
 }
+BatchPutRequest::BatchPutRequest( NetworkAPI *api, unsigned int issueNode, unsigned int seqNumber, void *origAddr, void *destAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int dst, unsigned int wdId, void *hostObject, reg_t hostRegId ) :
+   SendDataRequest( api, issueNode, seqNumber, origAddr, destAddr, len, count, ld, dst, wdId, hostObject, hostRegId, 0 ) {
+}
+
+BatchPutRequest::~BatchPutRequest() {
+}
+
+void BatchPutRequest::doSingleChunk() {
+   /* not coalesced: the destination matches the data with its wait request by address */
+   sys.getNetwork()->batchPut( _destination, ( uint64_t ) _destAddr, _origAddr, _len, 1, 0, _wdId, _hostObject, _hostRegId, 0, false );
+}
+
+void BatchPutRequest::doStrided( void *localAddr ) {
+   sys.getNetwork()->batchPut( _destination, ( uint64_t ) _destAddr, localAddr, _len, _count, _ld, _wdId, _hostObject, _hostRegId, 0, false );
+}
+
 void *SendDataRequest::getOrigAddr() const {
    return _origAddr;
 }
@@ -919,9 +1004,7 @@ GetRequestStrided::~GetRequestStrided() {
 
 void GetRequestStrided::clear() {
    //NANOS_INSTRUMENT( InstrumentState inst2(NANOS_STRIDED_COPY_UNPACK); );
-   for ( unsigned int j = 0; j < _count; j += 1 ) {
-      ::memcpy( &_hostAddr[ j  * _ld ], &_recvAddr[ j * _size ], _size );
-   }
+   StridedCopy::unpack( _hostAddr, _recvAddr, _size, _count, _ld );
    if ( VERBOSE_COMPLETION ) {
       (*myThread->_file) << std::setprecision(std::numeric_limits<double>::digits10) << OS::getMonotonicTime() << " Completed copyOutStrided request, hostAddr="<< (void*)_hostAddr <<" ["<< *((double*) _hostAddr) <<"] ops=" << (void *) _ops << std::endl;
    }
@@ -975,6 +1058,7 @@ void Network::synchronizeDirectory( void *addr ) {
    if ( this->getNodeNum() == 0 ) { //this is called by the slaves by the handler of this message, avoid the recursive call
       if ( _api != NULL ) {
          for (unsigned int idx = 1; idx < getNumNodes(); idx += 1) {
+            flushBatch( idx, FLUSH_ORDER );
             _api->synchronizeDirectory( idx, addr );
          }
       }
@@ -984,6 +1068,7 @@ void Network::synchronizeDirectory( void *addr ) {
 
 void Network::broadcastIdle() {
    if ( _api != NULL ) {
+      flushBatches( FLUSH_ORDER );
       _api->broadcastIdle();
    }
 }
@@ -1026,3 +1111,276 @@ void Network::setParentWD(WD *wd) {
 void Network::notifyIdle( unsigned int node ) {
    sys.notifyIdle( node );
 }
+
+std::size_t Network::batchRecordLen( std::size_t len ) {
+   return ( sizeof( BatchRecordHeader ) + len + 7 ) & ~( ( std::size_t ) 7 );
+}
+
+Network::AggregationStats::AggregationStats() : _messages( 0 ), _coalescedPuts( 0 ), _batches( 0 ), _bytes( 0 ) {
+   for ( unsigned int idx = 0; idx < FLUSH_REASONS; idx += 1 ) {
+      _flushes[ idx ] = 0;
+   }
+}
+
+void Network::setAggregation( bool enabled, std::size_t size, int time ) {
+   _aggregation = enabled;
+   _aggregationSize = size;
+   _aggregationTime = ( (double) time ) * 1e-6;
+}
+
+Network::AggregationStats const &Network::getAggregationStats( unsigned int dest ) const {
+   static AggregationStats noStats;
+   return _aggregation ? _batchBuffers[ dest ]._stats : noStats;
+}
+
+void Network::printAggregationStats() const {
+   if ( _aggregation ) {
+      for ( unsigned int dest = 0; dest < getNumNodes(); dest += 1 ) {
+         AggregationStats const &stats = _batchBuffers[ dest ]._stats;
+         if ( stats._messages > 0 ) {
+            message0( "Node " << _nodeNum << " to node " << dest << ": " << stats._messages << " aggregated messages ("
+                  << stats._coalescedPuts << " coalesced puts) in " << stats._batches << " batches, " << stats._bytes
+                  << " bytes. Flushes by size: " << stats._flushes[ FLUSH_SIZE ] << ", time: " << stats._flushes[ FLUSH_TIME ]
+                  << ", order: " << stats._flushes[ FLUSH_ORDER ] << ", explicit: " << stats._flushes[ FLUSH_EXPLICIT ] );
+         }
+      }
+   }
+}
+
+bool Network::canBatch( std::size_t dataLen ) const {
+   return _aggregation && batchRecordLen( sizeof( BatchPutRecord ) + dataLen ) <= _aggregationSize;
+}
+
+char *Network::beginBatchRecord( unsigned int dest, BatchRecordKind kind, std::size_t len ) {
+   BatchBuffer &buffer = _batchBuffers[ dest ];
+   std::size_t recordLen = batchRecordLen( len );
+   ensure( recordLen <= _maxBatchLen, "Message too large for a batch." );
+   buffer._lock.acquire();
+   if ( buffer._len + recordLen > _maxBatchLen ) {
+      sendBatch( dest, FLUSH_SIZE );
+   }
+   if ( buffer._len == 0 ) {
+      buffer._firstTime = OS::getMonotonicTime();
+   }
+   BatchRecordHeader *header = ( BatchRecordHeader * ) &buffer._buffer[ buffer._len ];
+   header->_kind = kind;
+   header->_len = recordLen;
+   buffer._len += recordLen;
+   buffer._lastPut = buffer._len;
+   buffer._stats._messages += 1;
+   return ( char * ) ( header + 1 );
+}
+
+void Network::endBatchRecord( unsigned int dest ) {
+   BatchBuffer &buffer = _batchBuffers[ dest ];
+   if ( buffer._len >= _aggregationSize ) {
+      sendBatch( dest, FLUSH_SIZE );
+   }
+   buffer._lock.release();
+}
+
+/* Active message handlers can not send messages, so a batch closed inside one
+ * (because it is full or something has to go after it) is kept aside and sent
+ * the next time a thread outside a handler sends or flushes this batch, or
+ * from poll. The caller holds the lock of the batch.
+ */
+void Network::sendBatch( unsigned int dest, BatchFlushReason reason ) {
+   BatchBuffer &buffer = _batchBuffers[ dest ];
+   sendDeferredBatches( dest );
+   if ( buffer._len > 0 ) {
+      if ( myThread != NULL && !myThread->_gasnetAllowAM ) {
+         char *batch = NEW char[ buffer._len ];
+         ::memcpy( batch, buffer._buffer, buffer._len );
+         buffer._deferred.push_back( std::make_pair( batch, buffer._len ) );
+         buffer._numDeferred += 1;
+      } else {
+         _api->sendBatch( dest, buffer._buffer, buffer._len );
+      }
+      buffer._stats._batches += 1;
+      buffer._stats._bytes += buffer._len;
+      buffer._stats._flushes[ reason ] += 1;
+      buffer._len = 0;
+      buffer._lastPut = 0;
+   }
+}
+
+/* The caller holds the lock of the batch */
+void Network::sendDeferredBatches( unsigned int dest ) {
+   BatchBuffer &buffer = _batchBuffers[ dest ];
+   if ( buffer._numDeferred > 0 && ( myThread == NULL || myThread->_gasnetAllowAM ) ) {
+      while ( !buffer._deferred.empty() ) {
+         std::pair< char *, std::size_t > batch = buffer._deferred.front();
+         buffer._deferred.pop_front();
+         _api->sendBatch( dest, batch.first, batch.second );
+         delete[] batch.first;
+      }
+      buffer._numDeferred = 0;
+   }
+}
+
+void Network::flushBatch( unsigned int dest, BatchFlushReason reason ) {
+   if ( _aggregation && ( _batchBuffers[ dest ]._len > 0 || _batchBuffers[ dest ]._numDeferred > 0 ) ) {
+      _batchBuffers[ dest ]._lock.acquire();
+      sendBatch( dest, reason );
+      _batchBuffers[ dest ]._lock.release();
+   }
+}
+
+void Network::flushBatches( BatchFlushReason reason ) {
+   if ( _aggregation ) {
+      for ( unsigned int dest = 0; dest < getNumNodes(); dest += 1 ) {
+         flushBatch( dest, reason );
+      }
+   }
+}
+
+void Network::flushExpiredBatches() {
+   if ( _aggregation ) {
+      double now = 0.0;
+      for ( unsigned int dest = 0; dest < getNumNodes(); dest += 1 ) {
+         BatchBuffer &buffer = _batchBuffers[ dest ];
+         if ( buffer._numDeferred > 0 && buffer._lock.tryAcquire() ) {
+            sendDeferredBatches( dest );
+            buffer._lock.release();
+         }
+         if ( buffer._len > 0 ) {
+            if ( now == 0.0 ) now = OS::getMonotonicTime();
+            if ( now - buffer._firstTime >= _aggregationTime && buffer._lock.tryAcquire() ) {
+               if ( buffer._len > 0 && now - buffer._firstTime >= _aggregationTime ) {
+                  sendBatch( dest, FLUSH_TIME );
+               }
+               buffer._lock.release();
+            }
+         }
+      }
+   }
+}
+
+bool Network::batchWorkDone( unsigned int dest, void const *remoteWdAddr ) {
+   if ( !_aggregation ) return false;
+   BatchWorkDoneRecord *record = ( BatchWorkDoneRecord * ) beginBatchRecord( dest, BATCH_WORK_DONE, sizeof( BatchWorkDoneRecord ) );
+   record->_remoteWdAddr = remoteWdAddr;
+   endBatchRecord( dest );
+   return true;
+}
+
+void Network::batchRegionMetadata( unsigned int dest, CopyData const &cd, unsigned int seq ) {
+   std::size_t dimsLen = cd.getNumDimensions() * sizeof( nanos_region_dimension_internal_t );
+   BatchRegionMetadataRecord *record = ( BatchRegionMetadataRecord * ) beginBatchRecord( dest, BATCH_REGION_METADATA, sizeof( BatchRegionMetadataRecord ) + dimsLen );
+   ::memcpy( ( void * ) &record->_cd, ( void const * ) &cd, sizeof( CopyData ) );
+   ::memcpy( ( void * ) ( record + 1 ), cd.getDimensions(), dimsLen );
+   record->_seq = seq;
+   endBatchRecord( dest );
+}
+
+void Network::batchPut( unsigned int remoteNode, uint64_t remoteAddr, void const *localPack, std::size_t size, std::size_t count, std::size_t ld, unsigned int wdId, void *hostObject, reg_t hostRegId, unsigned int metaSeq, bool coalesce ) {
+   BatchBuffer &buffer = _batchBuffers[ remoteNode ];
+   coalesce = coalesce && count == 1;
+   if ( coalesce ) {
+      /* append the data to the previous put if it is its continuation */
+      buffer._lock.acquire();
+      if ( buffer._lastPut != buffer._len ) {
+         BatchRecordHeader *header = ( BatchRecordHeader * ) &buffer._buffer[ buffer._lastPut ];
+         BatchPutRecord *last = ( BatchPutRecord * ) ( header + 1 );
+         if ( last->_realTag + last->_size == remoteAddr && last->_wdId == wdId && last->_hostObject == hostObject &&
+               last->_hostRegId == hostRegId && last->_metaSeq == metaSeq &&
+               buffer._lastPut + batchRecordLen( sizeof( BatchPutRecord ) + last->_size + size ) <= _maxBatchLen ) {
+            ::memcpy( &( ( char * ) ( last + 1 ) )[ last->_size ], localPack, size );
+            last->_size += size;
+            header->_len = batchRecordLen( sizeof( BatchPutRecord ) + last->_size );
+            buffer._len = buffer._lastPut + header->_len;
+            buffer._stats._messages += 1;
+            buffer._stats._coalescedPuts += 1;
+            endBatchRecord( remoteNode );
+            return;
+         }
+      }
+      buffer._lock.release();
+   }
+
+   BatchPutRecord *record = ( BatchPutRecord * ) beginBatchRecord( remoteNode, BATCH_PUT, sizeof( BatchPutRecord ) + size * count );
+   record->_realTag = remoteAddr;
+   record->_size = size;
+   record->_count = count;
+   record->_ld = ld;
+   record->_hostObject = hostObject;
+   record->_hostRegId = hostRegId;
+   record->_wdId = wdId;
+   record->_metaSeq = metaSeq;
+   ::memcpy( ( void * ) ( record + 1 ), localPack, size * count );
+   if ( coalesce ) {
+      buffer._lastPut = ( ( char * ) record ) - sizeof( BatchRecordHeader ) - buffer._buffer;
+   }
+   endBatchRecord( remoteNode );
+}
+
+void Network::batchRequestPut( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId ) {
+   BatchWaitRequestPutRecord *wait = ( BatchWaitRequestPutRecord * ) beginBatchRecord( dataDest, BATCH_WAIT_REQUEST_PUT, sizeof( BatchWaitRequestPutRecord ) );
+   wait->_addr = dstAddr;
+   wait->_wdId = wd->getHostId();
+   wait->_seq = getPutRequestSequenceNumber( dataDest );
+   endBatchRecord( dataDest );
+   /* the data node must have the region metadata before the data arrives */
+   flushBatch( dataDest, FLUSH_ORDER );
+
+   BatchRequestPutRecord *record = ( BatchRequestPutRecord * ) beginBatchRecord( dest, BATCH_REQUEST_PUT, sizeof( BatchRequestPutRecord ) );
+   record->_origAddr = ( void * ) origAddr;
+   record->_destAddr = ( void * ) dstAddr;
+   record->_len = len;
+   record->_count = count;
+   record->_ld = ld;
+   record->_hostObject = hostObject;
+   record->_hostRegId = hostRegId;
+   record->_dataDest = dataDest;
+   record->_wdId = wdId;
+   record->_seq = getPutRequestSequenceNumber( dest );
+   endBatchRecord( dest );
+}
+
+void Network::notifyBatch( unsigned int from, void *buf, std::size_t len ) {
+   char *record = ( char * ) buf;
+   char *end = record + len;
+   while ( record < end ) {
+      BatchRecordHeader *header = ( BatchRecordHeader * ) record;
+      switch ( header->_kind ) {
+         case BATCH_PUT:
+         {
+            BatchPutRecord *put = ( BatchPutRecord * ) ( header + 1 );
+            char *data = ( char * ) ( put + 1 );
+            char *realTag = ( char * ) put->_realTag;
+            StridedCopy::unpack( realTag, data, put->_size, put->_count, put->_ld );
+            notifyPut( from, put->_wdId, put->_size, put->_count, put->_ld, put->_realTag, put->_hostObject, put->_hostRegId, put->_metaSeq );
+            break;
+         }
+         case BATCH_REGION_METADATA:
+         {
+            BatchRegionMetadataRecord *metadata = ( BatchRegionMetadataRecord * ) ( header + 1 );
+            metadata->_cd.setDimensions( ( nanos_region_dimension_internal_t * ) ( metadata + 1 ) );
+            notifyRegionMetaData( &metadata->_cd, metadata->_seq );
+            break;
+         }
+         case BATCH_WORK_DONE:
+         {
+            BatchWorkDoneRecord *workDone = ( BatchWorkDoneRecord * ) ( header + 1 );
+            notifyWorkDone( from, ( void * ) workDone->_remoteWdAddr, 0 );
+            break;
+         }
+         case BATCH_WAIT_REQUEST_PUT:
+         {
+            BatchWaitRequestPutRecord *wait = ( BatchWaitRequestPutRecord * ) ( header + 1 );
+            notifyWaitRequestPut( ( void * ) wait->_addr, wait->_wdId, wait->_seq );
+            break;
+         }
+         case BATCH_REQUEST_PUT:
+         {
+            BatchRequestPutRecord *req = ( BatchRequestPutRecord * ) ( header + 1 );
+            notifyRequestPut( NEW BatchPutRequest( _api, from, req->_seq, req->_origAddr, req->_destAddr, req->_len,
+                     req->_count, req->_ld, req->_dataDest, req->_wdId, req->_hostObject, req->_hostRegId ) );
+            break;
+         }
+         default:
+            fatal0( "Unknown record in a batch of network messages." );
+      }
+      record += header->_len;
+   }
+}
@@ -63,6 +63,15 @@ namespace nanos {
          virtual void doStrided( void *localAddr ) = 0;
    };
 
+   //! Put request received in a batch, its data is sent back in a batch too
+   class BatchPutRequest : public SendDataRequest {
+      public:
+         BatchPutRequest( NetworkAPI *api, unsigned int issueNode, unsigned int seqNumber, void *origAddr, void *destAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int dst, unsigned int wdId, void *hostObject, reg_t hostRegId );
+         virtual ~BatchPutRequest();
+         virtual void doSingleChunk();
+         virtual void doStrided( void *localAddr );
+   };
+
    struct GetRequest {
 #ifdef HAVE_NEW_GCC_ATOMIC_OPS
       int _complete;
@@ -237,6 +246,113 @@ namespace nanos {
          std::list<SyncWDs> _syncReqs;
          RecursiveLock _syncReqsLock;
 
+      public:
+         //! Why a batch of aggregated messages was sent
+         enum BatchFlushReason {
+            FLUSH_SIZE = 0, //!< The batch reached the size threshold or the next message did not fit
+            FLUSH_TIME,     //!< The oldest message waited longer than the time threshold
+            FLUSH_ORDER,    //!< A message sent outside the batch (or depending on it) had to go after it
+            FLUSH_EXPLICIT, //!< Barriers and finalization
+            FLUSH_REASONS
+         };
+
+         struct AggregationStats {
+            std::size_t _messages;                 //!< Messages added to batches
+            std::size_t _coalescedPuts;            //!< Puts merged into the previous put of their batch
+            std::size_t _batches;                  //!< Batches sent
+            std::size_t _bytes;                    //!< Bytes sent in batches
+            std::size_t _flushes[ FLUSH_REASONS ]; //!< Batches sent for each BatchFlushReason
+            AggregationStats();
+         };
+
+      private:
+         /* Batches are sequences of records, each one starting with a
+          * BatchRecordHeader and padded to 8 bytes. They are unpacked in
+          * order by notifyBatch. */
+         enum BatchRecordKind {
+            BATCH_PUT = 1,
+            BATCH_REGION_METADATA,
+            BATCH_WORK_DONE,
+            BATCH_WAIT_REQUEST_PUT,
+            BATCH_REQUEST_PUT
+         };
+
+         struct BatchRecordHeader {
+            unsigned int _kind;
+            unsigned int _len;
+         };
+
+         //! Followed by the (packed) data
+         struct BatchPutRecord {
+            uint64_t     _realTag;
+            std::size_t  _size;
+            std::size_t  _count;
+            std::size_t  _ld;
+            void        *_hostObject;
+            reg_t        _hostRegId;
+            unsigned int _wdId;
+            unsigned int _metaSeq;
+         };
+
+         //! Followed by the region dimensions
+         struct BatchRegionMetadataRecord {
+            CopyData     _cd;
+            unsigned int _seq;
+         };
+
+         struct BatchWorkDoneRecord {
+            void const *_remoteWdAddr;
+         };
+
+         struct BatchWaitRequestPutRecord {
+            uint64_t     _addr;
+            unsigned int _wdId;
+            unsigned int _seq;
+         };
+
+         struct BatchRequestPutRecord {
+            void        *_origAddr;
+            void        *_destAddr;
+            std::size_t  _len;
+            std::size_t  _count;
+            std::size_t  _ld;
+            void        *_hostObject;
+            reg_t        _hostRegId;
+            unsigned int _dataDest;
+            unsigned int _wdId;
+            unsigned int _seq;
+         };
+
+         struct BatchBuffer {
+            Lock             _lock;
+            char            *_buffer;
+            std::size_t      _len;
+            std::size_t      _lastPut;   //!< Offset of the put record the next put may be merged into, _len if none
+            double           _firstTime; //!< When the oldest message of the batch was added
+            AggregationStats _stats;
+            std::list< std::pair< char *, std::size_t > > _deferred; //!< Batches closed inside active message handlers, not sent yet
+            std::size_t      _numDeferred;
+            BatchBuffer() : _lock(), _buffer( NULL ), _len( 0 ), _lastPut( 0 ), _firstTime( 0.0 ), _stats(), _deferred(), _numDeferred( 0 ) {}
+         };
+
+         bool         _aggregation;
+         std::size_t  _aggregationSize;
+         double       _aggregationTime;
+         std::size_t  _maxBatchLen;
+         BatchBuffer *_batchBuffers;
+
+         static std::size_t batchRecordLen( std::size_t len );
+         bool canBatch( std::size_t dataLen ) const;
+         char *beginBatchRecord( unsigned int dest, BatchRecordKind kind, std::size_t len );
+         void endBatchRecord( unsigned int dest );
+         void sendBatch( unsigned int dest, BatchFlushReason reason );
+         void sendDeferredBatches( unsigned int dest );
+         void flushBatch( unsigned int dest, BatchFlushReason reason );
+         void flushBatches( BatchFlushReason reason );
+         void flushExpiredBatches();
+         void batchRegionMetadata( unsigned int dest, CopyData const &cd, unsigned int seq );
+         void batchRequestPut( unsigned int dest, uint64_t origAddr, unsigned int dataDest, uint64_t dstAddr, std::size_t len, std::size_t count, std::size_t ld, unsigned int wdId, WD const *wd, void *hostObject, reg_t hostRegId );
+
       public:
          static const unsigned int MASTER_NODE_NUM = 0;
          typedef struct {
@@ -334,6 +450,23 @@ namespace nanos {
          void broadcastIdle();
          void processSyncRequests();
          void setParentWD(WD *wd);
+
+         /*! \brief Enables per destination aggregation of small puts, region metadata, work done and put requests
+          *  \param size Bytes after which a batch is sent (capped to NetworkAPI::getMaxBatchLen)
+          *  \param time Microseconds a message may wait in a batch
+          *  Must be called before initialize().
+          */
+         void setAggregation( bool enabled, std::size_t size, int time );
+         AggregationStats const &getAggregationStats( unsigned int dest ) const;
+         void printAggregationStats() const;
+         void notifyBatch( unsigned int from, void *buf, std::size_t len );
+         /*! \brief Adds a work done notice to the batch of its destination
+          *  NetworkAPI backends call this when they send the work done requests
+          *  they deferred, so the notice still goes after the data of the task.
+          *  \return false if aggregation is disabled and the backend must send it
+          */
+         bool batchWorkDone( unsigned int dest, void const *remoteWdAddr );
+         void batchPut( unsigned int remoteNode, uint64_t remoteAddr, void const *localPack, std::size_t size, std::size_t count, std::size_t ld, unsigned int wdId, void *hostObject, reg_t hostRegId, unsigned int metaSeq, bool coalesce );
    };
 
 } // namespace nanos
@@ -68,6 +68,9 @@ namespace nanos {
          virtual void processSendDataRequest( SendDataRequest *req ) = 0;
          virtual void synchronizeDirectory( unsigned int node, void *addr ) = 0;
          virtual void broadcastIdle() = 0;
+         //! Sends a buffer of aggregated messages, delivered to Network::notifyBatch on the destination
+         virtual void sendBatch( unsigned int dest, void const *buf, std::size_t len ) = 0;
+         virtual std::size_t getMaxBatchLen() const = 0;
    };
 
 } // namespace nanos
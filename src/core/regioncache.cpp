@@ -83,11 +83,16 @@ AllocatedChunk::AllocatedChunk( RegionCache &owner, uint64_t addr, uint64_t host
    _rooted( rooted ),
    _lruStamp( 0 ),
    _refs( 0 ),
-   _refWdId(),
-   _refLoc(),
+   _refsLock(),
+   _untrackedRefs( 0 ),
    _allocatedRegion( allocatedRegion ),
    _flushable( false ) {
       //*myThread->_file << "region " << allocatedRegion.id << " addr " << (void *) addr<<" hostAddr is " << (void*)hostAddress << " key " << allocatedRegion.key << std::endl;
+      for ( unsigned int idx = 0; idx < MAX_TRACKED_REFERENCES; idx += 1 ) {
+         _refRecords[ idx ]._wd = NULL;
+         _refRecords[ idx ]._count = 0;
+         _refRecords[ idx ]._locations = 0;
+      }
       _newRegions = NEW CacheRegionDictionary( *(allocatedRegion.key) );
       //*myThread->_file << "Created dictionary " << _newRegions << " w/key " << allocatedRegion.key << std::endl;
       ensure(_newRegions->getNumDimensions() > 0, "Invalid object");
@@ -361,9 +366,9 @@ bool AllocatedChunk::NEWaddReadRegion2( BaseAddressSpaceInOps &ops, reg_t reg, u
                               if ( location == 0 ) {
                                  ops.addOpFromHost( region_shape, version, this, copyIdx );
                               } else if ( location != _owner.getMemorySpaceId() ) {
-                                 sys.getSeparateMemory( location ).getCache().lock();
+                                 sys.getSeparateMemory( location ).getCache().readLock();
                                  AllocatedChunk *orig_chunk = sys.getSeparateMemory( location ).getCache().getAllocatedChunk( region_shape, wd, copyIdx );
-                                 sys.getSeparateMemory( location ).getCache().unlock();
+                                 sys.getSeparateMemory( location ).getCache().readUnlock();
                                  orig_chunk->unlock();
                                  ops.addOp( &sys.getSeparateMemory( location ) , region_shape, version, this, orig_chunk, wd, copyIdx );
                               }
@@ -374,9 +379,9 @@ bool AllocatedChunk::NEWaddReadRegion2( BaseAddressSpaceInOps &ops, reg_t reg, u
                            if ( location == 0 ) {
                               ops.addOpFromHost( region_shape, version, this, copyIdx );
                            } else if ( location != _owner.getMemorySpaceId() ) {
-                              sys.getSeparateMemory( location ).getCache().lock();
+                              sys.getSeparateMemory( location ).getCache().readLock();
                               AllocatedChunk *orig_chunk = sys.getSeparateMemory( location ).getCache().getAllocatedChunk( region_shape, wd, copyIdx );
-                              sys.getSeparateMemory( location ).getCache().unlock();
+                              sys.getSeparateMemory( location ).getCache().readUnlock();
                               orig_chunk->unlock();
                               ops.addOp( &sys.getSeparateMemory( location ) , region_shape, version, this, orig_chunk, wd, copyIdx );
                            }
@@ -976,17 +981,22 @@ DeviceOps *AllocatedChunk::getDeviceOps( global_reg_t const &reg, WD const *wd,
 
 void AllocatedChunk::printReferencingWDs() const {
    *(myThread->_file) << "Addr: " << (void*)_hostAddress << " Size: " << _size << " Referencing WDs: [";
-   for ( std::map<WD const *, unsigned int>::const_iterator it = _refWdId.begin(); it != _refWdId.end(); it++ ) {
-      if ( it->second != 0 ) {
-         WD const &wd = *it->first;
-         std::map<int, std::set<int> >::const_iterator itLoc = _refLoc.find( wd.getId() );
-         *(myThread->_file) << "(wd: " << wd.getId() << " desc: " << ( wd.getDescription() != NULL ? wd.getDescription() : "n/a" )  << " count: " << it->second <<" loc: {";
-         for (std::set<int>::const_iterator sIt = itLoc->second.begin(); sIt != itLoc->second.end(); sIt++ ) {
-            *(myThread->_file) << *sIt << " ";
+   for ( unsigned int idx = 0; idx < MAX_TRACKED_REFERENCES; idx += 1 ) {
+      ChunkReference const &r = _refRecords[ idx ];
+      if ( r._count != 0 ) {
+         WD const &wd = *r._wd;
+         *(myThread->_file) << "(wd: " << wd.getId() << " desc: " << ( wd.getDescription() != NULL ? wd.getDescription() : "n/a" )  << " count: " << r._count <<" loc: {";
+         for ( unsigned int loc = 0; loc < 32; loc += 1 ) {
+            if ( r._locations & ( 1U << loc ) ) {
+               *(myThread->_file) << loc << " ";
+            }
          }
          *(myThread->_file) << "}";
       }
    }
+   if ( _untrackedRefs != 0 ) {
+      *(myThread->_file) << "(untracked count: " << _untrackedRefs << ")";
+   }
    *(myThread->_file) << "]" << std::endl;
 }
 
@@ -1339,6 +1349,10 @@ void RegionCache::NEWcopyOut( global_reg_t const &reg, unsigned int version, WD
 RegionCache::RegionCache( memory_space_id_t memSpaceId, Device &cacheArch, enum CacheOptions flags, std::size_t slabSize ) :
    _chunks(),
    _lock(),
+   _readers( 0 ),
+   _exclusive( false ),
+   _exclusiveHolder( NULL ),
+   _exclusiveDepth( 0 ),
    _MAPlock(),
    _device( cacheArch ),
    _memorySpaceId( memSpaceId ),
@@ -1593,18 +1607,61 @@ void RegionCache::copyOut( global_reg_t const &hostMem, uint64_t devBaseAddr, De
 }
 
 void RegionCache::lock() {
-   while ( !_lock.tryAcquire() ) {
+   while ( !tryLock() ) {
       myThread->processTransfers();
    }
 }
 void RegionCache::unlock() {
+   if ( --_exclusiveDepth == 0 ) {
+      _exclusiveHolder = NULL;
+      memoryFence();
+      _exclusive = false;
+   }
    _lock.release();
 }
 bool RegionCache::tryLock() {
    bool result;
    result = _lock.tryAcquire();
+   if ( result && _exclusiveDepth++ == 0 ) {
+      _exclusiveHolder = myThread;
+      _exclusive = true;
+      memoryFence();
+      /* new lookups are held back by _exclusive, wait for the ones in flight; they
+       * may be waiting for transfers, so keep them progressing like lock() does */
+      while ( _readers.value() != 0 ) {
+         myThread->processTransfers();
+      }
+   }
    return result;
 }
+/* Shared access to _chunks: lookups of chunks already present can run
+ * concurrently, only allocation and eviction (lock/tryLock) exclude them.
+ * A thread that already holds the exclusive lock reads under it. */
+void RegionCache::readLock() {
+   while ( !tryReadLock() ) {
+      myThread->processTransfers();
+   }
+}
+bool RegionCache::tryReadLock() {
+   bool result = true;
+   if ( _exclusiveHolder != myThread ) {
+      if ( _exclusive ) {
+         result = false;
+      } else {
+         _readers++;
+         if ( _exclusive ) {
+            _readers--;
+            result = false;
+         }
+      }
+   }
+   return result;
+}
+void RegionCache::readUnlock() {
+   if ( _exclusiveHolder != myThread ) {
+      _readers--;
+   }
+}
 void RegionCache::MAPlock() {
    while ( !_MAPlock.tryAcquire() ) {
       myThread->processTransfers();
@@ -1622,27 +1679,40 @@ unsigned int RegionCache::getVersion( global_reg_t const &reg, WD const &wd, uns
 }
 
 void RegionCache::releaseRegions( MemCacheCopy *memCopies, unsigned int numCopies, WD const &wd ) {
-   while ( !_lock.tryAcquire() ) {
-      //myThread->idle();
-   }
+   bool *free_chunk = (bool *) alloca( numCopies * sizeof(bool) );
+   bool must_free = false;
 
+   readLock();
    for ( unsigned int idx = 0; idx < numCopies; idx += 1 ) {
       AllocatedChunk *chunk = _getAllocatedChunk( memCopies[ idx ]._reg, true, false, wd, idx );
       chunk->removeReference( wd ); //RegionCache::releaseRegions
-      if ( chunk->getReferenceCount() == 0 && ( memCopies[ idx ]._policy == NO_CACHE || memCopies[ idx ]._policy == FPGA ) ) {
-         _chunks.removeChunks( chunk->getHostAddress(), chunk->getSize() );
-         //*myThread->_file << "Delete chunk for idx " << idx << std::endl;
-         if ( VERBOSE_DEV_OPS ) {
-            *(myThread->_file) << "[" << myThread->getId() << "] _device(" << _device.getName() << ").memFree(  memspace=" << _memorySpaceId <<", devAddr="<< (void *)chunk->getAddress() << ", wd="<< wd.getId() << " ["<< (wd.getDescription() != NULL ? wd.getDescription() : "no description") << "], copyIdx="<< idx << " );" << std::endl;
+      free_chunk[ idx ] = chunk->getReferenceCount() == 0 && ( memCopies[ idx ]._policy == NO_CACHE || memCopies[ idx ]._policy == FPGA );
+      must_free = must_free || free_chunk[ idx ];
+   }
+   readUnlock();
+
+   if ( must_free ) {
+      while ( !tryLock() ) {
+         //myThread->idle();
+      }
+      for ( unsigned int idx = 0; idx < numCopies; idx += 1 ) {
+         if ( !free_chunk[ idx ] ) continue;
+         /* look it up again, it may have been referenced or evicted since the shared pass */
+         AllocatedChunk *chunk = _getAllocatedChunk( memCopies[ idx ]._reg, false, false, wd, idx );
+         if ( chunk != NULL && chunk != (AllocatedChunk *) -1 && chunk != (AllocatedChunk *) -2 && chunk->getReferenceCount() == 0 ) {
+            _chunks.removeChunks( chunk->getHostAddress(), chunk->getSize() );
+            //*myThread->_file << "Delete chunk for idx " << idx << std::endl;
+            if ( VERBOSE_DEV_OPS ) {
+               *(myThread->_file) << "[" << myThread->getId() << "] _device(" << _device.getName() << ").memFree(  memspace=" << _memorySpaceId <<", devAddr="<< (void *)chunk->getAddress() << ", wd="<< wd.getId() << " ["<< (wd.getDescription() != NULL ? wd.getDescription() : "no description") << "], copyIdx="<< idx << " );" << std::endl;
+            }
+            _device.memFree( chunk->getAddress(), sys.getSeparateMemory( _memorySpaceId ) );
+            _allocatedBytes -= chunk->getSize();
+            NewNewRegionDirectory::delAccess( memCopies[ idx ]._reg.key, memCopies[ idx ]._reg.id, getMemorySpaceId() );
+            delete chunk;
          }
-         _device.memFree( chunk->getAddress(), sys.getSeparateMemory( _memorySpaceId ) );
-         _allocatedBytes -= chunk->getSize();
-         NewNewRegionDirectory::delAccess( memCopies[ idx ]._reg.key, memCopies[ idx ]._reg.id, getMemorySpaceId() );
-         delete chunk;
       }
+      unlock();
    }
-
-   _lock.release();
 }
 
 uint64_t RegionCache::getDeviceAddress( global_reg_t const &reg, uint64_t baseAddress, AllocatedChunk *chunk ) const {
@@ -1678,7 +1748,7 @@ bool RegionCache::prepareRegions( MemCacheCopy *memCopies, unsigned int numCopie
       //while ( !_lock.tryAcquire() ) {
       //   myThread->idle();
       //}
-      if ( _lock.tryAcquire() ) {
+      if ( tryLock() ) {
          if ( sys.useFineAllocLock() ) {
             sys.allocLock();
          }
@@ -1781,7 +1851,7 @@ bool RegionCache::prepareRegions( MemCacheCopy *memCopies, unsigned int numCopie
          if ( sys.useFineAllocLock() ) {
             sys.allocUnlock();
          }
-         _lock.release();
+         unlock();
 
       } else {
          result = false;
@@ -1796,13 +1866,11 @@ bool RegionCache::prepareRegions( MemCacheCopy *memCopies, unsigned int numCopie
 }
 
 void RegionCache::prepareRegionsToBeCopied( std::set< global_reg_t > const &regs, unsigned int version, std::set< AllocatedChunk * > &chunks, WD const &wd, unsigned int copyIdx ) {
-   while ( !_lock.tryAcquire() ) {
-      //myThread->idle();
-   }
+   readLock();
    for ( std::set< global_reg_t >::iterator it = regs.begin(); it != regs.end(); it++ ) {
       this->_prepareRegionToBeCopied( *it, version, chunks, wd, copyIdx );
    }
-   _lock.release();
+   readUnlock();
 }
 
 void RegionCache::_prepareRegionToBeCopied( global_reg_t const &reg, unsigned int version, std::set< AllocatedChunk * > &chunks, WD const &wd, unsigned int copyIdx ) {
@@ -1810,10 +1878,8 @@ void RegionCache::_prepareRegionToBeCopied( global_reg_t const &reg, unsigned in
    if ( VERBOSE_CACHE ) { *myThread->_file <<"I'm " << myThread->runningOn()->getMemorySpaceId() << ", this is cache " << this->getMemorySpaceId() << " reg " << reg.id << " got chunk " << chunk << " " << wd.getDescription() <<" copyIdx " << copyIdx << std::endl; }
    if ( chunk != NULL ) {
       if ( chunks.count( chunk ) == 0 ) {
-         chunk->lock();
          chunk->addReference( wd, 1 ); //_prepareRegionToBeCopied
          chunks.insert( chunk );
-         chunk->unlock();
       }
    } else {
       fatal("Could not add a reference to a source chunk."); 
@@ -1859,7 +1925,7 @@ bool RegionCache::canAllocateMemory( MemCacheCopy *memCopies, unsigned int numCo
    bool *present_regions = (bool *) alloca( numCopies * sizeof(bool) );
    std::size_t *sizes = (std::size_t *) alloca( numCopies * sizeof(std::size_t) );
    unsigned int needed_chunks = 0;
-   if ( _lock.tryAcquire() ) {
+   if ( tryReadLock() ) {
    
    /* check if the desired region is already allocated */
    for ( unsigned int idx = 0; idx < numCopies; idx += 1 ) {
@@ -1875,7 +1941,7 @@ bool RegionCache::canAllocateMemory( MemCacheCopy *memCopies, unsigned int numCo
       }
    }
 
-   _lock.release();
+   readUnlock();
    //*myThread->_file << __FUNCTION__ << " needed chunks is " << needed_chunks << std::endl;
 
    if ( needed_chunks != 0 ) {
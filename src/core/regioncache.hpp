@@ -24,6 +24,7 @@
 #include "regioncache_decl.hpp"
 #include "processingelement_decl.hpp"
 #include "atomic.hpp"
+#include "lock.hpp"
 
 namespace nanos {
 
@@ -45,8 +46,28 @@ inline std::size_t AllocatedChunk::getSize() const {
 
 inline void AllocatedChunk::addReference( WD const &wd, unsigned int loc ) {
    _refs++;
-   _refWdId[&wd]++;
-   _refLoc[wd.getId()].insert(loc);
+   _refsLock.acquire();
+   ChunkReference *record = NULL;
+   for ( unsigned int idx = 0; idx < MAX_TRACKED_REFERENCES; idx += 1 ) {
+      ChunkReference &r = _refRecords[ idx ];
+      if ( r._count != 0 && r._wd == &wd ) {
+         record = &r;
+         break;
+      } else if ( record == NULL && r._count == 0 ) {
+         record = &r;
+      }
+   }
+   if ( record != NULL ) {
+      if ( record->_count == 0 ) {
+         record->_wd = &wd;
+         record->_locations = 0;
+      }
+      record->_count += 1;
+      record->_locations |= 1U << ( loc % 32 );
+   } else {
+      _untrackedRefs += 1;
+   }
+   _refsLock.release();
    //std::cerr << "add ref to chunk "<< (void*)this << " " << _refs.value() << std::endl;
 }
 
@@ -56,10 +77,17 @@ inline void AllocatedChunk::removeReference( WD const &wd ) {
       *myThread->_file << " removeReference ON A CHUNK WITH 0 REFS!!!" << std::endl;
    }
    _refs--;
-   _refWdId[&wd]--;
-   if ( _refWdId[&wd] == 0 ) {
-      _refLoc[wd.getId()].clear();
+   _refsLock.acquire();
+   unsigned int idx = 0;
+   while ( idx < MAX_TRACKED_REFERENCES && !( _refRecords[ idx ]._count != 0 && _refRecords[ idx ]._wd == &wd ) ) {
+      idx += 1;
+   }
+   if ( idx < MAX_TRACKED_REFERENCES ) {
+      _refRecords[ idx ]._count -= 1;
+   } else if ( _untrackedRefs > 0 ) {
+      _untrackedRefs -= 1;
    }
+   _refsLock.release();
    
    //std::cerr << "del ref to chunk "<< (void*)this << " " << _refs.value() << std::endl;
    //if ( _refs == (unsigned int) -1 ) {
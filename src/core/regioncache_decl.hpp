@@ -27,6 +27,7 @@
 #include "recursivelock_decl.hpp"
 #include "workdescriptor_fwd.hpp"
 #include "processingelement_fwd.hpp"
+#include "basethread_fwd.hpp"
 #include "deviceops_decl.hpp"
 #include "newregiondirectory_decl.hpp"
 #include "memoryops_fwd.hpp"
@@ -53,6 +54,16 @@ namespace nanos {
 
    class AllocatedChunk {
       private:
+         /*! \brief Compact record of the references held by one WD on a chunk,
+          *         kept for diagnostics (see printReferencingWDs).
+          */
+         struct ChunkReference {
+            WD const                     *_wd;
+            unsigned int                  _count;
+            unsigned int                  _locations; //!< bitmask of the addReference call sites
+         };
+         enum { MAX_TRACKED_REFERENCES = 4 };
+
          RegionCache                      &_owner;
          RecursiveLock                     _lock;
          uint64_t                          _address;
@@ -62,8 +73,9 @@ namespace nanos {
          bool                              _rooted;
          unsigned int                      _lruStamp;
          Atomic<unsigned int>              _refs;
-         std::map<WD const *, unsigned int>      _refWdId;
-         std::map<int, std::set<int> >     _refLoc;
+         Lock                              _refsLock;         //!< Only protects _refRecords, never held across other locks
+         ChunkReference                    _refRecords[MAX_TRACKED_REFERENCES];
+         unsigned int                      _untrackedRefs;    //!< References that did not fit in _refRecords
          global_reg_t                      _allocatedRegion;
          bool                              _flushable;
          
@@ -123,7 +135,11 @@ namespace nanos {
          };
       private:
          MemoryMap<AllocatedChunk>  _chunks;
-         RecursiveLock              _lock;
+         RecursiveLock              _lock;             //!< Exclusive access: allocation and eviction of chunks
+         Atomic<unsigned int>       _readers;          //!< Threads currently looking up _chunks in shared mode
+         volatile bool              _exclusive;        //!< Set while _lock is held, blocks new readers
+         BaseThread * volatile      _exclusiveHolder;
+         unsigned int               _exclusiveDepth;   //!< Recursion depth of _lock, only touched by its holder
          RecursiveLock              _MAPlock;
          Device                    &_device;
          //ProcessingElement         &_pe;
@@ -143,8 +159,8 @@ namespace nanos {
          Atomic<unsigned int>       _currentAllocations;
          std::size_t                _allocatedBytes;
 
-         typedef MemoryMap<AllocatedChunk>::MemChunkList ChunkList;
-         typedef MemoryMap<AllocatedChunk>::ConstMemChunkList ConstChunkList;
+         typedef MemoryMap<AllocatedChunk>::MemChunkVector ChunkList;
+         typedef MemoryMap<AllocatedChunk>::ConstMemChunkVector ConstChunkList;
 
          class Op {
                RegionCache &_parent;
@@ -205,6 +221,9 @@ namespace nanos {
          void lock();
          void unlock();
          bool tryLock();
+         void readLock();
+         bool tryReadLock();
+         void readUnlock();
          void MAPlock();
          void MAPunlock();
          bool canCopyFrom( RegionCache const &from ) const;
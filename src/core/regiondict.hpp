@@ -616,9 +616,9 @@ void RegionDictionary< Sparsity >::addRegionAndComputeIntersects( reg_t id, std:
 		public:
 		LocalFunction( RegionDictionary &dict ) : _currentDict( dict ) { } 
 
-		void _recursive ( reg_t this_id, unsigned int total_dims, unsigned int dim, MemoryMap< std::set< reg_t > >::MemChunkList results[], nanos_region_dimension_internal_t current_regions[], std::set<reg_t> *current_sets[], std::map<reg_t, std::set< reg_t > > &resulting_regions, bool compute_region ) {
+		void _recursive ( reg_t this_id, unsigned int total_dims, unsigned int dim, MemoryMap< std::set< reg_t > >::MemChunkVector results[], nanos_region_dimension_internal_t current_regions[], std::set<reg_t> *current_sets[], std::map<reg_t, std::set< reg_t > > &resulting_regions, bool compute_region ) {
 			if ( dim == 0 ) {
-				for ( MemoryMap< std::set< reg_t > >::MemChunkList::const_iterator it = results[ dim ].begin(); it != results[ dim ].end(); it++ ) {
+				for ( MemoryMap< std::set< reg_t > >::MemChunkVector::const_iterator it = results[ dim ].begin(); it != results[ dim ].end(); it++ ) {
 					if ( *(it->second) == NULL ) {
 						*(it->second) = NEW std::set< reg_t >();
 					}
@@ -682,7 +682,7 @@ void RegionDictionary< Sparsity >::addRegionAndComputeIntersects( reg_t id, std:
 					resulting_regions[parent_reg].insert( part );
 				}
 			} else {
-				for ( MemoryMap< std::set< reg_t > >::MemChunkList::const_iterator it = results[ dim ].begin(); it != results[ dim ].end(); it++ ) {
+				for ( MemoryMap< std::set< reg_t > >::MemChunkVector::const_iterator it = results[ dim ].begin(); it != results[ dim ].end(); it++ ) {
 					if ( *(it->second) == NULL ) {
 						*(it->second) = NEW std::set< reg_t >();
 					}
@@ -697,7 +697,7 @@ void RegionDictionary< Sparsity >::addRegionAndComputeIntersects( reg_t id, std:
 
 		void computeIntersections( reg_t this_id, std::map< reg_t, std::set< reg_t > > &resulting_regions ) {
 			RegionNode const *regNode = _currentDict.getRegionNode( this_id );
-			MemoryMap< std::set< reg_t > >::MemChunkList results[ _currentDict.getNumDimensions() ];
+			MemoryMap< std::set< reg_t > >::MemChunkVector results[ _currentDict.getNumDimensions() ];
 
 			for ( int idx = _currentDict.getNumDimensions() - 1; idx >= 0; idx -= 1 ) {
 				std::size_t accessedLength = regNode->getValue();
@@ -719,7 +719,7 @@ void RegionDictionary< Sparsity >::addRegionAndComputeIntersects( reg_t id, std:
 
 			if ( this_id != 1 ) {
 				for ( int idx = _currentDict.getNumDimensions() - 1; idx >= 0; idx -= 1 ) {
-					for ( MemoryMap< std::set< reg_t > >::MemChunkList::const_iterator it = results[ idx ].begin(); it != results[ idx ].end(); it++ ) {
+					for ( MemoryMap< std::set< reg_t > >::MemChunkVector::const_iterator it = results[ idx ].begin(); it != results[ idx ].end(); it++ ) {
 						(*it->second)->insert( this_id );
 					}
 				}
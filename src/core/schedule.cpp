@@ -19,6 +19,7 @@
 
 #include "schedule.hpp"
 #include "atomic.hpp"
+#include "eventcount.hpp"
 #include "processingelement.hpp"
 #include "basethread.hpp"
 #include "smpthread.hpp"
@@ -35,6 +36,8 @@
 
 using namespace nanos;
 
+EventCount Scheduler::_idleEvent;
+
 void SchedulerConf::config (Config &cfg)
 {
    cfg.setOptionsSection ( "Core [Scheduler]", "Policy independent scheduler options"  );
@@ -47,6 +50,33 @@ void SchedulerConf::config (Config &cfg)
 
    cfg.registerConfigOption ( "num-steal", NEW Config::PositiveVar( _numStealAfterSpins ), "Try to steal every so spins (default = 1)" );
    cfg.registerArgOption ( "num-steal", "spins-steal" );
+
+   cfg.registerConfigOption ( "idle-park", NEW Config::FlagOption( _useIdlePark ),
+                              "Idle threads spin for an adaptive amount of time and then park until new work is submitted" );
+   cfg.registerArgOption ( "idle-park", "idle-park" );
+
+   cfg.registerConfigOption ( "idle-park-max-spin", NEW Config::UintVar( _maxIdleSpinTime ),
+                              "Set the maximum time (in usecs) an idle thread spins before parking (default = 100)" );
+   cfg.registerArgOption ( "idle-park-max-spin", "idle-park-max-spin" );
+}
+
+void Scheduler::notifyIdleThreads ( size_t numElems, bool targeted )
+{
+   if ( !sys.getSchedulerConf().getUseIdlePark() ) return;
+
+   if ( targeted ) {
+      _idleEvent.notifyAll();
+      return;
+   }
+
+   SchedulerStats &stats = sys.getSchedulerStats();
+   for ( size_t i = 0; i < numElems; i++ ) {
+      int parked = _idleEvent.getWaiters();
+      if ( parked == 0 ) return;
+      int spinning = stats._idleThreads.value() - parked;
+      if ( stats._readyTasks.value() <= spinning ) return;
+      if ( !_idleEvent.notifyOne() ) return;
+   }
 }
 
 void Scheduler::submit ( WD &wd, bool force_queue )
@@ -67,6 +97,7 @@ void Scheduler::submit ( WD &wd, bool force_queue )
       } else {
          wd_tiedto->getTeam()->getSchedulePolicy().queue( wd_tiedto, wd );
       }
+      notifyIdleThreads( 1, true );
       return;
    }
 
@@ -76,6 +107,7 @@ void Scheduler::submit ( WD &wd, bool force_queue )
       * it in our scheduler system. Global ready task queue will take care about task/thread
       * architecture, while local ready task queue will wait until stealing. */
       mythread->getTeam()->getSchedulePolicy().queue( mythread, wd );
+      notifyIdleThreads();
 
       return;
    }
@@ -93,6 +125,7 @@ void Scheduler::submit ( WD &wd, bool force_queue )
    myThread->unpause();
    // And go on
    WD *next = getMyThreadSafe()->getTeam()->getSchedulePolicy().atSubmit( myThread, wd );
+   notifyIdleThreads();
 
    /* If SchedulePolicy have returned a 'next' value, we have to context switch to
       that WorkDescriptor */
@@ -115,6 +148,7 @@ void Scheduler::submit ( WD ** wds, size_t numElems )
    if ( numElems == 0 ) return;
    
    BaseThread *mythread = myThread;
+   bool targeted = false;
    
    // create a vector of threads for each wd
    BaseThread ** threadList = NEW BaseThread*[numElems];
@@ -122,6 +156,8 @@ void Scheduler::submit ( WD ** wds, size_t numElems )
    {
       WD* wd = wds[i];
       wd->_mcontrol.preInit();
+      wd->submitted();
+      wd->setReady();
       
       // If the wd is tied to anyone
       BaseThread *wd_tiedto = wd->isTiedTo();
@@ -133,6 +169,7 @@ void Scheduler::submit ( WD ** wds, size_t numElems )
          } else {
             //wd_tiedto->getTeam()->getSchedulePolicy().queue( wd_tiedto, wd );
             threadList[i] = wd_tiedto;
+            targeted = true;
          }
          continue;
       }
@@ -142,6 +179,7 @@ void Scheduler::submit ( WD ** wds, size_t numElems )
    
    // Call the scheduling policy
    mythread->getTeam()->getSchedulePolicy().queue( threadList, wds, numElems );
+   notifyIdleThreads( numElems, targeted );
    
    // Release
    delete[] threadList;
@@ -221,6 +259,16 @@ inline void Scheduler::idleLoop ()
 
    ThreadManager *const thread_manager = sys.getThreadManager();
 
+   // Idle-park mode: spin while work is expected to arrive soon, then park on _idleEvent
+   const bool idle_park = sys.getSchedulerConf().getUseIdlePark();
+   const double max_spin_time = sys.getSchedulerConf().getMaxIdleSpinTime() * 1.0e-6;
+   // Parking times out to bound the latency of wakeups that are not notified (e.g. thread stop)
+   const unsigned long long park_timeout = 10000000ULL;
+   // Average time (secs) between becoming idle and getting work, and the resulting spin phase length
+   double avg_idle_time = 0.0;
+   double spin_time = max_spin_time;
+   double idle_start = idle_park ? OS::getMonotonicTime() : 0.0;
+
    WD *current = myThread->getCurrentWD();
    sys.getSchedulerStats()._idleThreads++;
    myThread->setIdle( true );
@@ -295,7 +343,7 @@ inline void Scheduler::idleLoop ()
 
       if ( !next && thread->getTeam() != NULL ) {
          memoryFence();
-         if ( sys.getSchedulerStats()._readyTasks > 0 ) {
+         if ( sys.getSchedulerStats()._readyTasks.value() > 0 ) {
             NANOS_INSTRUMENT ( total_scheds++; )
             NANOS_INSTRUMENT ( unsigned long long begin_sched = (unsigned long long) ( OS::getMonotonicTime() * 1.0e9  ); )
             
@@ -333,6 +381,12 @@ inline void Scheduler::idleLoop ()
 
          NANOS_INSTRUMENT( sys.getInstrumentation()->raisePointEvents(event_num, &Keys[event_start], &Values[event_start]); )
 
+         if ( idle_park ) {
+            // Only spin when work usually shows up before parking would pay off
+            avg_idle_time = 0.75 * avg_idle_time + 0.25 * ( OS::getMonotonicTime() - idle_start );
+            spin_time = avg_idle_time <= max_spin_time ? std::min( 2.0 * avg_idle_time, max_spin_time ) : 0.0;
+         }
+
          thread->setIdle( false );
          sys.getSchedulerStats()._idleThreads--;
 
@@ -344,6 +398,8 @@ inline void Scheduler::idleLoop ()
          sys.getSchedulerStats()._idleThreads++;
          thread->setIdle( true );
 
+         if ( idle_park ) idle_start = OS::getMonotonicTime();
+
          NANOS_INSTRUMENT (total_spins = 0; )
          NANOS_INSTRUMENT (total_blocks = 0; )
          NANOS_INSTRUMENT (total_yields = 0; )
@@ -373,12 +429,29 @@ inline void Scheduler::idleLoop ()
       if ( spins == 0 ) {
          NANOS_INSTRUMENT ( total_spins += init_spins; )
 
-         // Perform yield and/or block
-         thread_manager->idle( yields
+         if ( idle_park ) {
+            if ( OS::getMonotonicTime() - idle_start >= spin_time ) {
+               // Announce ourselves before the last check, so that a submit either
+               // is seen here or sees us parked and notifies the event
+               int key = _idleEvent.prepareWait();
+               if ( sys.getSchedulerStats()._readyTasks.exactValue() == 0 && !thread->hasNextWD() && thread->isRunning() ) {
+                  NANOS_INSTRUMENT ( total_blocks++; )
+                  NANOS_INSTRUMENT ( unsigned long long begin_block = (unsigned long long) ( OS::getMonotonicTime() * 1.0e9  ); )
+                  _idleEvent.wait( key, park_timeout );
+                  NANOS_INSTRUMENT ( unsigned long long end_block = (unsigned long long) ( OS::getMonotonicTime() * 1.0e9  ); )
+                  NANOS_INSTRUMENT ( time_blocks += ( end_block - begin_block ); )
+               } else {
+                  _idleEvent.cancelWait();
+               }
+            }
+         } else {
+            // Perform yield and/or block
+            thread_manager->idle( yields
 #ifdef NANOS_INSTRUMENTATION_ENABLED
-               , total_yields, total_blocks, time_yields, time_blocks
+                  , total_yields, total_blocks, time_yields, time_blocks
 #endif
-               );
+                  );
+         }
 
          spins = init_spins;
       }
@@ -421,7 +494,7 @@ void Scheduler::waitOnCondition (GenericSyncCond *condition)
                //! Second calling scheduler policy at block
                if ( !next ) {
                   memoryFence();
-                  if ( sys.getSchedulerStats()._readyTasks > 0 ) {
+                  if ( sys.getSchedulerStats()._readyTasks.value() > 0 ) {
                      if ( sys.getSchedulerConf().getSchedulerEnabled() )
                         next = thread->getTeam()->getSchedulePolicy().atBlock( thread, current );
                   }
@@ -480,6 +553,7 @@ void Scheduler::wakeUp ( WD *wd )
          ensure( myTeam, "Trying to wake up a WD from a thread without team." );
          myTeam = (myTeam)? myTeam : sys.getMainTeam();
          next = myTeam->getSchedulePolicy().atWakeUp( myThread, *wd );
+         notifyIdleThreads( 1, wd->isTied() );
       }
 
       /* If SchedulePolicy have returned a 'next' value, we have to context switch to
@@ -543,8 +617,7 @@ struct AsyncWorkerBehaviour
          // Since this is the async behavior, set schedule to false:
          // do not prefetch at this point, as the thread will be always prefetching
          if ( Scheduler::inlineWorkAsync ( next, /* schedule */ false ) ) {
-            next->~WorkDescriptor();
-            delete[] ( char * ) next;
+            sys.deleteWD( next );
          }
       }
    }
@@ -867,6 +940,7 @@ void Scheduler::switchHelper (WD *oldWD, WD *newWD, void *arg)
       syncCond->unlock();
    } else if ( &(myThread->getThreadWD()) != oldWD ) {
       myThread->getTeam()->getSchedulePolicy().queue( myThread, *oldWD );
+      notifyIdleThreads();
    }
    myThread->setCurrentWD( *newWD );
 }
@@ -904,8 +978,7 @@ void Scheduler::switchTo ( WD *to )
 
    } else {
       if (inlineWork(to, /*schedule*/ true)) {
-         to->~WorkDescriptor();
-         delete[] (char *)to;
+         sys.deleteWD( to );
       }
    }
 }
@@ -941,8 +1014,7 @@ void Scheduler::exitHelper (WD *oldWD, WD *newWD, void *arg)
 {
     myThread->exitHelperDependent(oldWD, newWD, arg);
     myThread->setCurrentWD( *newWD );
-    oldWD->~WorkDescriptor();
-    delete[] (char *)oldWD;
+    sys.deleteWD( oldWD );
 }
 
 struct ExitBehaviour
@@ -959,8 +1031,7 @@ struct ExitBehaviour
       }
       else {
         if ( Scheduler::inlineWork ( next /*jb merge */, /*schedule*/ true ) ) {
-          next->~WorkDescriptor();
-          delete[] (char *)next;
+          sys.deleteWD( next );
         }
       }
    }
@@ -25,6 +25,7 @@
 #include <algorithm>
 
 #include "atomic.hpp"
+#include "shardedcounter.hpp"
 #include "synchronizedcondition_fwd.hpp"
 
 #include "schedule_decl.hpp"
@@ -74,6 +75,16 @@ inline unsigned int SchedulerConf::getNumStealAfterSpins ( void ) const
    return _numStealAfterSpins;
 }
 
+inline bool SchedulerConf::getUseIdlePark ( void ) const
+{
+   return _useIdlePark;
+}
+
+inline unsigned int SchedulerConf::getMaxIdleSpinTime ( void ) const
+{
+   return _maxIdleSpinTime;
+}
+
 inline const std::string & SchedulePolicy::getName () const
 {
    return _name;
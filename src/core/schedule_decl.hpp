@@ -30,6 +30,8 @@
 
 #include "workdescriptor_decl.hpp"
 #include "atomic_decl.hpp"
+#include "eventcount_decl.hpp"
+#include "shardedcounter_decl.hpp"
 #include "functors_decl.hpp"
 #include "basethread_decl.hpp"
 
@@ -50,6 +52,8 @@ namespace nanos {
          template<class behaviour>
          static void idleLoop (void);
 
+         static EventCount _idleEvent; //!< Idle threads park here when idle-park is enabled
+
       public:
          static bool tryPreOutlineWork ( WD *work );
          static void preOutlineWork ( WD *work );
@@ -86,6 +90,15 @@ namespace nanos {
 
          /*! \brief checks if a WD is elegible to run in a given thread */
          static bool checkBasicConstraints ( WD &wd, BaseThread const &thread );
+
+         /*! \brief Wakes up parked idle threads after new work has been queued (idle-park mode only)
+          *  \param numElems number of WDs that have been queued
+          *  \param targeted the WDs can only run in a given thread, so every parked thread is woken up
+          *
+          *  At most one thread per queued WD is woken up, and only while there are more ready
+          *  tasks than idle threads that are still spinning.
+          */
+         static void notifyIdleThreads ( size_t numElems = 1, bool targeted = false );
    };
 
    class SchedulerConf
@@ -96,9 +109,12 @@ namespace nanos {
          unsigned int                  _numChecks;         //!< Number of checks before schedule
          bool                          _schedulerEnabled;  //!< Scheduler is enabled
          int                           _numStealAfterSpins;//!< Steal every so spins
+         bool                          _useIdlePark;       //!< Idle threads park on an event count instead of yielding/blocking
+         unsigned int                  _maxIdleSpinTime;   //!< Upper bound (usecs) of the adaptive spin phase before parking
       private: /* PRIVATE METHODS */
         //! \brief SchedulerConf default constructor (private)
-        SchedulerConf() : _numSpins(1), _numChecks(1), _schedulerEnabled(true), _numStealAfterSpins(1) {}
+        SchedulerConf() : _numSpins(1), _numChecks(1), _schedulerEnabled(true), _numStealAfterSpins(1),
+                          _useIdlePark(false), _maxIdleSpinTime(100) {}
         //! \brief SchedulerConf copy constructor (private)
         SchedulerConf ( SchedulerConf &sc ) : _numSpins(), _numChecks(), _schedulerEnabled()
         {
@@ -121,6 +137,10 @@ namespace nanos {
          unsigned int getNumStealAfterSpins ( void ) const;
          //! \brief Returns if scheduler is enabled 
          bool getSchedulerEnabled () const;
+         //! \brief Returns if idle threads park on an event count
+         bool getUseIdlePark () const;
+         //! \brief Returns the upper bound (usecs) of the spin phase before parking
+         unsigned int getMaxIdleSpinTime () const;
 
          //! \brief Configure scheduler runtime options
          void config ( Config &cfg );
@@ -130,6 +150,7 @@ namespace nanos {
    {
          friend class WDDeque;
          friend class WDLFQueue;
+         friend class WDStealingDeque;
          friend class WDPriorityQueue<WD::PriorityType>;
          friend class WDPriorityQueue<double>;
          friend class Scheduler;
@@ -141,10 +162,12 @@ namespace nanos {
          friend class SlicerRepeatN;
          friend class SlicerCompoundWD;
       private:
-         Atomic<int>          _createdTasks;
-         Atomic<int>          _readyTasks;
-         Atomic<int>          _idleThreads;
-         Atomic<int>          _totalTasks;
+         /* Updated on every create, submit, pop and exit: each one is sharded per thread.
+          * Use exactValue() where an approximate read is not enough */
+         ShardedCounter       _createdTasks;
+         ShardedCounter       _readyTasks;
+         ShardedCounter       _idleThreads;
+         ShardedCounter       _totalTasks;
       private:
          /*! \brief SchedulerStats copy constructor (private)
           */
@@ -162,17 +185,7 @@ namespace nanos {
 
          int getCreatedTasks();
          int getReadyTasks();
-#ifdef HAVE_NEW_GCC_ATOMIC_OPS
-         int * getReadyTasksAddr( void ) { return &_readyTasks.override(); }
-#else
-         volatile int * getReadyTasksAddr( void ) { return &_readyTasks.override(); }
-#endif
          int getTotalTasks();
-#ifdef HAVE_NEW_GCC_ATOMIC_OPS
-         int * getTotalTasksAddr( void ) { return &_totalTasks.override(); }
-#else
-         volatile int * getTotalTasksAddr( void ) { return &_totalTasks.override(); }
-#endif
    };
 
    class ScheduleTeamData {
@@ -45,6 +45,7 @@
 #include "router.hpp"
 #include "addressspace.hpp"
 #include "globalregt.hpp"
+#include "queuelock.hpp"
 
 #ifdef SPU_DEV
 #include "spuprocessor.hpp"
@@ -99,6 +100,8 @@ using namespace nanos;
 
 System nanos::sys;
 
+__thread System::WDLayout System::_wdLayoutCache[System::_wdLayoutCacheSize];
+
 namespace nanos {
 namespace PMInterfaceType
 {
@@ -113,7 +116,7 @@ System::System () :
       /*jb _numPEs( INT_MAX ), _numThreads( 0 ),*/ _deviceStackSize( 0 ), _profile( false ),
       _instrument( false ), _verboseMode( false ), _summary( false ), _executionMode( DEDICATED ), _initialMode( POOL ),
       _untieMaster( true ), _delayedStart( false ), _synchronizedStart( true ), _alreadyFinished( false ),
-      _predecessorLists( false ), _throttlePolicy ( NULL ),
+      _predecessorLists( false ), _userLockKind( SPIN_LOCK ), _userLockSpins( 1000 ), _teamCacheSize( 4 ), _verifyTaskGraphs( false ), _throttlePolicy ( NULL ),
       _schedStats(), _schedConf(), _defSchedule( "bf" ), _defThrottlePolicy( "hysteresis" ), 
       _defBarr( "centralized" ), _defInstr ( "empty_trace" ), _defDepsManager( "plain" ), _defArch( "smp" ),
       _initializedThreads ( 0 ), /*_targetThreads ( 0 ),*/ _pausedThreads( 0 ),
@@ -129,7 +132,7 @@ System::System () :
 #ifdef NANOS_INSTRUMENTATION_ENABLED
       , _enableEvents(), _disableEvents(), _instrumentDefault("default"), _enableCpuidEvent( false )
 #endif
-      , _lockPoolSize(37), _lockPool( NULL ), _mainTeam (NULL), _simulator(false),  _task_max_retries(1), _affinityFailureCount( 0 )
+      , _lockPoolSize(37), _lockPool( NULL ), _mainTeam (NULL), _teamCache(), _teamCacheLock(), _simulator(false),  _task_max_retries(1), _affinityFailureCount( 0 )
       , _createLocalTasks( false )
       , _verboseDevOps( false )
       , _verboseCopies( false )
@@ -457,6 +460,29 @@ void System::config ()
 		   "Enable lazy reduction privatization" );
    cfg.registerArgOption ( "enable-lazy-privatization", "enable-lazy-privatization" );
 
+   typedef Config::MapVar<UserLockKind> UserLockConfig;
+   UserLockConfig *userLockConfig = NEW UserLockConfig( _userLockKind );
+   userLockConfig->addOption( "spin", SPIN_LOCK )
+                  .addOption( "queue", QUEUE_LOCK );
+   cfg.registerConfigOption( "user-lock", userLockConfig,
+                             "Implementation of omp_lock_t and nanos_init_lock() locks: spin (test-and-set) or queue (fair, parks waiters)" );
+   cfg.registerArgOption( "user-lock", "user-lock" );
+   cfg.registerEnvOption( "user-lock", "NX_USER_LOCK" );
+
+   cfg.registerConfigOption( "user-lock-spins", NEW Config::UintVar( _userLockSpins ),
+                             "Polls of a queue lock waiter before it parks" );
+   cfg.registerArgOption( "user-lock-spins", "user-lock-spins" );
+
+   cfg.registerConfigOption( "team-cache-size", NEW Config::UintVar( _teamCacheSize ),
+                             "Number of ended teams kept to be reused by new teams of the same shape (0 disables it)" );
+   cfg.registerArgOption( "team-cache-size", "team-cache-size" );
+   cfg.registerEnvOption( "team-cache-size", "NX_TEAM_CACHE_SIZE" );
+
+   cfg.registerConfigOption( "tdg-verify", NEW Config::FlagOption( _verifyTaskGraphs ),
+                             "Checks that replayed task graphs order every pair of dependent tasks" );
+   cfg.registerArgOption( "tdg-verify", "tdg-verify" );
+   cfg.registerEnvOption( "tdg-verify", "NX_TDG_VERIFY" );
+
    _schedConf.config( cfg );
 
    _hwloc.config( cfg );
@@ -465,6 +491,8 @@ void System::config ()
    verbose0 ( "Reading Configuration" );
 
    cfg.init();
+
+   QueueLock::setSpins( _userLockSpins );
    
    // Now read compiler-supplied flags
    // Open the own executable
@@ -746,7 +774,7 @@ void System::finish ()
    verbose ( "...thread has been joined" );
 
 
-   ensure( _schedStats._readyTasks == 0, "Ready task counter has an invalid value!");
+   ensure( _schedStats._readyTasks.exactValue() == 0, "Ready task counter has an invalid value!");
 
    verbose ( "NANOS++ statistics");
    verbose ( std::dec << (unsigned int) getCreatedTasks() << " tasks has been executed" );
@@ -828,6 +856,31 @@ void System::finish ()
    ensure(team->size() == 0, "Trying to finish execution, but team is still not empty");
    delete team;
 
+   //! \note deleting cached teams
+   while ( !_teamCache.empty() ) {
+      delete _teamCache.front();
+      _teamCache.pop_front();
+   }
+
+   //! \note joined threads hand their allocators over to the main thread, so remote frees
+   //! pending in their mailboxes are drained (allocators are never deleted, see Allocator::create)
+   for ( ThreadList::iterator it = _workers.begin(); it != _workers.end(); it++ ) {
+      if ( it->second != mythread ) it->second->getAllocator().adopt();
+   }
+   if ( allocator != NULL ) allocator->adopt();
+
+#ifdef NANOS_USE_ALLOCATOR
+   //! \note printing allocator statistics (before threads are deleted)
+   if ( _summary ) {
+      size_t local_frees = 0, remote_frees = 0;
+      for ( ThreadList::iterator it = _workers.begin(); it != _workers.end(); it++ ) {
+         local_frees += it->second->getAllocator().getLocalFrees();
+         remote_frees += it->second->getAllocator().getRemoteFrees();
+      }
+      message0( "=== Allocator frees: " << local_frees << " local, " << remote_frees << " remote" );
+   }
+#endif
+
    //! \note deleting processing elements (but main pe)
    for ( PEList::iterator it = _pes.begin(); it != _pes.end(); it++ ) {
       if ( it->first != (unsigned int)mythread->runningOn()->getId() ) {
@@ -848,9 +901,6 @@ void System::finish ()
    //! \note deleting last processing element
    delete _pes[mythread->runningOn()->getId() ];
 
-   //! \note deleting allocator (if any)
-   if ( allocator != NULL ) free (allocator);
-
    verbose0 ( "NANOS++ shutting down.... end" );
    //! \note printing execution summary
    if ( _summary ) executionSummary();
@@ -858,6 +908,83 @@ void System::finish ()
    _net.finalize(); //this can call exit (because of GASNet)
 }
 
+/*! \brief Computes the chunk layout of a WD (see createWD)
+ *
+ *  \param [out] layout is filled with the offsets and the total size of the chunk
+ */
+void System::computeWDLayout ( WDLayout &layout, size_t num_devices, size_t data_size, size_t data_align, bool alloc_WD,
+                               bool alloc_Data, size_t num_copies, size_t num_dimensions )
+{
+   size_t size_Data, size_DPtrs, size_Dimensions, size_PMD, end_PMD;
+
+   layout._numDevices = num_devices;
+   layout._dataSize = data_size;
+   layout._dataAlign = data_align;
+   layout._numCopies = num_copies;
+   layout._numDimensions = num_dimensions;
+   layout._allocWD = alloc_WD;
+   layout._allocData = alloc_Data;
+
+   // WD doesn't need to compute offset, it will always be the chunk allocated address
+
+   // Computing Data info
+   size_Data = alloc_Data ? data_size : 0;
+   if ( alloc_WD ) layout._offsetData = NANOS_ALIGNED_MEMORY_OFFSET(0, sizeof(WD), data_align );
+   else layout._offsetData = 0; // if there are no wd allocated, it will always be the chunk allocated address
+
+   // Computing Data Device pointers and Data Devicesinfo
+   size_DPtrs    = sizeof(DD *) * num_devices;
+   layout._offsetDPtrs  = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetData, size_Data, __alignof__( DD*) );
+
+   // Computing Copies info
+   if ( num_copies != 0 ) {
+      layout._sizeCopies   = sizeof(CopyData) * num_copies;
+      layout._offsetCopies = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetDPtrs, size_DPtrs, __alignof__(nanos_copy_data_t) );
+      // There must be at least 1 dimension entry
+      size_Dimensions = num_dimensions * sizeof(nanos_region_dimension_internal_t);
+      layout._offsetDimensions = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetCopies, layout._sizeCopies, __alignof__(nanos_region_dimension_internal_t) );
+   } else {
+      layout._sizeCopies = 0;
+      // No dimensions
+      size_Dimensions = 0;
+      layout._offsetCopies = layout._offsetDimensions = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetDPtrs, size_DPtrs, 1);
+   }
+
+   // Computing Internal Data info
+   size_PMD = _pmInterface->getInternalDataSize();
+   if ( size_PMD != 0 ) {
+      layout._offsetPMD = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetDimensions, size_Dimensions, _pmInterface->getInternalDataAlignment() );
+      end_PMD = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetPMD, size_PMD, 1);
+   } else {
+      layout._offsetPMD = layout._offsetDimensions;
+      end_PMD = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetDimensions, size_Dimensions, 1);
+   }
+
+   // Compute Scheduling Data size and total size
+   size_t size_Sched = _defSchedulePolicy->getWDDataSize();
+   if ( size_Sched != 0 ) {
+      layout._offsetSched = NANOS_ALIGNED_MEMORY_OFFSET(end_PMD, 0, _defSchedulePolicy->getWDDataAlignment() );
+      layout._totalSize = NANOS_ALIGNED_MEMORY_OFFSET(layout._offsetSched, size_Sched, 1);
+   } else {
+      layout._offsetSched = end_PMD;
+      layout._totalSize = end_PMD;
+   }
+}
+
+/*! \brief Destroys a WD and releases its chunk
+ *
+ *  When the allocator is enabled, chunks taken from the per-thread allocator by
+ *  createWD or duplicateWD go back to the allocator of the thread that created
+ *  them, where they are reused by the next WD of the same size class.
+ */
+void System::deleteWD ( WD *wd )
+{
+   bool pooled = wd->isChunkPooled();
+   wd->~WorkDescriptor();
+   if ( pooled ) Allocator::deallocate( wd );
+   else delete[] (char *) wd;
+}
+
 /*! \brief Creates a new WD
  *
  *  This function creates a new WD, allocating memory space for device ptrs and
@@ -910,6 +1037,10 @@ void System::finish ()
  *  |   PM Data     |
  *  +---------------+
  *  </pre>
+ *
+ *  The layout of each call site is cached per thread. When the allocator is enabled the
+ *  chunk comes from the per-thread allocator so that it is recycled once the WD is released
+ *  with deleteWD.
  */
 void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, size_t data_size, size_t data_align,
                         void **data, WD *uwg, nanos_wd_props_t *props, nanos_wd_dyn_props_t *dyn_props,
@@ -922,62 +1053,31 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
    unsigned int i;
    char *chunk = 0;
 
-   size_t size_CopyData;
-   size_t size_Data, offset_Data, size_DPtrs, offset_DPtrs, size_Copies, offset_Copies, size_Dimensions, offset_Dimensions, offset_PMD;
-   size_t offset_Sched;
-   size_t total_size;
-
-   // WD doesn't need to compute offset, it will always be the chunk allocated address
+   bool alloc_WD = ( *uwd == NULL );
+   bool alloc_Data = ( data != NULL && *data == NULL );
 
-   // Computing Data info
-   size_Data = (data != NULL && *data == NULL)? data_size:0;
-   if ( *uwd == NULL ) offset_Data = NANOS_ALIGNED_MEMORY_OFFSET(0, sizeof(WD), data_align );
-   else offset_Data = 0; // if there are no wd allocated, it will always be the chunk allocated address
-
-   // Computing Data Device pointers and Data Devicesinfo
-   size_DPtrs    = sizeof(DD *) * num_devices;
-   offset_DPtrs  = NANOS_ALIGNED_MEMORY_OFFSET(offset_Data, size_Data, __alignof__( DD*) );
-
-   // Computing Copies info
-   if ( num_copies != 0 ) {
-      size_CopyData = sizeof(CopyData);
-      size_Copies   = size_CopyData * num_copies;
-      offset_Copies = NANOS_ALIGNED_MEMORY_OFFSET(offset_DPtrs, size_DPtrs, __alignof__(nanos_copy_data_t) );
-      // There must be at least 1 dimension entry
-      size_Dimensions = num_dimensions * sizeof(nanos_region_dimension_internal_t);
-      offset_Dimensions = NANOS_ALIGNED_MEMORY_OFFSET(offset_Copies, size_Copies, __alignof__(nanos_region_dimension_internal_t) );
-   } else {
-      size_Copies = 0;
-      // No dimensions
-      size_Dimensions = 0;
-      offset_Copies = offset_Dimensions = NANOS_ALIGNED_MEMORY_OFFSET(offset_DPtrs, size_DPtrs, 1);
+   // The layout only depends on the call site (identified by its devices) and on the sizes
+   // below, so it is computed once and cached per thread
+   WDLayout &layout = _wdLayoutCache[ ( ( uintptr_t ) devices >> 4 ) % _wdLayoutCacheSize ];
+   if ( layout._devices != devices || layout._numDevices != num_devices || layout._dataSize != data_size ||
+        layout._dataAlign != data_align || layout._numCopies != num_copies || layout._numDimensions != num_dimensions ||
+        layout._allocWD != alloc_WD || layout._allocData != alloc_Data ) {
+      computeWDLayout( layout, num_devices, data_size, data_align, alloc_WD, alloc_Data, num_copies, num_dimensions );
+      layout._devices = devices;
    }
 
-   // Computing Internal Data info and total size
    static size_t size_PMD   = _pmInterface->getInternalDataSize();
-   if ( size_PMD != 0 ) {
-      static size_t align_PMD = _pmInterface->getInternalDataAlignment();
-      offset_PMD = NANOS_ALIGNED_MEMORY_OFFSET(offset_Dimensions, size_Dimensions, align_PMD );
-   } else {
-      offset_PMD = offset_Dimensions;
-      size_PMD = size_Dimensions;
-   }
-   
-   // Compute Scheduling Data size
    static size_t size_Sched = _defSchedulePolicy->getWDDataSize();
-   if ( size_Sched != 0 )
-   {
-      static size_t align_Sched =  _defSchedulePolicy->getWDDataAlignment();
-      offset_Sched = NANOS_ALIGNED_MEMORY_OFFSET(offset_PMD, size_PMD, align_Sched );
-      total_size = NANOS_ALIGNED_MEMORY_OFFSET(offset_Sched,size_Sched,1);
-   }
-   else
-   {
-      offset_Sched = offset_PMD; // Needed by compiler unused variable error
-      total_size = NANOS_ALIGNED_MEMORY_OFFSET(offset_PMD,size_PMD,1);
-   }
+   size_t total_size = layout._totalSize;
 
-   chunk = NEW char[total_size];
+#ifdef NANOS_USE_ALLOCATOR
+   // WD chunks are recycled through the per-thread allocator, unless the caller provided the WD
+   bool pooled = alloc_WD;
+#else
+   bool pooled = false;
+#endif
+   if ( pooled ) chunk = ( char * ) getAllocator().allocate( total_size );
+   else chunk = NEW char[total_size];
    if ( props != NULL ) {
       if (props->clear_chunk)
           memset(chunk, 0, sizeof(char) * total_size);
@@ -985,10 +1085,10 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
 
    // allocating WD and DATA
    if ( *uwd == NULL ) *uwd = (WD *) chunk;
-   if ( data != NULL && *data == NULL ) *data = (chunk + offset_Data);
+   if ( data != NULL && *data == NULL ) *data = (chunk + layout._offsetData);
 
    // allocating Device Data
-   DD **dev_ptrs = ( DD ** ) (chunk + offset_DPtrs);
+   DD **dev_ptrs = ( DD ** ) (chunk + layout._offsetDPtrs);
    for ( i = 0 ; i < num_devices ; i ++ ) dev_ptrs[i] = ( DD* ) devices[i].factory( devices[i].arg );
 
    //std::cerr << "num_copies=" << num_copies <<" copies=" <<copies << " num_dimensions=" <<num_dimensions << " dimensions=" << dimensions<< std::endl;
@@ -998,9 +1098,9 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
 
    // allocating copy-ins/copy-outs
    if ( copies != NULL && *copies == NULL ) {
-      *copies = ( CopyData * ) (chunk + offset_Copies);
-      ::bzero(*copies, size_Copies);
-      *dimensions = ( nanos_region_dimension_internal_t * ) ( chunk + offset_Dimensions );
+      *copies = ( CopyData * ) (chunk + layout._offsetCopies);
+      ::bzero(*copies, layout._sizeCopies);
+      *dimensions = ( nanos_region_dimension_internal_t * ) ( chunk + layout._offsetDimensions );
    }
 
    WD * wd;
@@ -1014,6 +1114,7 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
    
    // Set total size
    wd->setTotalSize(total_size );
+   wd->setChunkPooled( pooled );
    
    if ( wd->getNUMANode() >= (int)sys.getNumNumaNodes() )
       throw NANOS_INVALID_PARAM;
@@ -1023,14 +1124,14 @@ void System::createWD ( WD **uwd, size_t num_devices, nanos_device_t *devices, s
 
    // initializing internal data
    if ( size_PMD > 0) {
-      _pmInterface->initInternalData( chunk + offset_PMD );
-      wd->setInternalData( chunk + offset_PMD );
+      _pmInterface->initInternalData( chunk + layout._offsetPMD );
+      wd->setInternalData( chunk + layout._offsetPMD );
    }
    
    // Create Scheduling data
    if ( size_Sched > 0 ){
-      _defSchedulePolicy->initWDData( chunk + offset_Sched );
-      ScheduleWDData * sched_Data = reinterpret_cast<ScheduleWDData*>( chunk + offset_Sched );
+      _defSchedulePolicy->initWDData( chunk + layout._offsetSched );
+      ScheduleWDData * sched_Data = reinterpret_cast<ScheduleWDData*>( chunk + layout._offsetSched );
       wd->setSchedulerData( sched_Data, /*ownedByWD*/ false );
    }
 
@@ -1162,7 +1263,13 @@ void System::duplicateWD ( WD **uwd, WD *wd)
       total_size = NANOS_ALIGNED_MEMORY_OFFSET(offset_PMD,size_PMD,1);
    }
 
-   chunk = NEW char[total_size];
+#ifdef NANOS_USE_ALLOCATOR
+   bool pooled = ( *uwd == NULL );
+#else
+   bool pooled = false;
+#endif
+   if ( pooled ) chunk = ( char * ) getAllocator().allocate( total_size );
+   else chunk = NEW char[total_size];
 
    // allocating WD and DATA; if size_Data == 0 data keep the NULL value
    if ( *uwd == NULL ) *uwd = (WD *) chunk;
@@ -1196,6 +1303,7 @@ void System::duplicateWD ( WD **uwd, WD *wd)
 
    // Set total size
    (*uwd)->setTotalSize(total_size );
+   (*uwd)->setChunkPooled( pooled );
    
    // initializing internal data
    if ( size_PMD != 0) {
@@ -1372,19 +1480,26 @@ BaseThread * System::getWorker ( unsigned int n )
 void System::acquireWorker ( ThreadTeam * team, BaseThread * thread, bool enter, bool star, bool creator )
 {
    int thId = team->addThread( thread, star, creator );
-   TeamData *data = NEW TeamData();
-   if ( creator ) data->setCreator( true );
 
-   data->setStar(star);
+   //! \note Reusing the team data left by the former member with this id, if any
+   TeamData *data = team->reuseTeamData( thId );
+   if ( data != NULL ) {
+      data->reset();
+   } else {
+      data = NEW TeamData();
 
-   SchedulePolicy &sched = team->getSchedulePolicy();
-   ScheduleThreadData *sthdata = 0;
-   if ( sched.getThreadDataSize() > 0 )
-      sthdata = sched.createThreadData();
+      SchedulePolicy &sched = team->getSchedulePolicy();
+      ScheduleThreadData *sthdata = 0;
+      if ( sched.getThreadDataSize() > 0 )
+         sthdata = sched.createThreadData();
 
-   data->setId(thId);
-   data->setTeam(team);
-   data->setScheduleData(sthdata);
+      data->setId(thId);
+      data->setTeam(team);
+      data->setScheduleData(sthdata);
+   }
+   if ( creator ) data->setCreator( true );
+
+   data->setStar(star);
    if ( creator )
       data->setParentTeamData(thread->getTeamData());
 
@@ -1413,11 +1528,84 @@ int System::getNumThreads( void ) const
    return n;
 }
 
+bool System::reserveTeamMembers ( const ThreadTeam::MemberList &members, const BaseThread *creator )
+{
+   //! \note All members are locked before reserving any of them, so either all of them
+   //! are reserved or none. Callers hold _teamCacheLock, so only one of them locks more
+   //! than one thread at a time.
+   bool available = true;
+   unsigned locked;
+   for ( locked = 0; locked < members.size() && available; locked++ ) {
+      BaseThread *thread = members[locked];
+      if ( thread == creator ) continue;
+
+      thread->lock();
+      // Same conditions as getUnassignedWorker
+      bool cpu_active = thread->runningOn()->isActive();
+      available = ( !_smpPlugin->getBinding() || cpu_active )
+                  && !thread->hasTeam() && !thread->getNextTeam()
+                  && ( !thread->isSleeping() || cpu_active );
+   }
+
+   for ( unsigned i = 0; i < locked; i++ ) {
+      BaseThread *thread = members[i];
+      if ( thread == creator ) continue;
+
+      if ( available ) thread->reserve(); // set team flag only
+      thread->unlock();
+   }
+   return available;
+}
+
+ThreadTeam * System::getCachedTeam ( unsigned nthreads, SchedulePolicy &sched, bool reuse, bool parallel )
+{
+   ThreadTeam *parent = reuse ? myThread->getTeam() : NULL;
+   BaseThread *creator = reuse ? myThread : NULL;
+
+   LockBlock lock( _teamCacheLock );
+   for ( TeamCache::iterator it = _teamCache.begin(); it != _teamCache.end(); ++it ) {
+      ThreadTeam *team = *it;
+      if ( team->isFormedAs( nthreads, sched, parent, creator, parallel )
+           && reserveTeamMembers( team->getMembers(), creator ) ) {
+         _teamCache.erase( it );
+         return team;
+      }
+   }
+   return NULL;
+}
+
 ThreadTeam * System::createTeam ( unsigned nthreads, void *constraints, bool reuse, bool enter, bool parallel )
 {
    //! \note Getting default scheduler
    SchedulePolicy *sched = sys.getDefaultSchedulePolicy();
 
+   //! \note Reusing a team of the same shape, if there is one cached and its members are available
+   ThreadTeam *cached = _teamCacheSize > 0 ? getCachedTeam( nthreads, *sched, reuse, parallel ) : NULL;
+   if ( cached != NULL ) {
+      debug( "Reusing team " << cached << " of " << nthreads << " threads" );
+
+      cached->recycle();
+
+      //! \note Members are added in team id order, so every one gets its former id (and team data)
+      const ThreadTeam::MemberList &members = cached->getMembers();
+      for ( unsigned i = 0; i < members.size(); i++ ) {
+         BaseThread *thread = members[i];
+         if ( reuse && thread == myThread ) {
+            acquireWorker( cached, thread, /* enter */ enter, /* staring */ true, /* creator */ true );
+            continue;
+         }
+         thread->lock();
+         acquireWorker( cached, thread, /*enter*/ enter, /* staring */ parallel, /* creator */ false );
+         thread->setNextTeam( NULL );
+         thread->wakeup();
+         thread->unlock();
+      }
+
+      cached->init();
+
+      return cached;
+   }
+
    //! \note Getting scheduler team data (if any)
    ScheduleTeamData *std = ( sched->getTeamDataSize() > 0 )? sched->createTeamData() : NULL;
 
@@ -1479,8 +1667,20 @@ void System::endTeam ( ThreadTeam *team )
       At the end of the parallel return the claimed cpus
    */
    _threadManager->returnClaimedCpus();
-   
-   delete team;
+
+   //! \note Keeping the team for the next one of the same shape, the least recently ended is evicted
+   ThreadTeam *evicted = team;
+   if ( _teamCacheSize > 0 && !team->getMembers().empty() ) {
+      LockBlock lock( _teamCacheLock );
+      _teamCache.push_front( team );
+      evicted = NULL;
+      if ( _teamCache.size() > _teamCacheSize ) {
+         evicted = _teamCache.back();
+         _teamCache.pop_back();
+      }
+   }
+
+   delete evicted;
 }
 
 void System::waitUntilThreadsPaused ()
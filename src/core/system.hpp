@@ -25,6 +25,7 @@
 #include <vector>
 #include <string>
 #include "schedule_decl.hpp"
+#include "shardedcounter.hpp"
 #include "threadteam.hpp"
 #include "slicer.hpp"
 #include "nanos-int.h"
@@ -63,6 +64,8 @@ inline void System::setVerbose ( bool value ) { _verboseMode = value; }
 
 inline bool System::isSummaryEnabled() const{ return _summary; }
 
+inline System::UserLockKind System::getUserLockKind() const { return _userLockKind; }
+
 inline void System::setInitialMode ( System::InitialMode mode ) { _initialMode = mode; }
 
 inline System::InitialMode System::getInitialMode() const { return _initialMode; }
@@ -90,6 +93,8 @@ inline bool System::getSynchronizedStart ( void ) const { return _synchronizedSt
 inline void System::setPredecessorLists ( bool value ) { _predecessorLists = value; }
 inline bool System::getPredecessorLists ( void ) const { return _predecessorLists; }
 
+inline bool System::verifyTaskGraphs ( void ) const { return _verifyTaskGraphs; }
+
 inline int System::getWorkDescriptorId( void ) { return _atomicWDSeed++; }
 
 inline int System::getNumWorkers() const { return _workers.size(); }
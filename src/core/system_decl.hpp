@@ -68,6 +68,7 @@ namespace nanos {
          // constants
          typedef enum { DEDICATED, SHARED } ExecutionMode;
          typedef enum { POOL, ONE_THREAD } InitialMode;
+         typedef enum { SPIN_LOCK, QUEUE_LOCK } UserLockKind;
          typedef enum { NONE, WRITE_THROUGH, WRITE_BACK, DEFAULT } CachePolicyType;
          typedef Config::MapVar<CachePolicyType> CachePolicyConfig;
 
@@ -83,6 +84,7 @@ namespace nanos {
          typedef std::map<std::string, WorkSharing *> WorkSharings;
          typedef std::multimap<std::string, std::string> ModulesPlugins;
          typedef std::vector<ArchPlugin*> ArchitecturePlugins;
+         typedef std::list<ThreadTeam *> TeamCache;
 
          //! \brief Compiler supplied flags in symbols
          struct SuppliedFlags
@@ -115,6 +117,10 @@ namespace nanos {
          bool                 _synchronizedStart;
          bool                 _alreadyFinished;       //!< \brief Prevent System::finish from being executed more than once.
          bool                 _predecessorLists;      //!< \brief Maintain predecessors list (disabled by default).
+         UserLockKind         _userLockKind;          //!< \brief Implementation of the locks created by the user APIs
+         unsigned int         _userLockSpins;         //!< \brief Polls of a queue lock waiter before it parks
+         unsigned int         _teamCacheSize;         //!< \brief Maximum number of ended teams kept for reuse
+         bool                 _verifyTaskGraphs;      //!< \brief Check the dependencies of replayed task graphs
 
 
          ThrottlePolicy      *_throttlePolicy;
@@ -222,6 +228,8 @@ namespace nanos {
          const int                 _lockPoolSize;
          Lock *                    _lockPool;
          ThreadTeam               *_mainTeam;
+         TeamCache                 _teamCache;       //!< \brief Ended teams, most recently ended first
+         Lock                      _teamCacheLock;
          bool                      _simulator;
 
          //! Specifies the maximum number of times a recoverable task can re-execute (avoids infinite recursion).
@@ -234,6 +242,11 @@ namespace nanos {
          //! \brief Reads environment variables and compiler-supplied flags
          void config ();
          void loadModules();
+
+         //! \brief Reserves all members but creator, or none if any of them is not available
+         bool reserveTeamMembers ( const ThreadTeam::MemberList &members, const BaseThread *creator );
+         //! \brief Returns a cached team of the given shape whose members have been reserved, NULL if none
+         ThreadTeam * getCachedTeam ( unsigned nthreads, SchedulePolicy &sched, bool reuse, bool parallel );
          void loadArchitectures();
          void unloadModules();
 
@@ -257,8 +270,34 @@ namespace nanos {
          void *_watchAddr;
 
       private:
+         /*! \brief Chunk layout of the WDs created from a given call site (see createWD) */
+         struct WDLayout {
+            const nanos_device_t *_devices;      /**< Call site: devices of the WD definition */
+            size_t                _numDevices;
+            size_t                _dataSize;
+            size_t                _dataAlign;
+            size_t                _numCopies;
+            size_t                _numDimensions;
+            bool                  _allocWD;
+            bool                  _allocData;
+            size_t                _offsetData;
+            size_t                _offsetDPtrs;
+            size_t                _sizeCopies;
+            size_t                _offsetCopies;
+            size_t                _offsetDimensions;
+            size_t                _offsetPMD;
+            size_t                _offsetSched;
+            size_t                _totalSize;
+         };
+
+         static const size_t      _wdLayoutCacheSize = 64;
+         static __thread WDLayout _wdLayoutCache[_wdLayoutCacheSize]; /**< Per thread, direct mapped by call site */
+
          PE * createPE ( std::string pe_type, int pid, int uid );
 
+         void computeWDLayout ( WDLayout &layout, size_t num_devices, size_t data_size, size_t data_align, bool alloc_WD,
+                                bool alloc_Data, size_t num_copies, size_t num_dimensions );
+
          //* \brief Prints the Environment Summary (resources, plugins, prog. model, etc.) before the execution
          void environmentSummary( void );
 
@@ -303,6 +342,10 @@ namespace nanos {
 
          void duplicateWD ( WD **uwd, WD *wd );
 
+         /*! \brief Destroys a WD created by createWD or duplicateWD and releases (recycles) its chunk
+          */
+         void deleteWD ( WD *wd );
+
         /* \brief prepares a WD to be scheduled/executed.
          * \param work WD to be set up
          */
@@ -360,11 +403,17 @@ namespace nanos {
          //! \brief Checks if predecessor lists are enabled
          bool getPredecessorLists ( void ) const;
 
+         //! \brief Are replayed task graphs checked against the accesses of their tasks?
+         bool verifyTaskGraphs ( void ) const;
+
          int nextThreadId ();
          unsigned int nextPEId ();
 
          bool isSummaryEnabled() const;
 
+         //! \brief Returns the implementation to use for the locks created by the user APIs
+         UserLockKind getUserLockKind() const;
+
          /*!
           * \brief Returns the maximum number of times a task can try to recover from an error by re-executing itself.
           */
@@ -0,0 +1,329 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "taskgraph.hpp"
+#include "dataaccess.hpp"
+#include "dependenciesdomain.hpp"
+#include "workdescriptor.hpp"
+#include "schedule.hpp"
+#include "system.hpp"
+#include "instrumentation.hpp"
+#include "debug.hpp"
+#include <algorithm>
+#include <alloca.h>
+
+using namespace nanos;
+
+TaskGraph::TaskGraph ( const AdjacencyList &predecessors )
+   : _predecessorOffsets(), _predecessors(), _successorOffsets(), _successors(), _sinks(), _references( 1 )
+{
+   unsigned numNodes = predecessors.size();
+   NodeList numSuccessors( numNodes, 0 );
+
+   _predecessorOffsets.reserve( numNodes + 1 );
+   _predecessorOffsets.push_back( 0 );
+   for ( unsigned node = 0; node < numNodes; node++ ) {
+      for ( const_iterator it = predecessors[node].begin(); it != predecessors[node].end(); it++ ) {
+         ensure( *it < node, "Task graph edges must go from older to newer tasks" );
+         _predecessors.push_back( *it );
+         numSuccessors[*it]++;
+      }
+      _predecessorOffsets.push_back( _predecessors.size() );
+   }
+
+   _successorOffsets.reserve( numNodes + 1 );
+   _successorOffsets.push_back( 0 );
+   for ( unsigned node = 0; node < numNodes; node++ ) {
+      _successorOffsets.push_back( _successorOffsets.back() + numSuccessors[node] );
+      if ( numSuccessors[node] == 0 ) _sinks.push_back( node );
+   }
+
+   // Nodes are visited in order, so the successors of every node end up sorted too
+   _successors.resize( _predecessors.size() );
+   NodeList next( _successorOffsets.begin(), _successorOffsets.end() - 1 );
+   for ( unsigned node = 0; node < numNodes; node++ ) {
+      for ( const_iterator it = beginPredecessors( node ); it != endPredecessors( node ); it++ ) {
+         _successors[next[*it]++] = node;
+      }
+   }
+}
+
+TaskGraphBuilder::Access::Access ( DataAccess const &dataAccess )
+   : _base( (uintptr_t) dataAccess.getAddress() ), _begin( (uintptr_t) dataAccess.getDepAddress() ), _end( 0 ),
+     _dimensions( dataAccess.getDimensions(), dataAccess.getDimensions() + dataAccess.getNumDimensions() ),
+     _lastWriter( -1 ), _readers()
+{
+   // Distance from the first accessed byte to the last one. Dimension 0 is in bytes and every
+   // other dimension is in units of the size of the previous ones.
+   uintptr_t length = 1;
+   if ( !_dimensions.empty() && _dimensions[0].accessed_length > 0 ) {
+      length = _dimensions[0].accessed_length;
+      uintptr_t stride = _dimensions[0].size;
+      for ( unsigned d = 1; d < _dimensions.size(); d++ ) {
+         if ( _dimensions[d].accessed_length > 0 ) length += ( _dimensions[d].accessed_length - 1 ) * stride;
+         stride *= _dimensions[d].size;
+      }
+   }
+   _end = _begin + length;
+}
+
+bool TaskGraphBuilder::Access::sameRegion ( const Access &access ) const
+{
+   if ( _begin != access._begin || _base != access._base || _dimensions.size() != access._dimensions.size() ) return false;
+
+   for ( unsigned d = 0; d < _dimensions.size(); d++ ) {
+      if ( _dimensions[d].size != access._dimensions[d].size ||
+           _dimensions[d].lower_bound != access._dimensions[d].lower_bound ||
+           _dimensions[d].accessed_length != access._dimensions[d].accessed_length ) return false;
+   }
+   return true;
+}
+
+bool TaskGraphBuilder::Access::overlaps ( const Access &access ) const
+{
+   if ( _begin >= access._end || access._begin >= _end ) return false;
+
+   // Regions of different arrays or shapes are only compared by their extent
+   if ( _base != access._base || _dimensions.size() != access._dimensions.size() ) return true;
+   for ( unsigned d = 0; d < _dimensions.size(); d++ ) {
+      if ( _dimensions[d].size != access._dimensions[d].size ) return true;
+   }
+
+   for ( unsigned d = 0; d < _dimensions.size(); d++ ) {
+      nanos_region_dimension_internal_t const &mine = _dimensions[d];
+      nanos_region_dimension_internal_t const &theirs = access._dimensions[d];
+      if ( mine.lower_bound >= theirs.lower_bound + theirs.accessed_length ||
+           theirs.lower_bound >= mine.lower_bound + mine.accessed_length ) return false;
+   }
+   return true;
+}
+
+bool TaskGraphBuilder::addTask ( size_t numDeps, DataAccess const *deps )
+{
+   if ( !isValid() ) return false;
+
+   unsigned node = _predecessors.size();
+   _predecessors.push_back( TaskGraph::NodeList() );
+   TaskGraph::NodeList &predecessors = _predecessors.back();
+
+   for ( size_t i = 0; i < numDeps; i++ ) {
+      DataAccess const &dep = deps[i];
+
+      // if address == NULL, just ignore it
+      if ( dep.getDepAddress() == NULL ) continue;
+
+      if ( dep.isConcurrent() || dep.isCommutative() ) {
+         invalidate( "concurrent and commutative accesses cannot be recorded" );
+         return false;
+      }
+
+      Access access( dep );
+      bool writes = dep.isOutput();
+
+      // Every record starting less than _maxLength bytes before this one may overlap it
+      AccessMap::iterator it = _accesses.lower_bound( access._begin > _maxLength ? access._begin - _maxLength : 0 );
+      for ( ; it != _accesses.end() && it->first < access._end; it++ ) {
+         Access const &record = it->second;
+         if ( !record.overlaps( access ) ) continue;
+
+         if ( record._lastWriter >= 0 && (unsigned) record._lastWriter != node ) {
+            predecessors.push_back( record._lastWriter );
+         }
+         if ( writes ) {
+            for ( TaskGraph::const_iterator reader = record._readers.begin(); reader != record._readers.end(); reader++ ) {
+               if ( *reader != node ) predecessors.push_back( *reader );
+            }
+         }
+      }
+
+      // Only the record of this exact region changes its last writer and readers
+      std::pair<AccessMap::iterator, AccessMap::iterator> range = _accesses.equal_range( access._begin );
+      for ( it = range.first; it != range.second && !it->second.sameRegion( access ); it++ );
+      if ( it == range.second ) {
+         it = _accesses.insert( std::make_pair( access._begin, access ) );
+         _maxLength = std::max( _maxLength, access._end - access._begin );
+      }
+
+      Access &record = it->second;
+      if ( writes ) {
+         record._lastWriter = node;
+         record._readers.clear();
+      } else {
+         record._readers.push_back( node );
+      }
+   }
+
+   std::sort( predecessors.begin(), predecessors.end() );
+   predecessors.erase( std::unique( predecessors.begin(), predecessors.end() ), predecessors.end() );
+
+   return true;
+}
+
+TaskGraph * TaskGraphBuilder::build () const
+{
+   ensure( isValid(), "Building an invalid task graph" );
+   return NEW TaskGraph( _predecessors );
+}
+
+TaskGraphReplay::TaskGraphReplay ( TaskGraph &graph, bool verify )
+   : _graph( graph ), _nodes( graph.getNumNodes(), (DOReplayed *) NULL ), _pending( graph.getNumNodes() ),
+     _submitted( 0 ), _references( 1 ), _sinksLock(), _verifier( verify ? NEW TaskGraphBuilder() : NULL )
+{
+   _graph.reference();
+
+   for ( unsigned node = 0; node < _graph.getNumNodes(); node++ ) {
+      _pending[node] = _graph.getNumPredecessors( node ) + 1;
+   }
+}
+
+TaskGraphReplay::~TaskGraphReplay ()
+{
+   delete _verifier;
+   _graph.unreference();
+}
+
+void TaskGraphReplay::verify ( unsigned node, size_t numDeps, DataAccess const *deps )
+{
+   if ( !_verifier->addTask( numDeps, deps ) ) {
+      fatal0( "Task " << node << " of a task graph replay cannot be verified: " << _verifier->getInvalidReason() );
+   }
+
+   TaskGraph::NodeList const &required = _verifier->getPredecessors( node );
+   for ( TaskGraph::const_iterator it = required.begin(); it != required.end(); it++ ) {
+      if ( !std::binary_search( _graph.beginPredecessors( node ), _graph.endPredecessors( node ), *it ) ) {
+         fatal0( "Task " << node << " of a task graph replay depends on task " << *it
+                 << " but the recorded graph does not order them, record the graph again" );
+      }
+   }
+}
+
+DOSubmit * TaskGraphReplay::createDependableObject ( WorkDescriptor &wd )
+{
+   return NEW DOReplayed( *this, &wd );
+}
+
+void TaskGraphReplay::submit ( DOSubmit &depObj, size_t numDeps, DataAccess const *deps )
+{
+   if ( _submitted == _graph.getNumNodes() ) {
+      fatal0( "More tasks submitted than the " << _graph.getNumNodes() << " of the replayed task graph" );
+   }
+
+   DOReplayed &replayed = static_cast<DOReplayed &>( depObj );
+   unsigned node = _submitted++;
+   replayed.setNode( node );
+
+   if ( _verifier != NULL ) verify( node, numDeps, deps );
+
+   _nodes[node] = &replayed;
+   _references++;
+
+   sys.getDefaultSchedulePolicy()->atCreate( replayed );
+   DependenciesDomain::increaseTasksInGraph();
+   replayed.submitted();
+
+   // Drop the count that kept the node from being released before it was submitted
+   if ( --_pending[node] == 0 ) replayed.dependenciesSatisfied();
+}
+
+void TaskGraphReplay::stop ()
+{
+   if ( _submitted != _graph.getNumNodes() ) {
+      fatal0( "Only " << _submitted << " of the " << _graph.getNumNodes() << " tasks of the replayed task graph were submitted" );
+   }
+
+   delete _verifier;
+   _verifier = NULL;
+}
+
+void TaskGraphReplay::orderAfter ( DependableObject &depObj )
+{
+   // Only the domain reference is left, every replayed task has finished
+   if ( _references.value() == 1 ) return;
+
+   SyncLockBlock lock( _sinksLock );
+   TaskGraph::NodeList const &sinks = _graph.getSinks();
+   for ( TaskGraph::const_iterator it = sinks.begin(); it != sinks.end(); it++ ) {
+      DOReplayed *sink = _nodes[*it];
+      if ( sink != NULL && sink->addSuccessor( depObj ) ) depObj.increasePredecessors();
+   }
+}
+
+void TaskGraphReplay::detach ( DOReplayed &depObj )
+{
+   if ( !_graph.isSink( depObj.getNode() ) ) return;
+
+   SyncLockBlock lock( _sinksLock );
+   _nodes[depObj.getNode()] = NULL;
+}
+
+void TaskGraphReplay::finished ( DOReplayed &depObj )
+{
+   TaskGraph::const_iterator begin = _graph.beginSuccessors( depObj.getNode() );
+   TaskGraph::const_iterator end = _graph.endSuccessors( depObj.getNode() );
+   size_t numSuccessors = end - begin;
+
+   // Same batch release as DependableObject::finished()
+   if ( numSuccessors > 1 ) {
+      WD** immediateSucc = (WD**) alloca( sizeof(WD*) * numSuccessors );
+      WD** pIS = immediateSucc;
+
+      for ( TaskGraph::const_iterator it = begin; it != end; it++ ) {
+         if ( --_pending[*it] != 0 ) continue;
+
+         DOReplayed &succ = *_nodes[*it];
+         NANOS_INSTRUMENT ( depObj.instrument( succ ); )
+
+         if ( !succ.canBeBatchReleased() ) {
+            succ.dependenciesSatisfied();
+            continue;
+         }
+
+         succ.dependenciesSatisfiedNoSubmit();
+
+         WD* wd = succ.getWD();
+         if ( depObj.getWD() != NULL ) {
+            wd->predecessorFinished( depObj.getWD() );
+         }
+
+         *pIS++ = wd;
+      }
+
+      size_t numImmediate = pIS - immediateSucc;
+      if ( numImmediate > 0 ) {
+         DependenciesDomain::decreaseTasksInGraph( numImmediate );
+         Scheduler::submit( immediateSucc, numImmediate );
+      }
+   } else {
+      for ( TaskGraph::const_iterator it = begin; it != end; it++ ) {
+         if ( --_pending[*it] != 0 ) continue;
+
+         NANOS_INSTRUMENT ( depObj.instrument( *_nodes[*it] ); )
+         _nodes[*it]->dependenciesSatisfied();
+      }
+   }
+
+   unreference();
+}
+
+void DOReplayed::finished ()
+{
+   _replay.detach( *this );
+   DependableObject::finished();
+   _replay.finished( *this );
+}
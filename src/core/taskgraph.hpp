@@ -0,0 +1,127 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_TASK_GRAPH
+#define _NANOS_TASK_GRAPH
+
+#include "taskgraph_decl.hpp"
+#include "atomic.hpp"
+#include "lock.hpp"
+#include "dependableobjectwd.hpp"
+
+namespace nanos {
+
+inline unsigned TaskGraph::getNumNodes () const
+{
+   return _predecessorOffsets.size() - 1;
+}
+
+inline unsigned TaskGraph::getNumEdges () const
+{
+   return _predecessors.size();
+}
+
+inline unsigned TaskGraph::getNumPredecessors ( unsigned node ) const
+{
+   return _predecessorOffsets[node+1] - _predecessorOffsets[node];
+}
+
+inline TaskGraph::const_iterator TaskGraph::beginPredecessors ( unsigned node ) const
+{
+   return _predecessors.begin() + _predecessorOffsets[node];
+}
+
+inline TaskGraph::const_iterator TaskGraph::endPredecessors ( unsigned node ) const
+{
+   return _predecessors.begin() + _predecessorOffsets[node+1];
+}
+
+inline TaskGraph::const_iterator TaskGraph::beginSuccessors ( unsigned node ) const
+{
+   return _successors.begin() + _successorOffsets[node];
+}
+
+inline TaskGraph::const_iterator TaskGraph::endSuccessors ( unsigned node ) const
+{
+   return _successors.begin() + _successorOffsets[node+1];
+}
+
+inline const TaskGraph::NodeList & TaskGraph::getSinks () const
+{
+   return _sinks;
+}
+
+inline bool TaskGraph::isSink ( unsigned node ) const
+{
+   return _successorOffsets[node] == _successorOffsets[node+1];
+}
+
+inline void TaskGraph::reference ()
+{
+   _references++;
+}
+
+inline void TaskGraph::unreference ()
+{
+   if ( --_references == 0 ) delete this;
+}
+
+inline unsigned TaskGraphBuilder::getNumTasks () const
+{
+   return _predecessors.size();
+}
+
+inline const TaskGraph::NodeList & TaskGraphBuilder::getPredecessors ( unsigned node ) const
+{
+   return _predecessors[node];
+}
+
+inline void TaskGraphBuilder::invalidate ( const char *reason )
+{
+   if ( _invalidReason == NULL ) _invalidReason = reason;
+}
+
+inline bool TaskGraphBuilder::isValid () const
+{
+   return _invalidReason == NULL;
+}
+
+inline const char * TaskGraphBuilder::getInvalidReason () const
+{
+   return _invalidReason;
+}
+
+inline void TaskGraphReplay::unreference ()
+{
+   if ( --_references == 0 ) delete this;
+}
+
+inline unsigned DOReplayed::getNode () const
+{
+   return _node;
+}
+
+inline void DOReplayed::setNode ( unsigned node )
+{
+   _node = node;
+}
+
+} // namespace nanos
+
+#endif
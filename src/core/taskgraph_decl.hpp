@@ -0,0 +1,271 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+//! \file taskgraph_decl.hpp
+//! \brief Task graph record and replay classes declaration.
+//
+//! \ingroup core_dependencies
+
+#ifndef _NANOS_TASK_GRAPH_DECL_H
+#define _NANOS_TASK_GRAPH_DECL_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+#include "atomic_decl.hpp"
+#include "lock_decl.hpp"
+#include "dataaccess_decl.hpp"
+#include "dependableobjectwd_decl.hpp"
+#include "workdescriptor_fwd.hpp"
+#include "taskgraph_fwd.hpp"
+
+namespace nanos {
+
+   /*! \class TaskGraph
+    *  \brief Immutable dependency graph of the tasks recorded in a domain
+    *
+    *  Applications that submit the same tasks with the same dependencies on every iteration can
+    *  record the graph of one iteration and replay it in the next ones. While a domain records,
+    *  tasks go through the dependencies plugin as usual and a TaskGraphBuilder computes the edges
+    *  between them from their data accesses. While it replays, the n-th task submitted becomes
+    *  the n-th node of the graph and is released by its last predecessor to finish, without
+    *  looking up its dependencies (see TaskGraphReplay).
+    *
+    *  Nodes are numbered in submission order and every edge goes from a lower to a higher node.
+    *  Predecessors and successors are stored as compressed adjacency arrays.
+    */
+   class TaskGraph
+   {
+      public:
+         typedef std::vector<unsigned> NodeList;
+         typedef std::vector<NodeList> AdjacencyList;
+         typedef NodeList::const_iterator const_iterator;
+
+      private:
+         NodeList       _predecessorOffsets; /**< Position of the predecessors of every node in _predecessors */
+         NodeList       _predecessors;       /**< Predecessors of all the nodes, sorted for every node */
+         NodeList       _successorOffsets;   /**< Position of the successors of every node in _successors */
+         NodeList       _successors;         /**< Successors of all the nodes */
+         NodeList       _sinks;              /**< Nodes without successors */
+         Atomic<int>    _references;         /**< Owner plus running replays */
+
+      private:
+         /*! \brief TaskGraph copy constructor (private)
+          */
+         TaskGraph ( const TaskGraph & );
+
+         /*! \brief TaskGraph copy assignment operator (private)
+          */
+         const TaskGraph & operator= ( const TaskGraph & );
+
+         /*! \brief TaskGraph destructor (private), see unreference()
+          */
+         ~TaskGraph () {}
+
+      public:
+         /*! \brief Builds the graph from the sorted predecessors of every node
+          */
+         TaskGraph ( const AdjacencyList &predecessors );
+
+         unsigned getNumNodes () const;
+         unsigned getNumEdges () const;
+
+         unsigned getNumPredecessors ( unsigned node ) const;
+         const_iterator beginPredecessors ( unsigned node ) const;
+         const_iterator endPredecessors ( unsigned node ) const;
+
+         const_iterator beginSuccessors ( unsigned node ) const;
+         const_iterator endSuccessors ( unsigned node ) const;
+
+         const NodeList & getSinks () const;
+         bool isSink ( unsigned node ) const;
+
+         void reference ();
+
+         /*! \brief Drops a reference, the graph is deleted with the last one
+          */
+         void unreference ();
+   };
+
+   /*! \class TaskGraphBuilder
+    *  \brief Computes the edges between tasks from their data accesses, in submission order
+    *
+    *  Readers depend on the last writer of the data they access and writers on the last writer and
+    *  on the readers that came after it, as in the dependencies plugins. Two regions of the same
+    *  array and shape overlap if all their dimensions do; any other pair of accesses is compared by
+    *  its extent in memory, which can add edges that are not needed but never misses one.
+    */
+   class TaskGraphBuilder
+   {
+      private:
+         struct Access
+         {
+            uintptr_t                                        _base;       /**< Base address of the array */
+            uintptr_t                                        _begin;      /**< First byte accessed */
+            uintptr_t                                        _end;        /**< Byte after the last one accessed */
+            std::vector<nanos_region_dimension_internal_t>   _dimensions; /**< Shape of the region */
+            int                                              _lastWriter; /**< Last node writing the region, or -1 */
+            TaskGraph::NodeList                              _readers;    /**< Nodes reading it after the last writer */
+
+            Access ( DataAccess const &dataAccess );
+
+            bool sameRegion ( const Access &access ) const;
+            bool overlaps ( const Access &access ) const;
+         };
+
+         typedef std::multimap<uintptr_t, Access>   AccessMap;
+
+      private:
+         AccessMap                  _accesses;      /**< Accessed regions, by their first byte */
+         uintptr_t                  _maxLength;     /**< Length of the longest region in _accesses */
+         TaskGraph::AdjacencyList   _predecessors;  /**< Predecessors of every node */
+         const char                *_invalidReason; /**< Why the tasks cannot be replayed, NULL if they can */
+
+      private:
+         /*! \brief TaskGraphBuilder copy constructor (private)
+          */
+         TaskGraphBuilder ( const TaskGraphBuilder & );
+
+         /*! \brief TaskGraphBuilder copy assignment operator (private)
+          */
+         const TaskGraphBuilder & operator= ( const TaskGraphBuilder & );
+
+      public:
+         TaskGraphBuilder () : _accesses(), _maxLength( 0 ), _predecessors(), _invalidReason( NULL ) {}
+
+         /*! \brief Adds the next node and computes its predecessors
+          *  \return false if the accesses cannot be replayed (the builder is invalidated)
+          */
+         bool addTask ( size_t numDeps, DataAccess const *deps );
+
+         unsigned getNumTasks () const;
+         const TaskGraph::NodeList & getPredecessors ( unsigned node ) const;
+
+         /*! \brief Marks the recorded tasks as not replayable
+          */
+         void invalidate ( const char *reason );
+         bool isValid () const;
+         const char * getInvalidReason () const;
+
+         /*! \brief Creates the TaskGraph of the tasks added so far
+          */
+         TaskGraph * build () const;
+   };
+
+   /*! \class TaskGraphReplay
+    *  \brief One replay of a TaskGraph in a domain
+    *
+    *  It lives until the domain is done with it (next taskwait) and every replayed task has
+    *  finished. Tasks submitted to the domain after the replay are ordered after its sinks.
+    *  With the tdg-verify option the accesses of the replayed tasks are analysed again, and the
+    *  replay fails if they need an edge that the graph does not have.
+    */
+   class TaskGraphReplay
+   {
+      private:
+         TaskGraph                  &_graph;
+         std::vector<DOReplayed *>   _nodes;      /**< DependableObject of every submitted node */
+         std::vector< Atomic<int> >  _pending;    /**< Unfinished predecessors of every node, plus one until it is submitted */
+         unsigned                    _submitted;  /**< Submitted nodes, only the domain owner submits */
+         Atomic<int>                 _references; /**< Domain plus unfinished nodes */
+         Lock                        _sinksLock;  /**< Protects the sinks in _nodes while tasks are ordered after them */
+         TaskGraphBuilder           *_verifier;   /**< Dependencies of the replayed accesses, if verification is enabled */
+
+      private:
+         /*! \brief TaskGraphReplay copy constructor (private)
+          */
+         TaskGraphReplay ( const TaskGraphReplay & );
+
+         /*! \brief TaskGraphReplay copy assignment operator (private)
+          */
+         const TaskGraphReplay & operator= ( const TaskGraphReplay & );
+
+         /*! \brief TaskGraphReplay destructor (private), see unreference()
+          */
+         ~TaskGraphReplay ();
+
+         /*! \brief Checks that the graph orders the node after every task it needs to wait for
+          */
+         void verify ( unsigned node, size_t numDeps, DataAccess const *deps );
+
+      public:
+         TaskGraphReplay ( TaskGraph &graph, bool verify );
+
+         /*! \brief Creates the DependableObject of a task submitted during the replay
+          */
+         DOSubmit * createDependableObject ( WorkDescriptor &wd );
+
+         /*! \brief Assigns the next node of the graph to a DependableObject from createDependableObject()
+          *  and releases it if its predecessors have already finished
+          */
+         void submit ( DOSubmit &depObj, size_t numDeps, DataAccess const *deps );
+
+         /*! \brief Ends the submission of tasks, all the nodes must have been submitted
+          */
+         void stop ();
+
+         /*! \brief Makes a DependableObject submitted after the replay wait for the replayed tasks
+          */
+         void orderAfter ( DependableObject &depObj );
+
+         /*! \brief Called when a replayed task starts finishing: its successors in the domain are final
+          */
+         void detach ( DOReplayed &depObj );
+
+         /*! \brief Called when a replayed task has finished: releases its successors in the graph
+          */
+         void finished ( DOReplayed &depObj );
+
+         void unreference ();
+   };
+
+   /*! \class DOReplayed
+    *  \brief DOSubmit of a task submitted while its domain replays a TaskGraph
+    */
+   class DOReplayed : public DOSubmit
+   {
+      private:
+         TaskGraphReplay   &_replay;
+         unsigned           _node;     /**< Node of the graph */
+
+      private:
+         /*! \brief DOReplayed copy constructor (private)
+          */
+         DOReplayed ( const DOReplayed & );
+
+         /*! \brief DOReplayed copy assignment operator (private)
+          */
+         const DOReplayed & operator= ( const DOReplayed & );
+
+      public:
+         DOReplayed ( TaskGraphReplay &replay, WorkDescriptor *wd ) : DOSubmit( wd ), _replay( replay ), _node( 0 ) {}
+
+         virtual ~DOReplayed () {}
+
+         unsigned getNode () const;
+         void setNode ( unsigned node );
+
+         /*! \brief Finishes the DependableObject and releases its successors in the graph
+          */
+         virtual void finished ();
+   };
+
+} // namespace nanos
+
+#endif
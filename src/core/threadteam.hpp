@@ -19,6 +19,8 @@
 
 #ifndef _NANOS_THREAD_TEAM_H
 #define _NANOS_THREAD_TEAM_H
+#include <string.h>
+#include <algorithm>
 #include "threadteam_decl.hpp"
 #include "atomic.hpp"
 #include "lock.hpp"
@@ -30,17 +32,25 @@ namespace nanos {
 
 inline ThreadTeam::ThreadTeam ( int maxThreads, SchedulePolicy &policy, ScheduleTeamData *data,
                                 Barrier &barrierImpl, ThreadTeamData & ttd, ThreadTeam * parent )
-                              : _threads(), _idList(), _expectedThreads(), _starSize(0), _idleThreads( 0 ),
+                              : _threads(), _numThreads( 0 ), _expectedThreads(), _finalSize( 0 ), _members(), _memberStars( 0 ),
+                                _teamDataPool( maxThreads, (TeamData *) NULL ), _generation( 0 ), _starSize(0), _idleThreads( 0 ),
                                 _numTasks( 0 ), _barrier(barrierImpl),
                                 _singleGuardCount( 0 ), _schedulePolicy( policy ),
                                 _scheduleData( data ), _threadTeamData( ttd ), _parent( parent ),
                                 _level( parent == NULL ? 0 : parent->getLevel() + 1 ), _creatorId(-1),
                                 _wsDescriptor(NULL), _redList(), _lock()
-{ }
+{
+   _threads.reserve( maxThreads );
+   _expectedThreads.reserve( maxThreads );
+   memset( _wsStorage, 0, sizeof( _wsStorage ) );
+}
 
 inline ThreadTeam::~ThreadTeam ()
 {
    ensure(size() == 0, "Destroying non-empty team!");
+   for ( TeamDataList::iterator it = _teamDataPool.begin(); it != _teamDataPool.end(); ++it ) {
+      delete *it;
+   }
    delete &_barrier;
    delete _scheduleData;
    delete &_threadTeamData;
@@ -58,13 +68,78 @@ inline void ThreadTeam::unlock()
 
 inline unsigned ThreadTeam::size() const
 {
-   return _threads.size();
+   return _numThreads;
 }
 
 inline void ThreadTeam::init ()
 {
    _barrier.init( size() );
    _threadTeamData.init( _parent );
+
+   _members.clear();
+   for ( ThreadTeamList::const_iterator it = _threads.begin(); it != _threads.end(); ++it ) {
+      if ( *it != NULL ) _members.push_back( *it );
+   }
+   _memberStars = _starSize.value();
+}
+
+inline void ThreadTeam::recycle ()
+{
+   ensure( size() == 0 && getFinalSize() == 0, "Recycling non-empty team!" );
+   cleanUpReductionList();
+
+   _threads.clear();
+   _expectedThreads.clear();
+   _numThreads = 0;
+   _finalSize = 0;
+   _starSize = 0;
+   _idleThreads = 0;
+   _numTasks = 0;
+   _singleGuardCount = 0;
+   _level = _parent == NULL ? 0 : _parent->getLevel() + 1;
+   _creatorId = -1;
+   _wsDescriptor = NULL;
+   memset( _wsStorage, 0, sizeof( _wsStorage ) );
+   _generation++;
+}
+
+inline bool ThreadTeam::isFormedAs ( unsigned nthreads, const SchedulePolicy &policy, const ThreadTeam *parent,
+                                     const BaseThread *creator, bool parallel ) const
+{
+   if ( _members.size() != nthreads || &_schedulePolicy != &policy || _parent != parent ) return false;
+   if ( creator == NULL ) {
+      return _creatorId == -1 && _memberStars == ( parallel ? nthreads : 0 );
+   }
+   return _creatorId >= 0 && (unsigned) _creatorId < nthreads && _members[_creatorId] == creator
+          && _memberStars == ( parallel ? nthreads : 1 );
+}
+
+inline const ThreadTeam::MemberList & ThreadTeam::getMembers () const
+{
+   return _members;
+}
+
+inline unsigned ThreadTeam::getGeneration () const
+{
+   return _generation;
+}
+
+inline void ThreadTeam::releaseTeamData ( TeamData *data )
+{
+   unsigned id = data->getId();
+   if ( id < _teamDataPool.size() && _teamDataPool[id] == NULL ) {
+      _teamDataPool[id] = data;
+   } else {
+      delete data;
+   }
+}
+
+inline TeamData * ThreadTeam::reuseTeamData ( unsigned id )
+{
+   if ( id >= _teamDataPool.size() ) return NULL;
+   TeamData *data = _teamDataPool[id];
+   _teamDataPool[id] = NULL;
+   return data;
 }
 
 inline void ThreadTeam::resized ()
@@ -75,34 +150,26 @@ inline void ThreadTeam::resized ()
 
 inline const BaseThread & ThreadTeam::getThread ( int i ) const
 {
+   // No holes in the id space: the i-th valid element is the i-th one
+   if ( _numThreads == _threads.size() && (unsigned) i < _numThreads ) return *_threads[i];
+
    // Return the i-th valid element in _threads
    int j = 0;
-   ThreadTeamList::const_iterator it = _threads.begin();
-   for ( it = _threads.begin(); it != _threads.end(); ++it, ++j ) {
-      if ( i == j ) {
-         return *(it->second);
+   ThreadTeamList::const_iterator it;
+   for ( it = _threads.begin(); it != _threads.end(); ++it ) {
+      if ( *it == NULL ) continue;
+      if ( i == j++ ) {
+         return **it;
       }
    }
 
    // If we didn't returned during the loop, return last thread
-   ThreadTeamList::const_reverse_iterator last = _threads.rbegin();
-   return *(last->second);
+   return *_threads.back();
 }
 
 inline BaseThread & ThreadTeam::getThread ( int i )
 {
-   // Return the i-th valid element in _threads
-   int j = 0;
-   ThreadTeamList::iterator it = _threads.begin();
-   for ( it = _threads.begin(); it != _threads.end(); ++it, ++j ) {
-      if ( i == j ) {
-         return *(it->second);
-      }
-   }
-
-   // If we didn't returned during the loop, return last thread
-   ThreadTeamList::reverse_iterator last = _threads.rbegin();
-   return *(last->second);
+   return const_cast<BaseThread &>( static_cast<const ThreadTeam &>( *this ).getThread( i ) );
 }
 
 inline const BaseThread & ThreadTeam::operator[]  ( int i ) const
@@ -120,11 +187,15 @@ inline unsigned ThreadTeam::addThread ( BaseThread *thread, bool star, bool crea
    unsigned id;
    {
       LockBlock Lock( _lock );
-      for ( id = 0; id < _idList.size(); id++) if ( _idList[id] == false ) break;
-      _threads[id] = thread;
-      _idList[id] = true;
-      _expectedThreads.insert( thread );
-      _barrier.resize( _expectedThreads.size() );
+      for ( id = 0; id < _threads.size(); id++) if ( _threads[id] == NULL ) break;
+      if ( id == _threads.size() ) _threads.push_back( thread );
+      else _threads[id] = thread;
+      _numThreads++;
+      if ( std::find( _expectedThreads.begin(), _expectedThreads.end(), thread ) == _expectedThreads.end() ) {
+         _expectedThreads.push_back( thread );
+         _finalSize = _expectedThreads.size();
+      }
+      _barrier.resize( _finalSize );
    }
    if ( star ) _starSize++;
    if ( creator ) {
@@ -136,24 +207,22 @@ inline unsigned ThreadTeam::addThread ( BaseThread *thread, bool star, bool crea
 inline size_t ThreadTeam::removeThread ( unsigned id )
 {
    LockBlock Lock( _lock );
-   _threads.erase( id );
-   _idList[id] = false;
-   return ( _threads.size() );
+   _threads[id] = NULL;
+   _numThreads--;
+   // Trailing free id's are dropped, so getThread keeps its fast path
+   while ( !_threads.empty() && _threads.back() == NULL ) _threads.pop_back();
+   return _numThreads;
 }
 
 inline BaseThread * ThreadTeam::popThread ( )
 {
    BaseThread * thread;
    {
-      // \todo It will be better to use _threads/_idList[] idiom
       LockBlock Lock( _lock );
-      ThreadTeamList::iterator last = _threads.end();
-      ThreadTeamIdList::iterator lastId = _idList.end();
-      --last;
-      --lastId;
-      thread = last->second;
-      lastId->second = false;
-      _threads.erase( last );
+      thread = _threads.back();
+      _threads.pop_back();
+      _numThreads--;
+      while ( !_threads.empty() && _threads.back() == NULL ) _threads.pop_back();
    }
    return thread;
 }
@@ -163,6 +232,8 @@ inline nanos_ws_desc_t  *ThreadTeam::getWorkSharingDescriptor( void ) { return _
 
 inline nanos_ws_desc_t **ThreadTeam::getWorkSharingDescriptorAddr( void ) { return &_wsDescriptor; }
 
+inline void *ThreadTeam::getWorkSharingStorage( unsigned slot ) { return &_wsStorage[slot * NANOS_WS_SLOT_SIZE]; }
+
 inline void ThreadTeam::barrier()
 {
    _barrier.barrier( myThread->getTeamId() );
@@ -210,8 +281,8 @@ inline unsigned ThreadTeam::getStarringThreads( BaseThread **list_of_threads ) c
    BaseThread *thread;
 
    for ( it = _threads.begin(); it != _threads.end(); it++ ) {
-      thread = it->second;
-      if ( thread->isStarring( this ) ) {
+      thread = *it;
+      if ( thread != NULL && thread->isStarring( this ) ) {
          list_of_threads[nThreadsQuery++] = thread;
       }
    }
@@ -230,8 +301,8 @@ inline unsigned ThreadTeam::getSupportingThreads( BaseThread **list_of_threads )
    BaseThread *thread;
 
    for ( it = _threads.begin(); it != _threads.end(); it++ ) {
-      thread = it->second;
-      if ( !thread->isStarring( this ) ) {
+      thread = *it;
+      if ( thread != NULL && !thread->isStarring( this ) ) {
          list_of_threads[nThreadsQuery++] = thread;
       }
    }
@@ -259,6 +330,37 @@ inline void ThreadTeam::computeVectorReductions ( void )
    }
 }
 
+inline bool ThreadTeam::canCombineReductions ( void ) const
+{
+   ReductionList::const_iterator it;
+   for ( it = _redList.begin(); it != _redList.end(); it++) {
+      if ( (*it)->vop ) return false;
+   }
+   return !_redList.empty();
+}
+
+inline void ThreadTeam::combineReductions ( unsigned dst, unsigned src )
+{
+   nanos_reduction_t *red;
+   ReductionList::iterator it;
+   for ( it = _redList.begin(); it != _redList.end(); it++) {
+      red = *it;
+      char *privates = reinterpret_cast<char*>(red->privates);
+      red->bop(privates + dst * red->element_size, privates + src * red->element_size, red->num_scalars);
+   }
+}
+
+inline void ThreadTeam::computeCombinedReductions ( unsigned root )
+{
+   nanos_reduction_t *red;
+   ReductionList::iterator it;
+   for ( it = _redList.begin(); it != _redList.end(); it++) {
+      red = *it;
+      char *privates = reinterpret_cast<char*>(red->privates);
+      red->bop(red->original, privates + root * red->element_size, red->num_scalars);
+   }
+}
+
 inline void *ThreadTeam::getReductionPrivateData ( void* s )
 {
    ReductionList::iterator it;
@@ -278,38 +380,44 @@ inline nanos_reduction_t *ThreadTeam::getReduction ( void* s )
    return NULL;
 }
 
-inline size_t ThreadTeam::getFinalSize ( void ) const { return _expectedThreads.size(); }
+inline size_t ThreadTeam::getFinalSize ( void ) const { return _finalSize; }
 
 inline bool ThreadTeam::isStable ( void )
 {
    LockBlock Lock( _lock );
-   bool is_stable = _threads.size() == _expectedThreads.size();
-   if ( is_stable ) {
-      // If first condition is met, we keep looking:
-      // _threads is a std::map (ordered by key) so we will dump all the values
-      // into a temp set in order to compare with a linear cost
-      ThreadSet threads_set;
-      ThreadTeamList::const_iterator it;
-      for ( it = _threads.begin(); it != _threads.end(); ++it ) {
-         threads_set.insert( (it->second) );
+   if ( _numThreads != _finalSize ) return false;
+
+   // Neither list has repeated threads, so being the same size it is enough
+   // to find every member among the expected ones
+   ThreadTeamList::const_iterator it;
+   for ( it = _threads.begin(); it != _threads.end(); ++it ) {
+      if ( *it != NULL && std::find( _expectedThreads.begin(), _expectedThreads.end(), *it ) == _expectedThreads.end() ) {
+         return false;
       }
-      is_stable = _expectedThreads == threads_set;
    }
-   return is_stable;
+   return true;
 }
 
 inline void ThreadTeam::addExpectedThread( BaseThread *thread )
 {
    LockBlock Lock( _lock );
-   _expectedThreads.insert( thread );
-   _barrier.resize( _expectedThreads.size() );
+   if ( std::find( _expectedThreads.begin(), _expectedThreads.end(), thread ) == _expectedThreads.end() ) {
+      _expectedThreads.push_back( thread );
+      _finalSize = _expectedThreads.size();
+   }
+   _barrier.resize( _finalSize );
 }
 
 inline void ThreadTeam::removeExpectedThread( BaseThread *thread )
 {
    LockBlock Lock( _lock );
-   _expectedThreads.erase( thread );
-   _barrier.resize( _expectedThreads.size() );
+   MemberList::iterator it = std::find( _expectedThreads.begin(), _expectedThreads.end(), thread );
+   if ( it != _expectedThreads.end() ) {
+      *it = _expectedThreads.back();
+      _expectedThreads.pop_back();
+      _finalSize = _expectedThreads.size();
+   }
+   _barrier.resize( _finalSize );
 }
 
 } // namespace nanos
@@ -26,6 +26,10 @@
 #include "schedule_decl.hpp"
 #include "barrier_decl.hpp"
 #include "task_reduction_decl.hpp"
+#include "allocator_decl.hpp"
+
+#define NANOS_WS_TEAM_SLOTS 8                    /**< Number of worksharing data slots preallocated in every team */
+#define NANOS_WS_SLOT_SIZE  (4*NANOS_CACHELINE)  /**< Size in bytes of every worksharing data slot */
 
 
 namespace nanos {
@@ -52,16 +56,22 @@ namespace nanos {
 
    class ThreadTeam
    {
+      public:
+         typedef std::vector<BaseThread *>         MemberList;     /**< Flat list of team members */
       private:
          typedef std::list<nanos_reduction_t*>     ReductionList;  /**< List of Reduction op's (Bursts) */
-         typedef std::map<unsigned, BaseThread *>  ThreadTeamList; /**< List of team members */
-         typedef std::map<unsigned, bool>          ThreadTeamIdList; /**< List of team members */
+         typedef std::vector<BaseThread *>         ThreadTeamList; /**< Team members indexed by team id (NULL if the id is free) */
+         typedef std::vector<TeamData *>           TeamDataList;   /**< Team data left by former members, indexed by team id */
          typedef std::list<TaskReduction *>        task_reduction_list_t;  //< List of task reductions type
-         typedef std::set<BaseThread *>            ThreadSet;
 
-         ThreadTeamList               _threads;          /**< Threads that make up the team */
-         ThreadTeamIdList             _idList;           /**< List of id usage (reusing old id's) */
-         ThreadSet                    _expectedThreads;  /**< Threads expected to form the team */
+         ThreadTeamList               _threads;          /**< Threads that make up the team (reusing old id's) */
+         unsigned                     _numThreads;       /**< Number of valid entries in _threads */
+         MemberList                   _expectedThreads;  /**< Threads expected to form the team */
+         unsigned                     _finalSize;        /**< Number of threads expected to form the team */
+         MemberList                   _members;          /**< Threads that formed the team at init(), in team id order */
+         unsigned                     _memberStars;      /**< Number of starring threads at init() */
+         TeamDataList                 _teamDataPool;     /**< Team data kept to be reused by the next member with the same id */
+         unsigned                     _generation;       /**< Number of times the team has been recycled */
          Atomic<size_t>               _starSize;
          int                          _idleThreads;
          int                          _numTasks;
@@ -78,6 +88,7 @@ namespace nanos {
          int                          _level;            /**< Nesting level of the team */
          int                          _creatorId;        /**< Team Id of the thread that created the team */
          nanos_ws_desc_t             *_wsDescriptor;     /**< Worksharing queue (pointer managed due specific atomic op's over these pointers) */
+         char                         _wsStorage[NANOS_WS_TEAM_SLOTS * NANOS_WS_SLOT_SIZE]; /**< Zero initialized storage for worksharing plugins data */
          ReductionList                _redList;          /**< Reduction List */
          Lock                         _lock;
       private:
@@ -117,6 +128,43 @@ namespace nanos {
           */
          void init ();
 
+         /*! \brief Prepares an ended team to be formed again
+          *
+          *  The barrier, the schedule team data and the team data left by the former members are
+          *  kept, the per-episode state is reset and the team generation is bumped.
+          *  It *must* be called before any thread is added back to the team.
+          */
+         void recycle ();
+
+         /*! \brief Returns whether the team was formed, at its last init(), as a team of nthreads
+          *  using policy, nested in parent, created by creator (NULL if none) and with all its
+          *  threads starring (parallel) or only its creator.
+          */
+         bool isFormedAs ( unsigned nthreads, const SchedulePolicy &policy, const ThreadTeam *parent,
+                           const BaseThread *creator, bool parallel ) const;
+
+         /*! \brief Returns the threads that formed the team at its last init(), in team id order
+          */
+         const MemberList & getMembers () const;
+
+         /*! \brief Returns the number of times the team has been recycled
+          *
+          *  Data cached by team pointer (e.g. in schedule thread data) is still valid after a
+          *  generation bump only if it does not depend on the previous episode.
+          */
+         unsigned getGeneration () const;
+
+         /*! \brief Keeps the TeamData of a leaving member for the next thread that gets its id
+          *
+          *  It *must* be called before the member is removed from the team. If there is already
+          *  a TeamData kept for that id, data is deleted.
+          */
+         void releaseTeamData ( TeamData *data );
+
+         /*! \brief Returns (and forgets) the TeamData kept for team id 'id', NULL if none
+          */
+         TeamData * reuseTeamData ( unsigned id );
+
          /*! This method should be called when there's a change in the team size to readjust all structures
           *  \warn Not implemented yet!
           */
@@ -177,6 +225,13 @@ namespace nanos {
          */
          nanos_ws_desc_t **getWorkSharingDescriptorAddr( void );
 
+        /*! \brief returns the slot-th block of NANOS_WS_SLOT_SIZE bytes of team worksharing storage
+         *
+         *  Worksharing plugins use these blocks for their descriptor data instead of allocating
+         *  it on every worksharing; they are responsible of knowing when a block can be reused.
+         */
+         void *getWorkSharingStorage( unsigned slot );
+
         /*! \brief Return number of starring thread
          */
          unsigned getNumStarringThreads( void ) const;
@@ -213,6 +268,22 @@ namespace nanos {
          */
          void computeVectorReductions ( void );
 
+        /*! \brief Returns whether the pending reductions can be combined pairwise
+         *
+         *  True if there are reductions and none of them is a vector reduction (which needs all
+         *  the private copies at once). Barriers may then use combineReductions and
+         *  computeCombinedReductions instead of computeVectorReductions.
+         */
+         bool canCombineReductions ( void ) const;
+
+        /*! \brief Combines the private reduction data of thread 'src' into the one of thread 'dst'
+         */
+         void combineReductions ( unsigned dst, unsigned src );
+
+        /*! \brief Compute reductions whose private copies were already combined into the one of thread 'root'
+         */
+         void computeCombinedReductions ( unsigned root );
+
         /*! \brief Get final size
          */
          size_t getFinalSize ( void ) const;
@@ -28,6 +28,7 @@
 #include "dependableobject.hpp"
 #include "atomic.hpp"
 #include "lock.hpp"
+#include "smallvector.hpp"
 
 namespace nanos {
 
@@ -85,7 +86,7 @@ inline void TrackableObject::setReader ( DependableObject &reader )
 
 inline bool TrackableObject::hasReader ( DependableObject &depObj )
 {
-   return ( find( _versionReaders.begin(), _versionReaders.end(), &depObj ) != _versionReaders.end() );
+   return ( std::find( _versionReaders.begin(), _versionReaders.end(), &depObj ) != _versionReaders.end() );
 }
 
 inline void TrackableObject::flushReaders ( )
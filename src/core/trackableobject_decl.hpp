@@ -25,6 +25,7 @@
 #include "commutationdepobj_decl.hpp"
 #include "atomic_decl.hpp"
 #include "lock_decl.hpp"
+#include "smallvector_decl.hpp"
 
 namespace nanos {
 
@@ -34,7 +35,7 @@ namespace nanos {
    class TrackableObject
    {
       public:
-         typedef std::list< DependableObject *> DependableObjectList; /**< Type list of DependableObject */
+         typedef SmallVector< DependableObject *, 4 > DependableObjectList; /**< Type list of DependableObject, the first readers are kept inline */
       private:
          DependableObject      *_lastWriter; /**< Points to the last DependableObject registered as writer of the TrackableObject */
          DependableObjectList   _versionReaders; /**< List of readers of the last version of the object */
@@ -30,6 +30,24 @@
 
 namespace nanos {
 
+#ifdef NANOS_INSTRUMENTATION_ENABLED
+/*! \brief Raises a num-ready point event once every NANOS_NUM_READY_SAMPLING queue operations of the thread
+ *
+ *  Reading the ready task counter sums all its shards, which would give back on every queue
+ *  operation what sharding saves on its updates.
+ */
+#define NANOS_NUM_READY_SAMPLING 64
+inline void raiseNumReadyEvent ( void )
+{
+   static __thread unsigned ops = 0;
+   if ( ( ops++ % NANOS_NUM_READY_SAMPLING ) != 0 ) return;
+
+   static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("num-ready");
+   nanos_event_value_t nb = (nanos_event_value_t ) sys.getReadyNum();
+   sys.getInstrumentation()->raisePointEvents(1, &key, &nb );
+}
+#endif
+
 inline WDDeque::WDDeque( bool enableDeviceCounter ) : _dq(), _lock(), _nelems(0), _ndevs(), _deviceCounter( enableDeviceCounter )
 {
    if ( _deviceCounter ) {
@@ -59,8 +77,8 @@ inline void WDDeque::push_front ( WorkDescriptor *wd )
          }
       }
 
-      int tasks = ++( sys.getSchedulerStats()._readyTasks );
-      increaseTasksInQueues(tasks);
+      ++( sys.getSchedulerStats()._readyTasks );
+      increaseTasksInQueues();
       memoryFence();
    }
 }
@@ -78,8 +96,8 @@ inline void WDDeque::push_back ( WorkDescriptor *wd )
          }
       }
 
-      int tasks = ++( sys.getSchedulerStats()._readyTasks );
-      increaseTasksInQueues(tasks);
+      ++( sys.getSchedulerStats()._readyTasks );
+      increaseTasksInQueues();
       memoryFence();
    }
 }
@@ -103,8 +121,8 @@ inline void WDDeque::push_front( WD** wds, size_t numElems )
          }
       }
    }
-   int tasks = sys.getSchedulerStats()._readyTasks += numElems;
-   increaseTasksInQueues(tasks,numElems);
+   sys.getSchedulerStats()._readyTasks += numElems;
+   increaseTasksInQueues(numElems);
 }
 
 inline void WDDeque::push_back( WD** wds, size_t numElems )
@@ -121,8 +139,8 @@ inline void WDDeque::push_back( WD** wds, size_t numElems )
          }
       }
    }
-   int tasks = sys.getSchedulerStats()._readyTasks += numElems;
-   increaseTasksInQueues(tasks,numElems);
+   sys.getSchedulerStats()._readyTasks += numElems;
+   increaseTasksInQueues(numElems);
 }
 
 struct NoConstraints
@@ -190,8 +208,8 @@ inline WorkDescriptor * WDDeque::popFrontWithConstraints ( BaseThread const *thr
                       }
                    }
 
-                   int tasks = --(sys.getSchedulerStats()._readyTasks);
-                   decreaseTasksInQueues(tasks);
+                   --( sys.getSchedulerStats()._readyTasks );
+                   decreaseTasksInQueues();
                }
                break;
             }
@@ -267,8 +285,8 @@ inline WorkDescriptor * WDDeque::popBackWithConstraints ( BaseThread const *thre
                         _ndevs[( found->getDevices()[i]->getDevice() )]--;
                      }
                   }
-                  int tasks = --(sys.getSchedulerStats()._readyTasks);
-                  decreaseTasksInQueues(tasks);
+                  --( sys.getSchedulerStats()._readyTasks );
+                  decreaseTasksInQueues();
                }
                break;
             }
@@ -310,8 +328,8 @@ inline bool WDDeque::removeWDWithConstraints( BaseThread *thread, WorkDescriptor
                         _ndevs[( this_wd->getDevices()[i]->getDevice() )]--;
                      }
                   }
-                  int tasks = --(sys.getSchedulerStats()._readyTasks);
-                  decreaseTasksInQueues(tasks);
+                  --( sys.getSchedulerStats()._readyTasks );
+                  decreaseTasksInQueues();
                }
                (*next)->setMyQueue( NULL );
                return true;
@@ -323,19 +341,15 @@ inline bool WDDeque::removeWDWithConstraints( BaseThread *thread, WorkDescriptor
    return false;
 }
 
-inline void WDDeque::increaseTasksInQueues( int tasks, int increment )
+inline void WDDeque::increaseTasksInQueues( int increment )
 {
-   NANOS_INSTRUMENT(static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("num-ready");)
-   NANOS_INSTRUMENT( nanos_event_value_t nb =  (nanos_event_value_t ) tasks );
-   NANOS_INSTRUMENT(sys.getInstrumentation()->raisePointEvents(1, &key, &nb );)
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
    _nelems += increment;
 }
 
-inline void WDDeque::decreaseTasksInQueues( int tasks, int decrement )
+inline void WDDeque::decreaseTasksInQueues( int decrement )
 {
-   NANOS_INSTRUMENT(static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("num-ready");)
-   NANOS_INSTRUMENT( nanos_event_value_t nb =  (nanos_event_value_t ) tasks );
-   NANOS_INSTRUMENT(sys.getInstrumentation()->raisePointEvents(1, &key, &nb );)
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
    _nelems -= decrement;
 }
 
@@ -483,7 +497,7 @@ inline WorkDescriptor * WDLFQueue::pop_front ( BaseThread *thread )
                                  (void *) head,
                                  (void *) NANOS_ABA_COMPOSE(next,head)) ) { // Try to swing _head to next node
               /*int tasks =*/ --(sys.getSchedulerStats()._readyTasks);
-              //decreaseTasksInQueues(tasks);
+              //decreaseTasksInQueues();
               if ( Scheduler::checkBasicConstraints( *wd, *thread) /* && Constraints::check(wd,*thread) FIXME*/ ) {
                  if ( !wd->dequeue( &swd ) ) {
                     NANOS_ABA_PTR(head)->setWD(wd);
@@ -514,6 +528,235 @@ inline bool WDLFQueue::removeWD( BaseThread *thread, WorkDescriptor *toRem, Work
    return false;
 }
 
+/*******************
+ * WDStealingDeque *
+ *******************/
+
+inline WDStealingDeque::WDStealingDeque( long initialSize ) : _owner( NULL ), _buffer( NULL ), _bottom( 0 ), _top( 0 ),
+   _overflow( false /* enableDeviceCounter */ )
+{
+   long size = 1;
+   while ( size < initialSize ) size <<= 1;
+   _buffer = allocateBuffer( size, NULL );
+}
+
+inline WDStealingDeque::~WDStealingDeque()
+{
+   Buffer *buffer = _buffer;
+   while ( buffer != NULL ) {
+      Buffer *prev = buffer->_prev;
+      delete[] buffer->_wds;
+      delete buffer;
+      buffer = prev;
+   }
+}
+
+inline WDStealingDeque::Buffer * WDStealingDeque::allocateBuffer ( long size, Buffer *prev )
+{
+   Buffer *buffer = NEW Buffer();
+   buffer->_size = size;
+   buffer->_prev = prev;
+   buffer->_wds = NEW WorkDescriptor *[size];
+   return buffer;
+}
+
+inline WDStealingDeque::Buffer * WDStealingDeque::grow ( Buffer *buffer, long bottom, long top )
+{
+   Buffer *bigger = allocateBuffer( buffer->_size * 2, buffer );
+   for ( long i = top; i < bottom; i++ ) {
+      bigger->_wds[ i & ( bigger->_size - 1 ) ] = buffer->_wds[ i & ( buffer->_size - 1 ) ];
+   }
+   // Old buffer is not released: thieves may still be reading from it
+   memoryFence();
+   _buffer = bigger;
+   return bigger;
+}
+
+inline void WDStealingDeque::setOwner ( BaseThread *owner )
+{
+   if ( _owner != owner ) _owner = owner;
+}
+
+inline BaseThread * WDStealingDeque::getOwner ( void ) const
+{
+   return _owner;
+}
+
+inline bool WDStealingDeque::empty ( void ) const
+{
+   return _bottom.value() <= _top.value() && _overflow.empty();
+}
+
+inline size_t WDStealingDeque::size() const
+{
+   long elems = _bottom.value() - _top.value();
+   return ( elems > 0 ? (size_t) elems : 0 ) + _overflow.size();
+}
+
+inline void WDStealingDeque::push_front ( WorkDescriptor *wd )
+{
+   if ( _owner != myThread ) {
+      _overflow.push_front( wd );
+      return;
+   }
+
+   wd->setMyQueue( this );
+
+   long bottom = _bottom.value();
+   long top = _top.value();
+   Buffer *buffer = _buffer;
+
+   if ( bottom - top >= buffer->_size ) buffer = grow( buffer, bottom, top );
+
+   buffer->_wds[ bottom & ( buffer->_size - 1 ) ] = wd;
+   _bottom = bottom + 1;
+
+   ++( sys.getSchedulerStats()._readyTasks );
+   increaseTasksInQueues();
+}
+
+inline void WDStealingDeque::push_back ( WorkDescriptor *wd )
+{
+   _overflow.push_back( wd );
+}
+
+inline WorkDescriptor * WDStealingDeque::popBottom ( void )
+{
+   // Only the owner modifies _bottom and _top never decreases
+   if ( _bottom.value() <= _top.value() ) return NULL;
+
+   long bottom = _bottom.value() - 1;
+   Buffer *buffer = _buffer;
+   _bottom = bottom;
+
+   memoryFence();
+
+   long top = _top.value();
+   if ( top > bottom ) {
+      // Empty, thieves took the last one
+      _bottom = bottom + 1;
+      return NULL;
+   }
+
+   WorkDescriptor *wd = buffer->_wds[ bottom & ( buffer->_size - 1 ) ];
+   if ( top == bottom ) {
+      // Last entry, race against thieves
+      if ( !_top.cswap( top, top + 1 ) ) wd = NULL;
+      _bottom = bottom + 1;
+   }
+
+   return wd;
+}
+
+inline WorkDescriptor * WDStealingDeque::steal ( void )
+{
+   long top = _top.value();
+   memoryFence();
+   long bottom = _bottom.value();
+
+   if ( top >= bottom ) return NULL;
+
+   Buffer *buffer = _buffer;
+   WorkDescriptor *wd = buffer->_wds[ top & ( buffer->_size - 1 ) ];
+
+   // Somebody else got it first
+   if ( !_top.cswap( top, top + 1 ) ) return NULL;
+
+   return wd;
+}
+
+inline WorkDescriptor * WDStealingDeque::acquire ( WorkDescriptor *wd, BaseThread *thread )
+{
+   WorkDescriptor *found = NULL;
+
+   --( sys.getSchedulerStats()._readyTasks );
+   decreaseTasksInQueues();
+   wd->setMyQueue( NULL );
+
+   if ( !Scheduler::checkBasicConstraints( *wd, *thread ) ) {
+      // The overflow queue looks for WDs which can be run by the requesting thread
+      _overflow.push_back( wd );
+      return NULL;
+   }
+
+   if ( !wd->dequeue( &found ) ) {
+      // Only a slice has been taken, the WD remains enqueued
+      if ( thread == _owner ) push_front( wd );
+      else _overflow.push_front( wd );
+   }
+
+   ensure( !found || !found->isTied() || found->isTiedTo() == thread, "" );
+
+   return found;
+}
+
+inline WorkDescriptor * WDStealingDeque::pop_front ( BaseThread *thread )
+{
+   if ( thread != _owner ) return pop_back( thread );
+
+   WorkDescriptor *wd = popBottom();
+   if ( wd != NULL && ( wd = acquire( wd, thread ) ) != NULL ) return wd;
+
+   return _overflow.empty() ? NULL : _overflow.pop_front( thread );
+}
+
+inline WorkDescriptor * WDStealingDeque::pop_back ( BaseThread *thread )
+{
+   WorkDescriptor *wd = steal();
+   if ( wd != NULL && ( wd = acquire( wd, thread ) ) != NULL ) return wd;
+
+   return _overflow.empty() ? NULL : _overflow.pop_back( thread );
+}
+
+inline bool WDStealingDeque::removeWD( BaseThread *thread, WorkDescriptor *toRem, WorkDescriptor **next )
+{
+   long top = _top.value();
+   memoryFence();
+   long bottom = _bottom.value();
+
+   if ( top >= bottom ) return false;
+
+   Buffer *buffer = _buffer;
+   if ( buffer->_wds[ top & ( buffer->_size - 1 ) ] != toRem ) return false;
+
+   if ( !Scheduler::checkBasicConstraints( *toRem, *thread ) ) return false;
+
+   if ( !_top.cswap( top, top + 1 ) ) return false;
+
+   --( sys.getSchedulerStats()._readyTasks );
+   decreaseTasksInQueues();
+   toRem->setMyQueue( NULL );
+
+   if ( !toRem->dequeue( next ) ) _overflow.push_front( toRem );
+
+   return true;
+}
+
+inline Lock& WDStealingDeque::getLock()
+{
+   return _overflow.getLock();
+}
+
+inline void WDStealingDeque::push_front( WD** wds, size_t numElems )
+{
+   _overflow.push_front( wds, numElems );
+}
+
+inline void WDStealingDeque::push_back( WD** wds, size_t numElems )
+{
+   _overflow.push_back( wds, numElems );
+}
+
+inline void WDStealingDeque::increaseTasksInQueues( int increment )
+{
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
+}
+
+inline void WDStealingDeque::decreaseTasksInQueues( int decrement )
+{
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
+}
+
 template <typename T>
 inline WDPriorityQueue<T>::WDPriorityQueue( bool enableDeviceCounter, bool optimise, bool reverse, PriorityValueFun getter )
    : _dq(), _lock(), _nelems(0), _optimise( optimise ), _reverse( reverse ), _ndevs(), _deviceCounter( enableDeviceCounter ),
@@ -644,8 +887,8 @@ inline void WDPriorityQueue<T>::push_back ( WorkDescriptor *wd )
             _ndevs[( wd->getDevices()[i]->getDevice() )]++;
          }
       }
-      int tasks = ++( sys.getSchedulerStats()._readyTasks );
-      increaseTasksInQueues(tasks);
+      ++( sys.getSchedulerStats()._readyTasks );
+      increaseTasksInQueues();
       memoryFence();
    }
 }
@@ -666,8 +909,8 @@ inline void WDPriorityQueue<T>::push_front ( WorkDescriptor *wd )
             _ndevs[( wd->getDevices()[i]->getDevice() )]++;
          }
       }
-      int tasks = ++( sys.getSchedulerStats()._readyTasks );
-      increaseTasksInQueues(tasks);
+      ++( sys.getSchedulerStats()._readyTasks );
+      increaseTasksInQueues();
       memoryFence();
    }
 }
@@ -713,8 +956,8 @@ inline void WDPriorityQueue<T>::push_front( WD** wds, size_t numElems )
          }
       }
    }
-   int tasks = sys.getSchedulerStats()._readyTasks += numElems;
-   increaseTasksInQueues(tasks,numElems);
+   sys.getSchedulerStats()._readyTasks += numElems;
+   increaseTasksInQueues(numElems);
    fatal_cond( _dq.size() != _nelems, "List size does not match queue size" );
 }
 
@@ -761,8 +1004,8 @@ inline void WDPriorityQueue<T>::push_back( WD** wds, size_t numElems )
       }
 
    }*/
-   int tasks = sys.getSchedulerStats()._readyTasks += numElems;
-   increaseTasksInQueues(tasks,numElems);
+   sys.getSchedulerStats()._readyTasks += numElems;
+   increaseTasksInQueues(numElems);
    fatal_cond( _dq.size() != _nelems, "List size does not match queue size" );
 }
 
@@ -812,8 +1055,8 @@ inline WorkDescriptor * WDPriorityQueue<T>::popFrontWithConstraints ( BaseThread
                      _maxPriority = _dq.front()->getPriority();
                      _minPriority = _dq.back()->getPriority();
                   }
-                  int tasks = --(sys.getSchedulerStats()._readyTasks);
-                  decreaseTasksInQueues(tasks);
+                  --( sys.getSchedulerStats()._readyTasks );
+                  decreaseTasksInQueues();
                }
                break;
             }
@@ -867,8 +1110,8 @@ inline WorkDescriptor * WDPriorityQueue<T>::popBackWithConstraints ( BaseThread
                      _maxPriority = _dq.front()->getPriority();
                      _minPriority = _dq.back()->getPriority();
                   }
-                  int tasks = --(sys.getSchedulerStats()._readyTasks);
-                  decreaseTasksInQueues(tasks);
+                  --( sys.getSchedulerStats()._readyTasks );
+                  decreaseTasksInQueues();
                }
                break;
             }
@@ -910,8 +1153,8 @@ inline bool WDPriorityQueue<T>::removeWDWithConstraints( BaseThread *thread, Wor
                         _ndevs[( ( *it )->getDevices()[i]->getDevice() )]--;
                      }
                   }
-                  int tasks = --(sys.getSchedulerStats()._readyTasks);
-                  decreaseTasksInQueues(tasks);
+                  --( sys.getSchedulerStats()._readyTasks );
+                  decreaseTasksInQueues();
                }
                (*next)->setMyQueue( NULL );
                return true;
@@ -957,21 +1200,17 @@ inline WD::PriorityType WDPriorityQueue<T>::minPriority() const
 }
 
 template<typename T>
-inline void WDPriorityQueue<T>::increaseTasksInQueues( int tasks, int increment )
+inline void WDPriorityQueue<T>::increaseTasksInQueues( int increment )
 {
-   NANOS_INSTRUMENT(static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("num-ready");)
-   NANOS_INSTRUMENT( nanos_event_value_t nb =  (nanos_event_value_t ) tasks );
-   NANOS_INSTRUMENT(sys.getInstrumentation()->raisePointEvents(1, &key, &nb );)
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
    _nelems += increment;
    fatal_cond( _dq.size() != _nelems, "List size does not match queue size (increase)" );
 }
 
 template<typename T>
-inline void WDPriorityQueue<T>::decreaseTasksInQueues( int tasks, int decrement )
+inline void WDPriorityQueue<T>::decreaseTasksInQueues( int decrement )
 {
-   NANOS_INSTRUMENT(static nanos_event_key_t key = sys.getInstrumentation()->getInstrumentationDictionary()->getEventKey("num-ready");)
-   NANOS_INSTRUMENT( nanos_event_value_t nb =  (nanos_event_value_t ) tasks );
-   NANOS_INSTRUMENT(sys.getInstrumentation()->raisePointEvents(1, &key, &nb );)
+   NANOS_INSTRUMENT( raiseNumReadyEvent(); )
    _nelems -= decrement;
    fatal_cond( _dq.size() != _nelems, "List size does not match queue size (decrease)" );
 }
@@ -27,6 +27,7 @@
 #include "debug.hpp"
 #include "atomic_decl.hpp"
 #include "lock_decl.hpp"
+#include "allocator_decl.hpp"
 
 #include "basethread_fwd.hpp"
 
@@ -100,8 +101,8 @@ namespace nanos {
           */
          virtual void push_back( WD** wds, size_t numElems ) = 0;
 
-         static void increaseTasksInQueues( int tasks, int increment = 1 );
-         static void decreaseTasksInQueues( int tasks, int decrement = 1 );
+         static void increaseTasksInQueues( int increment = 1 );
+         static void decreaseTasksInQueues( int decrement = 1 );
 
    };
 
@@ -160,8 +161,8 @@ namespace nanos {
 
          bool removeWD( BaseThread *thread, WorkDescriptor *toRem, WorkDescriptor **next );
 
-         void increaseTasksInQueues( int tasks, int increment = 1 );
-         void decreaseTasksInQueues( int tasks, int decrement = 1 );
+         void increaseTasksInQueues( int increment = 1 );
+         void decreaseTasksInQueues( int decrement = 1 );
 
          /*! \brief Returns the number of ready tasks that could be ran simultaneously
           * Tied and commutative WDs in the queue could decrease this number.
@@ -245,6 +246,104 @@ namespace nanos {
 
    };
    
+   /*! \brief Work-stealing deque of WorkDescriptors (Chase-Lev)
+    *
+    *  WDs are kept in a growable circular array. The owner thread pushes and
+    *  pops at the bottom (front) with no locking and no allocation (except when
+    *  the array has to grow), while any thread steals from the top (back) with
+    *  a single compare-and-swap. Operations which do not fit into this model
+    *  (pushes coming from other threads, push_back and batch operations) and
+    *  WDs which cannot be run by the thread that took them are moved to an
+    *  auxiliary WDDeque (the overflow queue).
+    */
+   class WDStealingDeque : public WDPool
+   {
+      private:
+         struct Buffer {
+            long                       _size;   /**< Number of entries (a power of two) */
+            Buffer                    *_prev;   /**< Previous (smaller) buffer, kept for late thieves */
+            WorkDescriptor * volatile *_wds;    /**< Circular array of WDs */
+         };
+
+         BaseThread          *_owner;                    /**< Thread allowed to work at the bottom */
+         Buffer * volatile    _buffer;                   /**< Current circular array */
+         Atomic<long>         _bottom;                   /**< Next free entry (owner side) */
+         char                 _pad0[NANOS_CACHELINE];    /**< Keeps _top away from owner data */
+         Atomic<long>         _top;                      /**< Oldest entry (steal side) */
+         char                 _pad1[NANOS_CACHELINE];    /**< Keeps _top away from the overflow queue */
+         WDDeque              _overflow;                 /**< Queue for non owner pushes and non runnable WDs */
+
+      private:
+         /*! \brief WDStealingDeque copy constructor (private)
+          */
+         WDStealingDeque ( const WDStealingDeque & );
+         /*! \brief WDStealingDeque copy assignment operator (private)
+          */
+         const WDStealingDeque & operator= ( const WDStealingDeque & );
+
+         /*! \brief Allocates a new circular array of 'size' entries
+          */
+         static Buffer * allocateBuffer ( long size, Buffer *prev );
+         /*! \brief Doubles the size of the circular array, keeping entries [top,bottom)
+          */
+         Buffer * grow ( Buffer *buffer, long bottom, long top );
+
+         /*! \brief Takes the WD at the bottom (owner only)
+          */
+         WorkDescriptor * popBottom ( void );
+         /*! \brief Takes the WD at the top (any thread)
+          */
+         WorkDescriptor * steal ( void );
+         /*! \brief Checks whether 'wd' (already taken out of the array) can be run by 'thread'
+          *
+          *  Returns the WD (or slice) to run. WDs which cannot be run are moved
+          *  to the overflow queue and remaining slices are enqueued again.
+          */
+         WorkDescriptor * acquire ( WorkDescriptor *wd, BaseThread *thread );
+
+         void increaseTasksInQueues( int increment = 1 );
+         void decreaseTasksInQueues( int decrement = 1 );
+
+      public:
+         /*! \brief WDStealingDeque default constructor
+          */
+         WDStealingDeque( long initialSize = 1024 );
+         /*! \brief WDStealingDeque destructor
+          */
+         ~WDStealingDeque();
+
+         /*! \brief Sets the thread owning the bottom of the deque
+          */
+         void setOwner ( BaseThread *owner );
+         BaseThread * getOwner ( void ) const;
+
+         bool empty ( void ) const;
+         size_t size() const;
+
+         /*! \brief Pushes at the bottom (owner) or in the overflow queue (other threads)
+          */
+         void push_front ( WorkDescriptor *wd );
+         /*! \brief Pushes in the overflow queue
+          */
+         void push_back( WorkDescriptor *wd );
+
+         /*! \brief Pops from the bottom (owner) or steals from the top (other threads)
+          */
+         WorkDescriptor * pop_front ( BaseThread *thread );
+         /*! \brief Steals from the top
+          */
+         WorkDescriptor * pop_back ( BaseThread *thread );
+
+         /*! \brief Removes 'toRem' only if it is at the top of the deque
+          */
+         bool removeWD( BaseThread *thread, WorkDescriptor *toRem, WorkDescriptor **next );
+
+         /*! \brief Returns the lock of the overflow queue, for batch operations. */
+         Lock& getLock();
+         void push_front( WD** wds, size_t numElems );
+         void push_back( WD** wds, size_t numElems );
+   };
+
    /*! \brief Class used to compare WDs by priority.
     *  \see WDPriorityQueue::push
     */
@@ -402,8 +501,8 @@ namespace nanos {
           */
          WD::PriorityType minPriority() const;
 
-         void increaseTasksInQueues( int tasks, int increment = 1 );
-         void decreaseTasksInQueues( int tasks, int decrement = 1 );
+         void increaseTasksInQueues( int increment = 1 );
+         void decreaseTasksInQueues( int decrement = 1 );
 
          /*! \brief Returns the number of ready tasks that could be ran simultaneously
           * Tied and commutative WDs in the queue could decrease this number.
@@ -26,6 +26,7 @@ namespace nanos {
    class WDPool;
    class WDDeque;
    class WDLFQueue;
+   class WDStealingDeque;
    template<typename T> class WDPriorityQueue;
 
 } // namespace nanos
@@ -543,6 +543,15 @@ void WorkDescriptor::waitCompletion( bool avoidFlush )
    }
 
    _depsDomain->clearDependenciesDomain();
+   if ( _depsDomain->hasTaskGraphState() ) _depsDomain->clearTaskGraphReplay();
+}
+
+bool WorkDescriptor::startTaskGraphReplay( TaskGraph &graph )
+{
+   // Replayed tasks are only ordered among themselves
+   if ( _components != 0 ) waitCompletion( true );
+
+   return _depsDomain->startTaskGraphReplay( graph );
 }
 
 void WorkDescriptor::exitWork ( WorkDescriptor &work )
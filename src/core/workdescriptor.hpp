@@ -32,6 +32,7 @@
 #include "instrumentationcontext.hpp"
 #include "schedule.hpp"
 #include "dependenciesdomain.hpp"
+#include "taskgraph.hpp"
 #include "allocator_decl.hpp"
 #include "system.hpp"
 #include "slicer_decl.hpp"
@@ -55,7 +56,7 @@ inline WorkDescriptor::WorkDescriptor ( int ndevices, DeviceData **devs, size_t
                                  _doSubmit(NULL), _doWait(), _depsDomain( sys.getDependenciesManager()->createDependenciesDomain() ), 
                                  _translateArgs( translate_args ),
                                  _priority( 0 ), _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
-                                 _copiesNotInChunk(false), _description(description), _instrumentationContextData(), _slicer(NULL),
+                                 _copiesNotInChunk(false), _chunkPooled(false), _description(description), _instrumentationContextData(), _slicer(NULL),
                                  _taskReductions(),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( NULL ), _callback(0), _arguments(0),
                                  _mcontrol( this, numCopies )
@@ -89,7 +90,7 @@ inline WorkDescriptor::WorkDescriptor ( DeviceData *device, size_t data_size, si
                                  _doSubmit(NULL), _doWait(), _depsDomain( sys.getDependenciesManager()->createDependenciesDomain() ),
                                  _translateArgs( translate_args ),
                                  _priority( 0 ),  _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
-                                 _copiesNotInChunk(false), _description(description), _instrumentationContextData(), _slicer(NULL), _taskReductions(),
+                                 _copiesNotInChunk(false), _chunkPooled(false), _description(description), _instrumentationContextData(), _slicer(NULL), _taskReductions(),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( NULL ), _callback(0), _arguments(0), _mcontrol( this, numCopies )
                                  {
                                      _devices = new DeviceData*[1];
@@ -124,7 +125,7 @@ inline WorkDescriptor::WorkDescriptor ( const WorkDescriptor &wd, DeviceData **d
                                  _depsDomain( sys.getDependenciesManager()->createDependenciesDomain() ),
                                  _translateArgs( wd._translateArgs ),
                                  _priority( wd._priority ), _commutativeOwnerMap(NULL), _commutativeOwners(NULL),
-                                 _copiesNotInChunk( wd._copiesNotInChunk), _description(description), _instrumentationContextData(), _slicer(wd._slicer), _taskReductions(),
+                                 _copiesNotInChunk( wd._copiesNotInChunk), _chunkPooled(false), _description(description), _instrumentationContextData(), _slicer(wd._slicer), _taskReductions(),
                                  _notifyCopy( NULL ), _notifyThread( NULL ), _remoteAddr( NULL ), _callback(0), _arguments(0), _mcontrol( this, wd._numCopies )
                                  {
                                     if ( wd._parent != NULL ) wd._parent->addWork(*this);
@@ -183,6 +184,10 @@ inline size_t WorkDescriptor::getDataAlignment () const { return _data_align; }
 
 inline void WorkDescriptor::setTotalSize ( size_t size ) { _totalSize = size; }
 
+inline void WorkDescriptor::setChunkPooled ( bool value ) { _chunkPooled = value; }
+
+inline bool WorkDescriptor::isChunkPooled () const { return _chunkPooled; }
+
 inline WorkDescriptor * WorkDescriptor::getParent() const { return _parent!=NULL?_parent:_forcedParent ; }
 inline void WorkDescriptor::forceParent ( WorkDescriptor * p ) { _forcedParent = p; }
 
@@ -359,6 +364,14 @@ inline bool WorkDescriptor::hasDepsPredecessors() { return ( _doSubmit == NULL ?
 
 inline void WorkDescriptor::submitWithDependencies( WorkDescriptor &wd, size_t numDeps, DataAccess* deps )
 {
+   // Replayed tasks get their dependencies from the task graph, not from the plugin
+   if ( _depsDomain->isReplayingTaskGraph() ) {
+      TaskGraphReplay &replay = _depsDomain->getTaskGraphReplay();
+      wd._doSubmit = replay.createDependableObject( wd );
+      replay.submit( *(wd._doSubmit), numDeps, deps );
+      return;
+   }
+
    wd._doSubmit = NEW DOSubmit();
    wd._doSubmit->setWD(&wd);
 
@@ -366,12 +379,21 @@ inline void WorkDescriptor::submitWithDependencies( WorkDescriptor &wd, size_t n
    SchedulePolicySuccessorFunctor cb( *sys.getDefaultSchedulePolicy() );
    
    initCommutativeAccesses( wd, numDeps, deps );
+
+   if ( _depsDomain->hasTaskGraphState() ) {
+      _depsDomain->prepareTaskGraphSubmission( *(wd._doSubmit), numDeps, deps );
+   }
    
    _depsDomain->submitDependableObject( *(wd._doSubmit), numDeps, deps, &cb );
 }
 
 inline void WorkDescriptor::waitOn( size_t numDeps, DataAccess* deps )
 {
+   // The last replayed tasks are not in the plugin data, wait for all of them
+   if ( _depsDomain->hasTaskGraphState() && _depsDomain->prepareTaskGraphWait() ) {
+      waitCompletion( true );
+   }
+
    _doWait->setWD(this);
    _depsDomain->submitDependableObject( *_doWait, numDeps, deps );
    _mcontrol.synchronize( numDeps, deps );
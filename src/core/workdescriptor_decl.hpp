@@ -42,6 +42,7 @@
 #include "memcontroller_decl.hpp"
 
 #include "dependenciesdomain_decl.hpp"
+#include "taskgraph_fwd.hpp"
 #include "task_reduction_decl.hpp"
 #include "simpleallocator_decl.hpp"
 #include "schedule_fwd.hpp"   // ScheduleWDData
@@ -262,6 +263,7 @@ typedef std::set<const Device *>  DeviceList;
          WorkDescriptorPtrList        *_commutativeOwners;      //!< Array of commutative target owners
          int                           _numaNode;               //!< FIXME:scheduler data. The NUMA node this WD was assigned to
          bool                          _copiesNotInChunk;       //!< States whether the buffer of the copies is allocated in the chunk of the WD
+         bool                          _chunkPooled;            //!< States whether the chunk comes from the per-thread allocator (see System::deleteWD)
          const char                   *_description;            //!< WorkDescriptor description, usually user function name
          InstrumentationContextData    _instrumentationContextData; //!< Instrumentation Context Data (empty if no instr. enabled)
          Slicer                       *_slicer;                 //! Related slicer (NULL if does'nt apply)
@@ -398,6 +400,9 @@ typedef std::set<const Device *>  DeviceList;
 
          void setTotalSize ( size_t size );
 
+         void setChunkPooled ( bool value );
+         bool isChunkPooled () const;
+
          void setBlocked ();
 
          bool isReady () const;
@@ -606,6 +611,11 @@ typedef std::set<const Device *>  DeviceList;
           */
          void waitOn( size_t numDeps, DataAccess* deps );
 
+         /*! \brief Replays graph with the next children submitted to the domain of this WD.
+          *  Waits first for the children that have not finished.
+          */
+         bool startTaskGraphReplay( TaskGraph &graph );
+
          /*! If this WorkDescriptor has an immediate successor (i.e., another WD that only depends on him)
              remove it from the dependence graph and return it. */
          WorkDescriptor * getImmediateSuccessor ( BaseThread &thread );
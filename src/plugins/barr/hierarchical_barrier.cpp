@@ -0,0 +1,397 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "barrier.hpp"
+#include "system.hpp"
+#include "atomic.hpp"
+#include "schedule.hpp"
+#include "plugin.hpp"
+#include "threadteam.hpp"
+#include "synchronizedcondition.hpp"
+#include "malign.hpp"
+#include <vector>
+
+namespace nanos {
+   namespace ext {
+
+      /*! \class HierarchicalBarrier
+       *  \brief implements a topology-aware combining tree barrier
+       *
+       *  Participants are grouped by their distance in the machine topology (see
+       *  Hwloc::getCpuDistance): threads of the same core, then of the same cache domain, then
+       *  of the same NUMA node and finally the whole machine. Each group is a tree of at most
+       *  _fanIn children per node rooted at its first member, and group roots take part in the
+       *  next level. Arrival goes up the tree and release goes down, every participant waiting
+       *  on flags in its own cache line. Flags are compared with a sense that flips each
+       *  episode, so they never need to be reset.
+       *
+       *  Waits spin for _spins checks and then block on a condition, so the thread may run
+       *  other work; whoever sets a flag only signals the condition if its owner announced it
+       *  was going to block.
+       *
+       *  Team reductions (without vector operations) are combined on the way up: each node
+       *  folds the private copies of its children into its own one and the root folds the
+       *  result into the original variable, so a barrier with reductions is a single pass.
+       *
+       *  The CPUs of the participants are only known inside barrier(), so the first episode
+       *  after init() or resize() is a centralized barrier that records them and builds the tree.
+       *  A participant leaving the team may resize the barrier while the others are still
+       *  returning from the previous episode, so resize() does not touch anything they may be
+       *  using: the nodes are only replaced by the next build and the build wait alternates
+       *  between two conditions, as in CentralizedBarrier.
+       */
+      class HierarchicalBarrier: public Barrier
+      {
+         public:
+            static int _fanIn;
+            static int _spins;
+
+         private:
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+            typedef int    flag_t;
+#else
+            typedef volatile int flag_t;
+#endif
+            typedef SingleSyncCond<EqualConditionChecker<int> > NodeCondition;
+
+            /*! \brief A flag alone in its cache line, as long as it starts one */
+            struct LineFlag {
+               flag_t            _value;
+               char              _pad[NANOS_CACHELINE - sizeof( flag_t )];
+
+               LineFlag () : _value( 0 ) {}
+            };
+
+            /*! \brief Barrier state of a participant
+             *  Nodes are cache line aligned (see allocateNodes), so each flag has its own line:
+             *  _arrived is written by the participant and read by its parent, _release the other
+             *  way round, and _blocking is read by whoever sets one of them.
+             */
+            struct Node {
+               LineFlag          _arrived;   /**< Set by the participant when its subtree has arrived */
+               LineFlag          _release;   /**< Set by the parent to release the participant */
+               LineFlag          _blocking;  /**< The participant may be blocked on _condition */
+               int               _sense;     /**< Sense of the next episode, only used by the participant */
+               int               _parent;
+               std::vector<int>  _children;
+               NodeCondition     _condition;
+
+               Node () : _arrived(), _release(), _blocking(), _sense( 1 ), _parent( -1 ), _children(), _condition() {}
+            } __attribute__(( aligned( NANOS_CACHELINE ) ));
+
+            char             *_nodesMemory;  /**< Allocation holding _nodes, which start at its first cache line boundary */
+            Node             *_nodes;
+            int               _numNodes;
+            int               _numParticipants;
+
+            /* Tree construction (first episode after init/resize) */
+            bool              _built;
+            std::vector<int>  _cpus;
+            Atomic<int>       _arrivedToBuild;
+            flag_t            _builtSense;
+            MultipleSyncCond<EqualConditionChecker<int> > _builtSet;
+            MultipleSyncCond<EqualConditionChecker<int> > _builtClear;
+
+         private:
+            void reset ( int numParticipants );
+            void allocateNodes ( int numNodes );
+            void freeNodes ( void );
+            void build ( void );
+            void linkGroup ( const std::vector<int> &group );
+            void buildBarrier ( int participant );
+            void treeBarrier ( int participant );
+
+            void waitFlag ( Node &me, flag_t *flag, int value );
+            void setFlag ( Node &node, flag_t *flag, int value );
+
+            void finishEpisode ( int root, bool combined );
+
+         public:
+            HierarchicalBarrier () : Barrier(), _nodesMemory( NULL ), _nodes( NULL ), _numNodes( 0 ), _numParticipants( 0 ), _built( false ), _cpus(), _arrivedToBuild( 0 ),
+               _builtSense( 0 ), _builtSet( EqualConditionChecker<int>( &_builtSense, 1 ), 1 ),
+               _builtClear( EqualConditionChecker<int>( &_builtSense, 0 ), 1 ) {}
+            HierarchicalBarrier ( const HierarchicalBarrier& orig ) : Barrier(orig), _nodesMemory( NULL ), _nodes( NULL ), _numNodes( 0 ),
+               _numParticipants( 0 ), _built( false ),
+               _cpus(), _arrivedToBuild( 0 ), _builtSense( 0 ), _builtSet( EqualConditionChecker<int>( &_builtSense, 1 ), 1 ),
+               _builtClear( EqualConditionChecker<int>( &_builtSense, 0 ), 1 )
+               { init( orig._numParticipants ); }
+
+            const HierarchicalBarrier & operator= ( const HierarchicalBarrier & barrier );
+
+            virtual ~HierarchicalBarrier() { freeNodes(); }
+
+            void init ( int numParticipants );
+            void resize ( int numThreads );
+
+            void barrier ( int participant );
+      };
+
+      int HierarchicalBarrier::_fanIn = 4;
+      int HierarchicalBarrier::_spins = 2000;
+
+      const HierarchicalBarrier & HierarchicalBarrier::operator= ( const HierarchicalBarrier & orig )
+      {
+         // self-assignment
+         if ( &orig == this ) return *this;
+
+         Barrier::operator=(orig);
+
+         if ( orig._numParticipants != _numParticipants )
+            resize(orig._numParticipants);
+
+         return *this;
+      }
+
+      void HierarchicalBarrier::init( int numParticipants )
+      {
+         reset( numParticipants );
+      }
+
+      void HierarchicalBarrier::resize( int numParticipants )
+      {
+         reset( numParticipants );
+      }
+
+      void HierarchicalBarrier::reset( int numParticipants )
+      {
+         _numParticipants = numParticipants;
+         _cpus.assign( numParticipants, 0 );
+
+         // The next episode builds the tree
+         _built = false;
+         _arrivedToBuild = 0;
+         _builtSet.resize( numParticipants );
+         _builtClear.resize( numParticipants );
+         memoryFence();
+      }
+
+      /*! \brief Replaces the nodes by numNodes new ones
+       *  std::vector does not honour the alignment of Node, so they are placed by hand.
+       */
+      void HierarchicalBarrier::allocateNodes( int numNodes )
+      {
+         freeNodes();
+         _nodesMemory = NEW char[numNodes * sizeof( Node ) + NANOS_CACHELINE];
+         _nodes = ( Node * ) NANOS_ALIGNED_MEMORY_OFFSET( _nodesMemory, 0, NANOS_CACHELINE );
+         for ( int i = 0; i < numNodes; i++ ) new ( &_nodes[i] ) Node();
+         _numNodes = numNodes;
+      }
+
+      void HierarchicalBarrier::freeNodes( void )
+      {
+         for ( int i = 0; i < _numNodes; i++ ) _nodes[i].~Node();
+         delete[] _nodesMemory;
+         _nodesMemory = NULL;
+         _nodes = NULL;
+         _numNodes = 0;
+      }
+
+      /*! \brief Makes 'group' a tree of at most _fanIn children per node rooted at group[0] */
+      void HierarchicalBarrier::linkGroup( const std::vector<int> &group )
+      {
+         int fanIn = _fanIn > 0 ? _fanIn : 1;
+         for ( unsigned i = 1; i < group.size(); i++ ) {
+            int parent = group[( i - 1 ) / fanIn];
+            _nodes[group[i]]._parent = parent;
+            _nodes[parent]._children.push_back( group[i] );
+         }
+      }
+
+      void HierarchicalBarrier::build( void )
+      {
+         bool topology = sys._hwloc.isHwlocAvailable();
+
+         // Every participant is waiting for the build, so nobody is using the former nodes
+         allocateNodes( _numParticipants );
+
+         // Group members of each level by their distance to the group leader: same core,
+         // same cache domain, same NUMA node. The leaders go on to the next level.
+         std::vector<int> members;
+         for ( int i = 0; i < _numParticipants; i++ ) members.push_back( i );
+
+         for ( unsigned level = 0; level < 3 && topology; level++ ) {
+            std::vector<int> leaders;
+            std::vector<bool> grouped( members.size(), false );
+
+            for ( unsigned i = 0; i < members.size(); i++ ) {
+               if ( grouped[i] ) continue;
+
+               std::vector<int> group;
+               for ( unsigned j = i; j < members.size(); j++ ) {
+                  if ( grouped[j] ) continue;
+                  if ( j == i || sys._hwloc.getCpuDistance( _cpus[members[i]], _cpus[members[j]] ) <= level ) {
+                     group.push_back( members[j] );
+                     grouped[j] = true;
+                  }
+               }
+
+               linkGroup( group );
+               leaders.push_back( group[0] );
+            }
+
+            members.swap( leaders );
+         }
+
+         // Whole machine
+         linkGroup( members );
+
+         _built = true;
+      }
+
+      void HierarchicalBarrier::buildBarrier( int participant )
+      {
+         // The sense cannot flip before every participant has arrived
+         int sense = 1 - _builtSense;
+         MultipleSyncCond<EqualConditionChecker<int> > &built = sense ? _builtSet : _builtClear;
+
+         _cpus[participant] = myThread->getCpuId();
+
+         if ( ++_arrivedToBuild == _numParticipants ) {
+            build();
+            Barrier::computeVectorReductions();
+
+            _arrivedToBuild = 0;
+            memoryFence();
+            _builtSense = sense;
+            built.signal();
+         } else {
+            built.wait();
+         }
+      }
+
+      void HierarchicalBarrier::waitFlag( Node &me, flag_t *flag, int value )
+      {
+         for ( int spins = _spins; spins > 0; spins-- ) {
+            if ( *flag == value ) return;
+            memoryFence();
+         }
+
+         me._condition.setConditionChecker( EqualConditionChecker<int>( flag, value ) );
+         me._blocking._value = 1;
+         memoryFence();
+         me._condition.wait();
+         me._blocking._value = 0;
+      }
+
+      void HierarchicalBarrier::setFlag( Node &node, flag_t *flag, int value )
+      {
+         *flag = value;
+         memoryFence();
+         // Pairs with the fence in waitFlag: either the owner sees the flag or we see it blocking
+         if ( node._blocking._value ) node._condition.signal();
+      }
+
+      void HierarchicalBarrier::finishEpisode( int root, bool combined )
+      {
+         if ( combined ) {
+            ThreadTeam *team = myThread->getTeam();
+            team->computeCombinedReductions( root );
+            team->cleanUpReductionList();
+         } else {
+            Barrier::computeVectorReductions();
+         }
+      }
+
+      void HierarchicalBarrier::treeBarrier( int participant )
+      {
+         Node &me = _nodes[participant];
+         int sense = me._sense;
+         bool combine = myThread->getTeam()->canCombineReductions();
+
+         // Bottom-up: wait for the children and fold their reductions into ours
+         for ( unsigned i = 0; i < me._children.size(); i++ ) {
+            int child = me._children[i];
+            waitFlag( me, &_nodes[child]._arrived._value, sense );
+            memoryFence();
+            if ( combine ) myThread->getTeam()->combineReductions( participant, child );
+         }
+
+         if ( me._parent != -1 ) {
+            setFlag( _nodes[me._parent], &me._arrived._value, sense );
+
+            // Top-down: wait for the parent
+            waitFlag( me, &me._release._value, sense );
+            memoryFence();
+         } else {
+            finishEpisode( participant, combine );
+            memoryFence();
+         }
+
+         for ( unsigned i = 0; i < me._children.size(); i++ ) {
+            Node &child = _nodes[me._children[i]];
+            setFlag( child, &child._release._value, sense );
+         }
+
+         me._sense = 1 - sense;
+      }
+
+      void HierarchicalBarrier::barrier( int participant )
+      {
+         // Participants are team ids: a WD that is not tied must resume on this thread after
+         // blocking, or it would take the place of another one in the next episode
+         WD *current = myThread->getCurrentWD();
+         bool tie = !current->isTied();
+         if ( tie ) current->tieTo( *myThread );
+
+         if ( !_built ) buildBarrier( participant );
+         else treeBarrier( participant );
+
+         if ( tie ) current->untie();
+      }
+
+
+      static Barrier * createHierarchicalBarrier()
+      {
+         return NEW HierarchicalBarrier();
+      }
+
+
+      /*! \class HierarchicalBarrierPlugin
+       *  \brief plugin of the related HierarchicalBarrier class
+       *  \see HierarchicalBarrier
+       */
+      class HierarchicalBarrierPlugin : public Plugin
+      {
+
+         public:
+            HierarchicalBarrierPlugin() : Plugin( "Hierarchical Barrier Plugin",1 ) {}
+
+            virtual void config( Config &cfg )
+            {
+               cfg.setOptionsSection( "Hierarchical barrier", "Topology-aware tree barrier" );
+
+               cfg.registerConfigOption( "hier-barrier-fanin", NEW Config::PositiveVar( HierarchicalBarrier::_fanIn ),
+                  "Maximum number of children of each node of the barrier tree" );
+               cfg.registerArgOption( "hier-barrier-fanin", "hier-barrier-fanin" );
+               cfg.registerEnvOption( "hier-barrier-fanin", "NX_HIER_BARRIER_FANIN" );
+
+               cfg.registerConfigOption( "hier-barrier-spins", NEW Config::IntegerVar( HierarchicalBarrier::_spins ),
+                  "Number of checks before a thread waiting in the barrier blocks" );
+               cfg.registerArgOption( "hier-barrier-spins", "hier-barrier-spins" );
+               cfg.registerEnvOption( "hier-barrier-spins", "NX_HIER_BARRIER_SPINS" );
+            }
+
+            virtual void init() {
+               sys.setDefaultBarrFactory( createHierarchicalBarrier );
+            }
+      };
+   }
+}
+
+DECLARE_PLUGIN("barr-hierarchical",nanos::ext::HierarchicalBarrierPlugin);
@@ -0,0 +1,400 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "basedependenciesdomain.hpp"
+#include "plugin.hpp"
+#include "system.hpp"
+#include "config.hpp"
+#include "address.hpp"
+#include "compatibility.hpp"
+#include "allocator_decl.hpp"
+#include <vector>
+
+namespace nanos {
+   namespace ext {
+
+      /*! \brief Plain (address based) dependencies domain with the address map split in shards.
+       *
+       *  Every shard has its own lock, map and pool of TrackableObjects, so that submissions and
+       *  the releases done by finishing tasks only contend when they touch the same shard.
+       */
+      class ShardedDependenciesDomain : public BaseDependenciesDomain
+      {
+         private:
+            typedef TR1::unordered_map<Address::TargetType, TrackableObject*> DepsMap; /**< Maps addresses to Trackable objects */
+
+            static const size_t  _slabSize = 32; /**< Number of TrackableObjects allocated at once by a shard */
+
+            struct Shard {
+               Lock                 _lock;   /**< Protects the map and the pool of this shard */
+               DepsMap              _map;    /**< Addresses of this shard */
+               std::vector<char *>  _slabs;  /**< Storage of the TrackableObjects of this shard */
+               size_t               _used;   /**< Number of TrackableObjects constructed in _slabs */
+               char                 _pad[NANOS_CACHELINE]; /**< Keeps shards in different cache lines */
+
+               Shard () : _lock(), _map(), _slabs(), _used( 0 ) {}
+            };
+
+         public:
+            static unsigned int  _numShards;  /**< Number of shards of every domain (power of two) */
+            static unsigned int  _shardShift; /**< 64 - log2(_numShards) */
+
+         private:
+            Shard               *_shards;     /**< Shards, allocated at the first submission */
+
+         private:
+            ShardedDependenciesDomain ( const ShardedDependenciesDomain &depDomain );
+            const ShardedDependenciesDomain & operator= ( const ShardedDependenciesDomain &depDomain );
+
+            //! \brief Returns the shard an address belongs to
+            Shard & getShard ( Address::TargetType target ) const
+            {
+               uint64_t hash = ( (uint64_t) (uintptr_t) target ) * 0x9E3779B97F4A7C15ULL;
+               return _shards[ _numShards == 1 ? 0 : hash >> _shardShift ];
+            }
+
+            //! \brief Returns the shard an address belongs to, or NULL if nothing has been submitted yet
+            Shard * findShard ( Address::TargetType target ) const
+            {
+               return _shards == NULL ? NULL : &getShard( target );
+            }
+
+            //! \brief Gets a TrackableObject from the pool of the shard (shard lock must be held)
+            TrackableObject * newTrackableObject ( Shard &shard )
+            {
+               size_t slab = shard._used / _slabSize;
+               if ( slab == shard._slabs.size() ) {
+                  shard._slabs.push_back( NEW char[ _slabSize * sizeof( TrackableObject ) ] );
+               }
+               TrackableObject *status = ( (TrackableObject *) shard._slabs[slab] ) + ( shard._used % _slabSize );
+               shard._used++;
+               return new ( status ) TrackableObject();
+            }
+
+            //! \brief Destroys all the TrackableObjects of the shard keeping its storage
+            void clearShard ( Shard &shard )
+            {
+               for ( DepsMap::iterator it = shard._map.begin(); it != shard._map.end(); it++ ) {
+                  it->second->~TrackableObject();
+               }
+               shard._map.clear();
+               shard._used = 0;
+            }
+
+            //! \brief Clear current dependencies domain
+            //!
+            //! This function should be called withing a thread safe area. It is, when other
+            //! tasks can not update the domain: after a taskwait and before any task submission.
+            void clearDependenciesDomain ( void )
+            {
+               if ( _shards == NULL ) return;
+               for ( unsigned int i = 0; i < _numShards; i++ ) {
+                  clearShard( _shards[i] );
+               }
+            }
+
+            //! \brief Looks for the dependency's address, returns the trackableObject associated
+            //! \param dep Dependency to be checked.
+            //! \sa Dependency TrackableObject
+            TrackableObject* lookupDependency ( const Address& target )
+            {
+               // Only the owner of the domain submits, so only this thread can create the shards
+               if ( _shards == NULL ) {
+                  Shard *shards = NEW Shard[_numShards];
+                  memoryFence();
+                  _shards = shards;
+               }
+
+               Shard &shard = getShard( target() );
+               SyncLockBlock lock( shard._lock );
+
+               DepsMap::iterator it = shard._map.find( target() );
+               if ( it != shard._map.end() ) return it->second;
+
+               TrackableObject *status = newTrackableObject( shard );
+               shard._map.insert( std::make_pair( target(), status ) );
+               return status;
+            }
+         protected:
+            //! \brief Assigns the DependableObject depObj an id in this domain and adds it to the domains dependency system.
+            //! \param depObj DependableObject to be added to the domain.
+            //! \param begin Iterator to the start of the list of dependencies to be associated to the Dependable Object.
+            //! \param end Iterator to the end of the mentioned list.
+            //! \param callback A function to call when a WD has a successor [Optional].
+            //! \sa Dependency DependableObject TrackableObject
+            template<typename iterator>
+            void submitDependableObjectInternal ( DependableObject &depObj, iterator begin, iterator end,
+                                                  SchedulePolicySuccessorFunctor* callback )
+            {
+               // Initializing several properties of the depObject
+               depObj.setId ( _lastDepObjId++ );
+               depObj.init();
+               depObj.setDependenciesDomain( this );
+
+               // Object is not ready to get its dependencies satisfied, so we increase the
+               // number of predecessors to permit other dependableObjects to free some of
+               // its dependencies without triggering the "dependenciesSatisfied" method.
+               depObj.increasePredecessors();
+
+               // flushDeps will be needed for waiting (see decreasePredecessors)
+               std::list<uint64_t> flushDeps;
+
+               // Iterate from begin to end, just to handle each data access
+               for ( iterator it = begin; it != end; it++ ) {
+                  DataAccess &dep = (*it);
+                  Address target = dep.getDepAddress();
+
+                  // if address == NULL, just ignore it
+                  if ( target() == NULL ) continue;
+                  AccessType const &accessType = dep.flags;
+
+                  submitDependableObjectDataAccess( depObj, target, accessType, callback );
+                  flushDeps.push_back( (uint64_t) target() );
+               }
+
+               // Calling scheduler policy "atCreate"
+               sys.getDefaultSchedulePolicy()->atCreate( depObj );
+
+               // To Task In Graph count consistent before releasing the fake dependency
+               increaseTasksInGraph();
+
+               depObj.submitted();
+
+               // Now everything is ready, release fake dependency
+               depObj.decreasePredecessors( &flushDeps, NULL, false, true );
+            }
+
+            //! \brief Adds a region access of a DependableObject to the domains dependency system.
+            //! \param depObj target DependableObject
+            //! \param target accessed memory address
+            //! \param accessType kind of region access
+            //! \param callback Function to call if an immediate predecessor is found.
+            void submitDependableObjectDataAccess( DependableObject &depObj, Address const &target,
+                                                   AccessType const &accessType, SchedulePolicySuccessorFunctor* callback )
+            {
+
+               ensure(!(accessType.concurrent && accessType.commutative),"Task cannot be concurrent AND commutative");
+
+               TrackableObject &status = *lookupDependency( target );
+
+               if ( status.getLastWriter() == &depObj ) return;
+
+               if ( accessType.concurrent || accessType.commutative ) {
+                  ensure(accessType.input && accessType.output,"Commutative & concurrent must be inout");
+                  ensure(!depObj.waits(), "Commutative & concurrent should not wait" );
+                  submitDependableObjectCommutativeDataAccess( depObj, target, accessType, status, callback );
+               } else if ( accessType.output ) {
+                  if ( accessType.input ) submitDependableObjectInoutDataAccess( depObj, target, accessType, status, callback );
+                  else submitDependableObjectOutputDataAccess( depObj, target, accessType, status, callback );
+                  if ( !depObj.waits() ) depObj.addWriteTarget( target );
+               } else if ( accessType.input ) {
+                  if ( accessType.output ) submitDependableObjectInoutDataAccess( depObj, target, accessType, status, callback );
+                  else submitDependableObjectInputDataAccess( depObj, target, accessType, status, callback );
+                  if ( !depObj.waits() ) depObj.addReadTarget( target );
+               } else {
+                  fatal( "Invalid data access" );
+               }
+
+            }
+
+            inline void deleteLastWriter ( DependableObject &depObj, BaseDependency const &target )
+            {
+               const Address& address( static_cast<const Address&>( target ) );
+               Shard *shard = findShard( address() );
+               if ( shard == NULL ) return;
+
+               SyncLockBlock lock1( shard->_lock );
+               DepsMap::iterator it = shard->_map.find( address() );
+
+               if ( it != shard->_map.end() ) {
+                  TrackableObject &status = *it->second;
+
+                  status.deleteLastWriter(depObj);
+               }
+            }
+
+            inline void deleteReader ( DependableObject &depObj, BaseDependency const &target )
+            {
+               const Address& address( static_cast<const Address&>( target ) );
+               Shard *shard = findShard( address() );
+               if ( shard == NULL ) return;
+
+               SyncLockBlock lock1( shard->_lock );
+               DepsMap::iterator it = shard->_map.find( address() );
+
+               if ( it != shard->_map.end() ) {
+                  TrackableObject &status = *it->second;
+
+                  {
+                     SyncLockBlock lock2( status.getReadersLock() );
+                     status.deleteReader(depObj);
+                  }
+               }
+            }
+
+            inline void removeCommDO ( CommutationDO *commDO, BaseDependency const &target )
+            {
+               const Address& address( static_cast<const Address&>( target ) );
+               Shard *shard = findShard( address() );
+               if ( shard == NULL ) return;
+
+               SyncLockBlock lock1( shard->_lock );
+               DepsMap::iterator it = shard->_map.find( address() );
+
+               if ( it != shard->_map.end() ) {
+                  TrackableObject &status = *it->second;
+
+                  if ( status.getCommDO ( ) == commDO ) {
+                     status.setCommDO ( 0 );
+                  }
+               }
+            }
+
+         public:
+            ShardedDependenciesDomain() : BaseDependenciesDomain(), _shards( NULL ) {}
+
+            ~ShardedDependenciesDomain()
+            {
+               if ( _shards == NULL ) return;
+               for ( unsigned int i = 0; i < _numShards; i++ ) {
+                  Shard &shard = _shards[i];
+                  clearShard( shard );
+                  for ( size_t s = 0; s < shard._slabs.size(); s++ ) {
+                     delete[] shard._slabs[s];
+                  }
+               }
+               delete[] _shards;
+            }
+
+            /*!
+             *  \note This function cannot be implemented in
+             *  BaseDependenciesDomain since it calls a template function,
+             *  and they cannot be virtual.
+             */
+            inline void submitDependableObject ( DependableObject &depObj, std::vector<DataAccess> &deps, SchedulePolicySuccessorFunctor* callback )
+            {
+               submitDependableObjectInternal ( depObj, deps.begin(), deps.end(), callback );
+            }
+
+            /*!
+             *  \note This function cannot be implemented in
+             *  BaseDependenciesDomain since it calls a template function,
+             *  and they cannot be virtual.
+             */
+            inline void submitDependableObject ( DependableObject &depObj, size_t numDeps, DataAccess* deps, SchedulePolicySuccessorFunctor* callback )
+            {
+               submitDependableObjectInternal ( depObj, deps, deps+numDeps, callback );
+            }
+
+            bool haveDependencePendantWrites ( void *addr )
+            {
+               Shard *shard = findShard( addr );
+               if ( shard == NULL ) return false;
+
+               SyncLockBlock lock( shard->_lock );
+               DepsMap::iterator it = shard->_map.find( addr );
+               if ( it == shard->_map.end() ) {
+                  return false;
+               } else {
+                  TrackableObject* status = it->second;
+                  DependableObject *lastWriter = status->getLastWriter();
+                  return (lastWriter != NULL);
+               }
+            }
+
+            void finalizeAllReductions ( void )
+            {
+               if ( _shards == NULL ) return;
+               // Shard locks are not held: releasing a CommutationDO may come back to this domain
+               for ( unsigned int i = 0; i < _numShards; i++ ) {
+                  DepsMap &map = _shards[i]._map;
+                  for ( DepsMap::iterator it = map.begin(); it != map.end(); it++ ) {
+                     TrackableObject& status = *( it->second );
+                     Address::TargetType target = it->first;
+                     CommutationDO *commDO = status.getCommDO();
+                     if ( commDO != NULL ) {
+                        status.setCommDO( NULL );
+                        status.setLastWriter( *commDO );
+
+                        TaskReduction *tr = myThread->getCurrentWD()->getTaskReduction( (const void *) target );
+                        if ( tr != NULL ) {
+                           if ( myThread->getCurrentWD()->getDepth() == tr->getDepth() )
+                              commDO->setTaskReduction( tr );
+                        }
+
+                        commDO->resetReferences();
+
+                        //! Finally decrease dummy dependence added in createCommutationDO
+                        std::list<uint64_t> flushDeps;
+                        commDO->decreasePredecessors( &flushDeps, NULL, false, false );
+                     }
+                  }
+               }
+            }
+      };
+
+      unsigned int ShardedDependenciesDomain::_numShards = 16;
+      unsigned int ShardedDependenciesDomain::_shardShift = 60;
+
+      template void ShardedDependenciesDomain::submitDependableObjectInternal ( DependableObject &depObj, DataAccess* begin, DataAccess* end, SchedulePolicySuccessorFunctor* callback );
+      template void ShardedDependenciesDomain::submitDependableObjectInternal ( DependableObject &depObj, std::vector<DataAccess>::iterator begin, std::vector<DataAccess>::iterator end, SchedulePolicySuccessorFunctor* callback );
+
+      class ShardedDependenciesManager : public DependenciesManager
+      {
+         public:
+            ShardedDependenciesManager() : DependenciesManager("Nanos sharded dependencies domain") {}
+            virtual ~ShardedDependenciesManager () {}
+
+            /*! \brief Creates a sharded dependencies domain.
+             */
+            DependenciesDomain* createDependenciesDomain () const
+            {
+               return NEW ShardedDependenciesDomain();
+            }
+      };
+
+      class NanosShardedDepsPlugin : public Plugin
+      {
+         public:
+            NanosShardedDepsPlugin() : Plugin( "Nanos++ sharded dependencies management plugin",1 )
+            {
+            }
+
+            virtual void config ( Config &cfg )
+            {
+               cfg.setOptionsSection( "Sharded deps module", "Sharded dependencies management module" );
+               cfg.registerConfigOption ( "deps-shards", NEW Config::UintVar( ShardedDependenciesDomain::_numShards ), "Number of shards of the address map of each dependencies domain (rounded up to a power of two)" );
+               cfg.registerArgOption( "deps-shards", "deps-shards" );
+            }
+
+            virtual void init()
+            {
+               unsigned int bits = 0;
+               while ( ( 1U << bits ) < ShardedDependenciesDomain::_numShards && bits < 16 ) bits++;
+               ShardedDependenciesDomain::_numShards = 1U << bits;
+               ShardedDependenciesDomain::_shardShift = 64 - bits;
+
+               sys.setDependenciesManager(NEW ShardedDependenciesManager());
+            }
+      };
+
+   }
+}
+
+DECLARE_PLUGIN("deps-sharded",nanos::ext::NanosShardedDepsPlugin);
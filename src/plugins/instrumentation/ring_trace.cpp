@@ -0,0 +1,427 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "ring_trace.hpp"
+#include "plugin.hpp"
+#include "system.hpp"
+#include "instrumentation.hpp"
+#include "instrumentationcontext_decl.hpp"
+#include "lock.hpp"
+#include "os.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace nanos {
+namespace ext {
+
+#ifdef NANOS_INSTRUMENTATION_ENABLED
+
+/*! \brief Single producer (its thread) single consumer (the flusher) ring of trace records
+ */
+class RingTraceBuffer
+{
+   private:
+      RingTraceRecord  *_records;
+      uint64_t          _mask;
+      uint16_t          _thread;
+      uint64_t          _head;          /**< Next record to write, only written by the producer */
+      uint64_t          _tailCache;     /**< Last _tail seen by the producer */
+      uint64_t          _dropped;       /**< Events lost because the ring was full */
+      char              _pad[NANOS_CACHELINE];
+      uint64_t          _tail;          /**< Next record to flush, only written by the consumer */
+
+      RingTraceBuffer ( const RingTraceBuffer & );
+      const RingTraceBuffer & operator= ( const RingTraceBuffer & );
+   public:
+      //! \param size Number of records, must be a power of two
+      RingTraceBuffer ( unsigned size, uint16_t thread ) : _records( NEW RingTraceRecord[size] ), _mask( size - 1 ),
+            _thread( thread ), _head( 0 ), _tailCache( 0 ), _dropped( 0 ), _tail( 0 ) {}
+
+      ~RingTraceBuffer () { delete[] _records; }
+
+      uint64_t getDropped () const { return _dropped; }
+
+      //! \brief Appends the events, all of them taken at time. Producer only.
+      void push ( uint64_t time, unsigned int count, Instrumentation::Event *events )
+      {
+         uint64_t head = _head;
+         for ( unsigned int i = 0; i < count; i++ ) {
+            Instrumentation::Event &e = events[i];
+            nanos_event_type_t type = e.getType();
+            nanos_event_key_t key = e.getKey();
+
+            if ( key == 0 && ( type == NANOS_POINT || type == NANOS_BURST_START || type == NANOS_BURST_END ) ) continue;
+
+            if ( head - _tailCache > _mask ) {
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+               _tailCache = __atomic_load_n( &_tail, __ATOMIC_ACQUIRE );
+#else
+               _tailCache = *( volatile uint64_t * ) &_tail;
+               memoryFence();
+#endif
+               if ( head - _tailCache > _mask ) {
+                  _dropped += count - i;
+                  break;
+               }
+            }
+
+            RingTraceRecord &r = _records[head & _mask];
+            r.time = time;
+            r.key = key;
+            r.thread = _thread;
+            r.type = ( uint8_t ) type;
+            if ( type == NANOS_PTP_START || type == NANOS_PTP_END ) {
+               r.value = ( uint64_t ) e.getId();
+               r.domain = ( uint8_t ) e.getDomain();
+            } else {
+               r.value = ( uint64_t ) e.getValue();
+               r.domain = 0;
+            }
+            head++;
+         }
+
+         // Publish all the records at once
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+         __atomic_store_n( &_head, head, __ATOMIC_RELEASE );
+#else
+         memoryFence();
+         *( volatile uint64_t * ) &_head = head;
+#endif
+      }
+
+      /*! \brief Passes all the published records to out.write( records, count ) and frees them. Consumer only.
+       *
+       *  Records are passed in at most two chunks (before and after wrapping around).
+       */
+      template <class Output>
+      void flush ( Output &out )
+      {
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+         uint64_t head = __atomic_load_n( &_head, __ATOMIC_ACQUIRE );
+#else
+         uint64_t head = *( volatile uint64_t * ) &_head;
+         memoryFence();
+#endif
+         uint64_t tail = _tail;
+         while ( tail != head ) {
+            uint64_t first = tail & _mask;
+            uint64_t count = std::min( head - tail, _mask + 1 - first );
+            out.write( &_records[first], count );
+            tail += count;
+         }
+
+#ifdef HAVE_NEW_GCC_ATOMIC_OPS
+         __atomic_store_n( &_tail, tail, __ATOMIC_RELEASE );
+#else
+         memoryFence();
+         *( volatile uint64_t * ) &_tail = tail;
+#endif
+      }
+};
+
+class InstrumentationRingTrace: public Instrumentation
+{
+   private:
+      typedef std::vector<RingTraceBuffer *> BufferList;
+
+      static __thread RingTraceBuffer *_myBuffer;
+
+      BufferList           _buffers;
+      Lock                 _buffersLock;
+      uint64_t             _startTime;
+      pthread_t            _flusher;
+      volatile bool        _stop;
+      bool                 _running;
+      // Output file, only used by the flusher thread (and by finalize once it has been joined)
+      std::string          _fileName;
+      int                  _fd;
+      char                *_window;          /**< Mapped window of the output file */
+      size_t               _windowSize;
+      size_t               _windowOffset;    /**< File offset of the mapped window */
+      size_t               _windowPos;       /**< Write position within the mapped window */
+
+   public:
+      static std::string   _fileBase;        /**< Output files prefix */
+      static unsigned int  _bufferSize;      /**< Records per thread buffer */
+      static unsigned int  _flushPeriod;     /**< Microseconds between flushes */
+
+      InstrumentationRingTrace() : Instrumentation( *NEW InstrumentationContextDisabled() ), _buffers(), _buffersLock(),
+            _startTime( OS::getMonotonicTimeNs() ), _flusher(), _stop( false ), _running( false ), _fileName(), _fd( -1 ), _window( NULL ),
+            _windowSize( 0 ), _windowOffset( 0 ), _windowPos( 0 ) {}
+
+      ~InstrumentationRingTrace()
+      {
+         for ( BufferList::iterator it = _buffers.begin(); it != _buffers.end(); ++it ) {
+            delete *it;
+         }
+      }
+
+      void initialize( void )
+      {
+         std::ostringstream name;
+         name << _fileBase << "." << getpid();
+         _fileName = name.str();
+
+         // A multiple of the page size, as window offsets must be page aligned
+         _windowSize = 4096 * sizeof( RingTraceRecord ) * 64;
+         _fd = open( ( _fileName + ".trace" ).c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+         if ( _fd == -1 ) {
+            warning0( "Ring trace: cannot create " << _fileName << ".trace: " << strerror( errno ) << ", tracing disabled" );
+            return;
+         }
+
+         RingTraceHeader header;
+         memset( &header, 0, sizeof( header ) );
+         memcpy( header.magic, NANOS_RING_TRACE_MAGIC, sizeof( header.magic ) );
+         header.startTime = _startTime;
+         header.recordSize = sizeof( RingTraceRecord );
+         write( ( const char * ) &header, sizeof( header ) );
+
+         _running = pthread_create( &_flusher, NULL, flusherMain, this ) == 0;
+         if ( !_running ) warning0( "Ring trace: cannot create the flusher thread, events will be written at finalization" );
+      }
+
+      void finalize( void )
+      {
+         if ( _running ) {
+            _stop = true;
+            pthread_join( _flusher, NULL );
+            _running = false;
+         }
+         if ( _fd != -1 ) {
+            flushAll();
+
+            uint64_t dropped = 0;
+            {
+               LockBlock lock( _buffersLock );
+               for ( BufferList::iterator it = _buffers.begin(); it != _buffers.end(); ++it ) {
+                  dropped += ( *it )->getDropped();
+               }
+            }
+            if ( dropped > 0 ) {
+               warning0( "Ring trace: " << dropped << " events were lost, consider increasing ring-trace-buffer-size" );
+            }
+
+            size_t size = _windowOffset + _windowPos;
+            if ( _window != NULL ) munmap( _window, _windowSize );
+            _window = NULL;
+            if ( ftruncate( _fd, size ) != 0 ) {
+               warning0( "Ring trace: cannot truncate " << _fileName << ".trace: " << strerror( errno ) );
+            }
+            close( _fd );
+            _fd = -1;
+            writeDictionary();
+            verbose0( "Ring trace written to " << _fileName << ".trace" );
+         }
+      }
+
+      void disable( void ) {}
+      void enable( void ) {}
+      void addResumeTask( WorkDescriptor &w ) {}
+      void addSuspendTask( WorkDescriptor &w, bool last ) {}
+
+      void addEventList ( unsigned int count, Event *events )
+      {
+         RingTraceBuffer *buffer = _myBuffer;
+         if ( buffer == NULL ) buffer = createBuffer();
+
+         buffer->push( OS::getMonotonicTimeNs() - _startTime, count, events );
+      }
+
+      void threadStart( BaseThread &thread ) {}
+      void threadFinish ( BaseThread &thread ) {}
+
+      //! \brief Copies records to the output file (flusher thread only)
+      void write ( const RingTraceRecord *records, uint64_t count )
+      {
+         write( ( const char * ) records, count * sizeof( RingTraceRecord ) );
+      }
+
+   private:
+      RingTraceBuffer * createBuffer ()
+      {
+         BaseThread *thread = getMyThreadSafe();
+         RingTraceBuffer *buffer = NEW RingTraceBuffer( _bufferSize,
+               thread != NULL ? ( uint16_t ) thread->getId() : ( uint16_t ) NANOS_RING_TRACE_NO_THREAD );
+         {
+            LockBlock lock( _buffersLock );
+            _buffers.push_back( buffer );
+         }
+         _myBuffer = buffer;
+         return buffer;
+      }
+
+      static void * flusherMain ( void *arg )
+      {
+         InstrumentationRingTrace *trace = ( InstrumentationRingTrace * ) arg;
+         while ( !trace->_stop ) {
+            usleep( _flushPeriod );
+            trace->flushAll();
+         }
+         return NULL;
+      }
+
+      void flushAll ()
+      {
+         BufferList buffers;
+         {
+            LockBlock lock( _buffersLock );
+            buffers = _buffers;
+         }
+         for ( BufferList::iterator it = buffers.begin(); it != buffers.end(); ++it ) {
+            ( *it )->flush( *this );
+         }
+      }
+
+      void write ( const char *data, size_t size )
+      {
+         while ( size > 0 && _fd != -1 ) {
+            if ( _window == NULL || _windowPos == _windowSize ) nextWindow();
+            if ( _window == NULL ) return;
+
+            size_t n = std::min( size, _windowSize - _windowPos );
+            memcpy( _window + _windowPos, data, n );
+            _windowPos += n;
+            data += n;
+            size -= n;
+         }
+      }
+
+      //! \brief Grows the output file and maps its next window
+      void nextWindow ()
+      {
+         if ( _window != NULL ) {
+            munmap( _window, _windowSize );
+            _window = NULL;
+            _windowOffset += _windowSize;
+            _windowPos = 0;
+         }
+         if ( ftruncate( _fd, _windowOffset + _windowSize ) != 0 ) {
+            warning0( "Ring trace: cannot grow " << _fileName << ".trace: " << strerror( errno ) << ", tracing stopped" );
+            return;
+         }
+         void *window = mmap( NULL, _windowSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, _windowOffset );
+         if ( window == MAP_FAILED ) {
+            warning0( "Ring trace: cannot map " << _fileName << ".trace: " << strerror( errno ) << ", tracing stopped" );
+            return;
+         }
+         _window = ( char * ) window;
+      }
+
+      void writeDictionary ()
+      {
+         std::ofstream dict( ( _fileName + ".dict" ).c_str() );
+         if ( !dict ) {
+            warning0( "Ring trace: cannot create " << _fileName << ".dict" );
+            return;
+         }
+
+         InstrumentationDictionary *iD = getInstrumentationDictionary();
+         InstrumentationDictionary::ConstKeyMapIterator itK;
+         InstrumentationKeyDescriptor::ConstValueMapIterator itV;
+         for ( itK = iD->beginKeyMap(); itK != iD->endKeyMap(); itK++ ) {
+            InstrumentationKeyDescriptor *kD = itK->second;
+            if ( kD->getId() == 0 ) continue;
+            dict << "key " << kD->getId() << " " << itK->first << " " << kD->getDescription() << std::endl;
+            for ( itV = kD->beginValueMap(); itV != kD->endValueMap(); itV++ ) {
+               InstrumentationValueDescriptor *vD = itV->second;
+               dict << "value " << kD->getId() << " " << vD->getId() << " " << vD->getDescription() << std::endl;
+            }
+         }
+      }
+};
+
+__thread RingTraceBuffer *InstrumentationRingTrace::_myBuffer = NULL;
+
+#else
+
+class InstrumentationRingTrace: public Instrumentation
+{
+   public:
+      static std::string   _fileBase;
+      static unsigned int  _bufferSize;
+      static unsigned int  _flushPeriod;
+
+      InstrumentationRingTrace() : Instrumentation() {}
+      ~InstrumentationRingTrace() {}
+
+      void initialize( void ) {}
+      void finalize( void ) {}
+      void disable( void ) {}
+      void enable( void ) {}
+      void addResumeTask( WorkDescriptor &w ) {}
+      void addSuspendTask( WorkDescriptor &w, bool last ) {}
+      void addEventList ( unsigned int count, Event *events ) {}
+      void threadStart( BaseThread &thread ) {}
+      void threadFinish ( BaseThread &thread ) {}
+};
+
+#endif
+
+std::string InstrumentationRingTrace::_fileBase = "nanox-trace";
+unsigned int InstrumentationRingTrace::_bufferSize = 65536;
+unsigned int InstrumentationRingTrace::_flushPeriod = 10000;
+
+class InstrumentationRingTracePlugin : public Plugin {
+   public:
+      InstrumentationRingTracePlugin () : Plugin( "Instrumentation which writes a binary trace through per-thread ring buffers.", 1 ) {}
+      ~InstrumentationRingTracePlugin () {}
+
+      void config( Config &cfg )
+      {
+         cfg.setOptionsSection( "Ring trace plugin", "Ring trace instrumentation specific options" );
+
+         cfg.registerConfigOption( "ring-trace-file", NEW Config::StringVar( InstrumentationRingTrace::_fileBase ),
+                                   "Prefix of the trace files: <prefix>.<pid>.trace and <prefix>.<pid>.dict (default: nanox-trace)" );
+         cfg.registerArgOption( "ring-trace-file", "ring-trace-file" );
+         cfg.registerEnvOption( "ring-trace-file", "NX_RING_TRACE_FILE" );
+
+         cfg.registerConfigOption( "ring-trace-buffer-size", NEW Config::UintVar( InstrumentationRingTrace::_bufferSize ),
+                                   "Events kept per thread between flushes, rounded up to a power of two (default: 65536)" );
+         cfg.registerArgOption( "ring-trace-buffer-size", "ring-trace-buffer-size" );
+         cfg.registerEnvOption( "ring-trace-buffer-size", "NX_RING_TRACE_BUFFER_SIZE" );
+
+         cfg.registerConfigOption( "ring-trace-flush-period", NEW Config::UintVar( InstrumentationRingTrace::_flushPeriod ),
+                                   "Microseconds between flushes of the thread buffers to the trace file (default: 10000)" );
+         cfg.registerArgOption( "ring-trace-flush-period", "ring-trace-flush-period" );
+         cfg.registerEnvOption( "ring-trace-flush-period", "NX_RING_TRACE_FLUSH_PERIOD" );
+      }
+
+      void init ()
+      {
+         unsigned int size = 2;
+         while ( size < InstrumentationRingTrace::_bufferSize && size < 0x80000000U ) size <<= 1;
+         InstrumentationRingTrace::_bufferSize = size;
+
+         sys.setInstrumentation( NEW InstrumentationRingTrace() );
+      }
+};
+
+} // namespace ext
+} // namespace nanos
+
+DECLARE_PLUGIN("instrumentation-ring_trace",nanos::ext::InstrumentationRingTracePlugin);
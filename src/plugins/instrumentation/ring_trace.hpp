@@ -0,0 +1,64 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_RING_TRACE_H
+#define _NANOS_RING_TRACE_H
+
+#include <stdint.h>
+
+/*! \file ring_trace.hpp
+ *  \brief Layout of the files written by the ring_trace instrumentation plugin
+ *
+ *  A trace is made of two files:
+ *  - <base>.<pid>.trace: a RingTraceHeader followed by RingTraceRecord's. Records of a given
+ *    thread are in time order, but records of different threads are interleaved in blocks.
+ *  - <base>.<pid>.dict: the instrumentation dictionary as text lines, either
+ *    "key <key> <name> <description>" or "value <key> <value> <description>".
+ *
+ *  Both are read by nanox-trace-convert (src/utils) to produce Paraver or Chrome traces.
+ */
+
+#define NANOS_RING_TRACE_MAGIC         "NXRTRACE"
+#define NANOS_RING_TRACE_NO_THREAD     0xFFFF      /**< Thread field of events raised by non runtime threads */
+
+namespace nanos {
+namespace ext {
+
+   struct RingTraceHeader
+   {
+      char      magic[8];      /**< NANOS_RING_TRACE_MAGIC (not null terminated) */
+      uint64_t  startTime;     /**< Monotonic time (ns) record times are relative to */
+      uint32_t  recordSize;    /**< sizeof(RingTraceRecord) */
+      uint32_t  reserved;
+   };
+
+   struct RingTraceRecord
+   {
+      uint64_t  time;          /**< Nanoseconds since RingTraceHeader::startTime */
+      uint64_t  value;         /**< Event value, or event id for PtP events */
+      uint32_t  key;           /**< Event key, 0 for state events */
+      uint16_t  thread;        /**< Runtime thread id, NANOS_RING_TRACE_NO_THREAD if none */
+      uint8_t   type;          /**< nanos_event_type_t */
+      uint8_t   domain;        /**< nanos_event_domain_t, PtP events only */
+   };
+
+} // namespace ext
+} // namespace nanos
+
+#endif
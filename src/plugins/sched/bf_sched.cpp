@@ -22,6 +22,7 @@
 #include "plugin.hpp"
 #include "system.hpp"
 #include "config.hpp"
+#include "stealorder.hpp"
 
 namespace nanos {
    namespace ext {
@@ -41,10 +42,39 @@ namespace nanos {
               ~TeamData () { delete _readyQueue; }
            };
 
+           /*! \brief Per-thread ready queue, only used when work-stealing deques are enabled */
+           struct ThreadData : public ScheduleThreadData
+           {
+              WDStealingDeque _readyQueue;
+              /*! victims of this thread, nearest first */
+              StealOrder      _stealOrder;
+
+              ThreadData () : ScheduleThreadData(), _readyQueue(), _stealOrder( _stealTopology ) {}
+              virtual ~ThreadData () {
+                 ensure( _readyQueue.empty(), "Destroying non-empty queue" );
+              }
+           };
+
+           /*! \brief Steals from the back of the deque of a victim */
+           struct StealFrom
+           {
+              BaseThread *_thief;
+
+              StealFrom ( BaseThread *thief ) : _thief( thief ) {}
+
+              WD * operator() ( BaseThread &victim )
+              {
+                 ThreadData &vdata = (ThreadData &) *victim.getTeamData()->getScheduleData();
+                 return vdata._readyQueue.pop_back( _thief );
+              }
+           };
+
          public:
            static bool       _useStack;
            static bool       _usePriority;
            static bool       _useSmartPriority;
+           static bool       _useWSDeque;
+           static bool       _stealTopology;
 
            BreadthFirst() : SchedulePolicy("Breadth First")
            {
@@ -54,13 +84,19 @@ namespace nanos {
                  disable too
                */
                _usePriority = _usePriority && sys.getPrioritiesNeeded();
+
+               /* Work-stealing deques do not keep any priority order */
+               if ( _useWSDeque && ( _usePriority || _useSmartPriority ) ) {
+                  warning0( "Work-stealing deques cannot be used together with priorities, disabling bf-ws-deque" );
+                  _useWSDeque = false;
+               }
            }
            virtual ~BreadthFirst () {}
 
          private:
             
            virtual size_t getTeamDataSize () const { return sizeof(TeamData); }
-           virtual size_t getThreadDataSize () const { return 0; }
+           virtual size_t getThreadDataSize () const { return _useWSDeque ? sizeof(ThreadData) : 0; }
 
            virtual ScheduleTeamData * createTeamData ()
            {
@@ -69,14 +105,18 @@ namespace nanos {
 
            virtual ScheduleThreadData * createThreadData ()
            {
-              return 0;
+              return _useWSDeque ? NEW ThreadData() : 0;
            }
 
            virtual void queue ( BaseThread *thread, WD &wd )
            {
               BaseThread *targetThread = wd.isTiedTo();
               if ( targetThread ) targetThread->addNextWD(&wd);
-              else {
+              else if ( _useWSDeque ) {
+                 ThreadData &data = (ThreadData &) *thread->getTeamData()->getScheduleData();
+                 if ( thread == myThread ) data._readyQueue.setOwner( thread );
+                 data._readyQueue.push_front( &wd );
+              } else {
                  TeamData &tdata = (TeamData &) *thread->getTeam()->getScheduleData();
                  if ( _useStack ) return tdata._readyQueue->push_front( &wd );
                  else tdata._readyQueue->push_back( &wd );
@@ -86,6 +126,9 @@ namespace nanos {
             virtual void queue ( BaseThread ** threads, WD ** wds, size_t numElems )
             {
                fatal_cond( numElems == 0, "Cannot queue 0 elements.");
+
+               // Per-thread deques cannot be filled in batch
+               if ( _useWSDeque ) return SchedulePolicy::queue( threads, wds, numElems );
                
                // First step: check if all threads have the same team
                ThreadTeam* team = threads[0]->getTeam();
@@ -168,11 +211,28 @@ namespace nanos {
 
            WD * atIdle ( BaseThread *thread, int numSteal )
            {
+              if ( _useWSDeque ) return stealFromTeam( thread );
+
               TeamData &tdata = (TeamData &) *thread->getTeam()->getScheduleData();
               
               return tdata._readyQueue->pop_front( thread );
            }
 
+           /*! \brief Pops from the thread's own deque (LIFO with bf-use-stack, FIFO otherwise)
+            *  and, if it is empty, steals from the other threads of the team, nearest ones first.
+            */
+           WD * stealFromTeam ( BaseThread *thread )
+           {
+              ThreadData &data = (ThreadData &) *thread->getTeamData()->getScheduleData();
+              data._readyQueue.setOwner( thread );
+
+              WD *wd = _useStack ? data._readyQueue.pop_front( thread ) : data._readyQueue.pop_back( thread );
+              if ( wd != NULL ) return wd;
+
+              StealFrom stealFrom( thread );
+              return data._stealOrder.steal( thread, stealFrom );
+           }
+
            WD * atPrefetch ( BaseThread *thread, WD &current )
            {
               WD * found = current.getImmediateSuccessor(*thread);
@@ -212,6 +272,8 @@ namespace nanos {
 
             int getNumConcurrentWDs()
             {
+               if ( _useWSDeque ) return SchedulePolicy::getNumConcurrentWDs();
+
                TeamData &tdata = (TeamData &) *myThread->getTeam()->getScheduleData();
                if ( _usePriority || _useSmartPriority ) {
                   WDPriorityQueue<> &q = (WDPriorityQueue<> &) *(tdata._readyQueue);
@@ -231,6 +293,8 @@ namespace nanos {
       bool BreadthFirst::_useStack = false;
       bool BreadthFirst::_usePriority = true;
       bool BreadthFirst::_useSmartPriority = false;
+      bool BreadthFirst::_useWSDeque = false;
+      bool BreadthFirst::_stealTopology = true;
 
       class BFSchedPlugin : public Plugin
       {
@@ -253,6 +317,12 @@ namespace nanos {
                cfg.registerConfigOption ( "schedule-smart-priority", NEW Config::FlagOption( BreadthFirst::_useSmartPriority ), "Smart priority queue propagates high priorities to predecessors");
                cfg.registerArgOption( "schedule-smart-priority", "schedule-smart-priority" );
 
+               cfg.registerConfigOption ( "bf-ws-deque", NEW Config::FlagOption( BreadthFirst::_useWSDeque ), "Per-thread lock-free work-stealing deques instead of a team queue");
+               cfg.registerArgOption( "bf-ws-deque", "bf-ws-deque" );
+
+               cfg.registerConfigOption ( "bf-steal-topology", NEW Config::FlagOption( BreadthFirst::_stealTopology ), "With bf-ws-deque, steals from the nearest threads (shared cache, then NUMA node) first");
+               cfg.registerArgOption( "bf-steal-topology", "bf-steal-topology" );
+
             }
 
             virtual void init() {
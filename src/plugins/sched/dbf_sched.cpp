@@ -21,6 +21,7 @@
 #include "wddeque.hpp"
 #include "plugin.hpp"
 #include "system.hpp"
+#include "stealorder.hpp"
 
 namespace nanos {
    namespace ext {
@@ -30,6 +31,7 @@ namespace nanos {
          public:
             static bool       _usePriority;
             static bool       _useSmartPriority;
+            static bool       _stealTopology;
          private:
             /** \brief DistributedBF Scheduler data associated to each thread
               *
@@ -38,8 +40,10 @@ namespace nanos {
             {
                /*! queue of ready tasks to be executed */
                WDPool *_readyQueue;
+               /*! victims of this thread, nearest first */
+               StealOrder _stealOrder;
 
-               ThreadData () : ScheduleThreadData(), _readyQueue( NULL )
+               ThreadData () : ScheduleThreadData(), _readyQueue( NULL ), _stealOrder( _stealTopology )
                {
                  if ( _usePriority || _useSmartPriority ) _readyQueue = NEW WDPriorityQueue<>( true /* enableDeviceCounter */, true /* optimise option */ );
                  else _readyQueue = NEW WDDeque( true /* enableDeviceCounter */ );
@@ -47,6 +51,20 @@ namespace nanos {
                virtual ~ThreadData () { delete _readyQueue; }
             };
 
+            /*! \brief Steals from the back of the ready queue of a victim */
+            struct StealFrom
+            {
+               BaseThread *_thief;
+
+               StealFrom ( BaseThread *thief ) : _thief( thief ) {}
+
+               WD * operator() ( BaseThread &victim )
+               {
+                  ThreadData &tdata = ( ThreadData & ) *victim.getTeamData()->getScheduleData();
+                  return tdata._readyQueue->pop_back ( _thief );
+               }
+            };
+
             /* disable copy and assigment */
             explicit DistributedBFPolicy ( const DistributedBFPolicy & );
             const DistributedBFPolicy & operator= ( const DistributedBFPolicy & );
@@ -194,26 +212,9 @@ namespace nanos {
             }
 
             //! If also the parent is NULL or if someone moved it to another queue while was trying to steal it, 
-            //! try to steal tasks from other queues
-            //! \warning other queues are checked cyclically: should be random
-            int size = thread->getTeam()->getFinalSize();
-            int thid = rand() % size;
-            int count = 0;
-            wd = NULL;
-
-            do {
-               thid = ( thid + 1 ) % size;
-
-               BaseThread &victim = thread->getTeam()->getThread(thid);
-
-               if ( victim.getTeam() != NULL ) {
-                 ThreadData &tdata = ( ThreadData & ) *victim.getTeamData()->getScheduleData();
-                 wd = tdata._readyQueue->pop_back ( thread );
-               }
-
-               count++;
-
-            } while ( wd == NULL && count < size );
+            //! try to steal tasks from other queues, nearest ones first
+            StealFrom stealFrom( thread );
+            wd = data._stealOrder.steal( thread, stealFrom );
 
             return wd;
          }
@@ -221,6 +222,7 @@ namespace nanos {
 
       bool DistributedBFPolicy::_usePriority = true;
       bool DistributedBFPolicy::_useSmartPriority = false;
+      bool DistributedBFPolicy::_stealTopology = true;
 
       class DistributedBFSchedPlugin : public Plugin
       {
@@ -238,6 +240,8 @@ namespace nanos {
                cfg.registerConfigOption ( "schedule-smart-priority", NEW Config::FlagOption( DistributedBFPolicy::_useSmartPriority ), "Smart priority queue propagates high priorities to predecessors");
                cfg.registerArgOption( "schedule-smart-priority", "schedule-smart-priority" );
 
+               cfg.registerConfigOption ( "dbf-steal-topology", NEW Config::FlagOption( DistributedBFPolicy::_stealTopology ), "Steals from the nearest threads (shared cache, then NUMA node) first");
+               cfg.registerArgOption( "dbf-steal-topology", "dbf-steal-topology" );
                
             }
 
@@ -0,0 +1,116 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_STEAL_ORDER_HPP
+#define _NANOS_STEAL_ORDER_HPP
+
+#include <stdlib.h>
+#include <vector>
+#include "basethread.hpp"
+#include "threadteam.hpp"
+#include "system.hpp"
+
+namespace nanos {
+namespace ext {
+
+/*! \brief Victim selection order for work-stealing schedulers
+ *
+ *  The other threads of the team are grouped by their distance to the thief in the machine
+ *  topology (see Hwloc::getCpuDistance): threads sharing a private cache first, then those
+ *  sharing an outer cache, the same NUMA node and finally remote NUMA nodes. Levels are visited
+ *  nearest first; inside each level the walk starts at a random victim.
+ *
+ *  Without topology information all the threads fall in the first level, which is the same
+ *  random-start cyclic walk the schedulers used before.
+ */
+class StealOrder
+{
+   public:
+      enum { NUM_LEVELS = 4 };
+
+   private:
+      typedef std::vector<BaseThread *> VictimList;
+
+      VictimList     _levels[NUM_LEVELS];
+      bool           _useTopology;
+      ThreadTeam    *_team;     /**< Team the levels were computed for */
+      unsigned       _teamSize; /**< Team size the levels were computed for */
+
+      /*! \brief Recomputes the victim levels of 'thread' for its current team */
+      void build ( BaseThread *thread, ThreadTeam *team )
+      {
+         for ( int l = 0; l < NUM_LEVELS; l++ ) _levels[l].clear();
+
+         bool topology = _useTopology && sys._hwloc.isHwlocAvailable();
+         int cpu = topology ? thread->getCpuId() : 0;
+
+         unsigned size = team->size();
+         for ( unsigned i = 0; i < size; i++ ) {
+            BaseThread *victim = &team->getThread( i );
+            if ( victim == thread ) continue;
+
+            unsigned level = topology ? sys._hwloc.getCpuDistance( cpu, victim->getCpuId() ) : 0;
+            if ( level >= NUM_LEVELS ) level = NUM_LEVELS - 1;
+            _levels[level].push_back( victim );
+         }
+
+         _team = team;
+         _teamSize = size;
+      }
+
+   public:
+      /*! \param useTopology group the victims by topology distance, otherwise use a single level */
+      StealOrder ( bool useTopology ) : _useTopology( useTopology ), _team( NULL ), _teamSize( 0 ) {}
+
+      /*! \brief Visits the victims of 'thread' nearest first until 'stealFrom' returns a WD
+       *
+       *  \param thread the thief
+       *  \param stealFrom functor called with every victim that is still in the team, returns the stolen WD or NULL
+       */
+      template <class STEAL_T>
+      WD * steal ( BaseThread *thread, STEAL_T &stealFrom )
+      {
+         ThreadTeam *team = thread->getTeam();
+         if ( team != _team || team->size() != _teamSize ) build( thread, team );
+
+         for ( int l = 0; l < NUM_LEVELS; l++ ) {
+            VictimList &victims = _levels[l];
+            int size = victims.size();
+            if ( size == 0 ) continue;
+
+            int v = rand() % size;
+            for ( int count = 0; count < size; count++ ) {
+               v = ( v + 1 ) % size;
+
+               BaseThread *victim = victims[v];
+               if ( victim->getTeam() != team ) continue;
+
+               WD *wd = stealFrom( *victim );
+               if ( wd != NULL ) return wd;
+            }
+         }
+
+         return NULL;
+      }
+};
+
+} // namespace ext
+} // namespace nanos
+
+#endif
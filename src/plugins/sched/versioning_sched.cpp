@@ -25,6 +25,7 @@
 #include "os.hpp"
 #include "config.hpp"
 #include "hashmap.hpp"
+#include "perfmodelstore_decl.hpp"
 
 #include <math.h>
 #include <limits>
@@ -40,6 +41,7 @@ namespace ext
 #define MAX_DEVIATION   0.01
 #define MIN_RECORDS     3
 #define MAX_DIFFERENCE  4
+#define MERGE_RECORDS   16
 
 /*
  * Some terminology and data structures schemas to understand the code
@@ -71,6 +73,14 @@ namespace ext
  *  |                                  | +-----------------+ | |
  *  |                                  +---------------------+ |
  *  +----------------------------------------------------------+
+ *
+ * Once a version has enough records, each thread accumulates its own execution times and
+ * merges them into WDExecInfo every MERGE_RECORDS executions, so that threads do not
+ * serialize on the stats lock after each task.
+ *
+ * If a performance model file is given, WDExecInfo records are seeded from it (keyed by a
+ * run independent outline key, the params size and the device name) and saved back at
+ * shutdown, so versions that were already measured in previous runs are not learned again.
  */
 
 
@@ -91,6 +101,7 @@ namespace ext
       double                  _lastElapsedTime;
       int                     _numRecords;
       Atomic<int>             _numAssigned;
+      Device const *          _device;
    };
 
    typedef WDBestRecordKey WDExecInfoKey;
@@ -98,6 +109,15 @@ namespace ext
    typedef std::vector<WDExecRecord> WDExecInfoData;
    typedef HashMap< WDExecInfoKey, WDExecInfoData, false, 257, WDExecInfoHashKey > WDExecInfo;
 
+   struct WDPendingRecord {
+      int                     _numRecords;
+      double                  _elapsedTime;
+      double                  _lastElapsedTime;
+   };
+
+   typedef std::pair< WDExecInfoKey, unsigned int > WDPendingKey;
+   typedef std::map< WDPendingKey, WDPendingRecord > WDPendingRecords;
+
 
    typedef enum {
       NANOS_SCHED_VER_NULL_EVENT,                        /* 0 */
@@ -259,6 +279,7 @@ namespace ext
                WDBestRecord               _wdExecBest;
                WDExecInfo                 _wdExecStats;
                std::set<WDExecInfoKey>    _wdExecStatsKeys;
+               std::map<WDExecInfoKey, std::string> _wdModelKeys;
                ResourceMap                _executionMap;
 
                static Lock                _bestLock;
@@ -266,7 +287,7 @@ namespace ext
 
                WDDeque *                  _readyQueue;
 
-               TeamData ( unsigned int size ) : ScheduleTeamData(), _wdExecBest(), _wdExecStats(), _wdExecStatsKeys(), _executionMap( size )
+               TeamData ( unsigned int size ) : ScheduleTeamData(), _wdExecBest(), _wdExecStats(), _wdExecStatsKeys(), _wdModelKeys(), _executionMap( size )
                {
                   unsigned int i;
                   for ( i = 0; i < size; i++ ) {
@@ -304,6 +325,7 @@ namespace ext
                   bool compatible = false;
                   unsigned int i;
                   for ( i = 0; i < numVersions; i++ ) {
+                     data[i]._device = wd->getDevices()[i]->getDevice();
                      // Check there is at least one thread for each compatible device type
                      if ( sys.getNumWorkers( wd->getDevices()[i] ) == 0 ) {
                         // If not, 'disable' the implementation by making the scheduler never choose it
@@ -322,9 +344,15 @@ namespace ext
                      }
                   }
 
+                  WDExecInfoKey key = std::make_pair( wd->getVersionGroupId(), wd->getParamsSize() );
+                  if ( _perfModel.isEnabled() ) {
+                     std::string outline = PerfModelStore::getOutlineKey( ( void * ) wd->getVersionGroupId(), wd->getDescription() );
+                     _wdModelKeys[key] = outline;
+                     if ( !outline.empty() ) loadExecInfoData( data, wd, outline );
+                  }
+
                   _statsLock.release();
 
-                  WDExecInfoKey key = std::make_pair( wd->getVersionGroupId(), wd->getParamsSize() );
                   _wdExecStatsKeys.insert( key );
 
                   fatal_cond( !compatible, "Error: there is no suitable device in the system to run the submitted task.");
@@ -332,6 +360,78 @@ namespace ext
                }
 
 
+               /*
+                * Seed the records of a new wd key with the statistics saved by previous runs
+                * Must be called with _statsLock held
+                */
+               void loadExecInfoData ( WDExecInfoData & data, WD * wd, const std::string &outline )
+               {
+                  WDBestRecordData best;
+                  best._pe = NULL;
+                  best._versionId = 0;
+                  best._elapsedTime = std::numeric_limits<double>::max();
+
+                  unsigned int i;
+                  for ( i = 0; i < data.size(); i++ ) {
+                     PerfModelStore::Record stored;
+                     if ( data[i]._numRecords != -1 || !_perfModel.find( outline, wd->getParamsSize(), data[i]._device->getName(), stored ) ) continue;
+
+                     // Any PE of the right type will do, it is only used to match worker device types
+                     ProcessingElement * pe = NULL;
+                     for ( int w = 0; w < sys.getNumWorkers() && pe == NULL; w++ ) {
+                        if ( sys.getWorker( w )->runningOn()->supports( *data[i]._device ) ) pe = sys.getWorker( w )->runningOn();
+                     }
+                     if ( pe == NULL ) continue;
+
+                     int numRecords = stored._count < ( unsigned long ) std::numeric_limits<int>::max() ? ( int ) stored._count : std::numeric_limits<int>::max();
+                     data[i]._pe = pe;
+                     data[i]._elapsedTime = stored._mean;
+                     data[i]._lastElapsedTime = stored._mean;
+                     data[i]._numRecords = numRecords;
+                     data[i]._numAssigned = numRecords;
+
+                     if ( stored._mean < best._elapsedTime ) {
+                        best._pe = pe;
+                        best._versionId = i;
+                        best._elapsedTime = stored._mean;
+                     }
+
+                     debug( "[versioning] Loaded record for key ("
+                           + toString<unsigned long>( wd->getVersionGroupId() )
+                           + ", " + toString<size_t>( wd->getParamsSize() ) + ") {dev="
+                           + data[i]._device->getName() + ", #=" + toString<int>( numRecords )
+                           + ", T=" + toString<double>( stored._mean ) + "}" );
+                  }
+
+                  if ( best._pe != NULL ) {
+                     _bestLock.acquire();
+                     getWDBestRecord( wd ) = best;
+                     _bestLock.release();
+                  }
+               }
+
+
+               /*
+                * Hand the statistics recorded in this run to the performance model store
+                */
+               void storeExecInfoData ()
+               {
+                  for ( std::set<WDExecInfoKey>::iterator it = _wdExecStatsKeys.begin(); it != _wdExecStatsKeys.end(); it++ ) {
+                     WDExecInfoKey key = *it;
+                     std::map<WDExecInfoKey, std::string>::iterator outline = _wdModelKeys.find( key );
+                     if ( outline == _wdModelKeys.end() || outline->second.empty() ) continue;
+
+                     WDExecInfoData &data = _wdExecStats[key];
+                     for ( unsigned int i = 0; i < data.size(); i++ ) {
+                        WDExecRecord &record = data[i];
+                        if ( record._pe == NULL || record._numRecords <= 0 ) continue;
+                        _perfModel.update( outline->second, key.second, record._device->getName(),
+                              PerfModelStore::Record( record._numRecords, record._elapsedTime ) );
+                     }
+                  }
+               }
+
+
                inline WDExecInfoData& getWDExecInfo ( WD * wd )
                {
                   WDExecInfoKey key = std::make_pair( wd->getVersionGroupId(), wd->getParamsSize() );
@@ -394,16 +494,29 @@ namespace ext
                }
          };
 
+         struct ThreadData : public ScheduleThreadData
+         {
+            public:
+               WDPendingRecords           _pendingRecords;
+               int                        _numPending;
+               Lock                       _pendingLock;   //!< Taken by the owner thread and by atShutdown
+
+               ThreadData () : ScheduleThreadData(), _pendingRecords(), _numPending( 0 ), _pendingLock() {}
+               virtual ~ThreadData () {}
+         };
+
       public:
-         static bool       _useStack;
-         static int        _minRecordTrial;
+         static bool             _useStack;
+         static int              _minRecordTrial;
+         static std::string      _perfModelFile;
+         static PerfModelStore   _perfModel;
 
          Versioning() : SchedulePolicy( "Versioning" ) {}
          virtual ~Versioning () {}
 
       private:
          virtual size_t getTeamDataSize () const { return sizeof( TeamData ); }
-         virtual size_t getThreadDataSize () const { return 0; }
+         virtual size_t getThreadDataSize () const { return sizeof( ThreadData ); }
 
          virtual ScheduleTeamData * createTeamData ()
          {
@@ -417,7 +530,7 @@ namespace ext
 
          virtual ScheduleThreadData * createThreadData ()
          {
-            return 0;
+            return NEW ThreadData();
          }
 
          virtual void queue ( BaseThread *thread, WD &wd )
@@ -1047,6 +1160,35 @@ namespace ext
             return atIdle( thread, false );
          }
 
+         /*
+          * Merge the execution times a thread has kept since its last merge into the team stats
+          * The caller holds the _pendingLock of the thread
+          */
+         void mergeRecords ( TeamData &tdata, ThreadData &thdata )
+         {
+            if ( thdata._pendingRecords.empty() ) return;
+
+            tdata._statsLock.acquire();
+
+            for ( WDPendingRecords::iterator it = thdata._pendingRecords.begin(); it != thdata._pendingRecords.end(); it++ ) {
+               WDExecInfoData &data = tdata._wdExecStats[it->first.first];
+               if ( it->first.second >= data.size() ) continue;
+
+               WDExecRecord &records = data[it->first.second];
+               double time = records._elapsedTime * records._numRecords;
+               records._numRecords += it->second._numRecords;
+               records._elapsedTime = ( time + it->second._elapsedTime ) / records._numRecords;
+               records._lastElapsedTime = it->second._lastElapsedTime;
+            }
+
+            memoryFence();
+
+            tdata._statsLock.release();
+
+            thdata._pendingRecords.clear();
+            thdata._numPending = 0;
+         }
+
          WD * atBeforeExit ( BaseThread *thread, WD &currentWD, bool schedule )
          {
             TeamData &tdata = ( TeamData & ) *thread->getTeam()->getScheduleData();
@@ -1058,70 +1200,89 @@ namespace ext
 
                tdata._executionMap[thread->getId()]->finishTask( &currentWD );
 
-               tdata._statsLock.acquire();
                WDExecInfoData & data = tdata.getWDExecInfo( &currentWD );
 
-               // Record statistic values
-               // Update stats
-               // TODO: Choose the appropriate device
-
-               if ( data[devIdx]._numRecords == -1 ) {
-                  // As it is the first time for the given PE, we omit the results because
-                  // they can be potentially worse than future executions
-                  WDExecRecord & records = data[devIdx];
-                  records._pe = pe;
-                  records._elapsedTime = 0.0; // Should be 'executionTime'
-                  records._numRecords++; // Should be '1' but in fact it is -1+1 = 0
-                  records._lastElapsedTime = executionTime;
-
-                  debug("[versioning] First recording for key ("
-                        + toString<unsigned long>( currentWD.getVersionGroupId() )
-                        + ", " + toString<size_t>( currentWD.getParamsSize() )
-                        + ") {pe=" + toString<void *>( records._pe )
-                        + ", dev=" + currentWD.getDevices()[devIdx]->getDevice()->getName()
-                        + ", #=" + toString<int>( records._numRecords )
-                        + ", T=" + toString<double>( records._elapsedTime )
-                        + ", T2=" + toString<double>( records._lastElapsedTime )
-                        + "}; exec time = " + toString<double>( executionTime ) );
+               if ( data[devIdx]._numRecords >= _minRecordTrial ) {
+                  // The version is already known: keep the record in the thread and merge it later
+                  ThreadData &thdata = ( ThreadData & ) *thread->getTeamData()->getScheduleData();
+                  WDPendingKey key = std::make_pair( std::make_pair( currentWD.getVersionGroupId(), currentWD.getParamsSize() ), devIdx );
+                  thdata._pendingLock.acquire();
+                  WDPendingRecord &pending = thdata._pendingRecords[key];
+                  pending._numRecords++;
+                  pending._elapsedTime += executionTime;
+                  pending._lastElapsedTime = executionTime;
+
+                  if ( ++thdata._numPending >= MERGE_RECORDS ) mergeRecords( tdata, thdata );
+                  thdata._pendingLock.release();
 
                } else {
-                  WDExecRecord & records  = data[devIdx];
-                  double time = records._elapsedTime * records._numRecords;
-                  records._numRecords++;
-                  records._elapsedTime = ( time + executionTime ) / records._numRecords;
-                  records._lastElapsedTime = executionTime;
-
-                  debug("[versioning] Recording for key ("
-                        + toString<unsigned long>( currentWD.getVersionGroupId() )
-                        + ", " + toString<size_t>( currentWD.getParamsSize() )
-                        + ") {pe=" + toString<void *>( records._pe )
-                        + ", dev=" + currentWD.getDevices()[devIdx]->getDevice()->getName()
-                        + ", #=" + toString<int>( records._numRecords )
-                        + ", T=" + toString<double>( records._elapsedTime )
-                        + ", T2=" + toString<double>( records._lastElapsedTime )
-                        + "}; exec time = " + toString<double>( executionTime ) );
+                  tdata._statsLock.acquire();
 
-               }
+                  // Record statistic values
+                  // Update stats
+                  // TODO: Choose the appropriate device
+
+                  if ( data[devIdx]._numRecords == -1 ) {
+                     // As it is the first time for the given PE, we omit the results because
+                     // they can be potentially worse than future executions
+                     WDExecRecord & records = data[devIdx];
+                     records._pe = pe;
+                     records._elapsedTime = 0.0; // Should be 'executionTime'
+                     records._numRecords++; // Should be '1' but in fact it is -1+1 = 0
+                     records._lastElapsedTime = executionTime;
+
+                     debug("[versioning] First recording for key ("
+                           + toString<unsigned long>( currentWD.getVersionGroupId() )
+                           + ", " + toString<size_t>( currentWD.getParamsSize() )
+                           + ") {pe=" + toString<void *>( records._pe )
+                           + ", dev=" + currentWD.getDevices()[devIdx]->getDevice()->getName()
+                           + ", #=" + toString<int>( records._numRecords )
+                           + ", T=" + toString<double>( records._elapsedTime )
+                           + ", T2=" + toString<double>( records._lastElapsedTime )
+                           + "}; exec time = " + toString<double>( executionTime ) );
+
+                  } else {
+                     WDExecRecord & records  = data[devIdx];
+                     double time = records._elapsedTime * records._numRecords;
+                     records._numRecords++;
+                     records._elapsedTime = ( time + executionTime ) / records._numRecords;
+                     records._lastElapsedTime = executionTime;
+
+                     debug("[versioning] Recording for key ("
+                           + toString<unsigned long>( currentWD.getVersionGroupId() )
+                           + ", " + toString<size_t>( currentWD.getParamsSize() )
+                           + ") {pe=" + toString<void *>( records._pe )
+                           + ", dev=" + currentWD.getDevices()[devIdx]->getDevice()->getName()
+                           + ", #=" + toString<int>( records._numRecords )
+                           + ", T=" + toString<double>( records._elapsedTime )
+                           + ", T2=" + toString<double>( records._lastElapsedTime )
+                           + "}; exec time = " + toString<double>( executionTime ) );
 
-               memoryFence();
+                  }
 
-               tdata._statsLock.release();
-               tdata._bestLock.acquire();
+                  memoryFence();
 
-               // Check if it is the best time
-               WDBestRecordData &bestData = tdata.getWDBestRecord( &currentWD );
-               bool isBestTime = ( bestData._elapsedTime > executionTime ) || ( bestData._pe == NULL );
-               if ( isBestTime ) {
-                  // New best value recorded
-                  bestData._versionId = devIdx;
-                  bestData._pe = pe;
-                  bestData._elapsedTime = executionTime;
-
-                  debug("[versioning] New best time: {pe=" + toString<void *>( bestData._pe )
-                        + ", T=" + toString<double>( bestData._elapsedTime ) + "}" );
+                  tdata._statsLock.release();
                }
 
-               tdata._bestLock.release();
+               // Check if it is the best time, the lock is only needed if it may be
+               WDBestRecordData &bestData = tdata.getWDBestRecord( &currentWD );
+               if ( ( bestData._elapsedTime > executionTime ) || ( bestData._pe == NULL ) ) {
+                  tdata._bestLock.acquire();
+
+                  bool isBestTime = ( bestData._elapsedTime > executionTime ) || ( bestData._pe == NULL );
+                  if ( isBestTime ) {
+                     // New best value recorded
+                     bestData._versionId = devIdx;
+                     bestData._pe = pe;
+                     bestData._elapsedTime = executionTime;
+
+                     debug("[versioning] New best time: {pe=" + toString<void *>( bestData._pe )
+                           + ", T=" + toString<double>( bestData._elapsedTime ) + "}" );
+                  }
+
+                  tdata._bestLock.release();
+               }
             }
 
             if ( schedule ) {
@@ -1151,6 +1312,34 @@ namespace ext
          }
 
 
+         virtual void atShutdown ()
+         {
+            ThreadTeam *team = myThread->getTeam();
+            TeamData &tdata = ( TeamData & ) *team->getScheduleData();
+
+            for ( unsigned int i = 0; i < team->size(); i++ ) {
+               nanos::TeamData *thTeamData = ( *team )[i].getTeamData();
+               if ( thTeamData != NULL && thTeamData->getScheduleData() != NULL ) {
+                  // The thread may still be finishing a task in atBeforeExit
+                  ThreadData &thdata = ( ThreadData & ) *thTeamData->getScheduleData();
+                  thdata._pendingLock.acquire();
+                  mergeRecords( tdata, thdata );
+                  thdata._pendingLock.release();
+               }
+            }
+
+            if ( _perfModel.isEnabled() ) {
+               tdata._statsLock.acquire();
+               tdata.storeExecInfoData();
+               tdata._statsLock.release();
+
+               if ( _perfModel.save() ) {
+                  verbose0( "Saved " << _perfModel.size() << " performance model records to '" << _perfModelFile << "'" );
+               }
+            }
+         }
+
+
          /*
           * This function should only be called for debugging purposes
           *
@@ -1222,6 +1411,8 @@ namespace ext
 
    bool Versioning::_useStack = false;
    int Versioning::_minRecordTrial = MIN_RECORDS;
+   std::string Versioning::_perfModelFile;
+   PerfModelStore Versioning::_perfModel;
    Lock Versioning::TeamData::_bestLock;
    Lock Versioning::TeamData::_statsLock;
 
@@ -1252,10 +1443,21 @@ namespace ext
                   NEW Config::IntegerVar( Versioning::_minRecordTrial ),
                   "Minimum number of task version trials for the versioning policy" );
             cfg.registerArgOption( "versioning-min-trials", "versioning-min-trials" );
+
+            // Set the file where task version statistics are kept between runs
+            cfg.registerConfigOption ( "versioning-perf-model",
+                  NEW Config::StringVar( Versioning::_perfModelFile ),
+                  "File to load task version statistics from and save them to for the versioning policy" );
+            cfg.registerArgOption( "versioning-perf-model", "versioning-perf-model" );
+            cfg.registerEnvOption( "versioning-perf-model", "NX_VERSIONING_PERF_MODEL" );
          }
 
          virtual void init()
          {
+            if ( !Versioning::_perfModelFile.empty() ) {
+               Versioning::_perfModel.load( Versioning::_perfModelFile );
+            }
+
             sys.setDefaultSchedulePolicy( NEW Versioning() );
          }
    };
@@ -22,6 +22,7 @@
 #include "plugin.hpp"
 #include "system.hpp"
 #include "config.hpp"
+#include "stealorder.hpp"
 
 namespace nanos {
    namespace ext {
@@ -32,11 +33,39 @@ namespace nanos {
             struct ThreadData : public ScheduleThreadData
             {
                /*! queue of ready tasks to be executed */
-               WDDeque _readyQueue;
-
-               ThreadData () : _readyQueue() {}
+               WDPool *_readyQueue;
+               /*! victims of this thread, nearest first */
+               StealOrder _stealOrder;
+
+               ThreadData () : _readyQueue( NULL ), _stealOrder( _stealTopology )
+               {
+                  if ( _useWSDeque ) _readyQueue = NEW WDStealingDeque();
+                  else _readyQueue = NEW WDDeque();
+               }
                virtual ~ThreadData () {
-                  ensure(_readyQueue.empty(),"Destroying non-empty queue");
+                  ensure(_readyQueue->empty(),"Destroying non-empty queue");
+                  delete _readyQueue;
+               }
+
+               /*! \brief Makes 'thread' the owner of the queue (only needed by work-stealing deques) */
+               void setOwner ( BaseThread *thread )
+               {
+                  if ( _useWSDeque ) ( (WDStealingDeque *) _readyQueue )->setOwner( thread );
+               }
+            };
+
+            /*! \brief Steals from the ready queue of a victim following the steal policy */
+            struct StealFrom
+            {
+               WorkFirst  *_policy;
+               BaseThread *_thief;
+
+               StealFrom ( WorkFirst *policy, BaseThread *thief ) : _policy( policy ), _thief( thief ) {}
+
+               WD * operator() ( BaseThread &victim )
+               {
+                  ThreadData &tdata = ( ThreadData & ) *victim.getTeamData()->getScheduleData();
+                  return _policy->pop( *tdata._readyQueue, _stealPolicy, _thief );
                }
             };
 
@@ -48,8 +77,10 @@ namespace nanos {
 
             //alex: FIX: this should be defaults and not common to all instances
             static bool          _stealParent;
+            static bool          _useWSDeque;
             static QueuePolicy   _localPolicy;
             static QueuePolicy   _stealPolicy;
+            static bool          _stealTopology;
 
             // constructor
             WorkFirst() : SchedulePolicy( "Work First" ) {}
@@ -71,16 +102,16 @@ namespace nanos {
             /*! \brief Extracts a WD from the queue either from the beginning or the end of the queue
              *
              *  This function allows to simplify the code to extract code from the queues.
-             *  It's a wrapper around the WDDeque
+             *  It's a wrapper around the WDPool
              *  functions with the actual function chosen with the policy argument.
              *
              *   \param [inout] q The queue from we want to extract a WD
              *   \param [in] policy Either FIFO/LIFO to specify if we extract from the beginning or the end of the queue
              *   \param [in] thread The thread trying to extract the thread
              *   \returns either a WD if one was available in the queues or NULL
-             *   \sa WDDeque::pop_front, WDDeque::pop_back
+             *   \sa WDPool::pop_front, WDPool::pop_back
              */
-            WD * pop ( WDDeque &q, QueuePolicy policy, BaseThread *thread )
+            WD * pop ( WDPool &q, QueuePolicy policy, BaseThread *thread )
             {
                return policy == LIFO  ? q.pop_front(thread) : q.pop_back(thread);
             }
@@ -94,7 +125,44 @@ namespace nanos {
             virtual void queue ( BaseThread *thread, WD &wd )
             {
                 ThreadData &data = ( ThreadData & ) *thread->getTeamData()->getScheduleData();
-                data._readyQueue.push_front ( &wd );
+                if ( thread == myThread ) data.setOwner( thread );
+                data._readyQueue->push_front ( &wd );
+            }
+
+            /*!
+            *  \brief Enqueue a batch of work descriptors, taking the lock of each
+            *         target readyQueue once per run of consecutive WDs going to it
+            *  \param threads target thread of each work descriptor
+            *  \param wds work descriptors to be enqueued
+            *  \param numElems number of elements in both arrays
+            */
+            virtual void queue ( BaseThread ** threads, WD ** wds, size_t numElems )
+            {
+               // Work-stealing deques are lock-free, nothing to save there
+               if ( _useWSDeque ) return SchedulePolicy::queue( threads, wds, numElems );
+
+               size_t first = 0;
+               while ( first < numElems ) {
+                  size_t last = first + 1;
+                  while ( last < numElems && threads[last] == threads[first] ) last++;
+
+                  ThreadData &data = ( ThreadData & ) *threads[first]->getTeamData()->getScheduleData();
+                  {
+                     LockBlock lock( data._readyQueue->getLock() );
+                     data._readyQueue->push_front( &wds[first], last - first );
+                  }
+
+                  first = last;
+               }
+            }
+
+            /*! WDs tied to a thread which has no team cannot be queued in a batch
+             *  (Scheduler::submit has to leave them in the thread's next WDs list).
+             */
+            bool isValidForBatch ( const WD * wd ) const
+            {
+               BaseThread *tiedTo = wd->isTiedTo();
+               return tiedTo == NULL || tiedTo->getTeam() != NULL;
             }
 
             /*!
@@ -114,8 +182,10 @@ namespace nanos {
       };
 
       bool WorkFirst::_stealParent = true;
+      bool WorkFirst::_useWSDeque = false;
       WorkFirst::QueuePolicy WorkFirst::_localPolicy = WorkFirst::LIFO;
       WorkFirst::QueuePolicy WorkFirst::_stealPolicy = WorkFirst::FIFO;
+      bool WorkFirst::_stealTopology = true;
 
       /*!
        *  \brief Function called by the scheduler when a thread becomes idle to schedule it
@@ -128,11 +198,12 @@ namespace nanos {
          WorkDescriptor * next = NULL; 
 
          ThreadData &data = ( ThreadData & ) *thread->getTeamData()->getScheduleData();
+         data.setOwner( thread );
 
          /*
           *  First try to schedule the thread with a task from its queue
           */
-         if ( ( wd = pop( data._readyQueue, _localPolicy, thread ) ) != NULL ) {
+         if ( ( wd = pop( *data._readyQueue, _localPolicy, thread ) ) != NULL ) {
             return wd;
          } else {
             /*
@@ -151,27 +222,10 @@ namespace nanos {
 
             /*!
             *  If also the parent is NULL or if someone moved it to another queue while was trying to steal it,
-            *  try to steal tasks from other queues
-            *  \warning other queues are checked cyclically: should be random
+            *  try to steal tasks from other queues, nearest ones first
             */
-            int size = thread->getTeam()->getFinalSize();
-            int thid = rand() % size;
-            int count = 0;
-            wd = NULL;
-
-            do {
-               thid = ( thid + 1 ) % size;
-
-               BaseThread &victim = thread->getTeam()->getThread(thid);
-
-               if ( victim.getTeam() != NULL ) {
-                 ThreadData &tdata = ( ThreadData & ) *victim.getTeamData()->getScheduleData();
-                 wd = pop( tdata._readyQueue, _stealPolicy, thread );
-               }
-
-               count++;
-
-            } while ( wd == NULL && count < size );
+            StealFrom stealFrom( this, thread );
+            wd = data._stealOrder.steal( thread, stealFrom );
 
             return wd;
          }
@@ -192,6 +246,14 @@ namespace nanos {
                                              "Defines if tries to steal the parent" );
                cfg.registerArgOption ( "schedule-steal-parent", "schedule-parent" );
 
+               cfg.registerConfigOption ( "wf-ws-deque", NEW Config::FlagOption( WorkFirst::_useWSDeque ),
+                                             "Uses lock-free work-stealing deques as ready queues" );
+               cfg.registerArgOption ( "wf-ws-deque", "wf-ws-deque" );
+
+               cfg.registerConfigOption ( "wf-steal-topology", NEW Config::FlagOption( WorkFirst::_stealTopology ),
+                                             "Steals from the nearest threads (shared cache, then NUMA node) first" );
+               cfg.registerArgOption ( "wf-steal-topology", "wf-steal-topology" );
+
                typedef Config::MapVar<WorkFirst::QueuePolicy> QueueConfig;
                
                QueueConfig *queuePolicyLocalConfig = NEW QueueConfig ( WorkFirst::_localPolicy );
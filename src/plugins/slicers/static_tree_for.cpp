@@ -369,8 +369,7 @@ void SlicerStaticFor::submit ( WorkDescriptor &work )
    work.tieTo( (*team)[first_valid_thread] );
    if ( mythread == &((*team)[first_valid_thread]) ) {
       if ( Scheduler::inlineWork( &work, false ) ) {
-         work.~WorkDescriptor();
-         delete[] (char *) &work;
+         sys.deleteWD( &work );
       }
    }
    else (*team)[first_valid_thread].addNextWD( (WorkDescriptor *) &work);
@@ -26,17 +26,31 @@
 namespace nanos {
    namespace ext {
 
+      typedef int (*ntask_getter_t)( void ) ;
+
+      /*! \brief Checks that a task counter, read through a getter, is at most a given value */
+      class TaskNumConditionChecker : public ConditionChecker
+      {
+         private:
+            ntask_getter_t  _getter;     /**< reads the task counter */
+            int             _condition;  /**< upper bound of the counter */
+         public:
+            TaskNumConditionChecker() : ConditionChecker(), _getter( NULL ), _condition( 0 ) {}
+            TaskNumConditionChecker( ntask_getter_t getter, int condition ) : ConditionChecker(), _getter( getter ), _condition( condition ) {}
+
+            virtual bool checkCondition() { return _getter() <= _condition; }
+      };
+
       class HysteresisThrottle: public ThrottlePolicy
       {
          private:
-            typedef int (*ntask_getter_t)( void ) ;
             static int get_total_tasks (void) { return sys.getTaskNum(); }
             static int get_ready_tasks (void) { return sys.getReadyNum(); }
          private:
             int                                                  _upper;
             int                                                  _lower;
             std::string                                          _type;
-            MultipleSyncCond<LessOrEqualConditionChecker<int> > *_syncCond;
+            MultipleSyncCond<TaskNumConditionChecker>           *_syncCond;
             ntask_getter_t                                       _get_num_tasks;
 
             HysteresisThrottle ( const HysteresisThrottle & );
@@ -49,13 +63,13 @@ namespace nanos {
                _type ( type ),
                _syncCond( NULL )
             {
+               // The task counters are sharded per thread: the condition reads them through the getters
                if ( _type == "total" ) {
-                  _syncCond = (MultipleSyncCond< LessOrEqualConditionChecker<int> >*) new MultipleSyncCond< LessOrEqualConditionChecker<int> >(LessOrEqualConditionChecker<int>(sys.getSchedulerStats().getTotalTasksAddr(), lower * sys.getNumThreads())) ;
                   _get_num_tasks = &get_total_tasks;
                } else if ( _type == "ready" ) {
-                  _syncCond = (MultipleSyncCond< LessOrEqualConditionChecker<int> >*) new MultipleSyncCond< LessOrEqualConditionChecker<int> >(LessOrEqualConditionChecker<int>(sys.getSchedulerStats().getReadyTasksAddr(), lower * sys.getNumThreads())) ;
                   _get_num_tasks = &get_ready_tasks;
                } else fatal0("Unknow throttle type");
+               _syncCond = new MultipleSyncCond<TaskNumConditionChecker>( TaskNumConditionChecker( _get_num_tasks, lower * sys.getNumThreads() ) );
 
                verbose0( "Throttle hysteresis created");
                verbose0( "   type of tasks: " << _type );
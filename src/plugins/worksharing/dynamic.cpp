@@ -29,6 +29,10 @@ namespace ext {
 
 class WorkSharingDynamicFor : public WorkSharing {
 
+   public:
+      static unsigned int _maxChunksPerClaim; /**< Upper bound of the chunks handed out at once */
+
+   private:
      /*! \brief create a loop descriptor
       *  
       *  \return only one thread per loop will get 'true' (single like behaviour)
@@ -40,27 +44,23 @@ class WorkSharingDynamicFor : public WorkSharing {
 
          *wsd = myThread->getTeamWorkSharingDescriptor( &single );
          if ( single ) {
-            (*wsd)->data = NEW WorkSharingLoopInfo();
-            ((WorkSharingLoopInfo *)(*wsd)->data)->lowerBound = loop_info->lower_bound;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->upperBound = loop_info->upper_bound;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->loopStep   = loop_info->loop_step;
+            WorkSharingLoopInfo *loop_data = allocateLoopInfo();
+            int num_threads = myThread->getTeam() != NULL ? myThread->getTeam()->getFinalSize() : 1;
+            loop_data->lowerBound = loop_info->lower_bound;
+            loop_data->upperBound = loop_info->upper_bound;
+            loop_data->loopStep   = loop_info->loop_step;
             int chunk_size = std::max(1,loop_info->chunk_size);
-            ((WorkSharingLoopInfo *)(*wsd)->data)->chunkSize  = chunk_size;
+            loop_data->chunkSize  = chunk_size;
             int niters = (((loop_info->upper_bound - loop_info->lower_bound) / loop_info->loop_step ) + 1 );
             int chunks = niters / chunk_size;
             if ( niters % chunk_size != 0 ) chunks++;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->numOfChunks = chunks;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->currentChunk  = 0;
-
-#if 0
-fprintf(stderr,"lower=%d, upper=%d, step=%d, chunk=%d,nchunk=%d\n",
-            ((WorkSharingLoopInfo *)(*wsd)->data)->lowerBound,
-            ((WorkSharingLoopInfo *)(*wsd)->data)->upperBound,
-            ((WorkSharingLoopInfo *)(*wsd)->data)->loopStep,
-            ((WorkSharingLoopInfo *)(*wsd)->data)->chunkSize,
-            ((WorkSharingLoopInfo *)(*wsd)->data)->numOfChunks
-            );
-#endif
+            loop_data->numOfChunks = chunks;
+            loop_data->numOfUnits = chunks;
+            loop_data->numThreads = num_threads;
+            // Several chunks per claim, keeping around eight claims per thread
+            loop_data->unitsPerClaim = std::max( 1, std::min( (int) _maxChunksPerClaim, chunks / ( 8 * num_threads ) ) );
+
+            publishLoopInfo( *wsd, loop_data );
 
             memoryFence();
 
@@ -75,25 +75,37 @@ fprintf(stderr,"lower=%d, upper=%d, step=%d, chunk=%d,nchunk=%d\n",
 
      /*! \brief Get next chunk of iterations
       *
+      *  Far from the end of the loop a claim takes unitsPerClaim consecutive chunks, which are
+      *  returned as a single item; the last chunks are handed out one by one.
       */
       void nextItem( nanos_ws_desc_t *wsd, nanos_ws_item_t *item )
       {
          nanos_ws_item_loop_t *loop_item = ( nanos_ws_item_loop_t *) item;
          WorkSharingLoopInfo  *loop_data = ( WorkSharingLoopInfo  *) wsd->data;
 
-         int mychunk = loop_data->currentChunk++;
-         if ( mychunk > loop_data->numOfChunks)
+         if ( !enterLoop( wsd, loop_data ) ) {
+            loop_item->execute = false;
+            return;
+         }
+
+         int claim = loop_data->unitsPerClaim;
+         if ( claim > 1 && loop_data->currentChunk.value() + claim * loop_data->numThreads >= loop_data->numOfChunks ) claim = 1;
+
+         int mychunk = loop_data->currentChunk.fetchAndAdd( claim );
+         if ( mychunk >= loop_data->numOfChunks )
          {
             loop_item->execute = false;
+            leaveLoop( wsd, loop_data );
             return;
          }
+         int nchunks = std::min( claim, loop_data->numOfChunks - mychunk );
 
          int sign = (( loop_data->loopStep < 0 ) ? -1 : +1);
 
          loop_item->lower = loop_data->lowerBound + mychunk * loop_data->chunkSize * loop_data->loopStep;
-         loop_item->upper = loop_item->lower + loop_data->chunkSize * loop_data->loopStep - sign;
+         loop_item->upper = loop_item->lower + nchunks * loop_data->chunkSize * loop_data->loopStep - sign;
          if ( ( loop_data->upperBound * sign ) < ( loop_item->upper * sign ) ) loop_item->upper = loop_data->upperBound;
-         loop_item->last = mychunk == (loop_data->numOfChunks - 1);
+         loop_item->last = mychunk + nchunks == loop_data->numOfChunks;
          loop_item->execute = (loop_item->lower * sign) <= (loop_item->upper * sign);
       }
 
@@ -101,15 +113,23 @@ fprintf(stderr,"lower=%d, upper=%d, step=%d, chunk=%d,nchunk=%d\n",
    
 };
 
+unsigned int WorkSharingDynamicFor::_maxChunksPerClaim = 4;
+
 class WorkSharingDynamicForPlugin : public Plugin {
    public:
       WorkSharingDynamicForPlugin () : Plugin("Worksharing plugin for loops using a dynamic policy",1) {}
       ~WorkSharingDynamicForPlugin () {}
 
-      virtual void config( Config& cfg ) {}
+      virtual void config( Config& cfg )
+      {
+         cfg.setOptionsSection( "Dynamic worksharing", "Dynamic loop worksharing module" );
+         cfg.registerConfigOption ( "ws-dynamic-max-claim", NEW Config::UintVar( WorkSharingDynamicFor::_maxChunksPerClaim ), "Maximum number of chunks a thread takes at once in dynamic loops (1 = one by one)" );
+         cfg.registerArgOption( "ws-dynamic-max-claim", "ws-dynamic-max-claim" );
+      }
 
       void init ()
       {
+         if ( WorkSharingDynamicFor::_maxChunksPerClaim == 0 ) WorkSharingDynamicFor::_maxChunksPerClaim = 1;
          sys.registerWorkSharing("dynamic_for", NEW WorkSharingDynamicFor() );	
       }
 };
@@ -40,22 +40,19 @@ class WorkSharingGuidedFor : public WorkSharing {
 
          *wsd = myThread->getTeamWorkSharingDescriptor( &single );
          if ( single ) {
-            (*wsd)->data = NEW WorkSharingLoopInfo();
-             int num_threads = myThread->getTeam()->getFinalSize();
-            ((WorkSharingLoopInfo *)(*wsd)->data)->lowerBound = loop_info->lower_bound;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->upperBound = loop_info->upper_bound;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->loopStep   = loop_info->loop_step;
+            WorkSharingLoopInfo *loop_data = allocateLoopInfo();
+            int num_threads = myThread->getTeam()->getFinalSize();
+            loop_data->lowerBound = loop_info->lower_bound;
+            loop_data->upperBound = loop_info->upper_bound;
+            loop_data->loopStep   = loop_info->loop_step;
             int chunk_size = std::max(1,loop_info->chunk_size);
-            ((WorkSharingLoopInfo *)(*wsd)->data)->chunkSize  = chunk_size;
+            loop_data->chunkSize  = chunk_size;
             int niters = (((loop_info->upper_bound - loop_info->lower_bound) / loop_info->loop_step ) + 1 );
-            int chunks = niters / chunk_size;
-            if ( niters % chunk_size != 0 ) chunks++;
-            ((WorkSharingLoopInfo *)(*wsd)->data)->numOfChunks = 0;
-            while ( niters > 0 ) {
-               niters = niters - std::max( niters/(2*num_threads), chunk_size);
-               ((WorkSharingLoopInfo *)(*wsd)->data)->numOfChunks++;
-            }
-            ((WorkSharingLoopInfo *)(*wsd)->data)->currentChunk  = 0;
+            loop_data->numOfUnits = std::max( niters, 0 );
+            loop_data->numThreads = num_threads;
+            loop_data->unitsPerClaim = 1;
+
+            publishLoopInfo( *wsd, loop_data );
 
             memoryFence();
 
@@ -70,41 +67,38 @@ class WorkSharingGuidedFor : public WorkSharing {
 
      /*! \brief Get next chunk of iterations
       *
+      *  Chunks are claimed by moving the iteration counter with a compare and swap, so each
+      *  claim computes its size from the remaining iterations it has observed.
       */
       void nextItem( nanos_ws_desc_t *wsd, nanos_ws_item_t *item )
       {
          nanos_ws_item_loop_t *loop_item = ( nanos_ws_item_loop_t *) item;
          WorkSharingLoopInfo  *loop_data = ( WorkSharingLoopInfo  *) wsd->data;
 
-         int mychunk = loop_data->currentChunk++;
-         if ( mychunk > loop_data->numOfChunks)
-         {
+         if ( !enterLoop( wsd, loop_data ) ) {
             loop_item->execute = false;
             return;
          }
 
-         int num_threads = myThread->getTeam()->getFinalSize();
-         int sign = (( loop_data->loopStep < 0 ) ? -1 : +1);
-
-         loop_item->lower = loop_data->lowerBound;
-         int i = 0, niters = (((loop_data->upperBound - loop_data->lowerBound) / loop_data->loopStep ) + 1 );
-
-         int current;
-         while ( i < mychunk ) {
-            current = std::max( niters/(2*num_threads), loop_data->chunkSize);
-            niters -= current;
-            loop_item->lower += (current * loop_data->loopStep);
-            i++;
-         }
-         loop_item->upper = loop_item->lower 
-                          + std::max( niters/(2*num_threads), loop_data->chunkSize) * loop_data->loopStep 
-                          - loop_data->loopStep;
+         int first, size;
+         do {
+            first = loop_data->currentChunk.value();
+            if ( first >= loop_data->numOfUnits ) {
+               loop_item->execute = false;
+               leaveLoop( wsd, loop_data );
+               return;
+            }
+            int remaining = loop_data->numOfUnits - first;
+            size = std::min( remaining, std::max( remaining/(2*loop_data->numThreads), loop_data->chunkSize ) );
+         } while ( !loop_data->currentChunk.cswap( first, first + size ) );
 
+         int sign = (( loop_data->loopStep < 0 ) ? -1 : +1);
+         loop_item->lower = loop_data->lowerBound + first * loop_data->loopStep;
+         loop_item->upper = loop_item->lower + ( size - 1 ) * loop_data->loopStep;
          if ( ( loop_data->upperBound * sign ) < ( loop_item->upper * sign ) ) loop_item->upper = loop_data->upperBound;
-         loop_item->last = mychunk == (loop_data->numOfChunks - 1);
+         loop_item->last = first + size == loop_data->numOfUnits;
          loop_item->execute = (loop_item->lower * sign) <= (loop_item->upper * sign);
       }
-
       void duplicateWS ( nanos_ws_desc_t *orig, nanos_ws_desc_t **copy) {}
 
    
@@ -18,7 +18,10 @@
 /*************************************************************************************/
 
 #include "nanos-int.h"
-#include "atomic_decl.hpp"
+#include "atomic.hpp"
+#include "basethread.hpp"
+#include "threadteam.hpp"
+#include "allocator_decl.hpp"
 
 namespace nanos {
 namespace ext {
@@ -29,9 +32,105 @@ typedef struct {
    int                   loopStep;     // loop step
    int                   chunkSize;    // loop chunk size
    int                   numOfChunks;  // number of chunks for the loop
-   Atomic<int>           currentChunk; // current chunk ready to execute
+   int                   numOfUnits;   // units handed out through currentChunk: chunks (dynamic) or iterations (guided)
+   int                   unitsPerClaim;// chunks taken by every claim while far from the end of the loop (dynamic)
+   int                   numThreads;   // number of threads of the team when the loop was created
+   nanos_ws_desc_t      *owner;        // descriptor using this team storage slot, NULL if not in team storage
+   char                  pad0[NANOS_CACHELINE];
+   Atomic<int>           currentChunk; // next unit ready to execute (in its own cache line)
+   char                  pad1[NANOS_CACHELINE];
+   Atomic<int>           users;        // threads in the loop, biased while the slot is being recycled
+   char                  pad2[NANOS_CACHELINE];
 } WorkSharingLoopInfo;
 
+// WorkSharingLoopInfo must fit in a team worksharing storage slot
+typedef char WorkSharingLoopInfoFitsInSlot[ sizeof(WorkSharingLoopInfo) <= NANOS_WS_SLOT_SIZE ? 1 : -1 ];
+
+const int WS_LOOP_RECYCLE_BIAS = 1 << 24;
+
+// Loops (descriptors) in which the current thread is registered as user, see enterLoop(). A thread
+// may be in several loops at once, e.g. when a loop body opens a nested parallel region
+const unsigned WS_MAX_NESTED_LOOPS = 8;
+static __thread nanos_ws_desc_t *_wsCurrentLoops[WS_MAX_NESTED_LOOPS];
+static __thread unsigned _wsNumCurrentLoops = 0;
+
+/*! \brief Gets the data for a new loop descriptor
+ *
+ *  Data comes from the team storage when one of its slots is not in use anymore: all the units of
+ *  its loop have been handed out and every thread that entered it has left. Otherwise it is
+ *  allocated (and never released, as the descriptor itself). Fields must be initialized by the
+ *  caller, who has to call publishLoopInfo() afterwards.
+ */
+inline WorkSharingLoopInfo * allocateLoopInfo ( void )
+{
+   ThreadTeam *team = myThread->getTeam();
+   if ( team != NULL ) {
+      for ( unsigned i = 0; i < NANOS_WS_TEAM_SLOTS; i++ ) {
+         WorkSharingLoopInfo *info = (WorkSharingLoopInfo *) team->getWorkSharingStorage( i );
+         if ( info->currentChunk.value() < info->numOfUnits || info->users.value() != 0 ) continue;
+         // Threads entering the old loop from now on will fail (see enterLoop)
+         if ( info->users.cswap( 0, WS_LOOP_RECYCLE_BIAS ) ) return info;
+      }
+   }
+   WorkSharingLoopInfo *info = NEW WorkSharingLoopInfo();
+   info->owner = NULL;
+   info->users = 0;
+   return info;
+}
+
+/*! \brief Makes the data of a new loop descriptor available to the team
+ */
+inline void publishLoopInfo ( nanos_ws_desc_t *wsd, WorkSharingLoopInfo *info )
+{
+   info->currentChunk = 0;
+   if ( info->users.value() >= WS_LOOP_RECYCLE_BIAS ) {
+      info->owner = wsd;
+      memoryFence();
+      info->users -= WS_LOOP_RECYCLE_BIAS;
+   }
+   wsd->data = info;
+}
+
+/*! \brief Registers the current thread as user of the loop, if it was not yet
+ *
+ *  If the thread is already registered in WS_MAX_NESTED_LOOPS loops, the outermost one is forgotten:
+ *  its registration is never undone, so its slot is not recycled anymore, which is always safe.
+ *
+ *  \return false if the slot of the loop has been recycled (so the loop has already been completed)
+ */
+inline bool enterLoop ( nanos_ws_desc_t *wsd, WorkSharingLoopInfo *info )
+{
+   if ( info->owner == NULL ) return true;
+   for ( unsigned i = _wsNumCurrentLoops; i > 0; i-- ) {
+      if ( _wsCurrentLoops[i-1] == wsd ) return true;
+   }
+   if ( info->users.fetchAndAdd( 1 ) >= WS_LOOP_RECYCLE_BIAS || info->owner != wsd ) {
+      info->users--;
+      return false;
+   }
+   if ( _wsNumCurrentLoops == WS_MAX_NESTED_LOOPS ) {
+      for ( unsigned i = 1; i < WS_MAX_NESTED_LOOPS; i++ ) _wsCurrentLoops[i-1] = _wsCurrentLoops[i];
+      _wsNumCurrentLoops--;
+   }
+   _wsCurrentLoops[_wsNumCurrentLoops++] = wsd;
+   return true;
+}
+
+/*! \brief Unregisters the current thread as user of the loop, once it has got no more work from it
+ */
+inline void leaveLoop ( nanos_ws_desc_t *wsd, WorkSharingLoopInfo *info )
+{
+   for ( unsigned i = _wsNumCurrentLoops; i > 0; i-- ) {
+      if ( _wsCurrentLoops[i-1] == wsd ) {
+         // Loops are not always left innermost first (e.g. tasks interleaving loops of different teams)
+         for ( ; i < _wsNumCurrentLoops; i++ ) _wsCurrentLoops[i-1] = _wsCurrentLoops[i];
+         _wsNumCurrentLoops--;
+         info->users--;
+         return;
+      }
+   }
+}
+
 #if 0
    int                   neths;    // additional data to expand team
    nanos_thread_t       *eths;     // additional data to expand team
@@ -21,43 +21,97 @@
 #include "nanos.h"
 #include "atomic.hpp"
 #include "lock.hpp"
+#include "queuelock.hpp"
+#include "system.hpp"
+
+using namespace nanos;
+
+namespace {
+   // With the spin implementation an omp_lock_t holds a Lock in place, with the queue one
+   // it points to a QueueLock. The implementation is chosen once, at configuration time.
+   inline bool useQueueLocks ()
+   {
+      return sys.getUserLockKind() == System::QUEUE_LOCK;
+   }
+
+   inline void initLock ( omp_lock_t *arg )
+   {
+      if ( useQueueLocks() ) {
+         *arg = NEW QueueLock();
+      } else {
+         // NOTE: This assumes Lock is the same size than Void * so nothing has to be allocated
+         new ( (Lock *) arg ) Lock;
+      }
+   }
+
+   inline void destroyLock ( omp_lock_t *arg )
+   {
+      if ( useQueueLocks() ) delete ( QueueLock * ) *arg;
+   }
+
+   // Some codes use zero-initialized locks without omp_init_lock(), which is fine for the
+   // spin implementation; give them a QueueLock on first use
+   inline QueueLock * getQueueLock ( omp_lock_t *arg )
+   {
+      QueueLock *lock = ( QueueLock * ) *arg;
+      if ( lock != NULL ) return lock;
+
+      lock = NEW QueueLock();
+      if ( !__sync_bool_compare_and_swap( arg, (void *) NULL, (void *) lock ) ) {
+         delete lock;
+         lock = ( QueueLock * ) *arg;
+      }
+      return lock;
+   }
+
+   inline void setLock ( omp_lock_t *arg )
+   {
+      if ( useQueueLocks() ) getQueueLock( arg )->acquire();
+      else ( ( Lock * ) arg )->acquire();
+   }
+
+   inline void unsetLock ( omp_lock_t *arg )
+   {
+      if ( useQueueLocks() ) getQueueLock( arg )->release();
+      else ( ( Lock * ) arg )->release();
+   }
+
+   inline int testLock ( omp_lock_t *arg )
+   {
+      if ( useQueueLocks() ) return getQueueLock( arg )->tryAcquire();
+      return ( ( Lock * ) arg )->tryAcquire();
+   }
+}
 
 extern "C"
 {
-   using namespace nanos;
-
    NANOS_API_DEF(void, omp_init_lock, ( omp_lock_t *arg ))
    {
-      // NOTE: This assumes Lock is the same size than Void * so nothing has to be allocated
-      Lock *lock = (Lock *) arg;
-
-      new (lock) Lock;
+      initLock( arg );
    }
 
    NANOS_API_DEF(void, omp_destroy_lock, ( omp_lock_t *arg ))
    {
+      destroyLock( arg );
    }
 
    NANOS_API_DEF(void, omp_set_lock, ( omp_lock_t *arg ))
    {
-      Lock &lock = *(Lock *) arg;
-      lock++;
+      setLock( arg );
    }
 
    NANOS_API_DEF(void, omp_unset_lock,( omp_lock_t *arg ))
    {
-      Lock &lock = *(Lock *) arg;
-      lock--;
+      unsetLock( arg );
    }
 
    NANOS_API_DEF(int, omp_test_lock ,( omp_lock_t *arg ))
    {
-      Lock &lock = *(Lock *) arg;
-      return lock.tryAcquire();
+      return testLock( arg );
    }
 
    struct __omp_nest_lock {
-      Lock lock;
+      omp_lock_t lock;
       nanos_wd_t owner;
       short count;
    };
@@ -65,6 +119,7 @@ extern "C"
    NANOS_API_DEF(void, omp_init_nest_lock, ( omp_nest_lock_t *arg ) )
    {
       struct __omp_nest_lock *nlock = NEW struct __omp_nest_lock();
+      initLock( &nlock->lock );
       nlock->owner = NULL;
       nlock->count = 0;
       *arg = nlock;
@@ -73,6 +128,7 @@ extern "C"
    NANOS_API_DEF(void, omp_destroy_nest_lock, ( omp_nest_lock_t *arg ) )
    {
       struct __omp_nest_lock *nlock=( struct __omp_nest_lock * )*arg;
+      destroyLock( &nlock->lock );
       delete nlock;
    }
 
@@ -85,7 +141,7 @@ extern "C"
          // count >=1 is assumed because only the owner can set it
          nlock->count++;
       } else {
-         nlock->lock++;
+         setLock( &nlock->lock );
          // count == 0 is assumed because we just acquired the lock
          nlock->owner = nanos_current_wd();
          nlock->count++;
@@ -100,7 +156,7 @@ extern "C"
       nlock->count--;
       if ( nlock->count == 0 ) {
          nlock->owner = NULL;
-         nlock->lock--;
+         unsetLock( &nlock->lock );
       }
    }
 
@@ -113,7 +169,7 @@ extern "C"
          nlock->count++;
          return 1;
       } else {
-         int result = nlock->lock.tryAcquire();
+         int result = testLock( &nlock->lock );
          if ( result != 0 ) {
             // count == 0 is assumed because we just acquired the lock
             nlock->owner = nanos_current_wd();
@@ -123,4 +179,3 @@ extern "C"
       }
    }
 }
-
@@ -25,38 +25,93 @@ using namespace nanos;
 Allocator *nanos::allocator;
 
 size_t Allocator::_headerSize = NANOS_ALIGNED_MEMORY_OFFSET( 0, sizeof(Allocator::ObjectHeader), 16 );
+__thread char Allocator::_threadTag;
+size_t Allocator::Arena::_chunkHeaderSize = NANOS_ALIGNED_MEMORY_OFFSET( 0, sizeof(Allocator::Arena::Chunk), 16 );
 
 Allocator & nanos::getAllocator ( void )
 {
-   if (!allocator) {
-      allocator = (Allocator *) malloc(sizeof(Allocator));
-      if ( allocator == NULL ) throw(NANOS_ENOMEM);
-      new (allocator) Allocator();
-   }
+   if (!allocator) allocator = Allocator::create();
 
    BaseThread *my_thread = getMyThreadSafe();
    if ( my_thread == NULL ) return *allocator;
    else return my_thread->getAllocator();
 }
 
-void * Allocator::Arena::allocate ( void )
+Allocator * Allocator::create ( void )
+{
+   // Not using NEW: operator new may be routed to getAllocator()
+   Allocator *a = (Allocator *) malloc( sizeof(Allocator) );
+   if ( a == NULL ) throw(NANOS_ENOMEM);
+   new (a) Allocator();
+
+   return a;
+}
+
+void Allocator::adopt ( void )
 {
-   unsigned int obj;
+   _owner = &_threadTag;
+   drainRemoteFrees();
+}
 
-   if ( !_free ) return NULL;
+Allocator::Arena::Arena ( Allocator *allocator, size_t objectSize ) : _allocator( allocator ), _objectSize( objectSize ),
+   _freeList( NULL ), _top( NULL ), _end( NULL ), _chunks( NULL )
+{
+   _objectsPerChunk = NANOS_ARENA_CHUNK_SIZE / objectSize;
+   if ( _objectsPerChunk > NANOS_OBJECTS_PER_ARENA ) _objectsPerChunk = NANOS_OBJECTS_PER_ARENA;
+   if ( _objectsPerChunk == 0 ) _objectsPerChunk = 1;
+}
 
-   for ( obj = 0 ; obj < numObjects ; obj++ ) {
-      if ( _bitmap[obj]._bit ) break;
+Allocator::Arena::~Arena ()
+{
+   while ( _chunks != NULL ) {
+      Chunk *next = _chunks->_next;
+      free( _chunks );
+      _chunks = next;
    }
+}
 
-   if (obj == numObjects) {
-      _free = false;
-      return NULL; 
+Allocator::ObjectHeader * Allocator::Arena::refill ( void )
+{
+   if ( _top == _end ) {
+      Chunk *chunk = (Chunk *) malloc( _chunkHeaderSize + _objectSize * _objectsPerChunk );
+      if ( chunk == NULL ) throw(NANOS_ENOMEM);
+      chunk->_next = _chunks;
+      _chunks = chunk;
+      _top = ((char *) chunk) + _chunkHeaderSize;
+      _end = _top + _objectSize * _objectsPerChunk;
    }
 
-   _bitmap[obj]._bit = false;
+   ObjectHeader *obj = (ObjectHeader *) _top;
+   _top += _objectSize;
+
+   return obj;
+}
+
+Allocator::Arena * Allocator::createArena ( size_t sizeClass )
+{
+   // Only the owner allocates, so the first allocation identifies it
+   if ( _owner == NULL ) _owner = &_threadTag;
+
+   Arena *arena = (Arena *) malloc ( sizeof(Arena) );
+   if ( arena == NULL ) throw(NANOS_ENOMEM);
+   new ( arena ) Arena( this, ((size_t) 1) << sizeClass );
+   _arenas[sizeClass] = arena;
 
-   return (void *) &_arena[obj*_objectSize];
+   return arena;
 }
 
+void Allocator::drainRemoteFrees ( void )
+{
+   // Take the whole mailbox at once
+   ObjectHeader *list = _remoteList.value();
+   while ( !_remoteList.cswap( list, (ObjectHeader *) NULL ) ) {
+      list = _remoteList.value();
+   }
 
+   while ( list != NULL ) {
+      ObjectHeader *next = list->_next;
+      list->_arena->deallocate( list );
+      _remoteFrees++;
+      list = next;
+   }
+}
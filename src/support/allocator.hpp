@@ -20,6 +20,7 @@
 #ifndef _NANOS_ALLOCATOR_HPP
 #define _NANOS_ALLOCATOR_HPP
 #include "allocator_decl.hpp"
+#include "atomic.hpp"
 #include <vector>
 #include <cstdlib>
 #include <cstring>
@@ -29,32 +30,36 @@ namespace nanos {
 
 extern Allocator *allocator;
 
+inline Allocator * Allocator::Arena::getAllocator () const
+{
+   return _allocator;
+}
+
 inline size_t Allocator::Arena::getObjectSize () const
 {
    return _objectSize;
 }
 
-inline void Allocator::Arena::deallocate ( void *object )
+inline Allocator::ObjectHeader * Allocator::Arena::allocate ( void )
 {
-   unsigned long offset = ((char *) object - _arena);
-   unsigned long index = offset / _objectSize;
+   ObjectHeader *obj = _freeList;
 
-   //if (sys.getNetwork()->getNodeNum() == 0 && _objectSize > 32768) std::cerr << "Free object size " << _objectSize << " : " << (void *) _objectSize << " addr range is " << (void *) object << ":" << ((void *) (((char*)object)+_objectSize)) << " this is arena " << (void*) this << std::endl;
-   _free = true;
-   _bitmap[index]._bit = true;
+   if ( obj == NULL ) return refill();
 
-   //if (sys.getNetwork()->getNodeNum() == 0 && _objectSize > 32768) std::cerr << "memset from " << (void *) &_arena[index*_objectSize] << " to " << (void*) (&_arena[index*_objectSize+_objectSize]) << std::endl;
-   //memset( &_arena[index*_objectSize], 0, _objectSize );
+   _freeList = obj->_next;
+   return obj;
 }
 
-inline Allocator::Arena * Allocator::Arena::getNext ( void ) const
+inline void Allocator::Arena::deallocate ( ObjectHeader *object )
 {
-   return _next;
+   object->_next = _freeList;
+   _freeList = object;
 }
 
-inline void Allocator::Arena::setNext ( Arena * a )
+inline size_t Allocator::getSizeClass ( size_t size )
 {
-   _next = a;
+   if ( size <= 1 ) return 0;
+   return ( sizeof(unsigned long) * 8 ) - __builtin_clzl( (unsigned long) ( size - 1 ) );
 }
 
 inline void * Allocator::allocateBigObject ( size_t size )
@@ -72,52 +77,32 @@ inline void * Allocator::allocate ( size_t size, const char* file, int line )
 {
    if ( size > _sizeOfBig ) return allocateBigObject(size);
 
-   /* realSize is (size + header )'s next power of 2 */
-   size_t realSize = size + _headerSize + 1;
-   realSize |= realSize >> 1;
-   realSize |= realSize >> 2;
-   realSize |= realSize >> 4;
-   realSize |= realSize >> 8;
-   realSize |= realSize >> 16;
-   realSize++;
- 
-
-   ArenaCollection::iterator it;
-   for ( it = _arenas.begin(); it != _arenas.end(); it++ ) {
-      if ( (*it)->getObjectSize() == realSize ) break;
-   }
+   if ( _remoteList.value() != NULL ) drainRemoteFrees();
 
-   Arena *arena = NULL;
+   size_t sizeClass = getSizeClass( size + _headerSize );
 
-   if ( it == _arenas.end() ) {
-      // no arena found for that size, create a new one
-      arena = (Arena *) malloc ( sizeof(Arena) );
-      if ( arena == NULL ) throw(NANOS_ENOMEM);
-      new ( arena ) Arena( realSize );
-      _arenas.push_back( arena );
-   }
-   else arena = *it;
+   Arena *arena = _arenas[sizeClass];
+   if ( arena == NULL ) arena = createArena( sizeClass );
 
+   ObjectHeader * ptr = arena->allocate();
+   ptr->_arena = arena;
 
-   ObjectHeader * ptr = NULL;
+   return  ((char *) ptr ) + _headerSize;
+}
 
-   while ( ptr == NULL ) {
-      ptr = (ObjectHeader *) arena->allocate();
-      if ( ptr == NULL ) { 
-          if ( arena->getNext() == NULL ) {
-             Arena *next = ( Arena *) malloc ( sizeof(Arena) );
-             if ( next == NULL ) throw(NANOS_ENOMEM);
-             new (next) Arena(realSize);
-             arena->setNext( next );
-          }
-          arena = arena->getNext(); 
-      }
+inline void Allocator::release ( ObjectHeader *object )
+{
+   if ( _owner == &_threadTag ) {
+      object->_arena->deallocate( object );
+      _localFrees++;
+      return;
    }
 
-   ptr->_arena = arena;
-   //if (sys.getNetwork()->getNodeNum() == 0 && realSize > 32768) std::cerr << "Allocate object size " << realSize << " : " << (void *) realSize << " addr range is " << (void *) ptr << ":" << ((void *) (((char*)ptr)+realSize)) << " this is arena " << (void *) arena << std::endl;
-
-   return  ((char *) ptr ) + _headerSize;
+   ObjectHeader *head;
+   do {
+      head = _remoteList.value();
+      object->_next = head;
+   } while ( !_remoteList.cswap( head, object ) );
 }
 
 inline void Allocator::deallocate ( void *object, const char *file, int line )
@@ -132,7 +117,7 @@ inline void Allocator::deallocate ( void *object, const char *file, int line )
    if ( arena == NULL )
      free(ptr);
    else
-     arena->deallocate(ptr);
+     arena->getAllocator()->release(ptr);
 }
 
 inline size_t Allocator::getObjectSize ( void *object )
@@ -142,6 +127,16 @@ inline size_t Allocator::getObjectSize ( void *object )
    return arena->getObjectSize() - _headerSize ;
 }
 
+inline size_t Allocator::getLocalFrees ( void ) const
+{
+   return _localFrees;
+}
+
+inline size_t Allocator::getRemoteFrees ( void ) const
+{
+   return _remoteFrees;
+}
+
 } // namespace nanos
 
 #endif
@@ -23,6 +23,7 @@
 #include "allocator_fwd.hpp"
 #include "new_decl.hpp"
 #include "malign.hpp"
+#include "atomic_decl.hpp"
 #include <list>
 #include <map>
 #include <cstdlib>
@@ -31,6 +32,7 @@
 
 #define NANOS_CACHELINE 128 /* FIXME: This definition must be architectural dependant */
 #define NANOS_OBJECTS_PER_ARENA 1000
+#define NANOS_ARENA_CHUNK_SIZE (256*1024)
 
 namespace nanos {
 
@@ -85,27 +87,51 @@ class InternalAllocator
        inline void destroy( pointer p ) { p->~T(); }
 };
 /*! \class Allocator
+ *
+ *  Allocators are meant to be used by a single thread (the owner, which is
+ *  the thread allocating from it) but objects may be deallocated from any
+ *  thread. Objects released by the owner go straight back to their Arena,
+ *  whereas objects released by other threads are pushed (with a single atomic
+ *  operation) into the Allocator's remote-free mailbox, which the owner drains
+ *  in batches on its next allocation.
  */
 class Allocator
 {
    private:
+      class Arena;
+
+      struct ObjectHeader {
+         Arena         *_arena;               /**< Arena which the object belongs to (NULL for big objects) */
+         ObjectHeader  *_next;                /**< Free list link (only meaningful while the object is free) */
+      };
+
      /*! \class Arena
+      *
+      *  An Arena manages all the objects of a given size class. Free objects
+      *  are kept in an intrusive list (the link is stored in the object header)
+      *  so both allocation and deallocation are constant time operations. Memory
+      *  is obtained from the system in chunks of NANOS_OBJECTS_PER_ARENA objects
+      *  (at most) which are carved lazily, so a new chunk is not touched until
+      *  its objects are actually handed out. Only the owner thread of the related
+      *  Allocator may use an Arena.
       */
       class Arena
       {
          private: /* Arena data members and disabled constructors */
-            static const size_t numObjects = NANOS_OBJECTS_PER_ARENA;      /** Number of maximum objects allocated in this arena*/
+            struct Chunk {
+               Chunk            *_next;
+            };                                        /**< Memory chunk header */
 
-            union bitmap_entry {
-               bool             _bit;
-               char             pad[NANOS_CACHELINE];
-            };                                         /**< bitmap_entry struct */
+            static size_t     _chunkHeaderSize;       /**< Size of Chunk (keeping objects aligned) */
 
+            Allocator        *_allocator;             /**< Allocator this Arena belongs to */
             size_t            _objectSize;            /**< Object size in current Arena  */
-            char             *_arena;                 /**< Memory region used by Arena */
-            bitmap_entry     *_bitmap;                /**< Bit map (free/busy) */
-            Arena            *_next;                  /**< Next Arena in the list */
-            bool              _free;                  /**< Are there free entries */
+            size_t            _objectsPerChunk;       /**< Number of objects allocated in each chunk */
+            ObjectHeader     *_freeList;              /**< Free objects ready to be reused */
+            char             *_top;                   /**< First never used object in the last chunk */
+            char             *_end;                   /**< End of the last chunk */
+            Chunk            *_chunks;                /**< List of chunks owned by this Arena */
+
             /*! \brief Arena copy constructor (disabled)
              */
             Arena ( const Arena &a );
@@ -115,54 +141,43 @@ class Allocator
            /*! \brief Arena default constructor (disabled)
             */
             Arena ();
+           /*! \brief Returns a new object when the free list is empty
+            *
+            *  Carves a new object from the last chunk, getting a new chunk when needed.
+            */
+            ObjectHeader * refill ( void ) ;
          public: /* Arena method members */
            /*! \brief Arena constructor
             */
-            Arena ( size_t objectSize ) : _objectSize(objectSize), _next (NULL), _free(true)
-            {
-               _arena = (char *) malloc( (objectSize + sizeof(bitmap_entry) ) * numObjects );
-               if ( _arena == NULL ) throw ( NANOS_ENOMEM );
-               _bitmap = (bitmap_entry *) (_arena + objectSize * numObjects);
-               for ( size_t i = 0; i < numObjects; i++ ) _bitmap[i]._bit = true;
-            }
+            Arena ( Allocator *allocator, size_t objectSize );
            /*! \brief Arena destructor
             */
-            ~Arena ()
-            {
-               delete _next;
-               free(_arena);
-               free(_bitmap);
-            }
+            ~Arena ();
+           /*! \brief Returns the Allocator this Arena belongs to
+            */
+            Allocator * getAllocator ( void ) const ;
            /*! \brief Returns the size of allocated object
             */
             size_t getObjectSize ( void ) const ; 
-           /*! \brief Returns a free object address (and mark it as busy)
+           /*! \brief Returns a free object address
             */
-            void * allocate ( void ) ;
-           /*! \brief Mark 'object' as free
+            ObjectHeader * allocate ( void ) ;
+           /*! \brief Gives 'object' back to the Arena
             */
-            void deallocate ( void *object ) ;
-           /*! \brief Returns next Arena object in the list
-            */
-            Arena * getNext ( void ) const;
-           /*! \brief Set as next Arena object 'a'
-            */
-            void setNext ( Arena * a );
-      };
-      template<typename T>
-      struct InternalCollection {
-         typedef std::list<T, InternalAllocator<T> > type;
-      };
-
-      struct ObjectHeader {
-         Arena     *_arena;
+            void deallocate ( ObjectHeader *object ) ;
       };
 
    private: /* Allocator data members */
-      typedef InternalCollection<Arena *>::type  ArenaCollection;
+      static const size_t           _numSizeClasses = 32; /**< Power of two size classes */
 
-      ArenaCollection               _arenas;      /**< Vector of Arenas in Allocator*/
+      Arena                        *_arenas[_numSizeClasses]; /**< Arena for each size class (if already used) */
+      size_t                        _localFrees;  /**< Number of objects released by the owner thread */
+      size_t                        _remoteFrees; /**< Number of objects released by other threads (already drained) */
+      char                          _pad[NANOS_CACHELINE]; /**< Keeps the shared data away from owner data */
+      const void                   *_owner;       /**< Tag of the owner thread */
+      Atomic<ObjectHeader *>        _remoteList;  /**< Remote-free mailbox */
       static size_t                 _headerSize;  /**< Size of ObjectHeader */
+      static __thread char          _threadTag;   /**< Its address identifies the current thread */
 
       static const size_t                  _sizeOfBig = 1024*1024*10;
 
@@ -177,20 +192,50 @@ class Allocator
      /*! \brief Alternative allocation method for big objects */
       void * allocateBigObject ( size_t size ); 
 
+     /*! \brief Creates the Arena for the given size class */
+      Arena * createArena ( size_t sizeClass );
+
+     /*! \brief Returns the size class (log2 of the object size) for 'size' bytes */
+      static size_t getSizeClass ( size_t size );
+
+     /*! \brief Gives back 'object' either to its Arena (owner) or to the mailbox (others) */
+      void release ( ObjectHeader *object );
+
+     /*! \brief Moves all the objects in the remote-free mailbox back to their Arenas */
+      void drainRemoteFrees ( void );
+
    public: /* Allocator method members */
+    /*! \brief Creates a new Allocator
+     *
+     *  Allocators are never destroyed: objects allocated through an Allocator
+     *  may outlive its owner thread and be released at any later time, which
+     *  reaches the Allocator through the object's Arena.
+     */
+     static Allocator * create ( void );
     /*! \brief Allocator default constructor 
      */
-     Allocator ( ) : _arenas() {}
+     Allocator ( ) : _localFrees( 0 ), _remoteFrees( 0 ), _owner( NULL ), _remoteList( NULL )
+     {
+        for ( size_t i = 0; i < _numSizeClasses; i++ ) _arenas[i] = NULL;
+     }
     /*! \brief Allocator destructor 
+     *
+     *  Arenas are not released: objects allocated through this Allocator may
+     *  still be alive and deallocated later on by another thread.
      */
      ~Allocator () { }
+    /*! \brief Makes the calling thread the owner of the Allocator
+     *
+     *  The previous owner must not use the Allocator anymore (e.g. it has
+     *  already been joined). Objects pending in the remote-free mailbox are
+     *  given back to their Arenas.
+     */
+     void adopt ( void );
     /*! \brief Allocates 'size' bytes in memory and returns memory pointer
      *
-     *  This function will check in his list of Arenas looking for one who
-     *  stores objects of the given 'size'. If Allocator finds an Arena region
-     *  with this 'size' will ask to it for a new object. If none of the current
-     *  Arenas works with the given 'size' Allocator will create a new Arena entry
-     *  in order to manage this (and future) objects of the given 'size'.
+     *  The object size (including its header) is rounded up to the next power
+     *  of two, which directly indexes the Arena managing the objects of that
+     *  size class. The Arena is created the first time its size class is used.
      */
      void * allocate ( size_t size, const char *file = NULL, int line = 0 ) ;
     /*! \brief Deallocates 'object' (object has a header which identifies related Arena
@@ -199,6 +244,14 @@ class Allocator
     /*! \brief Get 'object' size for a given pointer
      */
      static size_t getObjectSize ( void *object ) ;
+    /*! \brief Returns the number of objects released by the owner thread
+     */
+     size_t getLocalFrees ( void ) const ;
+    /*! \brief Returns the number of objects released by other threads
+     *
+     *  Only objects already drained from the mailbox are accounted.
+     */
+     size_t getRemoteFrees ( void ) const ;
 };
 
 
@@ -0,0 +1,579 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_BTREE_MAP
+#define _NANOS_BTREE_MAP
+
+#include <algorithm>
+#include "btreemap_decl.hpp"
+#include "new_decl.hpp"
+#include "lock.hpp"
+
+namespace nanos {
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline BTreeMap<_Key,_Tp,_Compare>::BTreeMap ( const BTreeMap &map ) : _root( NULL ), _first( NULL ), _last( NULL ), _size( 0 ), _comp( map._comp ), _dirty(),
+   _keysDirty( false ), _syncLock()
+{
+   for ( const_iterator it = map.begin(); it != map.end(); it++ ) insert( end(), *it );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline BTreeMap<_Key,_Tp,_Compare>::~BTreeMap ()
+{
+   clear();
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline const BTreeMap<_Key,_Tp,_Compare> & BTreeMap<_Key,_Tp,_Compare>::operator= ( const BTreeMap &map )
+{
+   if ( this == &map ) return *this;
+   clear();
+   _comp = map._comp;
+   for ( const_iterator it = map.begin(); it != map.end(); it++ ) insert( end(), *it );
+   return *this;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::Slot * BTreeMap<_Key,_Tp,_Compare>::next ( const Slot *slot ) const
+{
+   const Leaf *leaf = slot->_leaf;
+   if ( slot->_pos + 1 < leaf->_count ) return leaf->_slots[slot->_pos + 1];
+   return leaf->_next != NULL ? leaf->_next->_slots[0] : NULL;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::Slot * BTreeMap<_Key,_Tp,_Compare>::prev ( const Slot *slot ) const
+{
+   if ( slot == NULL ) return _last != NULL ? _last->_slots[_last->_count - 1] : NULL;
+   const Leaf *leaf = slot->_leaf;
+   if ( slot->_pos > 0 ) return leaf->_slots[slot->_pos - 1];
+   return leaf->_prev != NULL ? leaf->_prev->_slots[leaf->_prev->_count - 1] : NULL;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline const _Key & BTreeMap<_Key,_Tp,_Compare>::firstKey ( const Node *node )
+{
+   if ( node->_isLeaf ) return static_cast<const Leaf *>( node )->_keys[0];
+   return static_cast<const Inner *>( node )->_keys[0];
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::updateFirstKey ( Node *node )
+{
+   // The smallest key of a node is also a separator in every ancestor it is the leftmost descendant of
+   while ( node->_parent != NULL ) {
+      node->_parent->_keys[node->_pos] = firstKey( node );
+      if ( node->_pos != 0 ) break;
+      node = node->_parent;
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::Leaf * BTreeMap<_Key,_Tp,_Compare>::findLeaf ( const _Key &key ) const
+{
+   Node *node = _root;
+   if ( node == NULL ) return NULL;
+   while ( !node->_isLeaf ) {
+      const Inner *inner = static_cast<const Inner *>( node );
+      // last child whose smallest key is not greater than key (the first one if there is none)
+      unsigned int lo = 1, hi = inner->_count;
+      while ( lo < hi ) {
+         unsigned int mid = ( lo + hi ) / 2;
+         if ( _comp( key, inner->_keys[mid] ) ) hi = mid;
+         else lo = mid + 1;
+      }
+      node = inner->_children[lo - 1];
+   }
+   return static_cast<Leaf *>( node );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline unsigned int BTreeMap<_Key,_Tp,_Compare>::lowerBoundIn ( const Leaf *leaf, const _Key &key ) const
+{
+   unsigned int lo = 0, hi = leaf->_count;
+   while ( lo < hi ) {
+      unsigned int mid = ( lo + hi ) / 2;
+      if ( _comp( leaf->_keys[mid], key ) ) lo = mid + 1;
+      else hi = mid;
+   }
+   return lo;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline unsigned int BTreeMap<_Key,_Tp,_Compare>::upperBoundIn ( const Leaf *leaf, const _Key &key ) const
+{
+   unsigned int lo = 0, hi = leaf->_count;
+   while ( lo < hi ) {
+      unsigned int mid = ( lo + hi ) / 2;
+      if ( _comp( key, leaf->_keys[mid] ) ) hi = mid;
+      else lo = mid + 1;
+   }
+   return lo;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::Slot * BTreeMap<_Key,_Tp,_Compare>::lowerBoundSlot ( const _Key &key ) const
+{
+   const Leaf *leaf = findLeaf( key );
+   if ( leaf == NULL ) return NULL;
+   unsigned int pos = lowerBoundIn( leaf, key );
+   if ( pos < leaf->_count ) return leaf->_slots[pos];
+   // every key of the following leaf is greater than key
+   return leaf->_next != NULL ? leaf->_next->_slots[0] : NULL;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::Slot * BTreeMap<_Key,_Tp,_Compare>::upperBoundSlot ( const _Key &key ) const
+{
+   const Leaf *leaf = findLeaf( key );
+   if ( leaf == NULL ) return NULL;
+   unsigned int pos = upperBoundIn( leaf, key );
+   if ( pos < leaf->_count ) return leaf->_slots[pos];
+   return leaf->_next != NULL ? leaf->_next->_slots[0] : NULL;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::iterator BTreeMap<_Key,_Tp,_Compare>::find ( const _Key &key )
+{
+   syncKeys();
+   Slot *slot = lowerBoundSlot( key );
+   if ( slot == NULL || _comp( key, slot->_value.first ) ) return end();
+   return iterator( slot, this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::const_iterator BTreeMap<_Key,_Tp,_Compare>::find ( const _Key &key ) const
+{
+   syncKeys();
+   const Slot *slot = lowerBoundSlot( key );
+   if ( slot == NULL || _comp( key, slot->_value.first ) ) return end();
+   return const_iterator( slot, this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::iterator BTreeMap<_Key,_Tp,_Compare>::lower_bound ( const _Key &key )
+{
+   syncKeys();
+   return iterator( lowerBoundSlot( key ), this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::const_iterator BTreeMap<_Key,_Tp,_Compare>::lower_bound ( const _Key &key ) const
+{
+   syncKeys();
+   return const_iterator( lowerBoundSlot( key ), this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::iterator BTreeMap<_Key,_Tp,_Compare>::upper_bound ( const _Key &key )
+{
+   syncKeys();
+   return iterator( upperBoundSlot( key ), this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::const_iterator BTreeMap<_Key,_Tp,_Compare>::upper_bound ( const _Key &key ) const
+{
+   syncKeys();
+   return const_iterator( upperBoundSlot( key ), this );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline std::pair<typename BTreeMap<_Key,_Tp,_Compare>::iterator, bool> BTreeMap<_Key,_Tp,_Compare>::insert ( const value_type &value )
+{
+   syncKeys();
+   if ( _root == NULL ) {
+      Leaf *leaf = NEW Leaf();
+      _root = _first = _last = leaf;
+      return std::make_pair( iterator( insertAt( leaf, 0, value ), this ), true );
+   }
+   Leaf *leaf = findLeaf( value.first );
+   unsigned int pos = lowerBoundIn( leaf, value.first );
+   if ( pos < leaf->_count && !_comp( value.first, leaf->_keys[pos] ) )
+      return std::make_pair( iterator( leaf->_slots[pos], this ), false );
+   return std::make_pair( iterator( insertAt( leaf, pos, value ), this ), true );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline typename BTreeMap<_Key,_Tp,_Compare>::iterator BTreeMap<_Key,_Tp,_Compare>::insert ( iterator hint, const value_type &value )
+{
+   syncKeys();
+   const _Key &key = value.first;
+   if ( hint._slot == NULL ) {
+      if ( _last != NULL && _comp( _last->_keys[_last->_count - 1], key ) )
+         return iterator( insertAt( _last, _last->_count, value ), this );
+   } else if ( _comp( key, hint._slot->_value.first ) ) {
+      Slot *before = prev( hint._slot );
+      if ( before == NULL || _comp( before->_value.first, key ) )
+         return iterator( insertAt( hint._slot->_leaf, hint._slot->_pos, value ), this );
+   } else if ( !_comp( hint._slot->_value.first, key ) ) {
+      return hint;
+   }
+   return insert( value ).first;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+typename BTreeMap<_Key,_Tp,_Compare>::Slot * BTreeMap<_Key,_Tp,_Compare>::insertAt ( Leaf *leaf, unsigned int pos, const value_type &value )
+{
+   if ( leaf->_count == ORDER ) {
+      Leaf *right = splitLeaf( leaf );
+      if ( pos > leaf->_count ) {
+         pos -= leaf->_count;
+         leaf = right;
+      }
+   }
+   Slot *slot = NEW Slot( value );
+   for ( unsigned int i = leaf->_count; i > pos; i-- ) {
+      leaf->_keys[i] = leaf->_keys[i - 1];
+      leaf->_slots[i] = leaf->_slots[i - 1];
+      leaf->_slots[i]->_pos = i;
+   }
+   leaf->_keys[pos] = value.first;
+   leaf->_slots[pos] = slot;
+   slot->_leaf = leaf;
+   slot->_pos = pos;
+   leaf->_count++;
+   _size++;
+   if ( pos == 0 ) updateFirstKey( leaf );
+   return slot;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+typename BTreeMap<_Key,_Tp,_Compare>::Leaf * BTreeMap<_Key,_Tp,_Compare>::splitLeaf ( Leaf *leaf )
+{
+   Leaf *right = NEW Leaf();
+   unsigned int half = leaf->_count / 2;
+   for ( unsigned int i = half; i < leaf->_count; i++ ) {
+      right->_keys[i - half] = leaf->_keys[i];
+      right->_slots[i - half] = leaf->_slots[i];
+      right->_slots[i - half]->_leaf = right;
+      right->_slots[i - half]->_pos = i - half;
+   }
+   right->_count = leaf->_count - half;
+   leaf->_count = half;
+
+   right->_prev = leaf;
+   right->_next = leaf->_next;
+   if ( leaf->_next != NULL ) leaf->_next->_prev = right;
+   else _last = right;
+   leaf->_next = right;
+
+   insertChild( leaf, right );
+   return right;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+typename BTreeMap<_Key,_Tp,_Compare>::Inner * BTreeMap<_Key,_Tp,_Compare>::splitInner ( Inner *inner )
+{
+   Inner *right = NEW Inner();
+   unsigned int half = inner->_count / 2;
+   for ( unsigned int i = half; i < inner->_count; i++ ) {
+      right->_keys[i - half] = inner->_keys[i];
+      right->_children[i - half] = inner->_children[i];
+      right->_children[i - half]->_parent = right;
+      right->_children[i - half]->_pos = i - half;
+   }
+   right->_count = inner->_count - half;
+   inner->_count = half;
+
+   insertChild( inner, right );
+   return right;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::insertChild ( Node *left, Node *right )
+{
+   Inner *parent = left->_parent;
+   if ( parent == NULL ) {
+      // left was the root: grow the tree one level
+      parent = NEW Inner();
+      parent->_keys[0] = firstKey( left );
+      parent->_children[0] = left;
+      parent->_count = 1;
+      left->_parent = parent;
+      left->_pos = 0;
+      _root = parent;
+   }
+
+   unsigned int pos = left->_pos + 1;
+   if ( parent->_count == ORDER ) {
+      Inner *sibling = splitInner( parent );
+      if ( pos > parent->_count ) {
+         pos -= parent->_count;
+         parent = sibling;
+      }
+   }
+   for ( unsigned int i = parent->_count; i > pos; i-- ) {
+      parent->_keys[i] = parent->_keys[i - 1];
+      parent->_children[i] = parent->_children[i - 1];
+      parent->_children[i]->_pos = i;
+   }
+   parent->_keys[pos] = firstKey( right );
+   parent->_children[pos] = right;
+   right->_parent = parent;
+   right->_pos = pos;
+   parent->_count++;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::eraseSlot ( Slot *slot )
+{
+   Leaf *leaf = slot->_leaf;
+   unsigned int pos = slot->_pos;
+   delete slot;
+   for ( unsigned int i = pos; i + 1 < leaf->_count; i++ ) {
+      leaf->_keys[i] = leaf->_keys[i + 1];
+      leaf->_slots[i] = leaf->_slots[i + 1];
+      leaf->_slots[i]->_pos = i;
+   }
+   leaf->_count--;
+   _size--;
+
+   if ( leaf->_count == 0 ) {
+      removeLeaf( leaf );
+   } else {
+      if ( pos == 0 ) updateFirstKey( leaf );
+      if ( leaf->_count < MIN_FILL ) mergeLeaf( leaf );
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::removeLeaf ( Leaf *leaf )
+{
+   if ( leaf->_prev != NULL ) leaf->_prev->_next = leaf->_next;
+   else _first = leaf->_next;
+   if ( leaf->_next != NULL ) leaf->_next->_prev = leaf->_prev;
+   else _last = leaf->_prev;
+
+   if ( leaf->_parent == NULL ) _root = NULL;
+   else removeChild( leaf->_parent, leaf->_pos );
+   delete leaf;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::removeChild ( Inner *inner, unsigned int pos )
+{
+   for ( unsigned int i = pos; i + 1 < inner->_count; i++ ) {
+      inner->_keys[i] = inner->_keys[i + 1];
+      inner->_children[i] = inner->_children[i + 1];
+      inner->_children[i]->_pos = i;
+   }
+   inner->_count--;
+
+   if ( inner->_count == 0 ) {
+      if ( inner->_parent == NULL ) _root = NULL;
+      else removeChild( inner->_parent, inner->_pos );
+      delete inner;
+      return;
+   }
+
+   if ( pos == 0 ) updateFirstKey( inner );
+
+   if ( inner->_parent == NULL ) {
+      // a root with a single child is useless: shrink the tree one level
+      if ( inner->_count == 1 ) {
+         _root = inner->_children[0];
+         _root->_parent = NULL;
+         _root->_pos = 0;
+         delete inner;
+      }
+   } else if ( inner->_count < MIN_FILL ) {
+      mergeInner( inner );
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::moveSlots ( Leaf *dst, Leaf *src )
+{
+   for ( unsigned int i = 0; i < src->_count; i++ ) {
+      unsigned int pos = dst->_count + i;
+      dst->_keys[pos] = src->_keys[i];
+      dst->_slots[pos] = src->_slots[i];
+      dst->_slots[pos]->_leaf = dst;
+      dst->_slots[pos]->_pos = pos;
+   }
+   dst->_count += src->_count;
+   src->_count = 0;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::moveChildren ( Inner *dst, Inner *src )
+{
+   for ( unsigned int i = 0; i < src->_count; i++ ) {
+      unsigned int pos = dst->_count + i;
+      dst->_keys[pos] = src->_keys[i];
+      dst->_children[pos] = src->_children[i];
+      dst->_children[pos]->_parent = dst;
+      dst->_children[pos]->_pos = pos;
+   }
+   dst->_count += src->_count;
+   src->_count = 0;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::mergeLeaf ( Leaf *leaf )
+{
+   // Siblings are always merged into the left node so no smallest key changes
+   Inner *parent = leaf->_parent;
+   if ( parent == NULL ) return;
+   if ( leaf->_pos > 0 ) {
+      Leaf *left = static_cast<Leaf *>( parent->_children[leaf->_pos - 1] );
+      if ( left->_count + leaf->_count <= MAX_MERGE ) {
+         moveSlots( left, leaf );
+         removeLeaf( leaf );
+         return;
+      }
+   }
+   if ( leaf->_pos + 1 < parent->_count ) {
+      Leaf *right = static_cast<Leaf *>( parent->_children[leaf->_pos + 1] );
+      if ( leaf->_count + right->_count <= MAX_MERGE ) {
+         moveSlots( leaf, right );
+         removeLeaf( right );
+      }
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::mergeInner ( Inner *inner )
+{
+   Inner *parent = inner->_parent;
+   Inner *src = NULL;
+   if ( inner->_pos > 0 ) {
+      Inner *left = static_cast<Inner *>( parent->_children[inner->_pos - 1] );
+      if ( left->_count + inner->_count <= MAX_MERGE ) {
+         moveChildren( left, inner );
+         src = inner;
+      }
+   }
+   if ( src == NULL && inner->_pos + 1 < parent->_count ) {
+      Inner *right = static_cast<Inner *>( parent->_children[inner->_pos + 1] );
+      if ( inner->_count + right->_count <= MAX_MERGE ) {
+         moveChildren( inner, right );
+         src = right;
+      }
+   }
+   if ( src != NULL ) {
+      removeChild( parent, src->_pos );
+      delete src;
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::erase ( iterator it )
+{
+   syncKeys();
+   eraseSlot( it._slot );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::erase ( iterator first, iterator last )
+{
+   syncKeys();
+   while ( first != last ) {
+      Slot *slot = first._slot;
+      first++;
+      eraseSlot( slot );
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline size_t BTreeMap<_Key,_Tp,_Compare>::erase ( const _Key &key )
+{
+   iterator it = find( key );
+   if ( it == end() ) return 0;
+   eraseSlot( it._slot );
+   return 1;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline _Key & BTreeMap<_Key,_Tp,_Compare>::mutableKey ( iterator it )
+{
+   Leaf *leaf = it._slot->_leaf;
+   if ( !leaf->_dirty ) {
+      leaf->_dirty = true;
+      _dirty.push_back( leaf );
+      _keysDirty = true;
+   }
+   return const_cast<_Key &>( it._slot->_value.first );
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::syncKeys () const
+{
+   if ( !_keysDirty ) return;
+
+   LockBlock lock( _syncLock );
+   if ( !_keysDirty ) return; // refreshed by a concurrent lookup meanwhile
+
+   for ( typename std::vector<Leaf *>::iterator it = _dirty.begin(); it != _dirty.end(); it++ ) {
+      Leaf *leaf = *it;
+      for ( unsigned int i = 0; i < leaf->_count; i++ ) leaf->_keys[i] = leaf->_slots[i]->_value.first;
+      leaf->_dirty = false;
+      const_cast<BTreeMap *>( this )->updateFirstKey( leaf );
+   }
+   _dirty.clear();
+
+   // Lookups which find the map clean use the copies without taking the lock
+   memoryFence();
+   _keysDirty = false;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+void BTreeMap<_Key,_Tp,_Compare>::destroy ( Node *node )
+{
+   if ( node->_isLeaf ) {
+      Leaf *leaf = static_cast<Leaf *>( node );
+      for ( unsigned int i = 0; i < leaf->_count; i++ ) delete leaf->_slots[i];
+      delete leaf;
+   } else {
+      Inner *inner = static_cast<Inner *>( node );
+      for ( unsigned int i = 0; i < inner->_count; i++ ) destroy( inner->_children[i] );
+      delete inner;
+   }
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::clear ()
+{
+   if ( _root != NULL ) destroy( _root );
+   _root = NULL;
+   _first = _last = NULL;
+   _size = 0;
+   _dirty.clear();
+   _keysDirty = false;
+}
+
+template <typename _Key, typename _Tp, typename _Compare>
+inline void BTreeMap<_Key,_Tp,_Compare>::swap ( BTreeMap &map )
+{
+   std::swap( _root, map._root );
+   std::swap( _first, map._first );
+   std::swap( _last, map._last );
+   std::swap( _size, map._size );
+   std::swap( _comp, map._comp );
+   _dirty.swap( map._dirty );
+   bool keysDirty = _keysDirty;
+   _keysDirty = map._keysDirty;
+   map._keysDirty = keysDirty;
+}
+
+} // namespace nanos
+
+#endif // _NANOS_BTREE_MAP
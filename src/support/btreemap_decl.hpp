@@ -0,0 +1,249 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_BTREE_MAP_DECL
+#define _NANOS_BTREE_MAP_DECL
+
+#include <stddef.h>
+#include <utility>
+#include <functional>
+#include <vector>
+#include "lock_decl.hpp"
+
+namespace nanos {
+
+  /*! \class BTreeMap
+   *  \brief Ordered map implemented as a B+tree with contiguous key arrays in its nodes
+   *
+   *  Offers the subset of the std::map interface used by MemoryMap. Lookups binary search
+   *  the key arrays of at most a handful of nodes instead of chasing red-black tree nodes
+   *  scattered in the heap.
+   *
+   *  Like in a std::map, every element lives in its own heap slot, so iterators and
+   *  pointers to elements stay valid until that element is erased. The nodes keep a copy
+   *  of the key of each slot: code that rewrites a key in place (without changing its
+   *  position in the order) must do it through mutableKey(), and the copies are brought
+   *  up to date by syncKeys(), which any lookup or update calls first.
+   *
+   *  Like a std::map, concurrent lookups are safe as long as nothing updates the map
+   *  meanwhile. Since the first of them may still have to refresh the key copies,
+   *  syncKeys() does so holding a lock of its own, and lookups only use the copies once
+   *  they are up to date.
+   */
+   template <typename _Key, typename _Tp, typename _Compare = std::less<_Key> >
+   class BTreeMap
+   {
+      public:
+         typedef _Key                         key_type;
+         typedef _Tp                          mapped_type;
+         typedef std::pair<const _Key, _Tp>   value_type;
+         typedef _Compare                     key_compare;
+         typedef size_t                       size_type;
+
+         enum { ORDER = 32 };                          /**< Maximum number of entries of a node */
+         enum { MIN_FILL = ORDER / 4 };                /**< Nodes below this size try to merge with a sibling */
+         enum { MAX_MERGE = ( ORDER * 3 ) / 4 };       /**< Largest node a merge may produce */
+
+      private:
+         struct Inner;
+         struct Leaf;
+
+         struct Node
+         {
+            Inner          *_parent;   /**< Parent node, NULL for the root */
+            unsigned int    _pos;      /**< Position in the parent */
+            unsigned int    _count;    /**< Number of keys (leaves) or children (inner nodes) */
+            bool            _isLeaf;
+
+            Node ( bool isLeaf ) : _parent( NULL ), _pos( 0 ), _count( 0 ), _isLeaf( isLeaf ) {}
+         };
+
+         struct Slot
+         {
+            value_type      _value;
+            Leaf           *_leaf;     /**< Leaf that holds this slot */
+            unsigned int    _pos;      /**< Position of this slot in its leaf */
+
+            Slot ( const value_type &value ) : _value( value ), _leaf( NULL ), _pos( 0 ) {}
+         };
+
+         struct Leaf : public Node
+         {
+            _Key            _keys[ORDER];   /**< Copies of the keys of the slots, sorted */
+            Slot           *_slots[ORDER];
+            Leaf           *_prev;
+            Leaf           *_next;
+            bool            _dirty;         /**< Some key was rewritten through mutableKey() */
+
+            Leaf () : Node( true ), _prev( NULL ), _next( NULL ), _dirty( false ) {}
+         };
+
+         struct Inner : public Node
+         {
+            _Key            _keys[ORDER];      /**< _keys[i] is the smallest key under _children[i] */
+            Node           *_children[ORDER];
+
+            Inner () : Node( false ) {}
+         };
+
+      public:
+         class const_iterator;
+
+         class iterator
+         {
+            private:
+               friend class BTreeMap;
+               friend class const_iterator;
+               Slot            *_slot;    /**< NULL for end() */
+               const BTreeMap  *_map;
+
+               iterator ( Slot *slot, const BTreeMap *map ) : _slot( slot ), _map( map ) {}
+            public:
+               iterator () : _slot( NULL ), _map( NULL ) {}
+
+               value_type & operator* () const { return _slot->_value; }
+               value_type * operator-> () const { return &_slot->_value; }
+
+               iterator & operator++ () { _slot = _map->next( _slot ); return *this; }
+               iterator operator++ ( int ) { iterator it( *this ); _slot = _map->next( _slot ); return it; }
+               iterator & operator-- () { _slot = _map->prev( _slot ); return *this; }
+               iterator operator-- ( int ) { iterator it( *this ); _slot = _map->prev( _slot ); return it; }
+
+               bool operator== ( const iterator &it ) const { return _slot == it._slot; }
+               bool operator!= ( const iterator &it ) const { return _slot != it._slot; }
+         };
+
+         class const_iterator
+         {
+            private:
+               friend class BTreeMap;
+               const Slot      *_slot;    /**< NULL for end() */
+               const BTreeMap  *_map;
+
+               const_iterator ( const Slot *slot, const BTreeMap *map ) : _slot( slot ), _map( map ) {}
+            public:
+               const_iterator () : _slot( NULL ), _map( NULL ) {}
+               const_iterator ( const iterator &it ) : _slot( it._slot ), _map( it._map ) {}
+
+               const value_type & operator* () const { return _slot->_value; }
+               const value_type * operator-> () const { return &_slot->_value; }
+
+               const_iterator & operator++ () { _slot = _map->next( _slot ); return *this; }
+               const_iterator operator++ ( int ) { const_iterator it( *this ); _slot = _map->next( _slot ); return it; }
+               const_iterator & operator-- () { _slot = _map->prev( _slot ); return *this; }
+               const_iterator operator-- ( int ) { const_iterator it( *this ); _slot = _map->prev( _slot ); return it; }
+
+               bool operator== ( const const_iterator &it ) const { return _slot == it._slot; }
+               bool operator!= ( const const_iterator &it ) const { return _slot != it._slot; }
+         };
+
+      private:
+         friend class iterator;
+         friend class const_iterator;
+
+         Node                *_root;
+         Leaf                *_first;      /**< Leftmost leaf */
+         Leaf                *_last;       /**< Rightmost leaf */
+         size_t               _size;
+         _Compare             _comp;
+         mutable std::vector<Leaf *>  _dirty;     /**< Leaves with keys rewritten through mutableKey() */
+         mutable volatile bool _keysDirty; /**< _dirty is not empty (read without holding _syncLock) */
+         mutable Lock         _syncLock;   /**< Serializes syncKeys() calls from concurrent lookups */
+
+         Slot * next ( const Slot *slot ) const;
+         Slot * prev ( const Slot *slot ) const;
+
+         static const _Key & firstKey ( const Node *node );
+         void updateFirstKey ( Node *node );
+
+         Leaf * findLeaf ( const _Key &key ) const;
+         unsigned int lowerBoundIn ( const Leaf *leaf, const _Key &key ) const;
+         unsigned int upperBoundIn ( const Leaf *leaf, const _Key &key ) const;
+         Slot * lowerBoundSlot ( const _Key &key ) const;
+         Slot * upperBoundSlot ( const _Key &key ) const;
+
+         Slot * insertAt ( Leaf *leaf, unsigned int pos, const value_type &value );
+         Leaf * splitLeaf ( Leaf *leaf );
+         Inner * splitInner ( Inner *inner );
+         void insertChild ( Node *left, Node *right );
+
+         void eraseSlot ( Slot *slot );
+         void removeLeaf ( Leaf *leaf );
+         void removeChild ( Inner *inner, unsigned int pos );
+         void mergeLeaf ( Leaf *leaf );
+         void mergeInner ( Inner *inner );
+         void moveSlots ( Leaf *dst, Leaf *src );
+         void moveChildren ( Inner *dst, Inner *src );
+
+         void destroy ( Node *node );
+
+      public:
+         BTreeMap () : _root( NULL ), _first( NULL ), _last( NULL ), _size( 0 ), _comp(), _dirty(), _keysDirty( false ), _syncLock() {}
+         BTreeMap ( const BTreeMap &map );
+         ~BTreeMap ();
+
+         const BTreeMap & operator= ( const BTreeMap &map );
+
+         iterator begin () { return iterator( _first != NULL ? _first->_slots[0] : NULL, this ); }
+         iterator end () { return iterator( NULL, this ); }
+         const_iterator begin () const { return const_iterator( _first != NULL ? _first->_slots[0] : NULL, this ); }
+         const_iterator end () const { return const_iterator( NULL, this ); }
+
+         size_t size () const { return _size; }
+         bool empty () const { return _size == 0; }
+         key_compare key_comp () const { return _comp; }
+
+         void clear ();
+         void swap ( BTreeMap &map );
+
+         iterator find ( const _Key &key );
+         const_iterator find ( const _Key &key ) const;
+         iterator lower_bound ( const _Key &key );
+         const_iterator lower_bound ( const _Key &key ) const;
+         iterator upper_bound ( const _Key &key );
+         const_iterator upper_bound ( const _Key &key ) const;
+
+         std::pair<iterator, bool> insert ( const value_type &value );
+
+        /*! \brief Inserts value right before hint when that keeps the order, like std::map,
+         *         avoiding the lookup; otherwise falls back to a regular insertion
+         */
+         iterator insert ( iterator hint, const value_type &value );
+
+         void erase ( iterator it );
+         void erase ( iterator first, iterator last );
+         size_t erase ( const _Key &key );
+
+        /*! \brief Writable reference to the key of it
+         *
+         *  The new key must keep the element between its neighbours. The copies of the key
+         *  kept in the tree are refreshed by the next syncKeys().
+         */
+         _Key & mutableKey ( iterator it );
+
+        /*! \brief Refreshes the keys copied in the nodes after calls to mutableKey()
+         *
+         *  Safe to call from concurrent lookups (see the class description).
+         */
+         void syncKeys () const;
+   };
+
+} // namespace nanos
+
+#endif // _NANOS_BTREE_MAP_DECL
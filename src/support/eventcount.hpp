@@ -0,0 +1,96 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_EVENTCOUNT
+#define _NANOS_EVENTCOUNT
+
+#include "eventcount_decl.hpp"
+#include "atomic.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <time.h>
+#include <climits>
+#else
+#include <sched.h>
+#endif
+
+namespace nanos {
+
+inline int EventCount::prepareWait ( void )
+{
+   // The atomic increment is a full barrier: the caller's re-check of its condition
+   // cannot be reordered before it
+   _waiters++;
+   return _epoch.value();
+}
+
+inline void EventCount::cancelWait ( void )
+{
+   _waiters--;
+}
+
+inline void EventCount::wait ( int key, unsigned long long timeout_ns )
+{
+#ifdef __linux__
+   struct timespec ts;
+   ts.tv_sec = timeout_ns / 1000000000ULL;
+   ts.tv_nsec = timeout_ns % 1000000000ULL;
+   syscall( SYS_futex, ( int * ) &_epoch.override(), FUTEX_WAIT_PRIVATE, key, timeout_ns != 0 ? &ts : NULL, NULL, 0 );
+#else
+   if ( _epoch.value() == key ) sched_yield();
+#endif
+   _waiters--;
+}
+
+inline bool EventCount::notifyOne ( void )
+{
+   // Pairs with the barrier in prepareWait(): either the waiter sees the caller's
+   // new state or the caller sees the waiter
+   memoryFence();
+   if ( _waiters.value() == 0 ) return false;
+
+   _epoch++;
+#ifdef __linux__
+   syscall( SYS_futex, ( int * ) &_epoch.override(), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0 );
+#endif
+   return true;
+}
+
+inline void EventCount::notifyAll ( void )
+{
+   memoryFence();
+   if ( _waiters.value() == 0 ) return;
+
+   _epoch++;
+#ifdef __linux__
+   syscall( SYS_futex, ( int * ) &_epoch.override(), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0 );
+#endif
+}
+
+inline int EventCount::getWaiters ( void ) const
+{
+   return _waiters.value();
+}
+
+} // namespace nanos
+
+#endif
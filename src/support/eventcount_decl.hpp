@@ -0,0 +1,70 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_EVENTCOUNT_DECL
+#define _NANOS_EVENTCOUNT_DECL
+
+#include "atomic_decl.hpp"
+
+namespace nanos {
+
+   /*! \class EventCount
+    *  \brief Lets threads sleep until some condition, checked without locks, may have changed.
+    *
+    *  A waiter announces itself with prepareWait(), re-checks its condition and then either
+    *  calls cancelWait() or wait() with the key returned by prepareWait(). A notifier first
+    *  makes the condition true and then calls notifyOne() or notifyAll(). A notification that
+    *  happens after prepareWait() makes the corresponding wait() return immediately, so no
+    *  wakeup is lost. On Linux the waiters sleep on a futex; elsewhere wait() just yields.
+    */
+   class EventCount
+   {
+      private:
+         Atomic<int>    _epoch;   /**< Futex word, changed by every notification */
+         Atomic<int>    _waiters; /**< Threads between prepareWait() and the end of wait() or cancelWait() */
+
+         // disable copy constructor and assignment operator
+         EventCount ( const EventCount & );
+         const EventCount & operator= ( const EventCount & );
+
+      public:
+         EventCount () : _epoch( 0 ), _waiters( 0 ) {}
+         ~EventCount () {}
+
+         /*! \brief Announces a waiter and returns the key to be passed to wait() */
+         int prepareWait ( void );
+         /*! \brief Withdraws a waiter announced with prepareWait() */
+         void cancelWait ( void );
+         /*! \brief Sleeps until a notification newer than key arrives or timeout_ns nanoseconds
+          *  have passed (0 means no timeout). Spurious wakeups are possible.
+          */
+         void wait ( int key, unsigned long long timeout_ns = 0 );
+
+         /*! \brief Wakes up one waiter, if any. Returns whether there was any waiter */
+         bool notifyOne ( void );
+         /*! \brief Wakes up all waiters */
+         void notifyAll ( void );
+
+         /*! \brief Returns the number of announced waiters */
+         int getWaiters ( void ) const;
+   };
+
+} // namespace nanos
+
+#endif
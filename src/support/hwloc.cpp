@@ -174,4 +174,25 @@ bool Hwloc::isCpuAvailable( unsigned int cpu ) const
    return hwloc_get_pu_obj_by_os_index( _hwlocTopology, cpu ) != NULL;
 #endif
 }
+
+unsigned int Hwloc::getCpuDistance( unsigned int cpu1, unsigned int cpu2 ) const
+{
+#ifndef HWLOC
+   return 0;
+#else
+   hwloc_obj_t pu1 = hwloc_get_pu_obj_by_os_index( _hwlocTopology, cpu1 );
+   hwloc_obj_t pu2 = hwloc_get_pu_obj_by_os_index( _hwlocTopology, cpu2 );
+   if ( pu1 == NULL || pu2 == NULL ) return 3;
+
+   hwloc_obj_t common = hwloc_get_common_ancestor_obj( _hwlocTopology, pu1, pu2 );
+   if ( common->type == HWLOC_OBJ_PU || common->type == HWLOC_OBJ_CORE ) return 0;
+   if ( common->type == HWLOC_OBJ_CACHE ) return common->attr->cache.depth <= 2 ? 0 : 1;
+
+   // No shared cache: check whether both CPUs still live in the same NUMA node
+   hwloc_obj_t node = hwloc_get_ancestor_obj_by_type( _hwlocTopology, HWLOC_OBJ_NODE, pu1 );
+   if ( node == NULL || hwloc_bitmap_isset( node->cpuset, pu2->os_index ) ) return 2;
+   return 3;
+#endif
+}
+
 }
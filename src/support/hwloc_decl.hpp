@@ -63,6 +63,21 @@ class Hwloc {
        */
       bool isCpuAvailable( unsigned int cpu ) const;
 
+      /*!
+       * \brief Returns how far apart two CPUs are in the memory hierarchy.
+       *
+       * 0: same core or sharing a private (L1/L2) cache,
+       * 1: sharing an outer cache (e.g. L3),
+       * 2: same NUMA node,
+       * 3: different NUMA nodes.
+       *
+       * If hwloc is not available, this function returns 0.
+       *
+       * @param cpu1 OS CPU index.
+       * @param cpu2 OS CPU index.
+       */
+      unsigned int getCpuDistance( unsigned int cpu1, unsigned int cpu2 ) const;
+
 };
 
 } // namespace nanos
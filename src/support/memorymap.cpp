@@ -158,14 +158,14 @@ void MemoryMap< uint64_t >::insertWithOverlapButNotGenerateIntersects( const Mem
 
       if ( firstPos == hint ) { //range is [firstPos, firstPos)
          if ( reuseFirstPos ) { //overlap with the firstPos, and we must reuse it so don't insert.
-            MemoryChunk &firstChunk = const_cast< MemoryChunk & >( hint->first );
+            MemoryChunk &firstChunk = this->mutableKey( hint );
             firstChunk.expandIncluding( iterKey );
          } else { //no overlap, and we can insert
             hint = this->insert( hint, BaseMap::value_type( iterKey, data ) );
          }
       } else { //range is [firstPos, hint)
          if ( reuseFirstPos ) { //don't delete first pos
-            MemoryChunk &firstChunk = const_cast< MemoryChunk & >( firstPos->first );
+            MemoryChunk &firstChunk = this->mutableKey( firstPos );
             iterator secondPos = firstPos;
             secondPos++;
             firstChunk.expandIncluding( ( expandToLast ? hint->first : iterKey ) );
@@ -192,6 +192,7 @@ void MemoryMap< uint64_t >::addChunk( uint64_t addr, std::size_t len, uint64_t d
    {
       /* NOT EXACT ADDR FOUND: "addr" is higher than any odther addr in the map OR less than "it" */
       insertWithOverlapButNotGenerateIntersects( key, it, data );
+      this->syncKeys();
    }
 }
 
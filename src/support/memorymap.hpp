@@ -24,6 +24,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "memorymap_decl.hpp"
+#include "btreemap.hpp"
+#include "smallvector.hpp"
 #include "basethread_decl.hpp"
 #include "debug.hpp"
 
@@ -143,16 +145,17 @@ inline void MemoryChunk::cutAfter( MemoryChunk const &mc ) {
 
 
 template < typename _Type >
-void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename BaseMap::iterator &hint, MemChunkList &ptrList )
+template < typename _List >
+void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename BaseMap::iterator &hint, _List &ptrList )
 {
    class LocalFunctions {
       MemoryMap< _Type > &_thisMap;
       MemoryChunk        &_key;
       iterator           &_hint;
-      MemChunkList       &_ptrList;
+      _List              &_ptrList;
 
       public:
-      LocalFunctions( MemoryMap< _Type > &thisMap, MemoryChunk &localKey, iterator &localHint, MemChunkList &localPtrList ) :
+      LocalFunctions( MemoryMap< _Type > &thisMap, MemoryChunk &localKey, iterator &localHint, _List &localPtrList ) :
          _thisMap( thisMap ), _key( localKey ), _hint( localHint ), _ptrList( localPtrList ) { }
 
       void insertNoOverlap()
@@ -185,7 +188,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
           */
          _Type *ptr = (_Type *) NULL;
          MemoryChunk &leftChunk = _key;
-         MemoryChunk &rightChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &rightChunk = _thisMap.mutableKey( _hint );
          MemoryChunk rightLeftOver;
 
          MemoryChunk::intersect( leftChunk, rightChunk, rightLeftOver );
@@ -202,7 +205,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
       void insertEndOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          MemoryChunk rightLeftOver;
          /*
@@ -239,7 +242,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
       {
          _Type *ptr = (_Type *) NULL;
          MemoryChunk &leftChunk = _key;
-         MemoryChunk &rightChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &rightChunk = _thisMap.mutableKey( _hint );
          _Type ** rightChunkDataPtr = &( _hint->second );
          MemoryChunk leftLeftOver;
          /*
@@ -272,7 +275,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
       void insertSubchunkOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          MemoryChunk leftLeftOver;
          /*
@@ -305,7 +308,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
       void insertTotalBeginOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          /*
           *   +=====================+
@@ -332,7 +335,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
       void insertSubchunkBeginOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          /*
           *   +===============================================+
@@ -362,7 +365,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
       {
          _Type *ptr = (_Type *) NULL;
          MemoryChunk &leftChunk = _key;
-         MemoryChunk &rightChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &rightChunk = _thisMap.mutableKey( _hint );
          const MemoryChunk *rightChunkPtr = &( _hint->first );
          _Type ** rightChunkDataPtr = &( _hint->second );
          /*
@@ -392,7 +395,7 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
       void insertSubchunkEndOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          /*
           *   +===============================================+
@@ -493,16 +496,17 @@ void MemoryMap< _Type >::insertWithOverlap( const MemoryChunk &key, typename Bas
 
 
 template < typename _Type >
-void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const MemoryChunk &key, typename BaseMap::iterator &hint, MemChunkList &ptrList )
+template < typename _List >
+void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const MemoryChunk &key, typename BaseMap::iterator &hint, _List &ptrList )
 {
    class LocalFunctions {
       MemoryMap< _Type > &_thisMap;
       MemoryChunk        &_key;
       iterator           &_hint;
-      MemChunkList       &_ptrList;
+      _List              &_ptrList;
 
       public:
-      LocalFunctions( MemoryMap< _Type > &thisMap, MemoryChunk &localKey, iterator &localHint, MemChunkList &localPtrList ) :
+      LocalFunctions( MemoryMap< _Type > &thisMap, MemoryChunk &localKey, iterator &localHint, _List &localPtrList ) :
          _thisMap( thisMap ), _key( localKey ), _hint( localHint ), _ptrList( localPtrList ) { }
 
       void insertNoOverlap()
@@ -587,7 +591,7 @@ void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const Memory
       {
          _Type *ptr = (_Type *) NULL;
          MemoryChunk &leftChunk = _key;
-         MemoryChunk &rightChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &rightChunk = _thisMap.mutableKey( _hint );
          _Type ** rightChunkDataPtr = &( _hint->second );
          MemoryChunk leftLeftOver;
          /*
@@ -651,7 +655,7 @@ void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const Memory
 
       void insertTotalBeginOverlap()
       {
-         MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          MemoryChunk &rightChunk = _key;
          /*
           *   +=====================+
@@ -678,7 +682,7 @@ void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const Memory
 
       void insertSubchunkBeginOverlap()
       {
-         //MemoryChunk &leftChunk = const_cast< MemoryChunk & >( _hint->first );
+         //MemoryChunk &leftChunk = _thisMap.mutableKey( _hint );
          //MemoryChunk &rightChunk = _key;
          /*
           *   +===============================================+
@@ -707,7 +711,7 @@ void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const Memory
       {
          _Type *ptr = (_Type *) NULL;
          MemoryChunk &leftChunk = _key;
-         MemoryChunk &rightChunk = const_cast< MemoryChunk & >( _hint->first );
+         MemoryChunk &rightChunk = _thisMap.mutableKey( _hint );
          const MemoryChunk *rightChunkPtr = &( _hint->first );
          _Type ** rightChunkDataPtr = &( _hint->second );
          /*
@@ -832,15 +836,16 @@ void MemoryMap< _Type >::insertWithOverlapButNotGenerateIntersects( const Memory
 }
 
 template < typename _Type >
-void MemoryMap< _Type >::getWithOverlapNoExactKey( const MemoryChunk &key, const_iterator &hint, ConstMemChunkList &ptrList ) const
+template < typename _List >
+void MemoryMap< _Type >::getWithOverlapNoExactKey( const MemoryChunk &key, const_iterator &hint, _List &ptrList ) const
 {
    class LocalFunctions {
       MemoryChunk          &_key;
       const_iterator       &_hint;
-      ConstMemChunkList    &_ptrList;
+      _List                &_ptrList;
 
       public:
-      LocalFunctions( MemoryChunk &localKey, const_iterator &localHint, ConstMemChunkList &localPtrList ) :
+      LocalFunctions( MemoryChunk &localKey, const_iterator &localHint, _List &localPtrList ) :
          _key( localKey ), _hint( localHint ), _ptrList( localPtrList ) { }
 
       void getNoOverlap()
@@ -1145,7 +1150,8 @@ void MemoryMap< _Type >::getWithOverlapNoExactKey( const MemoryChunk &key, const
 }
 
 template < typename _Type >
-void MemoryMap< _Type >::getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, MemChunkList &resultEntries )
+template < typename _List >
+void MemoryMap< _Type >::_getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, _List &resultEntries )
 {
    MemoryChunk key( addr, len );
 
@@ -1154,6 +1160,7 @@ void MemoryMap< _Type >::getOrAddChunkDoNotFragment( uint64_t addr, std::size_t
    {
       /* NOT EXACT ADDR FOUND: "addr" is higher than any odther addr in the map OR less than "it" */
       insertWithOverlapButNotGenerateIntersects( key, it, resultEntries );
+      this->syncKeys(); //keys may have been rewritten in place
       //res = MEM_CHUNK_NOT_FOUND_BUT_ALLOCATED;
    }
    else
@@ -1164,7 +1171,8 @@ void MemoryMap< _Type >::getOrAddChunkDoNotFragment( uint64_t addr, std::size_t
 }
 
 template < typename _Type >
-void MemoryMap< _Type >::getOrAddChunk( uint64_t addr, std::size_t len, MemChunkList &resultEntries )
+template < typename _List >
+void MemoryMap< _Type >::_getOrAddChunk( uint64_t addr, std::size_t len, _List &resultEntries )
 {
    MemoryChunk key( addr, len );
 
@@ -1173,6 +1181,7 @@ void MemoryMap< _Type >::getOrAddChunk( uint64_t addr, std::size_t len, MemChunk
    {
       /* NOT EXACT ADDR FOUND: "addr" is higher than any odther addr in the map OR less than "it" */
       insertWithOverlap( key, it, resultEntries );
+      this->syncKeys(); //keys may have been rewritten in place
       //res = MEM_CHUNK_NOT_FOUND_BUT_ALLOCATED;
    }
    else
@@ -1183,7 +1192,8 @@ void MemoryMap< _Type >::getOrAddChunk( uint64_t addr, std::size_t len, MemChunk
 }
 
 template < typename _Type >
-void MemoryMap< _Type >::getChunk( uint64_t addr, std::size_t len, ConstMemChunkList &resultEntries ) const
+template < typename _List >
+void MemoryMap< _Type >::_getChunk( uint64_t addr, std::size_t len, _List &resultEntries ) const
 {
    MemoryChunk key( addr, len );
 
@@ -1213,6 +1223,42 @@ void MemoryMap< _Type >::getChunk( uint64_t addr, std::size_t len, ConstMemChunk
    }
 }
 
+template < typename _Type >
+void MemoryMap< _Type >::getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, MemChunkList &resultEntries )
+{
+   _getOrAddChunkDoNotFragment( addr, len, resultEntries );
+}
+
+template < typename _Type >
+void MemoryMap< _Type >::getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, MemChunkVector &resultEntries )
+{
+   _getOrAddChunkDoNotFragment( addr, len, resultEntries );
+}
+
+template < typename _Type >
+void MemoryMap< _Type >::getOrAddChunk( uint64_t addr, std::size_t len, MemChunkList &resultEntries )
+{
+   _getOrAddChunk( addr, len, resultEntries );
+}
+
+template < typename _Type >
+void MemoryMap< _Type >::getOrAddChunk( uint64_t addr, std::size_t len, MemChunkVector &resultEntries )
+{
+   _getOrAddChunk( addr, len, resultEntries );
+}
+
+template < typename _Type >
+void MemoryMap< _Type >::getChunk( uint64_t addr, std::size_t len, ConstMemChunkList &resultEntries ) const
+{
+   _getChunk( addr, len, resultEntries );
+}
+
+template < typename _Type >
+void MemoryMap< _Type >::getChunk( uint64_t addr, std::size_t len, ConstMemChunkVector &resultEntries ) const
+{
+   _getChunk( addr, len, resultEntries );
+}
+
 template < typename _Type >
 void MemoryMap< _Type >::print(std::ostream &o) const
 {
@@ -23,6 +23,8 @@
 #include <map>
 #include <list>
 #include <stdint.h>
+#include "btreemap_decl.hpp"
+#include "smallvector_decl.hpp"
 
 namespace nanos {
 
@@ -95,23 +97,29 @@ class MemoryChunk {
       static void partitionEnd( MemoryChunk &mcA, MemoryChunk const &mcB );
 };
 
+/*! \class MemoryMap
+ *  \brief Map of non-overlapping memory chunks, kept in a B+tree (see BTreeMap)
+ *
+ *  Overlap queries either append to a MemChunkList or, to avoid allocating on every
+ *  lookup, to a caller-provided MemChunkVector that keeps the usual few results inline.
+ */
 template <typename _Type>
-class MemoryMap : public std::map< MemoryChunk, _Type * > { 
-   using std::map< MemoryChunk, _Type *>::operator=;
-   //private:
-   //   const MemoryMap & operator=( const MemoryMap &mm ) { this->std::map< MemoryChunk}
+class MemoryMap : public BTreeMap< MemoryChunk, _Type * > { 
+   using BTreeMap< MemoryChunk, _Type *>::operator=;
    public:
       //typedef enum { MEM_CHUNK_FOUND, MEM_CHUNK_NOT_FOUND, MEM_CHUNK_NOT_FOUND_BUT_ALLOCATED } QueryResult;
-      typedef std::map< MemoryChunk, _Type * > BaseMap;
+      typedef BTreeMap< MemoryChunk, _Type * > BaseMap;
       typedef std::pair< const MemoryChunk *, _Type ** > MemChunkPair;
       typedef std::list< MemChunkPair > MemChunkList;
+      typedef SmallVector< MemChunkPair, 8 > MemChunkVector;
       typedef std::pair< MemoryChunk, _Type * > ConstMemChunkPair;
       typedef std::list< ConstMemChunkPair > ConstMemChunkList;
+      typedef SmallVector< ConstMemChunkPair, 8 > ConstMemChunkVector;
       typedef typename BaseMap::iterator iterator;
       typedef typename BaseMap::const_iterator const_iterator;
 
-      MemoryMap() : std::map< MemoryChunk, _Type * >() { }
-      MemoryMap( const MemoryMap &mm ) : std::map< MemoryChunk, _Type * >( mm ) { }
+      MemoryMap() : BTreeMap< MemoryChunk, _Type * >() { }
+      MemoryMap( const MemoryMap &mm ) : BTreeMap< MemoryChunk, _Type * >( mm ) { }
       ~MemoryMap() {
          for ( iterator it = this->begin(); it != this->end(); it++ ) {
             delete it->second;
@@ -119,13 +127,25 @@ class MemoryMap : public std::map< MemoryChunk, _Type * > {
       }
 
    private:
-      void insertWithOverlap( const MemoryChunk &key, iterator &hint, MemChunkList &ptrList );
-      void insertWithOverlapButNotGenerateIntersects( const MemoryChunk &key, iterator &hint, MemChunkList &ptrList );
-      void getWithOverlapNoExactKey( const MemoryChunk &key, const_iterator &hint, ConstMemChunkList &ptrList ) const;
+      template < typename _List >
+      void insertWithOverlap( const MemoryChunk &key, iterator &hint, _List &ptrList );
+      template < typename _List >
+      void insertWithOverlapButNotGenerateIntersects( const MemoryChunk &key, iterator &hint, _List &ptrList );
+      template < typename _List >
+      void getWithOverlapNoExactKey( const MemoryChunk &key, const_iterator &hint, _List &ptrList ) const;
+      template < typename _List >
+      void _getOrAddChunk( uint64_t addr, std::size_t len, _List &resultEntries );
+      template < typename _List >
+      void _getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, _List &resultEntries );
+      template < typename _List >
+      void _getChunk( uint64_t addr, std::size_t len, _List &resultEntries ) const;
    public:
       void getOrAddChunk( uint64_t addr, std::size_t len, MemChunkList &resultEntries );
+      void getOrAddChunk( uint64_t addr, std::size_t len, MemChunkVector &resultEntries );
       void getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, MemChunkList &resultEntries );
+      void getOrAddChunkDoNotFragment( uint64_t addr, std::size_t len, MemChunkVector &resultEntries );
       void getChunk( uint64_t addr, std::size_t len, ConstMemChunkList &resultEntries ) const;
+      void getChunk( uint64_t addr, std::size_t len, ConstMemChunkVector &resultEntries ) const;
       void print(std::ostream &o) const;
       bool canPack() const;
       void removeChunks( uint64_t addr, std::size_t len );
@@ -137,11 +157,11 @@ class MemoryMap : public std::map< MemoryChunk, _Type * > {
 
 #if 1
 template <> 
-class MemoryMap<uint64_t> : public std::map< MemoryChunk, uint64_t > {
+class MemoryMap<uint64_t> : public BTreeMap< MemoryChunk, uint64_t > {
    public:
-      MemoryMap( const MemoryMap &mm ) : std::map< MemoryChunk, uint64_t> () { }
+      MemoryMap( const MemoryMap &mm ) : BTreeMap< MemoryChunk, uint64_t> () { }
       const MemoryMap & operator=( const MemoryMap &mm );// { return *this; }
-      typedef std::map< MemoryChunk, uint64_t > BaseMap;
+      typedef BTreeMap< MemoryChunk, uint64_t > BaseMap;
       typedef BaseMap::iterator iterator;
       typedef BaseMap::const_iterator const_iterator;
 
@@ -62,7 +62,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             prevIt--;
             if ( prevIt->first.getAddress() + prevIt->first.getLength() == thisIt->first.getAddress() ) {
                if ( prevIt->second->equal( *thisIt->second ) ) { 
-                  MemoryChunk &prevNoConst = const_cast< MemoryChunk & >( prevIt->first );
+                  MemoryChunk &prevNoConst = _thisMap.mutableKey( prevIt );
                   prevNoConst.expandIncluding( thisIt->first );
                   _thisMap.erase( thisIt );
                   thisIt = _thisMap.find( prevNoConst );
@@ -92,7 +92,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             void expandNoOverlap() {
                if ( _thisAndInputDataAreEqual ) {
                   /* we can expand safetly, and we finish */
-                  MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                  MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                   thisNoConst.expandIncluding( _inputKey );
                } else {
                   _thisIt = _thisMap.insert( _thisIt, typename BaseMap::value_type( _inputKey, NEW _Type ( *_inputData ) ) );
@@ -111,7 +111,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                      /* expand to fit [this ... inputKey ... next]
                       * then erase next entry
                       */
-                     MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                     MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                      thisNoConst.expandIncluding( nextKey );
                      delete nextIt->second;
                      _thisMap.erase( nextIt );
@@ -121,12 +121,12 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                       */
                      MemoryChunk rightLeftOver;
                      MemoryChunk inputKeyCopy = _inputKey;
-                     MemoryChunk &rightChunk = const_cast< MemoryChunk & >( nextIt->first );
+                     MemoryChunk &rightChunk = _thisMap.mutableKey( nextIt );
                      /* we can not merge both already-inserted entries,
                       * expand "this" as much as possible and partition
                       * the leftover of "inputKey" that intersects with hintCopy
                       */
-                     MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                     MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                      thisNoConst.expandExcluding( nextIt->first );
                      MemoryChunk::intersect( inputKeyCopy, rightChunk, rightLeftOver ); //this modifies nextIt->first!!
                      _thisIt = _thisMap.insert( nextIt, typename BaseMap::value_type( rightLeftOver, NEW _Type( *nextIt->second ) ) );
@@ -150,7 +150,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                       */
                      MemoryChunk rightLeftOver;
                      MemoryChunk inputKeyCopy = _inputKey;
-                     MemoryChunk &rightChunk = const_cast< MemoryChunk & >( nextIt->first );
+                     MemoryChunk &rightChunk = _thisMap.mutableKey( nextIt );
                      /* we can not merge both already-inserted entries,
                       * expand "this" as much as possible and partition
                       * the leftover of "inputKey" that intersects with hintCopy
@@ -170,7 +170,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                const MemoryChunk &nextKey = nextIt->first;
                _nextAndInputDataAreEqual = nextIt->second->equal( *_inputData );
                if ( _thisAndInputDataAreEqual ) {
-                  MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                  MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                   if ( _nextAndInputDataAreEqual )
                   {
                      /* [this .. inputKey .. next]{..inputKey..} */
@@ -221,7 +221,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                      /* expand to fit [this][next]{next:leftover}
                       * then erase next entry
                       */
-                     MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                     MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                      thisNoConst.expandIncluding( nextKey );
                      delete nextIt->second;
                      _thisMap.erase( nextIt );
@@ -258,12 +258,12 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                _nextAndInputDataAreEqual = nextIt->second->equal( *_inputData );
                if ( _thisAndInputDataAreEqual ) {
                   if ( _nextAndInputDataAreEqual ) {
-                     MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                     MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                      thisNoConst.expandIncluding( nextKeyCopy );
                      _thisMap.erase( nextIt );
                   } else {
                      if ( !nextData->contains( *_inputData ) ) {
-                        MemoryChunk &nextNoConst = const_cast< MemoryChunk & >( nextIt->first );
+                        MemoryChunk &nextNoConst = _thisMap.mutableKey( nextIt );
                         nextNoConst = _inputKey;
                         nextKeyCopy.cutAfter( _inputKey );
                         _thisIt = _thisMap.insert( nextIt, typename BaseMap::value_type( nextKeyCopy, NEW _Type ( *nextData ) ) );
@@ -278,13 +278,13 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                      tmpData->merge( *nextData );
                      if ( tmpData->equal( *thisData ) ) {
                         if ( thisData->equal( *nextData ) ) { //merge Equal with BOTH next and this
-                           MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                           MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                            thisNoConst.expandIncluding( nextKeyCopy );
                            _thisMap.erase( nextIt );
                            _thisIt = _thisMap.find( thisKey );
                         } else {
                            std::pair<typename BaseMap::iterator, bool> insertResult;
-                           MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                           MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                            thisNoConst.expandIncluding( _inputKey );
                            _thisMap.erase( nextIt );
                            MemoryChunk::partitionBeginAgtB( nextKeyCopy, _inputKey );
@@ -293,7 +293,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                            delete tmpData;
                         }
                      } else {
-                        MemoryChunk &nextNoConst = const_cast< MemoryChunk & >( nextIt->first );
+                        MemoryChunk &nextNoConst = _thisMap.mutableKey( nextIt );
                         nextNoConst = _inputKey;
                         nextKeyCopy.cutAfter( _inputKey );
                         _thisIt = _thisMap.insert( nextIt, typename BaseMap::value_type( nextKeyCopy, tmpData ) );
@@ -306,7 +306,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
                const MemoryChunk &nextKey = nextIt->first;
                _nextAndInputDataAreEqual = nextIt->second->equal( *_inputData );
                if ( _thisAndInputDataAreEqual ) {
-                  MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( _thisIt->first );
+                  MemoryChunk &thisNoConst = _thisMap.mutableKey( _thisIt );
                   if ( _nextAndInputDataAreEqual ) {
                      thisNoConst.expandIncluding( nextKey );
                      delete nextIt->second;
@@ -344,7 +344,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
          {
             if ( thisAndInputDataAreEqual ) {
                /* we can expand safetly, and we finish */
-               MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+               MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
                thisNoConst.expandIncluding( inputKey );
             } else {
                thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type ( *inputData ) ) );
@@ -448,7 +448,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             thisIt = insertResult.first;
          } else {
             MemoryChunk rightLeftOver;
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::intersect( inputKey, thisNoConst, rightLeftOver );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type( *inputData ) ));
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( rightLeftOver, NEW _Type( *thisData ) ));
@@ -468,7 +468,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             MemoryChunk::intersect( thisKey, inputKey, rightLeftOver );
          }
          else {
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::intersect( thisNoConst, inputKey, rightLeftOver );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type( *thisData ) ));
             thisIt->second->merge( *inputData );
@@ -510,7 +510,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
          if ( thisAndInputDataAreEqual || thisData->contains( *inputData ) ) {
             //do nothing
          } else {
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::partition( thisNoConst, inputKey, leftLeftOver );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type( *inputData ) ) );
             thisIt->second->merge( *thisData );
@@ -545,7 +545,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             //do_nothing
          } else {
             iterator thisItCopy;
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::partitionBeginAgtB( thisNoConst, inputKey );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type( *thisData ) ) );
             thisItCopy = thisIt; thisItCopy--;
@@ -566,7 +566,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
             insertResult = _thisMap.insert( typename BaseMap::value_type( inputKey, thisData ) ); //reuse data
             thisIt = insertResult.first;
          } else {
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::partitionEnd( inputKey, thisNoConst );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type ( *inputData ) ) );
             thisIt++;
@@ -589,7 +589,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
          if ( thisAndInputDataAreEqual ) {
             //do_nothing;
          } else {
-            MemoryChunk &thisNoConst = const_cast< MemoryChunk & >( thisIt->first );
+            MemoryChunk &thisNoConst = _thisMap.mutableKey( thisIt );
             MemoryChunk::partitionEnd( thisNoConst, inputKey );
             thisIt = _thisMap.insert( thisIt, typename BaseMap::value_type( inputKey, NEW _Type( *inputData ) ) );
             thisIt->second->merge( *thisData );
@@ -665,6 +665,7 @@ void MergeableMemoryMap< _Type >::merge2( const MemoryMap< _Type > &mm )
       local.tryToMergeWithPreviousEntry( thisIt );
       thisIt++;
    }
+   this->syncKeys();
 }
 
 } // namespace nanos
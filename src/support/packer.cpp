@@ -24,7 +24,6 @@
 
 using namespace nanos;
 
-
 bool Packer::PackInfo::operator<( Packer::PackInfo const &pack ) const {
    return _addr < pack._addr;
 }
@@ -37,16 +36,53 @@ bool Packer::PackInfo::sizeMatch( std::size_t len, std::size_t count ) const {
    return len == _len && count == _count ;
 }
 
+int Packer::getSizeClass( std::size_t size ) {
+   int sizeClass = 0;
+   while ( sizeClass < POOL_CLASSES && getClassBytes( sizeClass ) < size ) {
+      sizeClass += 1;
+   }
+   return ( sizeClass < POOL_CLASSES ) ? sizeClass : -1;
+}
+
+std::size_t Packer::getClassBytes( int sizeClass ) {
+   std::size_t base = ( std::size_t ) 1 << ( MIN_POOL_SHIFT + sizeClass / CLASS_STEPS );
+   return base + ( base / CLASS_STEPS ) * ( sizeClass % CLASS_STEPS );
+}
+
+/* The caller holds _lock and the lock of the allocator */
+void Packer::releasePool() {
+   for ( int sizeClass = 0; sizeClass < POOL_CLASSES; sizeClass += 1 ) {
+      while ( _pool._count[ sizeClass ] > 0 ) {
+         _pool._count[ sizeClass ] -= 1;
+         _allocator->free( _pool._buffers[ sizeClass ][ _pool._count[ sizeClass ] ] );
+      }
+   }
+   _pool._bytes = 0;
+}
+
 void * Packer::give_pack( uint64_t addr, std::size_t len, std::size_t count ) {
    void *result = NULL;
    PackInfo key( addr, len, count );
 
 #if 1 /* simple implementation */
+   int sizeClass = getSizeClass( len * count );
+   std::size_t size = ( sizeClass >= 0 ) ? getClassBytes( sizeClass ) : len * count;
    _lock.acquire();
    if ( _allocator == NULL ) _allocator = sys.getNetwork()->getPackerAllocator();
-   _allocator->lock();
-   result = _allocator->allocate( len * count );
-   _allocator->unlock();
+   if ( sizeClass >= 0 && _pool._count[ sizeClass ] > 0 ) {
+      _pool._count[ sizeClass ] -= 1;
+      result = _pool._buffers[ sizeClass ][ _pool._count[ sizeClass ] ];
+      _pool._bytes -= size;
+   } else {
+      _allocator->lock();
+      result = _allocator->allocate( size );
+      if ( result == NULL && _pool._bytes > 0 ) {
+         /* the memory we need may be held by the pool */
+         releasePool();
+         result = _allocator->allocate( size );
+      }
+      _allocator->unlock();
+   }
    _lock.release();
 #else
    _lock.acquire();
@@ -103,12 +139,19 @@ void * Packer::give_pack( uint64_t addr, std::size_t len, std::size_t count ) {
 bool Packer::free_pack( uint64_t addr, std::size_t len, std::size_t count, void *allocAddr ) {
    bool result = true;
 #if 1
+   int sizeClass = getSizeClass( len * count );
    _lock.acquire();
-   _allocator->lock();
-   if ( _allocator->free( allocAddr ) == 0 ) {
-      result = false;
+   if ( sizeClass >= 0 && _pool._count[ sizeClass ] < POOL_DEPTH && _pool._bytes + getClassBytes( sizeClass ) <= MAX_POOL_BYTES ) {
+      _pool._buffers[ sizeClass ][ _pool._count[ sizeClass ] ] = allocAddr;
+      _pool._count[ sizeClass ] += 1;
+      _pool._bytes += getClassBytes( sizeClass );
+   } else {
+      _allocator->lock();
+      if ( _allocator->free( allocAddr ) == 0 ) {
+         result = false;
+      }
+      _allocator->unlock();
    }
-   _allocator->unlock();
    _lock.release();
 #else
    PackInfo key( addr, len, count );
@@ -127,5 +170,13 @@ bool Packer::free_pack( uint64_t addr, std::size_t len, std::size_t count, void
 }
 
 void Packer::setAllocator( SimpleAllocator *alloc ) {
+   _lock.acquire();
+   if ( _allocator != NULL ) {
+      /* pooled buffers belong to the previous allocator */
+      _allocator->lock();
+      releasePool();
+      _allocator->unlock();
+   }
    _allocator = alloc;
+   _lock.release();
 }
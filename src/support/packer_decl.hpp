@@ -55,9 +55,27 @@ class Packer {
          void *getMemory() const { return _memory; }
    };
 
+   /* Pack buffers up to 1MB are allocated with their size rounded up to a size class (four
+    * classes per power of two, so at most a quarter more than requested) and, when released,
+    * kept in a small pool for the next pack of the same class. Buffers of strided gets are
+    * released by the polling thread, so the pool is shared by all threads and guarded by
+    * _lock. If the allocator runs out of memory the pool is given back to it and the
+    * allocation retried.
+    */
+   enum { MIN_POOL_SHIFT = 12, MAX_POOL_SHIFT = 20, CLASS_STEPS = 4, POOL_CLASSES = ( MAX_POOL_SHIFT - MIN_POOL_SHIFT ) * CLASS_STEPS + 1, POOL_DEPTH = 4 };
+   enum { MAX_POOL_BYTES = 4 * 1024 * 1024 };
+
+   struct PackPool {
+      std::size_t      _bytes;                            //!< Bytes held by the pool
+      unsigned int     _count[POOL_CLASSES];
+      void            *_buffers[POOL_CLASSES][POOL_DEPTH];
+      PackPool() : _bytes( 0 ) { for ( int i = 0; i < POOL_CLASSES; i += 1 ) _count[i] = 0; }
+   };
+
    std::map< PackInfo, PackMemory > _packs;
    SimpleAllocator *_allocator;
    Lock _lock;
+   PackPool _pool;
 
    typedef std::map< PackInfo, PackMemory >::iterator mapIterator;
 
@@ -65,8 +83,12 @@ class Packer {
       Packer( Packer const &p );
       bool operator=( Packer const &p );
 
+      static int getSizeClass( std::size_t size );
+      static std::size_t getClassBytes( int sizeClass );
+      void releasePool();
+
    public:
-      Packer() : _packs(), _allocator( NULL ) {}
+      Packer() : _packs(), _allocator( NULL ), _lock(), _pool() {}
       void *give_pack( uint64_t addr, std::size_t len, std::size_t count );
       bool free_pack( uint64_t addr, std::size_t len, std::size_t count, void *allocAddr );
       void setAllocator( SimpleAllocator *alloc );
@@ -0,0 +1,181 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "perfmodelstore_decl.hpp"
+#include "lock.hpp"
+#include "debug.hpp"
+
+#include <dlfcn.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <limits>
+
+using namespace nanos;
+
+const char *PerfModelStore::_header = "nanox-perfmodel 1";
+
+bool PerfModelStore::Key::operator< ( const Key &key ) const
+{
+   if ( _dataSize != key._dataSize ) return _dataSize < key._dataSize;
+   int cmp = _outline.compare( key._outline );
+   if ( cmp != 0 ) return cmp < 0;
+   return _device < key._device;
+}
+
+bool PerfModelStore::load( const std::string &fileName )
+{
+   LockBlock lock( _lock );
+
+   _fileName.clear();
+   _records.clear();
+
+   // A model that does not exist yet is created at save time
+   std::ifstream file( fileName.c_str() );
+   if ( !file.is_open() ) {
+      _fileName = fileName;
+      return true;
+   }
+
+   std::string line;
+   if ( !std::getline( file, line ) || line != _header ) {
+      warning0( "Ignoring performance model file '" << fileName << "': unknown format" );
+      return false;
+   }
+
+   unsigned int lineNo = 1;
+   while ( std::getline( file, line ) ) {
+      lineNo++;
+      if ( line.empty() ) continue;
+
+      // <data size> <device> <count> <mean> <outline>; the outline goes last as it may contain spaces
+      std::istringstream fields( line );
+      std::size_t dataSize;
+      std::string device, outline;
+      Record record;
+      if ( fields >> dataSize >> device >> record._count >> record._mean >> std::ws ) {
+         std::getline( fields, outline );
+      }
+
+      if ( outline.empty() || record._count == 0 ) {
+         warning0( "Ignoring performance model file '" << fileName << "': malformed line " << lineNo );
+         _records.clear();
+         return false;
+      }
+
+      _records[Key( outline, dataSize, device )] = record;
+   }
+
+   _fileName = fileName;
+
+   verbose0( "Loaded " << _records.size() << " performance model records from '" << fileName << "'" );
+
+   return true;
+}
+
+bool PerfModelStore::save() const
+{
+   LockBlock lock( _lock );
+
+   if ( _fileName.empty() ) return false;
+
+   std::ostringstream tmpName;
+   tmpName << _fileName << ".tmp." << getpid();
+
+   {
+      std::ofstream file( tmpName.str().c_str() );
+      if ( !file.is_open() ) {
+         warning0( "Could not write performance model file '" << tmpName.str() << "'" );
+         return false;
+      }
+
+      file << _header << std::endl;
+      file << std::setprecision( std::numeric_limits<double>::digits10 + 2 );
+      for ( RecordMap::const_iterator it = _records.begin(); it != _records.end(); it++ ) {
+         file << it->first._dataSize << " " << it->first._device << " "
+              << it->second._count << " " << it->second._mean << " " << it->first._outline << std::endl;
+      }
+
+      if ( !file.good() ) {
+         warning0( "Could not write performance model file '" << tmpName.str() << "'" );
+         file.close();
+         unlink( tmpName.str().c_str() );
+         return false;
+      }
+   }
+
+   if ( rename( tmpName.str().c_str(), _fileName.c_str() ) != 0 ) {
+      warning0( "Could not replace performance model file '" << _fileName << "': " << strerror( errno ) );
+      unlink( tmpName.str().c_str() );
+      return false;
+   }
+
+   return true;
+}
+
+bool PerfModelStore::find( const std::string &outline, std::size_t dataSize, const std::string &device, Record &record ) const
+{
+   LockBlock lock( _lock );
+
+   RecordMap::const_iterator it = _records.find( Key( outline, dataSize, device ) );
+   if ( it == _records.end() ) return false;
+
+   record = it->second;
+   return true;
+}
+
+void PerfModelStore::update( const std::string &outline, std::size_t dataSize, const std::string &device, const Record &record )
+{
+   if ( outline.empty() || record._count == 0 ) return;
+
+   LockBlock lock( _lock );
+
+   Record &stored = _records[Key( outline, dataSize, device )];
+   stored._count = record._count < _maxCount ? record._count : _maxCount;
+   stored._mean = record._mean;
+}
+
+std::string PerfModelStore::getOutlineKey( const void *addr, const char *description )
+{
+   std::ostringstream key;
+
+   Dl_info info;
+   if ( addr != NULL && dladdr( addr, &info ) != 0 && info.dli_fname != NULL && info.dli_fname[0] != '\0' ) {
+      const char *module = strrchr( info.dli_fname, '/' );
+      module = ( module != NULL ) ? module + 1 : info.dli_fname;
+      key << module << "+0x" << std::hex << ( ( const char * ) addr - ( const char * ) info.dli_fbase );
+   }
+
+   if ( description != NULL && description[0] != '\0' ) {
+      if ( !key.str().empty() ) key << " ";
+      key << description;
+   }
+
+   // Keys are stored one per line
+   std::string result = key.str();
+   for ( std::string::iterator it = result.begin(); it != result.end(); it++ ) {
+      if ( *it == '\n' || *it == '\r' ) *it = ' ';
+   }
+
+   return result;
+}
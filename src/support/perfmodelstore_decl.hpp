@@ -0,0 +1,115 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_PERFMODELSTORE_DECL
+#define _NANOS_PERFMODELSTORE_DECL
+
+#include <string>
+#include <map>
+#include "lock_decl.hpp"
+
+namespace nanos {
+
+   /*! \brief Persistent store of task execution time statistics
+    *
+    *  Records are keyed by task outline, data size and device name, and keep the number of
+    *  samples and their mean execution time. The store is a plain text file, one record per
+    *  line, that is read when the runtime starts and rewritten (through a temporary file and
+    *  a rename, so readers never see a half written model) when it shuts down.
+    */
+   class PerfModelStore
+   {
+      public:
+         struct Record {
+            unsigned long  _count;     //!< Number of samples
+            double         _mean;      //!< Mean execution time of the samples
+
+            Record() : _count( 0 ), _mean( 0.0 ) {}
+            Record( unsigned long count, double mean ) : _count( count ), _mean( mean ) {}
+         };
+
+      private:
+         struct Key {
+            std::string    _outline;
+            std::size_t    _dataSize;
+            std::string    _device;
+
+            Key( const std::string &outline, std::size_t dataSize, const std::string &device ) :
+               _outline( outline ), _dataSize( dataSize ), _device( device ) {}
+
+            bool operator< ( const Key &key ) const;
+         };
+
+         typedef std::map<Key, Record> RecordMap;
+
+         std::string       _fileName;
+         unsigned long     _maxCount;  //!< Samples kept per record, so old runs do not freeze the mean
+         RecordMap         _records;
+         mutable Lock      _lock;
+
+         static const char *_header;
+
+      private:
+         /*! \brief PerfModelStore copy constructor (disabled) */
+         PerfModelStore( const PerfModelStore &store );
+         /*! \brief PerfModelStore copy assignment operator (disabled) */
+         PerfModelStore & operator= ( const PerfModelStore &store );
+
+      public:
+         /*! \brief PerfModelStore default constructor */
+         PerfModelStore() : _fileName(), _maxCount( 1000 ), _records(), _lock() {}
+         /*! \brief PerfModelStore destructor */
+         ~PerfModelStore() {}
+
+         /*! \brief Sets the file backing the store and loads it, if it exists
+          *  \return false if the file exists but could not be parsed, in which case the store
+          *  is left disabled so that the file is not overwritten
+          */
+         bool load( const std::string &fileName );
+
+         /*! \brief Writes the store back to its file
+          *  \return false if the store has no file or it could not be written
+          */
+         bool save() const;
+
+         bool isEnabled() const { return !_fileName.empty(); }
+         std::size_t size() const { return _records.size(); }
+
+         void setMaxCount( unsigned long maxCount ) { _maxCount = maxCount; }
+
+         /*! \brief Looks up the record of an outline, data size and device */
+         bool find( const std::string &outline, std::size_t dataSize, const std::string &device, Record &record ) const;
+
+         /*! \brief Replaces the record of an outline, data size and device */
+         void update( const std::string &outline, std::size_t dataSize, const std::string &device, const Record &record );
+
+         /*! \brief Builds a key for a task outline that does not change between runs
+          *
+          *  \a addr is any address that identifies the outline within its binary (e.g. the
+          *  address of its constant device descriptors). It is turned into the name of the
+          *  module containing it plus its offset from the module base, so it is stable even
+          *  if the module is loaded at a different address. An empty key is returned when
+          *  neither the address nor \a description can identify the outline.
+          */
+         static std::string getOutlineKey( const void *addr, const char *description );
+   };
+
+} // namespace nanos
+
+#endif
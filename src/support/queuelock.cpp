@@ -0,0 +1,57 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "queuelock.hpp"
+#include "new_decl.hpp"
+
+using namespace nanos;
+
+__thread QueueLock::Node * QueueLock::_freeNodes = NULL;
+unsigned int QueueLock::_spins = 1000;
+
+QueueLock::Node * QueueLock::getNode ( void )
+{
+   Node *node = _freeNodes;
+   if ( node == NULL ) return NEW Node();
+
+   _freeNodes = node->_nextFree;
+   return node;
+}
+
+void QueueLock::putNode ( Node *node )
+{
+   node->_nextFree = _freeNodes;
+   _freeNodes = node;
+}
+
+void QueueLock::waitTurn ( Node *node )
+{
+   for ( unsigned int i = 0; i < _spins; i++ ) {
+      if ( node->_locked.value() == 0 ) return;
+   }
+
+   while ( node->_locked.value() != 0 ) {
+      int key = node->_parked.prepareWait();
+      if ( node->_locked.value() == 0 ) {
+         node->_parked.cancelWait();
+         return;
+      }
+      node->_parked.wait( key );
+   }
+}
@@ -0,0 +1,110 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_QUEUE_LOCK
+#define _NANOS_QUEUE_LOCK
+
+#include "queuelock_decl.hpp"
+#include "atomic.hpp"
+#include "eventcount.hpp"
+
+namespace nanos {
+
+inline bool QueueLock::isQueueLock ( const nanos_lock_t *lock )
+{
+   return lock->state_ == (nanos_lock_state_t) TAG;
+}
+
+inline void QueueLock::setSpins ( unsigned int spins )
+{
+   _spins = spins;
+}
+
+inline void QueueLock::operator++ ( int val )
+{
+   acquire();
+}
+
+inline void QueueLock::operator-- ( int val )
+{
+   release();
+}
+
+inline void QueueLock::acquire ( void )
+{
+   Node *node = getNode();
+   node->_next = NULL;
+   node->_locked = 1;
+
+   // Full barrier swap: the node must be initialized before it becomes visible as the tail
+   Node *pred;
+   do {
+      pred = _tail;
+   } while ( !__sync_bool_compare_and_swap( &_tail, pred, node ) );
+
+   if ( pred != NULL ) {
+      pred->_next = node;
+      waitTurn( node );
+   }
+
+   _holder = node;
+}
+
+inline bool QueueLock::tryAcquire ( void )
+{
+   if ( _tail != NULL ) return false;
+
+   Node *node = getNode();
+   node->_next = NULL;
+   node->_locked = 0;
+
+   if ( !__sync_bool_compare_and_swap( &_tail, (Node *) NULL, node ) ) {
+      putNode( node );
+      return false;
+   }
+
+   _holder = node;
+   return true;
+}
+
+inline void QueueLock::release ( void )
+{
+   Node *node = _holder;
+   Node *succ = node->_next;
+
+   if ( succ == NULL ) {
+      if ( __sync_bool_compare_and_swap( &_tail, node, (Node *) NULL ) ) {
+         putNode( node );
+         return;
+      }
+      // A waiter has already swapped itself in but not yet linked to us
+      while ( ( succ = node->_next ) == NULL ) {}
+   }
+
+   // The successor's critical section must see ours
+   memoryFence();
+   succ->_locked = 0;
+   succ->_parked.notifyOne();
+
+   putNode( node );
+}
+
+} // namespace nanos
+
+#endif
@@ -0,0 +1,95 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_QUEUE_LOCK_DECL
+#define _NANOS_QUEUE_LOCK_DECL
+
+#include "nanos-int.h"
+#include "atomic_decl.hpp"
+#include "eventcount_decl.hpp"
+
+namespace nanos {
+
+   /*! \class QueueLock
+    *  \brief Fair (FIFO) MCS queue lock whose waiters spin for a while and then park.
+    *
+    *  Every waiter spins on its own queue node instead of on the lock word, so a release only
+    *  touches the cache line of the next waiter. Waiters that keep waiting for longer than
+    *  the spin limit sleep on the EventCount of their node until their predecessor hands the
+    *  lock over.
+    *
+    *  Queue nodes come from a per-thread free list and are never freed, so a releaser may
+    *  still notify a node that its owner has already reused: that is just a spurious wakeup.
+    *
+    *  A QueueLock is a nanos_lock_t whose state is permanently TAG, a value a Lock never
+    *  takes, so the C API can tell both kinds of lock apart.
+    */
+   class QueueLock : public nanos_lock_t
+   {
+      public:
+         enum { TAG = 2 };
+
+      private:
+         struct Node
+         {
+            Node * volatile  _next;      /**< Next waiter in the queue */
+            Atomic<int>      _locked;    /**< Cleared by the predecessor on hand-over */
+            EventCount       _parked;    /**< Parked waiters sleep here */
+            Node            *_nextFree;  /**< Next node in the per-thread free list */
+
+            Node () : _next( NULL ), _locked( 0 ), _parked(), _nextFree( NULL ) {}
+         };
+
+         Node * volatile      _tail;     /**< Last node of the queue, NULL if the lock is free */
+         Node                *_holder;   /**< Node of the current holder */
+
+         static __thread Node *_freeNodes;
+         static unsigned int   _spins;   /**< Polls of the node before parking */
+
+         // disable copy constructor and assignment operator
+         QueueLock ( const QueueLock & );
+         const QueueLock & operator= ( const QueueLock & );
+
+         static Node * getNode ( void );
+         static void putNode ( Node *node );
+
+         /*! \brief Waits until the predecessor hands the lock over to node */
+         static void waitTurn ( Node *node );
+
+      public:
+         QueueLock () : nanos_lock_t( (nanos_lock_state_t) TAG ), _tail( NULL ), _holder( NULL ) {}
+         ~QueueLock () {}
+
+         void acquire ( void );
+         bool tryAcquire ( void );
+         void release ( void );
+
+         void operator++ ( int val );
+         void operator-- ( int val );
+
+         /*! \brief Whether lock is a QueueLock rather than a plain Lock */
+         static bool isQueueLock ( const nanos_lock_t *lock );
+
+         /*! \brief Sets how many times a waiter polls its node before parking */
+         static void setSpins ( unsigned int spins );
+   };
+
+} // namespace nanos
+
+#endif
@@ -0,0 +1,109 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SHARDED_COUNTER
+#define _NANOS_SHARDED_COUNTER
+
+#include "shardedcounter_decl.hpp"
+#include "atomic.hpp"
+
+namespace nanos {
+
+inline ShardedCounter::ShardedCounter ( int initial )
+{
+   if ( initial >= 0 ) _shards[0]._added = (unsigned) initial;
+   else _shards[0]._removed = (unsigned) -initial;
+}
+
+inline ShardedCounter::Shard & ShardedCounter::myShard ( void )
+{
+   int shard = _myShard;
+   if ( shard == 0 ) {
+      shard = _myShard = ( _numShards.fetchAndAdd() % MAX_SHARDS ) + 1;
+   }
+   return _shards[shard - 1];
+}
+
+inline int ShardedCounter::usedShards ( void )
+{
+   int used = _numShards.value();
+   // Shard 0 also holds the initial value
+   if ( used < 1 ) return 1;
+   return used < MAX_SHARDS ? used : (int) MAX_SHARDS;
+}
+
+inline void ShardedCounter::operator++ ( void ) { myShard()._added++; }
+inline void ShardedCounter::operator++ ( int ) { myShard()._added++; }
+inline void ShardedCounter::operator-- ( void ) { myShard()._removed++; }
+inline void ShardedCounter::operator-- ( int ) { myShard()._removed++; }
+
+inline void ShardedCounter::operator+= ( int val )
+{
+   if ( val >= 0 ) myShard()._added += (unsigned) val;
+   else myShard()._removed += (unsigned) -val;
+}
+
+inline void ShardedCounter::operator-= ( int val )
+{
+   if ( val >= 0 ) myShard()._removed += (unsigned) val;
+   else myShard()._added += (unsigned) -val;
+}
+
+inline int ShardedCounter::value ( void ) const
+{
+   // Unsigned arithmetic: the counts may wrap around, their difference does not
+   unsigned sum = 0;
+   int used = usedShards();
+   for ( int i = 0; i < used; i++ ) {
+      sum += _shards[i]._added.value() - _shards[i]._removed.value();
+   }
+   return (int) sum;
+}
+
+inline int ShardedCounter::exactValue ( void ) const
+{
+   unsigned added[MAX_SHARDS], removed[MAX_SHARDS];
+
+   for ( int i = 0; i < MAX_SHARDS; i++ ) {
+      removed[i] = _shards[i]._removed.value();
+      added[i] = _shards[i]._added.value();
+   }
+
+   // Both counts of every shard only grow: if a second pass sees all of them unchanged,
+   // nothing changed in between and the first pass is a consistent snapshot
+   for ( ;; ) {
+      bool stable = true;
+      unsigned sum = 0;
+      for ( int i = 0; i < MAX_SHARDS; i++ ) {
+         unsigned r = _shards[i]._removed.value();
+         unsigned a = _shards[i]._added.value();
+         if ( r != removed[i] || a != added[i] ) {
+            stable = false;
+            removed[i] = r;
+            added[i] = a;
+         }
+         sum += a - r;
+      }
+      if ( stable ) return (int) sum;
+   }
+}
+
+} // namespace nanos
+
+#endif
@@ -0,0 +1,89 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SHARDED_COUNTER_DECL
+#define _NANOS_SHARDED_COUNTER_DECL
+
+#include "atomic_decl.hpp"
+#include "allocator_decl.hpp"
+
+namespace nanos {
+
+   /*! \class ShardedCounter
+    *  \brief Integer counter split in per-thread, cacheline-padded shards.
+    *
+    *  Every thread updates its own shard, so frequent updates from many threads do not
+    *  bounce a single cache line. Each shard keeps two monotonic counts (added and removed)
+    *  and the counter value is the sum of their differences over all the shards.
+    *
+    *  value() sums the shards without synchronization: it is cheap and exact once updates
+    *  stop, but may be off by the updates racing with the read. exactValue() returns a
+    *  consistent snapshot (double collect) for correctness-critical callers; it retries while
+    *  the counter is being updated, so it must stay out of hot paths.
+    */
+   class ShardedCounter
+   {
+      public:
+         enum { MAX_SHARDS = 64 };
+
+      private:
+         struct Shard
+         {
+            Atomic<unsigned>  _added;
+            Atomic<unsigned>  _removed;
+            char              _pad[NANOS_CACHELINE - 2 * sizeof(Atomic<unsigned>)];
+
+            Shard () : _added( 0 ), _removed( 0 ) {}
+         };
+
+         char              _pad0[NANOS_CACHELINE];  /**< Keeps the shards away from the preceding data */
+         Shard             _shards[MAX_SHARDS];
+
+         static __thread int  _myShard;   /**< Shard of the calling thread plus one, 0 if not assigned yet */
+         static Atomic<int>   _numShards; /**< Number of shard indices handed out so far */
+
+         // disable copy constructor and assignment operator
+         ShardedCounter ( const ShardedCounter & );
+         const ShardedCounter & operator= ( const ShardedCounter & );
+
+         /*! \brief Returns the shard of the calling thread, assigning one on its first call */
+         Shard & myShard ( void );
+         /*! \brief Returns how many shards can hold updates */
+         static int usedShards ( void );
+
+      public:
+         ShardedCounter ( int initial = 0 );
+         ~ShardedCounter () {}
+
+         void operator++ ( void );
+         void operator++ ( int );
+         void operator-- ( void );
+         void operator-- ( int );
+         void operator+= ( int val );
+         void operator-= ( int val );
+
+         /*! \brief Approximate value, see the class description */
+         int value ( void ) const;
+         /*! \brief Linearizable value, see the class description */
+         int exactValue ( void ) const;
+   };
+
+} // namespace nanos
+
+#endif
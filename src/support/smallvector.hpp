@@ -0,0 +1,82 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SMALL_VECTOR
+#define _NANOS_SMALL_VECTOR
+
+#include "smallvector_decl.hpp"
+#include "new_decl.hpp"
+
+namespace nanos {
+
+template <typename T, size_t N>
+inline SmallVector<T,N>::SmallVector ( const SmallVector &sv ) : _data( _inline ), _size( 0 ), _capacity( N )
+{
+   *this = sv;
+}
+
+template <typename T, size_t N>
+inline SmallVector<T,N>::~SmallVector ()
+{
+   if ( _data != _inline ) delete[] _data;
+}
+
+template <typename T, size_t N>
+inline const SmallVector<T,N> & SmallVector<T,N>::operator= ( const SmallVector &sv )
+{
+   if ( this == &sv ) return *this;
+   if ( sv._size > _capacity ) grow( sv._size );
+   for ( size_t i = 0; i < sv._size; i++ ) _data[i] = sv._data[i];
+   _size = sv._size;
+   return *this;
+}
+
+template <typename T, size_t N>
+inline void SmallVector<T,N>::grow ( size_t capacity )
+{
+   T *data = NEW T[capacity];
+   for ( size_t i = 0; i < _size; i++ ) data[i] = _data[i];
+   if ( _data != _inline ) delete[] _data;
+   _data = data;
+   _capacity = capacity;
+}
+
+template <typename T, size_t N>
+inline void SmallVector<T,N>::push_back ( const T &value )
+{
+   if ( _size == _capacity ) grow( 2 * _capacity );
+   _data[_size++] = value;
+}
+
+template <typename T, size_t N>
+inline void SmallVector<T,N>::remove ( const T &value )
+{
+   size_t j = 0;
+   for ( size_t i = 0; i < _size; i++ ) {
+      if ( !( _data[i] == value ) ) {
+         if ( i != j ) _data[j] = _data[i];
+         j++;
+      }
+   }
+   _size = j;
+}
+
+} // namespace nanos
+
+#endif // _NANOS_SMALL_VECTOR
@@ -0,0 +1,77 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_SMALL_VECTOR_DECL
+#define _NANOS_SMALL_VECTOR_DECL
+
+#include <stddef.h>
+
+namespace nanos {
+
+  /*! \class SmallVector
+   *  \brief Sequence that keeps its first N elements inline and only goes to the heap past them
+   *
+   *  Offers the subset of the std::list interface used for short, frequently rebuilt lists
+   *  (e.g. the readers of a TrackableObject). T must be default constructible and assignable.
+   *  Heap storage is kept after clear() so the object can be refilled without allocating.
+   */
+   template <typename T, size_t N>
+   class SmallVector
+   {
+      public:
+         typedef T         value_type;
+         typedef T *       iterator;
+         typedef const T * const_iterator;
+      private:
+         T        _inline[N];  /**< Inline storage for the first N elements */
+         T       *_data;       /**< Current storage: _inline or a heap buffer */
+         size_t   _size;       /**< Number of elements */
+         size_t   _capacity;   /**< Capacity of _data */
+
+         void grow ( size_t capacity );
+      public:
+         SmallVector () : _data( _inline ), _size( 0 ), _capacity( N ) {}
+         SmallVector ( const SmallVector &sv );
+         ~SmallVector ();
+
+         const SmallVector & operator= ( const SmallVector &sv );
+
+         iterator begin () { return _data; }
+         iterator end () { return _data + _size; }
+         const_iterator begin () const { return _data; }
+         const_iterator end () const { return _data + _size; }
+
+         size_t size () const { return _size; }
+         bool empty () const { return _size == 0; }
+
+         T & front () { return _data[0]; }
+         const T & front () const { return _data[0]; }
+
+         void push_back ( const T &value );
+
+        /*! \brief Removes every element equal to value keeping the order of the rest
+         */
+         void remove ( const T &value );
+
+         void clear () { _size = 0; }
+   };
+
+} // namespace nanos
+
+#endif // _NANOS_SMALL_VECTOR_DECL
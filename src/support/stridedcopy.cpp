@@ -0,0 +1,250 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#include "stridedcopy.hpp"
+#include "atomic.hpp"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  if defined(__clang__) || ( defined(__GNUC__) && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) )
+#     define NANOS_STRIDED_COPY_X86
+#     include <immintrin.h>
+#  endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define NANOS_STRIDED_COPY_NEON
+#  include <arm_neon.h>
+#endif
+
+using namespace nanos;
+
+StridedCopy::Kernel StridedCopy::_kernel = NULL;
+char const *StridedCopy::_kernelName = "none";
+
+/* Rows longer than this are left to memcpy, which already moves them at full speed */
+#define MAX_VECTOR_ROW 512
+
+namespace {
+
+template <std::size_t LEN>
+inline void copyFixedRows ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t count )
+{
+   // A constant size lets the compiler expand the memcpy inline
+   for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+      ::memcpy( dst, src, LEN );
+   }
+}
+
+void copyRowsScalar ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+   switch ( len ) {
+      case 4: copyFixedRows<4>( dst, dstLd, src, srcLd, count ); break;
+      case 8: copyFixedRows<8>( dst, dstLd, src, srcLd, count ); break;
+      case 16: copyFixedRows<16>( dst, dstLd, src, srcLd, count ); break;
+      case 32: copyFixedRows<32>( dst, dstLd, src, srcLd, count ); break;
+      default:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            ::memcpy( dst, src, len );
+         }
+   }
+}
+
+#ifdef NANOS_STRIDED_COPY_X86
+
+/* The vector kernels copy every row with full-width accesses; the last access of a row
+ * whose length is not a multiple of the vector width overlaps the previous one.
+ */
+
+__attribute__(( target( "avx2" ) ))
+void copyRowsAVX2 ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+   if ( len < 16 || len > MAX_VECTOR_ROW ) {
+      copyRowsScalar( dst, dstLd, src, srcLd, len, count );
+      return;
+   }
+   switch ( len ) {
+      case 16:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            _mm_storeu_si128( (__m128i *) dst, _mm_loadu_si128( (__m128i const *) src ) );
+         }
+         break;
+      case 32:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            _mm256_storeu_si256( (__m256i *) dst, _mm256_loadu_si256( (__m256i const *) src ) );
+         }
+         break;
+      case 64:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            __m256i a = _mm256_loadu_si256( (__m256i const *) src );
+            __m256i b = _mm256_loadu_si256( (__m256i const *) ( src + 32 ) );
+            _mm256_storeu_si256( (__m256i *) dst, a );
+            _mm256_storeu_si256( (__m256i *) ( dst + 32 ), b );
+         }
+         break;
+      default:
+         if ( len < 32 ) {
+            for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+               __m128i a = _mm_loadu_si128( (__m128i const *) src );
+               __m128i b = _mm_loadu_si128( (__m128i const *) ( src + len - 16 ) );
+               _mm_storeu_si128( (__m128i *) dst, a );
+               _mm_storeu_si128( (__m128i *) ( dst + len - 16 ), b );
+            }
+         } else {
+            for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+               std::size_t j;
+               for ( j = 0; j + 32 < len; j += 32 ) {
+                  _mm256_storeu_si256( (__m256i *) ( dst + j ), _mm256_loadu_si256( (__m256i const *) ( src + j ) ) );
+               }
+               _mm256_storeu_si256( (__m256i *) ( dst + len - 32 ), _mm256_loadu_si256( (__m256i const *) ( src + len - 32 ) ) );
+            }
+         }
+   }
+}
+
+__attribute__(( target( "avx512f" ) ))
+void copyRowsAVX512 ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+   if ( len < 64 || len > MAX_VECTOR_ROW ) {
+      copyRowsAVX2( dst, dstLd, src, srcLd, len, count );
+      return;
+   }
+   if ( len == 64 ) {
+      for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+         _mm512_storeu_si512( (void *) dst, _mm512_loadu_si512( (void const *) src ) );
+      }
+   } else {
+      for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+         std::size_t j;
+         for ( j = 0; j + 64 < len; j += 64 ) {
+            _mm512_storeu_si512( (void *) ( dst + j ), _mm512_loadu_si512( (void const *) ( src + j ) ) );
+         }
+         _mm512_storeu_si512( (void *) ( dst + len - 64 ), _mm512_loadu_si512( (void const *) ( src + len - 64 ) ) );
+      }
+   }
+}
+
+#endif
+
+#ifdef NANOS_STRIDED_COPY_NEON
+
+void copyRowsNEON ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+   if ( len < 16 || len > MAX_VECTOR_ROW ) {
+      copyRowsScalar( dst, dstLd, src, srcLd, len, count );
+      return;
+   }
+   switch ( len ) {
+      case 16:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            vst1q_u8( (uint8_t *) dst, vld1q_u8( (uint8_t const *) src ) );
+         }
+         break;
+      case 32:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            uint8x16_t a = vld1q_u8( (uint8_t const *) src );
+            uint8x16_t b = vld1q_u8( (uint8_t const *) ( src + 16 ) );
+            vst1q_u8( (uint8_t *) dst, a );
+            vst1q_u8( (uint8_t *) ( dst + 16 ), b );
+         }
+         break;
+      default:
+         for ( std::size_t i = 0; i < count; i++, dst += dstLd, src += srcLd ) {
+            std::size_t j;
+            for ( j = 0; j + 16 < len; j += 16 ) {
+               vst1q_u8( (uint8_t *) ( dst + j ), vld1q_u8( (uint8_t const *) ( src + j ) ) );
+            }
+            vst1q_u8( (uint8_t *) ( dst + len - 16 ), vld1q_u8( (uint8_t const *) ( src + len - 16 ) ) );
+         }
+   }
+}
+
+#endif
+
+#if defined(NANOS_STRIDED_COPY_X86) && defined(__SSE2__)
+
+void streamRow ( char *dst, char const *src, std::size_t len )
+{
+   // Align the destination to the vector width, the source may stay unaligned
+   std::size_t head = ( 16 - ( (uintptr_t) dst & 15 ) ) & 15;
+   if ( head > len ) head = len;
+   ::memcpy( dst, src, head );
+   dst += head; src += head; len -= head;
+
+   for ( ; len >= 64; len -= 64, dst += 64, src += 64 ) {
+      __m128i a = _mm_loadu_si128( (__m128i const *) src );
+      __m128i b = _mm_loadu_si128( (__m128i const *) ( src + 16 ) );
+      __m128i c = _mm_loadu_si128( (__m128i const *) ( src + 32 ) );
+      __m128i d = _mm_loadu_si128( (__m128i const *) ( src + 48 ) );
+      _mm_stream_si128( (__m128i *) dst, a );
+      _mm_stream_si128( (__m128i *) ( dst + 16 ), b );
+      _mm_stream_si128( (__m128i *) ( dst + 32 ), c );
+      _mm_stream_si128( (__m128i *) ( dst + 48 ), d );
+   }
+   for ( ; len >= 16; len -= 16, dst += 16, src += 16 ) {
+      _mm_stream_si128( (__m128i *) dst, _mm_loadu_si128( (__m128i const *) src ) );
+   }
+   ::memcpy( dst, src, len );
+}
+
+#endif
+
+} // namespace
+
+void StridedCopy::copyStreaming ( void *dst, std::size_t dstLd, void const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+#if defined(NANOS_STRIDED_COPY_X86) && defined(__SSE2__)
+   if ( count == 1 || ( dstLd == len && srcLd == len ) ) {
+      streamRow( (char *) dst, (char const *) src, len * count );
+   } else {
+      char *d = (char *) dst;
+      char const *s = (char const *) src;
+      for ( std::size_t i = 0; i < count; i++, d += dstLd, s += srcLd ) {
+         streamRow( d, s, len );
+      }
+   }
+   // Streaming stores are weakly ordered, make them visible before reporting the copy done
+   _mm_sfence();
+#else
+   copy( dst, dstLd, src, srcLd, len, count );
+#endif
+}
+
+void StridedCopy::selectKernel ()
+{
+   Kernel kernel = copyRowsScalar;
+   char const *name = "memcpy";
+
+#if defined(NANOS_STRIDED_COPY_X86)
+   __builtin_cpu_init();
+   if ( __builtin_cpu_supports( "avx512f" ) ) {
+      kernel = copyRowsAVX512;
+      name = "avx512";
+   } else if ( __builtin_cpu_supports( "avx2" ) ) {
+      kernel = copyRowsAVX2;
+      name = "avx2";
+   }
+#elif defined(NANOS_STRIDED_COPY_NEON)
+   kernel = copyRowsNEON;
+   name = "neon";
+#endif
+
+   // Concurrent callers select the same kernel, publish the name before the kernel
+   _kernelName = name;
+   memoryFence();
+   _kernel = kernel;
+}
@@ -0,0 +1,56 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_STRIDED_COPY
+#define _NANOS_STRIDED_COPY
+
+#include <string.h>
+#include "stridedcopy_decl.hpp"
+
+namespace nanos {
+
+inline void StridedCopy::copy ( void *dst, std::size_t dstLd, void const *src, std::size_t srcLd, std::size_t len, std::size_t count )
+{
+   if ( count == 1 || ( dstLd == len && srcLd == len ) ) {
+      ::memcpy( dst, src, len * count );
+      return;
+   }
+   if ( _kernel == NULL ) selectKernel();
+   _kernel( (char *) dst, dstLd, (char const *) src, srcLd, len, count );
+}
+
+inline void StridedCopy::pack ( void *dst, void const *src, std::size_t len, std::size_t count, std::size_t ld )
+{
+   copy( dst, len, src, ld, len, count );
+}
+
+inline void StridedCopy::unpack ( void *dst, void const *src, std::size_t len, std::size_t count, std::size_t ld )
+{
+   copy( dst, ld, src, len, len, count );
+}
+
+inline char const *StridedCopy::getKernelName ()
+{
+   if ( _kernel == NULL ) selectKernel();
+   return _kernelName;
+}
+
+} // namespace nanos
+
+#endif
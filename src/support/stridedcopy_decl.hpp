@@ -0,0 +1,82 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+#ifndef _NANOS_STRIDED_COPY_DECL
+#define _NANOS_STRIDED_COPY_DECL
+
+#include <cstddef>
+
+namespace nanos {
+
+   /*! \class StridedCopy
+    *  \brief Row copy kernels used to pack, unpack and move 1D strided regions.
+    *
+    *  Every operation copies \a count rows of \a len bytes, the rows of the source being
+    *  \a srcLd bytes apart and the rows of the destination \a dstLd bytes apart. Packing
+    *  is the case dstLd == len and unpacking the case srcLd == len.
+    *
+    *  The kernel is chosen the first time it is used, depending on the instruction set of
+    *  the running processor (AVX-512, AVX2, NEON or plain memcpy). Vector kernels have
+    *  special cases for the row lengths that appear in tiled algorithms (8 to 64 bytes),
+    *  where calling memcpy once per row costs more than the copy itself.
+    */
+   class StridedCopy
+   {
+      public:
+         typedef void ( *Kernel ) ( char *dst, std::size_t dstLd, char const *src, std::size_t srcLd, std::size_t len, std::size_t count );
+
+      private:
+         static Kernel        _kernel;     /**< Kernel in use, NULL until it has been selected */
+         static char const   *_kernelName; /**< Name of the kernel in use */
+
+         static void selectKernel ();
+
+         /*! \brief StridedCopy default constructor (disabled)
+          */
+         StridedCopy ();
+
+      public:
+         /*! \brief Copies \a count rows of \a len bytes between two strided regions
+          */
+         static void copy ( void *dst, std::size_t dstLd, void const *src, std::size_t srcLd, std::size_t len, std::size_t count );
+
+         /*! \brief Gathers \a count rows of \a len bytes, \a ld bytes apart, into the contiguous buffer \a dst
+          */
+         static void pack ( void *dst, void const *src, std::size_t len, std::size_t count, std::size_t ld );
+
+         /*! \brief Scatters the contiguous buffer \a src into \a count rows of \a len bytes, \a ld bytes apart
+          */
+         static void unpack ( void *dst, void const *src, std::size_t len, std::size_t count, std::size_t ld );
+
+         /*! \brief Same as copy(), but the destination is written with non-temporal stores
+          *
+          *  Meant for copies larger than the last level cache, that would only evict useful
+          *  data from it. The stores are fenced before returning. Falls back to copy() on
+          *  processors without streaming stores.
+          */
+         static void copyStreaming ( void *dst, std::size_t dstLd, void const *src, std::size_t srcLd, std::size_t len, std::size_t count );
+
+         /*! \brief Returns the name of the kernel selected for this processor
+          */
+         static char const *getKernelName ();
+   };
+
+} // namespace nanos
+
+#endif
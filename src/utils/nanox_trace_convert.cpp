@@ -0,0 +1,413 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*! \file nanox_trace_convert.cpp
+ *  \brief Converts the binary traces written by the ring_trace instrumentation plugin
+ *
+ *  Usage: nanox-trace-convert [--paraver|--chrome] <prefix>.<pid>.trace [output prefix]
+ *
+ *  Paraver output (<output>.prv, .pcf and .row) uses the same event types as the extrae plugin,
+ *  so existing configuration files can be used with it. Chrome output (<output>.json) can be
+ *  loaded in chrome://tracing or Perfetto.
+ */
+
+#include "nanos-int.h"
+#include "ring_trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+using namespace nanos::ext;
+
+namespace {
+
+   const unsigned long long _eventState    = 9000000;   /*!< Paraver type of state changes */
+   const unsigned long long _eventSubState = 9000004;   /*!< Paraver type of sub-state changes */
+   const unsigned long long _eventBase     = 9200000;   /*!< Paraver type base of key/value events */
+
+   const char *_stateNames[NANOS_EVENT_STATE_TYPES] = { "NOT CREATED", "NOT RUNNING",
+      "STARTUP", "SHUTDOWN", "ERROR", "IDLE",
+      "RUNTIME", "RUNNING", "SYNCHRONIZATION", "SCHEDULING", "CREATION",
+      "DATA TRANSFER ISSUE", "CACHE ALLOC/FREE", "YIELD", "ACQUIRING LOCK", "CONTEXT SWITCH",
+      "FILL COLOR", "WAKING UP", "STOPPED", "SYNCED RUNNING", "DEBUG" };
+
+   struct KeyInfo
+   {
+      std::string                                 name;
+      std::string                                 description;
+      std::map<unsigned long long, std::string>   values;
+   };
+
+   typedef std::map<unsigned, KeyInfo>            Dictionary;
+   typedef std::vector<RingTraceRecord>           RecordList;
+   typedef std::map<unsigned, unsigned>           ThreadMap;     /**< Runtime thread id -> trace thread (1..N) */
+
+   //! \brief Point to point communication (PTP_START/PTP_END records with the same domain and id)
+   struct Communication
+   {
+      const RingTraceRecord *send;
+      const RingTraceRecord *recv;
+   };
+
+   bool recordTimeLess ( const RingTraceRecord &a, const RingTraceRecord &b ) { return a.time < b.time; }
+   bool communicationLess ( const Communication &a, const Communication &b ) { return a.send->time < b.send->time; }
+
+   const char * stateName ( unsigned long long state )
+   {
+      return state < NANOS_EVENT_STATE_TYPES ? _stateNames[state] : "UNKNOWN";
+   }
+
+   bool readTrace ( const std::string &fileName, RecordList &records )
+   {
+      FILE *file = fopen( fileName.c_str(), "rb" );
+      if ( file == NULL ) {
+         std::cerr << "Cannot open " << fileName << std::endl;
+         return false;
+      }
+
+      RingTraceHeader header;
+      if ( fread( &header, sizeof( header ), 1, file ) != 1 ||
+           memcmp( header.magic, NANOS_RING_TRACE_MAGIC, sizeof( header.magic ) ) != 0 ) {
+         std::cerr << fileName << " is not a ring trace" << std::endl;
+         fclose( file );
+         return false;
+      }
+      if ( header.recordSize != sizeof( RingTraceRecord ) ) {
+         std::cerr << fileName << " has records of " << header.recordSize << " bytes, expected "
+                   << sizeof( RingTraceRecord ) << std::endl;
+         fclose( file );
+         return false;
+      }
+
+      RingTraceRecord record;
+      while ( fread( &record, sizeof( record ), 1, file ) == 1 ) {
+         records.push_back( record );
+      }
+      fclose( file );
+
+      // Records of every thread are already sorted, a stable sort keeps them in order
+      std::stable_sort( records.begin(), records.end(), recordTimeLess );
+      return true;
+   }
+
+   void readDictionary ( const std::string &fileName, Dictionary &dict )
+   {
+      std::ifstream file( fileName.c_str() );
+      if ( !file ) {
+         std::cerr << "Warning: cannot open " << fileName << ", events will not be named" << std::endl;
+         return;
+      }
+
+      std::string line;
+      while ( std::getline( file, line ) ) {
+         std::istringstream in( line );
+         std::string kind;
+         unsigned key;
+         in >> kind >> key;
+         if ( kind == "key" ) {
+            KeyInfo &info = dict[key];
+            in >> info.name;
+            std::getline( in >> std::ws, info.description );
+         } else if ( kind == "value" ) {
+            unsigned long long value;
+            in >> value;
+            std::getline( in >> std::ws, dict[key].values[value] );
+         }
+      }
+   }
+
+   void matchCommunications ( const RecordList &records, std::vector<Communication> &comms )
+   {
+      typedef std::map<std::pair<unsigned, unsigned long long>, const RingTraceRecord *> Pending;
+      Pending sends, recvs;
+
+      for ( RecordList::const_iterator it = records.begin(); it != records.end(); ++it ) {
+         if ( it->type != NANOS_PTP_START && it->type != NANOS_PTP_END ) continue;
+
+         std::pair<unsigned, unsigned long long> id( it->domain, it->value );
+         bool isSend = it->type == NANOS_PTP_START;
+         Pending &others = isSend ? recvs : sends;
+         Pending::iterator other = others.find( id );
+         if ( other != others.end() ) {
+            Communication comm;
+            comm.send = isSend ? &*it : other->second;
+            comm.recv = isSend ? other->second : &*it;
+            comms.push_back( comm );
+            others.erase( other );
+         } else {
+            ( isSend ? sends : recvs )[id] = &*it;
+         }
+      }
+      std::sort( comms.begin(), comms.end(), communicationLess );
+   }
+
+   std::string jsonEscape ( const std::string &str )
+   {
+      std::string out;
+      for ( std::string::const_iterator it = str.begin(); it != str.end(); ++it ) {
+         if ( *it == '"' || *it == '\\' ) out += '\\';
+         if ( ( unsigned char ) *it < 0x20 ) out += ' ';
+         else out += *it;
+      }
+      return out;
+   }
+
+   std::string keyName ( const Dictionary &dict, unsigned key )
+   {
+      Dictionary::const_iterator it = dict.find( key );
+      if ( it == dict.end() ) {
+         std::ostringstream name;
+         name << "key " << key;
+         return name.str();
+      }
+      return it->second.description.empty() ? it->second.name : it->second.description;
+   }
+
+   std::string valueName ( const Dictionary &dict, unsigned key, unsigned long long value )
+   {
+      Dictionary::const_iterator it = dict.find( key );
+      if ( it != dict.end() ) {
+         std::map<unsigned long long, std::string>::const_iterator itV = it->second.values.find( value );
+         if ( itV != it->second.values.end() ) return itV->second;
+      }
+      std::ostringstream name;
+      name << value;
+      return name.str();
+   }
+
+   /*! \brief Writes <output>.prv, <output>.pcf and <output>.row
+    */
+   bool writeParaver ( const std::string &output, const RecordList &records, const Dictionary &dict, ThreadMap &threads )
+   {
+      std::ofstream prv( ( output + ".prv" ).c_str() );
+      if ( !prv ) {
+         std::cerr << "Cannot create " << output << ".prv" << std::endl;
+         return false;
+      }
+
+      unsigned nthreads = threads.size();
+      unsigned long long endTime = records.empty() ? 0 : records.back().time;
+
+      char date[64];
+      time_t now = time( NULL );
+      strftime( date, sizeof( date ), "%d/%m/%y at %H:%M", localtime( &now ) );
+      prv << "#Paraver (" << date << "):" << endTime << "_ns:1(" << nthreads << "):1:1(" << nthreads << ":1)" << std::endl;
+
+      std::vector<Communication> comms;
+      matchCommunications( records, comms );
+      std::vector<Communication>::const_iterator comm = comms.begin();
+
+      RecordList::const_iterator it = records.begin();
+      while ( it != records.end() ) {
+         // Communications are sorted by send time, as every other record
+         for ( ; comm != comms.end() && comm->send->time <= it->time; ++comm ) {
+            unsigned s = threads[comm->send->thread], r = threads[comm->recv->thread];
+            prv << "3:" << s << ":1:1:" << s << ":" << comm->send->time << ":" << comm->send->time
+                << ":" << r << ":1:1:" << r << ":" << comm->recv->time << ":" << comm->recv->time
+                << ":" << comm->send->value << ":" << ( unsigned ) comm->send->domain << std::endl;
+         }
+
+         // Events of the same thread at the same time go in one line
+         unsigned thread = threads[it->thread];
+         unsigned long long time = it->time;
+         std::ostringstream line;
+         for ( ; it != records.end() && it->time == time && threads[it->thread] == thread; ++it ) {
+            switch ( it->type ) {
+               case NANOS_STATE_START:    line << ":" << _eventState << ":" << it->value; break;
+               case NANOS_STATE_END:      line << ":" << _eventState << ":0"; break;
+               case NANOS_SUBSTATE_START: line << ":" << _eventSubState << ":" << it->value; break;
+               case NANOS_SUBSTATE_END:   line << ":" << _eventSubState << ":0"; break;
+               case NANOS_POINT:
+               case NANOS_BURST_START:    line << ":" << _eventBase + it->key << ":" << it->value; break;
+               case NANOS_BURST_END:      line << ":" << _eventBase + it->key << ":0"; break;
+               default: break;
+            }
+         }
+         if ( !line.str().empty() ) {
+            prv << "2:" << thread << ":1:1:" << thread << ":" << time << line.str() << std::endl;
+         }
+      }
+
+      std::ofstream pcf( ( output + ".pcf" ).c_str() );
+      pcf << "DEFAULT_OPTIONS" << std::endl << std::endl
+          << "LEVEL               THREAD" << std::endl
+          << "UNITS               NANOSEC" << std::endl
+          << "LOOK_BACK           100" << std::endl
+          << "SPEED               1" << std::endl
+          << "FLAG_ICONS          ENABLED" << std::endl
+          << "NUM_OF_STATE_COLORS 1000" << std::endl
+          << "YMAX_SCALE          37" << std::endl << std::endl << std::endl
+          << "DEFAULT_SEMANTIC" << std::endl << std::endl
+          << "THREAD_FUNC          State As Is" << std::endl << std::endl << std::endl;
+
+      const unsigned long long stateTypes[2] = { _eventState, _eventSubState };
+      const char *stateDescriptions[2] = { "Thread state: ", "Thread sub-state" };
+      for ( unsigned t = 0; t < 2; t++ ) {
+         pcf << "EVENT_TYPE" << std::endl << "0    " << stateTypes[t] << "    " << stateDescriptions[t] << std::endl << "VALUES" << std::endl;
+         for ( unsigned s = 0; s < NANOS_EVENT_STATE_TYPES; s++ ) {
+            pcf << s << "      " << _stateNames[s] << std::endl;
+         }
+         pcf << std::endl << std::endl;
+      }
+      for ( Dictionary::const_iterator itK = dict.begin(); itK != dict.end(); ++itK ) {
+         pcf << "EVENT_TYPE" << std::endl << "0    " << _eventBase + itK->first << "    " << keyName( dict, itK->first ) << std::endl;
+         if ( !itK->second.values.empty() ) {
+            pcf << "VALUES" << std::endl;
+            std::map<unsigned long long, std::string>::const_iterator itV;
+            for ( itV = itK->second.values.begin(); itV != itK->second.values.end(); ++itV ) {
+               pcf << itV->first << "      " << itV->second << std::endl;
+            }
+         }
+         pcf << std::endl << std::endl;
+      }
+
+      std::ofstream row( ( output + ".row" ).c_str() );
+      row << "LEVEL CPU SIZE " << nthreads << std::endl;
+      for ( ThreadMap::const_iterator itT = threads.begin(); itT != threads.end(); ++itT ) {
+         row << "CPU " << itT->second << std::endl;
+      }
+      row << std::endl << "LEVEL THREAD SIZE " << nthreads << std::endl;
+      for ( ThreadMap::const_iterator itT = threads.begin(); itT != threads.end(); ++itT ) {
+         if ( itT->first == NANOS_RING_TRACE_NO_THREAD ) row << "THREAD 1.1." << itT->second << " (external)" << std::endl;
+         else row << "THREAD 1.1." << itT->second << " (nanox thread " << itT->first << ")" << std::endl;
+      }
+
+      return prv && pcf && row;
+   }
+
+   /*! \brief Writes <output>.json in the Chrome trace event format
+    */
+   bool writeChrome ( const std::string &output, const RecordList &records, const Dictionary &dict, ThreadMap &threads )
+   {
+      std::ofstream json( ( output + ".json" ).c_str() );
+      if ( !json ) {
+         std::cerr << "Cannot create " << output << ".json" << std::endl;
+         return false;
+      }
+
+      json << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << std::endl;
+      json << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"nanox\"}}";
+      for ( ThreadMap::const_iterator itT = threads.begin(); itT != threads.end(); ++itT ) {
+         json << "," << std::endl << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << itT->second
+              << ",\"args\":{\"name\":\"";
+         if ( itT->first == NANOS_RING_TRACE_NO_THREAD ) json << "external";
+         else json << "thread " << itT->first;
+         json << "\"}}";
+      }
+
+      char ts[32];
+      for ( RecordList::const_iterator it = records.begin(); it != records.end(); ++it ) {
+         const char *ph;
+         std::string name, cat, args;
+         switch ( it->type ) {
+            case NANOS_STATE_START:    ph = "B"; cat = "state"; name = stateName( it->value ); break;
+            case NANOS_STATE_END:      ph = "E"; cat = "state"; name = stateName( it->value ); break;
+            case NANOS_SUBSTATE_START: ph = "B"; cat = "substate"; name = stateName( it->value ); break;
+            case NANOS_SUBSTATE_END:   ph = "E"; cat = "substate"; name = stateName( it->value ); break;
+            case NANOS_BURST_START:
+            case NANOS_BURST_END:
+            case NANOS_POINT:
+               ph = it->type == NANOS_BURST_START ? "B" : ( it->type == NANOS_BURST_END ? "E" : "i" );
+               cat = "event";
+               name = keyName( dict, it->key );
+               if ( it->type != NANOS_BURST_END ) {
+                  args = ",\"args\":{\"value\":\"" + jsonEscape( valueName( dict, it->key, it->value ) ) + "\"}";
+               }
+               if ( it->type == NANOS_POINT ) args += ",\"s\":\"t\"";
+               break;
+            case NANOS_PTP_START:
+            case NANOS_PTP_END: {
+               std::ostringstream id;
+               id << ",\"id\":\"" << ( unsigned ) it->domain << "-" << it->value << "\",\"bp\":\"e\"";
+               ph = it->type == NANOS_PTP_START ? "s" : "f";
+               cat = "ptp";
+               name = "communication";
+               args = id.str();
+               break;
+            }
+            default:
+               continue;
+         }
+         snprintf( ts, sizeof( ts ), "%llu.%03llu", ( unsigned long long ) it->time / 1000, ( unsigned long long ) it->time % 1000 );
+         json << "," << std::endl << "{\"name\":\"" << jsonEscape( name ) << "\",\"cat\":\"" << cat << "\",\"ph\":\"" << ph
+              << "\",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << threads[it->thread] << args << "}";
+      }
+      json << std::endl << "]}" << std::endl;
+
+      return json;
+   }
+
+   void usage ( const char *program )
+   {
+      std::cerr << "Usage: " << program << " [--paraver|--chrome] <prefix>.<pid>.trace [output prefix]" << std::endl;
+   }
+
+} // namespace
+
+int main ( int argc, char **argv )
+{
+   bool chrome = false;
+   int arg = 1;
+   if ( arg < argc && argv[arg][0] == '-' ) {
+      if ( strcmp( argv[arg], "--chrome" ) == 0 ) chrome = true;
+      else if ( strcmp( argv[arg], "--paraver" ) != 0 ) {
+         usage( argv[0] );
+         return 1;
+      }
+      arg++;
+   }
+   if ( arg >= argc || argc - arg > 2 ) {
+      usage( argv[0] );
+      return 1;
+   }
+
+   std::string traceName = argv[arg];
+   std::string base = traceName;
+   const std::string suffix = ".trace";
+   if ( base.size() > suffix.size() && base.compare( base.size() - suffix.size(), suffix.size(), suffix ) == 0 ) {
+      base.erase( base.size() - suffix.size() );
+   }
+   std::string output = arg + 1 < argc ? argv[arg + 1] : base;
+
+   RecordList records;
+   if ( !readTrace( traceName, records ) ) return 1;
+
+   Dictionary dict;
+   readDictionary( base + ".dict", dict );
+
+   ThreadMap threads;
+   for ( RecordList::const_iterator it = records.begin(); it != records.end(); ++it ) {
+      threads.insert( std::make_pair( ( unsigned ) it->thread, 0U ) );
+   }
+   unsigned index = 0;
+   for ( ThreadMap::iterator it = threads.begin(); it != threads.end(); ++it ) {
+      it->second = ++index;
+   }
+
+   bool ok = chrome ? writeChrome( output, records, dict, threads ) : writeParaver( output, records, dict, threads );
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator=gens/cluster-shm-generator
+exec_versions="presend aggregated"
+
+declare test_ENV_presend="NX_CLUSTER_SMP_PRESEND=256"
+declare test_ENV_aggregated="NX_CLUSTER_SMP_PRESEND=1024 NX_CLUSTER_AGGREGATION=yes NX_CLUSTER_AGGREGATION_SIZE=65536"
+
+</testinfo>
+*/
+
+/* Floods the shared memory rings in both directions: the master keeps sending
+ * work and data to the remote node (in 64KB batches in the second version, which
+ * fill the ring) while the remote node sends back the work done notifications
+ * and the data of the previous tasks. Neither side may stop draining its own
+ * rings while it waits for space in a full one.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <nanos.h>
+
+#define BLOCK   1024
+#define NBLOCKS 2048
+#define ROUNDS  4
+
+typedef struct {
+   int *v;
+   int round;
+} my_args;
+
+void bump( void *ptr );
+void bump( void *ptr )
+{
+   my_args *args = (my_args *) ptr;
+   int *v;
+   int i;
+   nanos_get_addr( 0, (void **) &v, nanos_current_wd() );
+   for ( i = 0; i < BLOCK; i++ )
+      v[i] += args->round;
+}
+
+nanos_smp_args_t bump_device_arg = { bump };
+
+struct nanos_const_wd_definition_1
+{
+     nanos_const_wd_definition_t base;
+     nanos_device_t devices[1];
+};
+
+struct nanos_const_wd_definition_1 const_data =
+{
+   {{
+      .mandatory_creation = true,
+      .tied = false},
+   __alignof__(my_args),
+   1,
+   1,
+   1,NULL},
+   {
+      {
+         nanos_smp_factory,
+         &bump_device_arg
+      }
+   }
+};
+
+int main ( int argc, char **argv )
+{
+   int *data;
+   int block, round, i;
+
+   /* the remote node serves tasks from here until the master finishes */
+   ompss_nanox_main_begin( (void *) main, __FILE__, __LINE__ );
+
+   data = (int *) malloc( sizeof(int) * BLOCK * NBLOCKS );
+   for ( i = 0; i < BLOCK * NBLOCKS; i++ )
+      data[i] = i;
+
+   for ( round = 1; round <= ROUNDS; round++ ) {
+      for ( block = 0; block < NBLOCKS; block++ ) {
+         nanos_wd_t wd = 0;
+         nanos_wd_dyn_props_t dyn_props = {0};
+         my_args *args = 0;
+         nanos_copy_data_t *cd = 0;
+         nanos_region_dimension_internal_t *dims = 0;
+         NANOS_SAFE( nanos_create_wd_compact( &wd, &const_data.base, &dyn_props, sizeof(my_args), (void **) &args, nanos_current_wd(), &cd, &dims ) );
+         args->v = &data[block * BLOCK];
+         args->round = round;
+         dims[0] = (nanos_region_dimension_internal_t) {sizeof(int) * BLOCK, 0, sizeof(int) * BLOCK};
+         cd[0] = (nanos_copy_data_t) {(void *) args->v, NANOS_SHARED, {true, true}, 1, &dims[0], 0};
+         NANOS_SAFE( nanos_submit( wd, 0, 0, 0 ) );
+      }
+      NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+   }
+
+   for ( i = 0; i < BLOCK * NBLOCKS; i++ ) {
+      if ( data[i] != i + ROUNDS * ( ROUNDS + 1 ) / 2 ) {
+         printf( "Checking element %d: %d instead of %d  FAIL\n", i, data[i], i + ROUNDS * ( ROUNDS + 1 ) / 2 );
+         return 1;
+      }
+   }
+   printf( "Checking the flooded copies ...  PASS\n" );
+   free( data );
+   ompss_nanox_main_end();
+   return 0;
+}
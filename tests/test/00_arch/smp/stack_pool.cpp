@@ -0,0 +1,105 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator='gens/core-generator -a --smp-stack-pool|--smp-stack-pool-hot=0|--no-smp-stack-pool'
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include <stdio.h>
+#include <string.h>
+#include "smpprocessor.hpp"
+#include "system.hpp"
+
+using namespace nanos;
+using namespace nanos::ext;
+
+#define DEPTH        6
+#define FANOUT       3
+#define FRAME_SIZE   (32*1024)
+
+// Every task fills part of its stack, blocks waiting for its children (which then run on
+// other stacks of the pools) and checks that nobody else wrote on its stack meanwhile.
+
+typedef struct {
+   int depth;
+   int id;
+} tree_args_t;
+
+Atomic<int> errors( 0 );
+Atomic<int> tasks( 0 );
+
+void tree ( void *args );
+
+static void spawn ( int depth, int id )
+{
+   // The WD keeps a pointer to its data, which the task frees
+   tree_args_t *args = new tree_args_t;
+   args->depth = depth;
+   args->id = id;
+   WD *wd = new WD( new SMPDD( tree ), sizeof( tree_args_t ), __alignof__( tree_args_t ), ( void * ) args );
+   WD *wg = getMyThreadSafe()->getCurrentWD();
+   wg->addWork( *wd );
+   sys.submit( *wd );
+}
+
+void tree ( void *args )
+{
+   tree_args_t *targs = ( tree_args_t * ) args;
+   int depth = targs->depth;
+   int id = targs->id;
+   delete targs;
+   volatile unsigned char frame[FRAME_SIZE];
+
+   memset( ( void * ) frame, id & 0xff, FRAME_SIZE );
+   tasks++;
+
+   if ( depth > 0 ) {
+      for ( int i = 0; i < FANOUT; i++ ) spawn( depth - 1, id * FANOUT + i + 1 );
+      getMyThreadSafe()->getCurrentWD()->waitCompletion();
+   }
+
+   for ( int i = 0; i < FRAME_SIZE; i++ ) {
+      if ( frame[i] != ( id & 0xff ) ) {
+         errors++;
+         break;
+      }
+   }
+}
+
+int main ( int argc, char **argv )
+{
+   int expected = 0;
+   for ( int d = 0, n = 1; d <= DEPTH; d++, n *= FANOUT ) expected += n;
+
+   spawn( DEPTH, 0 );
+   getMyThreadSafe()->getCurrentWD()->waitCompletion();
+
+   if ( errors.value() == 0 && tasks.value() == expected ) {
+      fprintf( stderr, "%s : %s\n", argv[0], "successful" );
+      return 0;
+   }
+
+   fprintf( stderr, "%s : %s (%d tasks, %d corrupted stacks)\n", argv[0], "unsuccessful",
+            tasks.value(), errors.value() );
+   return -1;
+}
@@ -0,0 +1,108 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Allocator micro-benchmark. Measures the number of allocations per
+ * second of a single thread Allocator (compared with the system malloc/free) using
+ * two access patterns: allocate/deallocate pairs and batches of allocations
+ * followed by their deallocations.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator"
+</testinfo>*/
+
+#include <iostream>
+#include <cstdio>
+#include <sys/time.h>
+#include "allocator.hpp"
+
+using namespace nanos;
+
+#define TIMES 200000
+#define BATCH 512
+
+int sizes[] = { 7, 17, 33, 63, 123 };
+void *ptrs[BATCH];
+
+static double get_secs ( void )
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return tv.tv_sec + tv.tv_usec * 1.0e-6;
+}
+
+static void print_rate ( const char *name, size_t allocations, double secs )
+{
+   fprintf( stdout, "%-30s %12.0f allocations/s\n", name, secs > 0.0 ? allocations / secs : 0.0 );
+}
+
+int main (int argc, char **argv)
+{
+   const unsigned int num_sizes = sizeof( sizes )/sizeof(int);
+   Allocator my_allocator;
+   double t;
+
+   // Allocate/deallocate pairs
+   t = get_secs();
+   for ( int n = 0; n < TIMES; n++ ) {
+      for ( unsigned int i = 0; i < num_sizes; i++ ) {
+         void *ptr = my_allocator.allocate( sizes[i] * sizeof(int) );
+         if ( ptr == NULL ) return -1;
+         *((int *) ptr) = n;
+         Allocator::deallocate( ptr );
+      }
+   }
+   print_rate( "Allocator (pairs)", (size_t) TIMES * num_sizes, get_secs() - t );
+
+   t = get_secs();
+   for ( int n = 0; n < TIMES; n++ ) {
+      for ( unsigned int i = 0; i < num_sizes; i++ ) {
+         void *ptr = malloc( sizes[i] * sizeof(int) );
+         if ( ptr == NULL ) return -1;
+         *((int *) ptr) = n;
+         free( ptr );
+      }
+   }
+   print_rate( "malloc (pairs)", (size_t) TIMES * num_sizes, get_secs() - t );
+
+   // Batches of allocations followed by their deallocations
+   t = get_secs();
+   for ( int n = 0; n < TIMES / BATCH; n++ ) {
+      for ( unsigned int i = 0; i < BATCH; i++ ) {
+         ptrs[i] = my_allocator.allocate( sizes[i%num_sizes] * sizeof(int) );
+         if ( ptrs[i] == NULL ) return -1;
+         *((int *) ptrs[i]) = n;
+      }
+      for ( unsigned int i = 0; i < BATCH; i++ ) Allocator::deallocate( ptrs[i] );
+   }
+   print_rate( "Allocator (batches)", (size_t) ( TIMES / BATCH ) * BATCH, get_secs() - t );
+
+   t = get_secs();
+   for ( int n = 0; n < TIMES / BATCH; n++ ) {
+      for ( unsigned int i = 0; i < BATCH; i++ ) {
+         ptrs[i] = malloc( sizes[i%num_sizes] * sizeof(int) );
+         if ( ptrs[i] == NULL ) return -1;
+         *((int *) ptrs[i]) = n;
+      }
+      for ( unsigned int i = 0; i < BATCH; i++ ) free( ptrs[i] );
+   }
+   print_rate( "malloc (batches)", (size_t) ( TIMES / BATCH ) * BATCH, get_secs() - t );
+
+   return 0;
+}
@@ -0,0 +1,100 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checking Allocator local vs. remote frees accounting. Half of the
+ * objects are deallocated by the thread which allocated them, the other half by
+ * another thread (through the owner's remote-free mailbox).
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator -a \"--gpus=0\""
+</testinfo>*/
+
+#include <iostream>
+#include <string.h>
+#include "config.hpp"
+#include "smpprocessor.hpp"
+#include "system.hpp"
+#include "allocator.hpp"
+
+using namespace std;
+using namespace nanos;
+using namespace nanos::ext;
+
+#define NUM_OBJECTS 1000
+
+int sizes[] = { 7, 17, 33, 63, 123 };
+void *ptrs[NUM_OBJECTS];
+bool check = true;
+
+void allocate( void *args );
+void deallocate ( void *args );
+
+void deallocate ( void *args )
+{
+   for ( int i = 0; i < NUM_OBJECTS; i += 2 ) {
+      Allocator::deallocate( ptrs[i] );
+   }
+}
+
+void allocate( void *args )
+{
+   int num_pes = sys.getSMPPlugin()->getNumWorkers();
+   Allocator allocator;
+   WD *wg = getMyThreadSafe()->getCurrentWD();
+
+   for ( int i = 0; i < NUM_OBJECTS; i++ ) {
+      ptrs[i] = allocator.allocate( sizes[i%5] * sizeof(int) );
+      if ( ptrs[i] == NULL ) check = false;
+   }
+
+   // Odd objects are released by the owner thread
+   for ( int i = 1; i < NUM_OBJECTS; i += 2 ) {
+      Allocator::deallocate( ptrs[i] );
+   }
+
+   // Even objects are released by another thread (if any)
+   ThreadTeam &team = *getMyThreadSafe()->getTeam();
+   WD * wd = new WD( new SMPDD( deallocate ), 0, 1, NULL );
+   wg->addWork( *wd );
+   wd->tieTo( team[num_pes > 1 ? 1 : 0] );
+   sys.submit( *wd );
+   wg->waitCompletion();
+
+   // Next allocation drains the mailbox
+   Allocator::deallocate( allocator.allocate( sizeof(int) ) );
+
+   size_t remote = num_pes > 1 ? NUM_OBJECTS / 2 : 0;
+   if ( allocator.getRemoteFrees() != remote ) check = false;
+   if ( allocator.getLocalFrees() != NUM_OBJECTS + 1 - remote ) check = false;
+}
+
+int main ( int argc, char **argv )
+{
+   WD *wg = getMyThreadSafe()->getCurrentWD();
+   ThreadTeam &team = *getMyThreadSafe()->getTeam();
+
+   WD * wd = new WD( new SMPDD( allocate ), 0, 1, NULL );
+   wg->addWork( *wd );
+   wd->tieTo( team[0] );
+   sys.submit( *wd );
+   wg->waitCompletion();
+
+   if (check) { return 0; } else { return -1; }
+}
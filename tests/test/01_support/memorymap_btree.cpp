@@ -0,0 +1,200 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checks the B+tree behind MemoryMap against std::map with random inserts,
+ * erases and in-place key rewrites, checks the overlap queries of MemoryMap and times the
+ * lookups on a map with many chunks.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator"
+</testinfo>*/
+
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "memorymap.hpp"
+
+using namespace nanos;
+
+typedef BTreeMap<long, long> Tree;
+typedef std::map<long, long> Reference;
+typedef MemoryMap<int> IntMap;
+
+static bool same ( Tree &tree, Reference &ref )
+{
+   if ( tree.size() != ref.size() ) return false;
+   Tree::iterator it = tree.begin();
+   for ( Reference::iterator rit = ref.begin(); rit != ref.end(); rit++, it++ ) {
+      if ( it == tree.end() || it->first != rit->first || it->second != rit->second ) return false;
+   }
+   if ( it != tree.end() ) return false;
+   if ( !ref.empty() ) {
+      Tree::iterator last = tree.end();
+      last--;
+      if ( last->first != ref.rbegin()->first ) return false;
+   }
+   return true;
+}
+
+static bool checkTree ()
+{
+   Tree tree;
+   Reference ref;
+   long range = 20000;
+
+   for ( int i = 0; i < 200000; i++ ) {
+      long key = rand() % range;
+      switch ( rand() % 6 ) {
+         case 0:
+         case 1:
+            if ( tree.insert( Tree::value_type( key, i ) ).second != ref.insert( Reference::value_type( key, i ) ).second ) return false;
+            break;
+         case 2:
+            tree.insert( tree.lower_bound( rand() % range ), Tree::value_type( key, i ) );
+            ref.insert( Reference::value_type( key, i ) );
+            break;
+         case 3:
+            if ( tree.erase( key ) != ref.erase( key ) ) return false;
+            break;
+         case 4:
+         {
+            Tree::iterator it = tree.lower_bound( key );
+            Reference::iterator rit = ref.lower_bound( key );
+            if ( ( it == tree.end() ) != ( rit == ref.end() ) ) return false;
+            if ( rit != ref.end() && it->first != rit->first ) return false;
+            it = tree.upper_bound( key );
+            rit = ref.upper_bound( key );
+            if ( ( it == tree.end() ) != ( rit == ref.end() ) ) return false;
+            if ( rit != ref.end() && it->first != rit->first ) return false;
+            break;
+         }
+         case 5:
+         {
+            /* move a key down into the gap left by its predecessor */
+            Tree::iterator it = tree.lower_bound( key );
+            if ( it == tree.end() ) break;
+            long low = -1;
+            if ( it != tree.begin() ) {
+               Tree::iterator prev = it;
+               prev--;
+               low = prev->first;
+            }
+            if ( it->first - low < 2 ) break;
+            long newKey = low + 1 + rand() % ( it->first - low - 1 );
+            long value = it->second;
+            ref.erase( it->first );
+            ref[newKey] = value;
+            tree.mutableKey( it ) = newKey;
+            break;
+         }
+      }
+      if ( i % 10000 == 0 && !same( tree, ref ) ) return false;
+   }
+   if ( !same( tree, ref ) ) return false;
+
+   while ( !ref.empty() ) {
+      long key = ( rand() % 2 ) ? ref.begin()->first : ref.rbegin()->first;
+      tree.erase( key );
+      ref.erase( key );
+   }
+   return same( tree, ref ) && tree.empty();
+}
+
+static bool checkOverlaps ()
+{
+   IntMap map;
+   IntMap::MemChunkVector added;
+
+   map.getOrAddChunk( 0, 100, added );
+   if ( added.size() != 1 ) return false;
+   *added.front().second = NEW int( 1 );
+
+   /* [50,150) splits [0,100) and adds [100,150) */
+   added.clear();
+   map.getOrAddChunk( 50, 100, added );
+   if ( added.size() != 2 || map.size() != 3 ) return false;
+   if ( added.front().first->getAddress() != 50 || added.front().first->getLength() != 50 ) return false;
+   if ( *added.front().second == NULL || **added.front().second != 1 ) return false;
+   *(added.begin() + 1)->second = NEW int( 2 );
+
+   IntMap::ConstMemChunkVector found;
+   IntMap::ConstMemChunkList foundList;
+   map.getChunk( 25, 100, found );
+   map.getChunk( 25, 100, foundList );
+   if ( found.size() != foundList.size() || found.size() != 3 ) return false;
+   IntMap::ConstMemChunkList::const_iterator lit = foundList.begin();
+   for ( IntMap::ConstMemChunkVector::const_iterator it = found.begin(); it != found.end(); it++, lit++ ) {
+      if ( !it->first.equal( lit->first ) || it->second != lit->second ) return false;
+   }
+   return true;
+}
+
+static double now ()
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static bool checkManyChunks ()
+{
+   const int chunks = 100000;
+   const int lookups = 1000000;
+   IntMap map;
+
+   for ( int i = 0; i < chunks; i++ ) {
+      IntMap::MemChunkVector added;
+      map.getOrAddChunk( (uint64_t) i * 256, 128, added );
+      if ( added.size() != 1 ) return false;
+      *added.front().second = NEW int( i );
+   }
+
+   double start = now();
+   for ( int i = 0; i < lookups; i++ ) {
+      int chunk = rand() % chunks;
+      IntMap::ConstMemChunkVector found;
+      map.getChunk( (uint64_t) chunk * 256, 128, found );
+      if ( found.size() != 1 || found.front().second == NULL || *found.front().second != chunk ) return false;
+   }
+   double elapsed = now() - start;
+
+   std::cout << chunks << " chunks: " << ( elapsed * 1e9 / lookups ) << " ns per lookup" << std::endl;
+   return true;
+}
+
+int main ( int argc, char **argv )
+{
+   srand( 1 );
+   if ( !checkTree() ) {
+      std::cout << "BTreeMap differs from std::map" << std::endl;
+      return 1;
+   }
+   if ( !checkOverlaps() ) {
+      std::cout << "Wrong overlap results" << std::endl;
+      return 1;
+   }
+   if ( !checkManyChunks() ) {
+      std::cout << "Wrong lookup results" << std::endl;
+      return 1;
+   }
+   std::cout << "Test passed" << std::endl;
+   return 0;
+}
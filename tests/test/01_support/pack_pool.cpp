@@ -0,0 +1,103 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checking the pool of pack buffers. A released buffer is reused by the next
+ * pack of its size class, packs are not rounded up to a power of two, and buffers released
+ * by another thread are given back to the allocator when it runs out of memory.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator -a \"--gpus=0\""
+</testinfo>*/
+
+#include <iostream>
+#include <stdlib.h>
+#include "config.hpp"
+#include "smpprocessor.hpp"
+#include "system.hpp"
+#include "packer_decl.hpp"
+
+using namespace std;
+using namespace nanos;
+using namespace nanos::ext;
+
+#define PACK_LEN ( 64 * 1024 + 1 )
+#define NUM_PACKS 3
+#define CLASS_BYTES ( 80 * 1024 )
+
+Packer packer;
+void *packs[NUM_PACKS];
+
+void release( void *args );
+
+void release( void *args )
+{
+   for ( int i = 0; i < NUM_PACKS; i++ ) {
+      packer.free_pack( 0, PACK_LEN, 1, packs[i] );
+   }
+}
+
+int main ( int argc, char **argv )
+{
+   int num_pes = sys.getSMPPlugin()->getNumWorkers();
+   char *memory = (char *) malloc( NUM_PACKS * CLASS_BYTES );
+   SimpleAllocator allocator( (uint64_t) memory, NUM_PACKS * CLASS_BYTES );
+   WD *wg = getMyThreadSafe()->getCurrentWD();
+   bool check = true;
+
+   packer.setAllocator( &allocator );
+
+   // The allocator only fits NUM_PACKS packs if they are not rounded up to 128KB
+   for ( int i = 0; i < NUM_PACKS; i++ ) {
+      packs[i] = packer.give_pack( 0, PACK_LEN, 1 );
+      if ( packs[i] == NULL ) check = false;
+   }
+
+   // A released buffer is the next one given for the same size class
+   if ( check ) {
+      void *last = packs[NUM_PACKS - 1];
+      packer.free_pack( 0, PACK_LEN, 1, last );
+      packs[NUM_PACKS - 1] = packer.give_pack( 0, PACK_LEN - 1, 1 );
+      if ( packs[NUM_PACKS - 1] != last ) check = false;
+   }
+
+   // Another thread (if any) releases all of them to the pool
+   if ( check ) {
+      ThreadTeam &team = *getMyThreadSafe()->getTeam();
+      WD * wd = new WD( new SMPDD( release ), 0, 1, NULL );
+      wg->addWork( *wd );
+      wd->tieTo( team[num_pes > 1 ? 1 : 0] );
+      sys.submit( *wd );
+      wg->waitCompletion();
+
+      // A larger pack only fits once the pool is given back to the allocator
+      void *large = packer.give_pack( 0, 2 * PACK_LEN, 1 );
+      if ( large == NULL ) check = false;
+      else packer.free_pack( 0, 2 * PACK_LEN, 1, large );
+   }
+
+   if ( check ) {
+      cout << "Checking pack pool: PASS" << endl;
+   } else {
+      cout << "Checking pack pool: FAIL" << endl;
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,108 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checking that the performance model store reads back what it saved: records
+ * keep their counts (up to the maximum) and exact means, outlines may contain spaces, and a
+ * malformed file is rejected without enabling the store.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator"
+</testinfo>*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdio.h>
+#include <unistd.h>
+#include "perfmodelstore_decl.hpp"
+
+using namespace nanos;
+
+static bool sameRecord ( PerfModelStore const &store, const std::string &outline, std::size_t dataSize,
+                         const std::string &device, unsigned long count, double mean )
+{
+   PerfModelStore::Record record;
+   return store.find( outline, dataSize, device, record ) && record._count == count && record._mean == mean;
+}
+
+int main ( int argc, char **argv )
+{
+   std::ostringstream name;
+   name << "perfmodel_store." << getpid() << ".txt";
+   std::string fileName = name.str();
+   std::string outline = PerfModelStore::getOutlineKey( ( void * ) &sameRecord, "task with\na description" );
+   bool check = true;
+
+   if ( outline.empty() || outline.find( '\n' ) != std::string::npos ) {
+      std::cout << "Bad outline key '" << outline << "'" << std::endl;
+      check = false;
+   }
+   if ( !PerfModelStore::getOutlineKey( NULL, NULL ).empty() ) {
+      std::cout << "An outline without address or description got a key" << std::endl;
+      check = false;
+   }
+
+   {
+      PerfModelStore store;
+      store.setMaxCount( 100 );
+      // A missing file enables the store, it is created when saved
+      check = check && store.load( fileName ) && store.isEnabled();
+      store.update( outline, 4096, "smp", PerfModelStore::Record( 10, 1.0 / 3.0 ) );
+      store.update( outline, 8192, "smp", PerfModelStore::Record( 500, 2.5e-7 ) );
+      store.update( outline, 4096, "cuda", PerfModelStore::Record( 3, 123456.789 ) );
+      store.update( "", 4096, "smp", PerfModelStore::Record( 1, 1.0 ) );
+      store.update( "other", 4096, "smp", PerfModelStore::Record( 0, 1.0 ) );
+      check = check && store.size() == 3 && store.save();
+   }
+
+   {
+      PerfModelStore store;
+      check = check && store.load( fileName ) && store.size() == 3;
+      check = check && sameRecord( store, outline, 4096, "smp", 10, 1.0 / 3.0 );
+      check = check && sameRecord( store, outline, 8192, "smp", 100, 2.5e-7 );
+      check = check && sameRecord( store, outline, 4096, "cuda", 3, 123456.789 );
+      if ( !check ) std::cout << "Records changed after a save and a load" << std::endl;
+   }
+
+   {
+      std::ofstream file( fileName.c_str(), std::ios::app );
+      file << "1024 smp not-a-count 1.0 broken" << std::endl;
+   }
+
+   {
+      PerfModelStore store;
+      if ( store.load( fileName ) || store.isEnabled() || store.size() != 0 ) {
+         std::cout << "A malformed model was accepted" << std::endl;
+         check = false;
+      }
+   }
+
+   unlink( fileName.c_str() );
+
+   if ( check ) {
+      std::cout << "Checking performance model store: PASS" << std::endl;
+   } else {
+      std::cout << "Checking performance model store: FAIL" << std::endl;
+      return 1;
+   }
+
+   return 0;
+}
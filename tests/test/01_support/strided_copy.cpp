@@ -0,0 +1,101 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/* DESCRIPTION: Checks the strided pack, unpack and copy kernels against a per-row memcpy for
+ * every row length up to past the vector threshold, with unaligned rows.
+ */
+
+/*<testinfo>
+test_generator="gens/core-generator"
+</testinfo>*/
+
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include "stridedcopy.hpp"
+
+using namespace nanos;
+
+#define MAX_LEN 600
+#define MAX_COUNT 9
+
+static void fill ( char *buf, std::size_t size )
+{
+   for ( std::size_t i = 0; i < size; i++ ) buf[i] = (char) rand();
+}
+
+static bool checkLength ( std::size_t len, std::size_t offset )
+{
+   std::size_t ld = len + 1 + ( len % 13 );
+   std::size_t stridedSize = MAX_COUNT * ld + 2 * offset;
+   char *strided = new char[stridedSize];
+   char *expected = new char[stridedSize];
+   char *packed = new char[MAX_COUNT * len + offset];
+   bool ok = true;
+
+   fill( strided, stridedSize );
+   fill( packed, MAX_COUNT * len + offset );
+
+   for ( std::size_t count = 1; count <= MAX_COUNT && ok; count++ ) {
+      // pack
+      StridedCopy::pack( packed + offset, strided + offset, len, count, ld );
+      for ( std::size_t i = 0; i < count && ok; i++ ) {
+         ok = ::memcmp( packed + offset + i * len, strided + offset + i * ld, len ) == 0;
+      }
+
+      // unpack, the gaps between the rows must stay untouched
+      fill( packed + offset, count * len );
+      ::memcpy( expected, strided, stridedSize );
+      for ( std::size_t i = 0; i < count; i++ ) {
+         ::memcpy( expected + offset + i * ld, packed + offset + i * len, len );
+      }
+      StridedCopy::unpack( strided + offset, packed + offset, len, count, ld );
+      ok = ok && ::memcmp( strided, expected, stridedSize ) == 0;
+
+      // strided to strided
+      char *other = new char[stridedSize];
+      fill( other, stridedSize );
+      ::memcpy( expected, other, stridedSize );
+      for ( std::size_t i = 0; i < count; i++ ) {
+         ::memcpy( expected + offset + i * ld, strided + i * ld, len );
+      }
+      StridedCopy::copy( other + offset, ld, strided, ld, len, count );
+      ok = ok && ::memcmp( other, expected, stridedSize ) == 0;
+      delete[] other;
+   }
+
+   delete[] strided;
+   delete[] expected;
+   delete[] packed;
+   return ok;
+}
+
+int main ( int argc, char **argv )
+{
+   for ( std::size_t len = 1; len <= MAX_LEN; len++ ) {
+      for ( std::size_t offset = 0; offset < 3; offset++ ) {
+         if ( !checkLength( len, offset ) ) {
+            std::cout << "Strided copy check failed for rows of " << len << " bytes at offset " << offset << std::endl;
+            return 1;
+         }
+      }
+   }
+
+   return 0;
+}
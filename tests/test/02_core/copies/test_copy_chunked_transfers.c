@@ -0,0 +1,144 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator=gens/api-generator
+exec_versions="smp_private_mem smp_private_mem_chunks"
+
+declare test_ENV_smp_private_mem="NX_SMP_PRIVATE_MEMORY=true"
+declare test_ENV_smp_private_mem_chunks="NX_SMP_PRIVATE_MEMORY=true NX_SMP_TRANSFER_CHUNK_SIZE=4096 NX_SMP_TRANSFER_STREAMING_THRESHOLD=65536"
+
+</testinfo>
+*/
+
+/* Large contiguous and strided copies into SMP private memory, split in chunks by the
+ * asynchronous transfer engine (and written with streaming stores in the second version).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <nanos.h>
+
+#define N      512
+#define TILE   96
+#define ROUNDS 4
+
+typedef struct {
+   double *m;
+   int r0;
+   int c0;
+   int rows;
+   int cols;
+} my_args;
+
+void bump( void *ptr );
+void bump( void *ptr )
+{
+   my_args *args = (my_args *) ptr;
+   double *m;
+   int i, j;
+   nanos_get_addr( 0, (void **) &m, nanos_current_wd() );
+   for ( i = args->r0; i < args->r0 + args->rows; i++ )
+      for ( j = args->c0; j < args->c0 + args->cols; j++ )
+         m[i * N + j] += 1.0;
+}
+
+nanos_smp_args_t test_device_arg = { bump };
+
+struct nanos_const_wd_definition_1
+{
+     nanos_const_wd_definition_t base;
+     nanos_device_t devices[1];
+};
+
+struct nanos_const_wd_definition_1 const_data =
+{
+   {{
+      .mandatory_creation = true,
+      .tied = false},
+   __alignof__(my_args),
+   1,
+   1,
+   2,NULL},
+   {
+      {
+         nanos_smp_factory,
+         &test_device_arg
+      }
+   }
+};
+
+static void submit_bump( double *m, int r0, int c0, int rows, int cols )
+{
+   my_args *args = 0;
+   nanos_copy_data_t *cd = 0;
+   nanos_region_dimension_internal_t *dims = 0;
+   nanos_wd_t wd = 0;
+   nanos_wd_dyn_props_t dyn_props = {0};
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &const_data.base, &dyn_props, sizeof(my_args), (void **) &args, nanos_current_wd(), &cd, &dims ) );
+   args->m = m;
+   args->r0 = r0;
+   args->c0 = c0;
+   args->rows = rows;
+   args->cols = cols;
+
+   dims[0] = (nanos_region_dimension_internal_t) { N * sizeof(double), c0 * sizeof(double), cols * sizeof(double) };
+   dims[1] = (nanos_region_dimension_internal_t) { N, r0, rows };
+   cd[0] = (nanos_copy_data_t) { (void *) m, NANOS_SHARED, {true, true}, 2, &dims[0], 0 };
+
+   NANOS_SAFE( nanos_submit( wd, 0, 0, 0 ) );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+}
+
+int main ( int argc, char **argv )
+{
+   double *m = (double *) malloc( N * N * sizeof(double) );
+   double expected;
+   int i, j, r, errors = 0;
+
+   for ( i = 0; i < N * N; i++ ) m[i] = i;
+
+   for ( r = 0; r < ROUNDS; r++ ) {
+      /* whole matrix: one contiguous 2MB transfer each way */
+      submit_bump( m, 0, 0, N, N );
+      /* tiles: strided transfers, the last one with a row length that is not a power of two */
+      submit_bump( m, 0, 0, TILE, TILE );
+      submit_bump( m, N - TILE, 8, TILE, 3 );
+   }
+
+   for ( i = 0; i < N; i++ ) {
+      for ( j = 0; j < N; j++ ) {
+         expected = i * N + j + ROUNDS;
+         if ( i < TILE && j < TILE ) expected += ROUNDS;
+         if ( i >= N - TILE && j >= 8 && j < 8 + 3 ) expected += ROUNDS;
+         if ( m[i * N + j] != expected ) errors++;
+      }
+   }
+
+   if ( errors == 0 ) {
+      printf( "Checking for chunked copy correctness...  PASS\n" );
+   } else {
+      printf( "Checking for chunked copy correctness...  FAIL (%d wrong elements)\n", errors );
+   }
+   free( m );
+   return errors != 0;
+}
@@ -0,0 +1,152 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator=gens/api-generator
+test_deps_plugins=plain,regions,perfect-regions,sharded
+</testinfo>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <nanos.h>
+
+/* One writer releasing many readers at once, which in turn release one
+ * last writer. Exercises the batch release of successors. */
+#define NUM_READERS 1000
+
+int value = 0;
+int readers = 0;
+int errors = 0;
+
+void writer();
+void writer()
+{
+   value = 42;
+}
+
+void reader();
+void reader()
+{
+   if ( value != 42 ) __sync_fetch_and_add( &errors, 1 );
+   __sync_fetch_and_add( &readers, 1 );
+}
+
+void last_writer();
+void last_writer()
+{
+   if ( readers != NUM_READERS ) __sync_fetch_and_add( &errors, 1 );
+   value = 0;
+}
+
+nanos_smp_args_t writer_device_arg = { (void(*)())writer };
+nanos_smp_args_t reader_device_arg = { (void(*)())reader };
+nanos_smp_args_t last_writer_device_arg = { (void(*)())last_writer };
+
+/* ************** CONSTANT PARAMETERS IN WD CREATION ******************** */
+
+struct nanos_const_wd_definition_1
+{
+     nanos_const_wd_definition_t base;
+     nanos_device_t devices[1];
+};
+
+struct nanos_const_wd_definition_1 writer_data = 
+{
+   {{
+      .mandatory_creation = true,
+      .tied = false},
+   1,
+   0,
+   1,
+   0,NULL},
+   {
+      {
+         nanos_smp_factory,
+         &writer_device_arg
+      }
+   }
+};
+
+struct nanos_const_wd_definition_1 reader_data = 
+{
+   {{
+      .mandatory_creation = true,
+      .tied = false},
+   1,
+   0,
+   1,
+   0,NULL},
+   {
+      {
+         nanos_smp_factory,
+         &reader_device_arg
+      }
+   }
+};
+
+struct nanos_const_wd_definition_1 last_writer_data = 
+{
+   {{
+      .mandatory_creation = true,
+      .tied = false},
+   1,
+   0,
+   1,
+   0,NULL},
+   {
+      {
+         nanos_smp_factory,
+         &last_writer_device_arg
+      }
+   }
+};
+
+int main ( int argc, char **argv )
+{
+   int i;
+   nanos_region_dimension_t dimensions[1] = {{sizeof(int), 0, sizeof(int)}};
+   nanos_data_access_t write_access[1] = {{&value, {1,1,0,0,0}, 1, dimensions}};
+   nanos_data_access_t read_access[1] = {{&value, {1,0,0,0,0}, 1, dimensions}};
+   nanos_wd_dyn_props_t dyn_props = {0};
+
+   nanos_wd_t wd = 0;
+   NANOS_SAFE( nanos_create_wd_compact ( &wd, &writer_data.base, &dyn_props, 0, NULL, nanos_current_wd(), NULL, NULL ) );
+   NANOS_SAFE( nanos_submit( wd, 1, write_access, 0 ) );
+
+   for ( i = 0; i < NUM_READERS; i++ ) {
+      wd = 0;
+      NANOS_SAFE( nanos_create_wd_compact ( &wd, &reader_data.base, &dyn_props, 0, NULL, nanos_current_wd(), NULL, NULL ) );
+      NANOS_SAFE( nanos_submit( wd, 1, read_access, 0 ) );
+   }
+
+   wd = 0;
+   NANOS_SAFE( nanos_create_wd_compact ( &wd, &last_writer_data.base, &dyn_props, 0, NULL, nanos_current_wd(), NULL, NULL ) );
+   NANOS_SAFE( nanos_submit( wd, 1, write_access, 0 ) );
+
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   if ( errors != 0 || readers != NUM_READERS || value != 0 ) {
+      printf("Error: %d errors, %d of %d readers executed\n", errors, readers, NUM_READERS);
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,213 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/api-generator -a --tdg-verify|--no-tdg-verify"
+test_deps_plugins=plain,regions
+</testinfo>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <nanos.h>
+
+/* Every iteration increments each element of x, adds neighbour pairs of x into y and
+ * accumulates all of y into total. The first iteration is recorded and the others replay it. */
+#define N 16
+#define ITERS 10
+
+int x[N];
+int y[N-1];
+int total = 0;
+int checked_total = -1;
+
+typedef struct {
+   int index;
+} task_args;
+
+void increment(void *ptr);
+void increment(void *ptr)
+{
+   x[((task_args *) ptr)->index]++;
+}
+
+void add_pair(void *ptr);
+void add_pair(void *ptr)
+{
+   int i = ((task_args *) ptr)->index;
+   y[i] = x[i] + x[i+1];
+}
+
+void accumulate(void *ptr);
+void accumulate(void *ptr)
+{
+   int i;
+   for ( i = 0; i < N-1; i++ ) total += y[i];
+}
+
+void check(void *ptr);
+void check(void *ptr)
+{
+   checked_total = total;
+}
+
+nanos_smp_args_t increment_device_arg = { increment };
+nanos_smp_args_t add_pair_device_arg = { add_pair };
+nanos_smp_args_t accumulate_device_arg = { accumulate };
+nanos_smp_args_t check_device_arg = { check };
+
+/* ************** CONSTANT PARAMETERS IN WD CREATION ******************** */
+
+struct nanos_const_wd_definition_1
+{
+     nanos_const_wd_definition_t base;
+     nanos_device_t devices[1];
+};
+
+#define CONST_WD_DEFINITION(name) \
+struct nanos_const_wd_definition_1 name##_data = \
+{ \
+   {{ \
+      .mandatory_creation = true, \
+      .tied = false}, \
+   __alignof__(task_args), \
+   0, \
+   1, \
+   0,NULL}, \
+   { \
+      { \
+         nanos_smp_factory, \
+         &name##_device_arg \
+      } \
+   } \
+};
+
+CONST_WD_DEFINITION(increment)
+CONST_WD_DEFINITION(add_pair)
+CONST_WD_DEFINITION(accumulate)
+CONST_WD_DEFINITION(check)
+
+nanos_wd_dyn_props_t dyn_props = {0};
+
+void submit_task( struct nanos_const_wd_definition_1 *data, int index, size_t num_accesses, nanos_data_access_t *accesses );
+void submit_task( struct nanos_const_wd_definition_1 *data, int index, size_t num_accesses, nanos_data_access_t *accesses )
+{
+   nanos_wd_t wd = 0;
+   task_args *args = 0;
+   NANOS_SAFE( nanos_create_wd_compact ( &wd, &data->base, &dyn_props, sizeof( task_args ), ( void ** )&args, nanos_current_wd(), NULL, NULL ) );
+   args->index = index;
+   NANOS_SAFE( nanos_submit( wd, num_accesses, accesses, 0 ) );
+}
+
+void submit_iteration();
+void submit_iteration()
+{
+   int i;
+   nanos_region_dimension_t element[1] = {{sizeof(int), 0, sizeof(int)}};
+
+   for ( i = 0; i < N; i++ ) {
+      nanos_data_access_t accesses[1] = {{&x[i], {1,1,0,0,0}, 1, element, 0}};
+      submit_task( &increment_data, i, 1, accesses );
+   }
+
+   for ( i = 0; i < N-1; i++ ) {
+      nanos_data_access_t accesses[3] = {{&x[i], {1,0,0,0,0}, 1, element, 0},
+                                         {&x[i+1], {1,0,0,0,0}, 1, element, 0},
+                                         {&y[i], {0,1,0,0,0}, 1, element, 0}};
+      submit_task( &add_pair_data, i, 3, accesses );
+   }
+
+   {
+      nanos_data_access_t accesses[N];
+      nanos_data_access_t total_access = {&total, {1,1,0,0,0}, 1, element, 0};
+      for ( i = 0; i < N-1; i++ ) {
+         nanos_data_access_t y_access = {&y[i], {1,0,0,0,0}, 1, element, 0};
+         accesses[i] = y_access;
+      }
+      accesses[N-1] = total_access;
+      submit_task( &accumulate_data, 0, N, accesses );
+   }
+}
+
+int main ( int argc, char **argv )
+{
+   int i;
+   unsigned int num_tasks = 0, num_edges = 0;
+   nanos_task_graph_t graph = NULL;
+   nanos_region_dimension_t element[1] = {{sizeof(int), 0, sizeof(int)}};
+   nanos_data_access_t total_access[1] = {{&total, {1,0,0,0,0}, 1, element, 0}};
+   nanos_data_access_t check_accesses[2] = {{&total, {1,0,0,0,0}, 1, element, 0},
+                                            {&checked_total, {0,1,0,0,0}, 1, element, 0}};
+
+   for ( i = 0; i < N; i++ ) x[i] = 0;
+
+   // Misuse is reported, not fatal
+   if ( nanos_task_graph_record_end( &graph ) != NANOS_INVALID_REQUEST ) {
+      printf("Error: ending a recording that was not started\n");
+      return 1;
+   }
+   if ( nanos_task_graph_replay_end() != NANOS_INVALID_REQUEST ) {
+      printf("Error: ending a replay that was not started\n");
+      return 1;
+   }
+
+   // Waiting on dependencies makes the recording unusable
+   NANOS_SAFE( nanos_task_graph_record_begin() );
+   NANOS_SAFE( nanos_wait_on( 1, total_access ) );
+   if ( nanos_task_graph_record_end( &graph ) != NANOS_INVALID_REQUEST ) {
+      printf("Error: a recording with a wait on dependencies was accepted\n");
+      return 1;
+   }
+
+   NANOS_SAFE( nanos_task_graph_record_begin() );
+   submit_iteration();
+   NANOS_SAFE( nanos_task_graph_record_end( &graph ) );
+
+   NANOS_SAFE( nanos_task_graph_get_size( graph, &num_tasks, &num_edges ) );
+   if ( num_tasks != 2*N || num_edges != 3*(N-1) ) {
+      printf("Error: recorded %u tasks and %u edges instead of %d and %d\n", num_tasks, num_edges, 2*N, 3*(N-1));
+      return 1;
+   }
+
+   for ( i = 1; i < ITERS; i++ ) {
+      NANOS_SAFE( nanos_task_graph_replay_begin( graph ) );
+      submit_iteration();
+      NANOS_SAFE( nanos_task_graph_replay_end() );
+   }
+
+   // Tasks submitted after a replay are ordered after it
+   submit_task( &check_data, 0, 2, check_accesses );
+
+   NANOS_SAFE( nanos_task_graph_destroy( graph ) );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+
+   for ( i = 0; i < N; i++ ) {
+      if ( x[i] != ITERS ) {
+         printf("Error: x[%d] is %d instead of %d\n", i, x[i], ITERS);
+         return 1;
+      }
+   }
+   if ( total != (N-1)*ITERS*(ITERS+1) || checked_total != total ) {
+      printf("Error: total is %d and %d was checked instead of %d\n", total, checked_total, (N-1)*ITERS*(ITERS+1));
+      return 1;
+   }
+
+   return 0;
+}
@@ -0,0 +1,69 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator=gens/core-generator
+exec_versions="cache nocache"
+declare test_ENV_cache="NX_TEAM_CACHE_SIZE=2"
+declare test_ENV_nocache="NX_TEAM_CACHE_SIZE=0"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include "system.hpp"
+#include <stdlib.h>
+
+using namespace nanos;
+
+#define NUM_ITERS 1000
+
+int main ( int argc, char **argv )
+{
+   const char *size = getenv( "NX_TEAM_CACHE_SIZE" );
+   bool cached = size == NULL || atoi( size ) > 0;
+
+   ThreadTeam *first = NULL;
+   unsigned generation = 0;
+
+   for ( int i = 0; i < NUM_ITERS; i++ ) {
+      ThreadTeam *team = sys.createTeam( 1, NULL, true );
+
+      if ( team->size() != 1 || &team->getThread( 0 ) != myThread || myThread->getTeam() != team ) {
+         fprintf( stderr, "Wrong team at iteration %d\n", i );
+         return EXIT_FAILURE;
+      }
+
+      if ( i == 0 ) {
+         first = team;
+         generation = team->getGeneration();
+      } else if ( cached && ( team != first || team->getGeneration() != generation + i ) ) {
+         fprintf( stderr, "Team was not reused at iteration %d\n", i );
+         return EXIT_FAILURE;
+      }
+
+      myThread->setLeaveTeam( true );
+      myThread->leaveTeam( );
+
+      sys.endTeam( team );
+   }
+
+   return EXIT_SUCCESS;
+}
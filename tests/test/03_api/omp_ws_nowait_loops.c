@@ -0,0 +1,148 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator=gens/api-omp-generator
+</testinfo>
+*/
+
+#include <stdio.h>
+#include "nanos.h"
+#include "omp.h"
+
+/* Many short dynamic and guided loops without barriers between them: every iteration of
+ * every loop must be executed exactly once even if loop descriptors are recycled. Every
+ * fourth loop runs the next one to completion after its first item, so threads are
+ * registered in two loops at once.
+ */
+
+#define NUM_LOOPS 2000
+#define NUM_ITERS 67
+
+struct  nanos_const_wd_definition_1
+{
+  nanos_const_wd_definition_t base;
+  nanos_device_t devices[1];
+};
+
+struct  nanos_args_1_t
+{
+  int *hits;
+};
+
+static int run_loop ( int *hits, int loop )
+{
+   int inner = 0;
+   nanos_err_t err;
+   nanos_ws_desc_t *wsd;
+   nanos_ws_info_loop_t info;
+   nanos_ws_item_loop_t item;
+   _Bool single_guard;
+   nanos_omp_sched_t kind = ( loop % 2 ) ? nanos_omp_sched_guided : nanos_omp_sched_dynamic;
+   int i;
+
+   void *ws_policy = nanos_omp_find_worksharing( kind );
+   if ( ws_policy == 0 ) nanos_handle_error( NANOS_UNIMPLEMENTED );
+
+   info.lower_bound = 0;
+   info.upper_bound = NUM_ITERS - 1;
+   info.loop_step = 1;
+   info.chunk_size = 1 + loop % 3;
+
+   err = nanos_worksharing_create( &wsd, ws_policy, (void **) &info, &single_guard );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+
+   err = nanos_worksharing_next_item( wsd, (void **) &item );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+   if ( loop % 4 == 0 && loop + 1 < NUM_LOOPS ) inner = run_loop( hits, loop + 1 ) + 1;
+   while ( item.execute ) {
+      for ( i = item.lower; i <= item.upper; i++ ) __sync_fetch_and_add( &hits[loop], 1 );
+      err = nanos_worksharing_next_item( wsd, (void **) &item );
+      if ( err != NANOS_OK ) nanos_handle_error( err );
+   }
+
+   return inner;
+}
+
+static void smp_ol_main_1 ( struct nanos_args_1_t *const args )
+{
+   nanos_err_t err;
+   int loop;
+
+   err = nanos_omp_set_implicit( nanos_current_wd() );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+   err = nanos_enter_team();
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+
+   for ( loop = 0; loop < NUM_LOOPS; loop++ ) loop += run_loop( args->hits, loop );
+
+   err = nanos_omp_barrier();
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+   err = nanos_leave_team();
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+}
+
+int main ( int argc, char **argv )
+{
+   static int hits[NUM_LOOPS];
+   nanos_err_t err;
+   nanos_wd_dyn_props_t dyn_props;
+   unsigned int nth_i;
+   struct nanos_args_1_t imm_args;
+   int loop, errors = 0;
+   static nanos_smp_args_t smp_ol_main_1_args = {.outline = (void (*)(void *))(void (*)(struct nanos_args_1_t *))&smp_ol_main_1};
+   static struct nanos_const_wd_definition_1 nanos_wd_const_data = {.base = {.props = {.mandatory_creation = 1, .tied = 1, .clear_chunk = 0, .reserved0 = 0, .reserved1 = 0, .reserved2 = 0, .reserved3 = 0, .reserved4 = 0}, .data_alignment = __alignof__(struct nanos_args_1_t), .num_copies = 0, .num_devices = 1, .num_dimensions = 0, .description = 0}, .devices = {[0] = {.factory = &nanos_smp_factory, .arg = &smp_ol_main_1_args}}};
+   unsigned int nanos_num_threads = nanos_omp_get_num_threads_next_parallel(0);
+   nanos_team_t nanos_team = (nanos_team_t)0;
+   nanos_thread_t nanos_team_threads[nanos_num_threads];
+
+   err = nanos_create_team( &nanos_team, (nanos_sched_t)0, &nanos_num_threads, (nanos_constraint_t *)0, 1, nanos_team_threads, NULL );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+
+   dyn_props.tie_to = (nanos_thread_t)0;
+   dyn_props.priority = 0;
+   dyn_props.flags.is_final = 0;
+   for ( nth_i = 1; nth_i < nanos_num_threads; nth_i++ ) {
+      struct nanos_args_1_t *ol_args = 0;
+      nanos_wd_t nanos_wd_ = (nanos_wd_t)0;
+      dyn_props.tie_to = nanos_team_threads[nth_i];
+      err = nanos_create_wd_compact( &nanos_wd_, &nanos_wd_const_data.base, &dyn_props, sizeof(struct nanos_args_1_t), (void **)&ol_args, nanos_current_wd(), (nanos_copy_data_t **)0, (nanos_region_dimension_internal_t **)0 );
+      if ( err != NANOS_OK ) nanos_handle_error( err );
+      ol_args->hits = hits;
+      err = nanos_submit( nanos_wd_, 0, (nanos_data_access_t *)0, (nanos_team_t)0 );
+      if ( err != NANOS_OK ) nanos_handle_error( err );
+   }
+   dyn_props.tie_to = nanos_team_threads[0];
+   imm_args.hits = hits;
+   err = nanos_create_wd_and_run_compact( &nanos_wd_const_data.base, &dyn_props, sizeof(struct nanos_args_1_t), &imm_args, 0, (nanos_data_access_t *)0, (nanos_copy_data_t *)0, (nanos_region_dimension_internal_t *)0, (nanos_translate_args_t)0 );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+   err = nanos_end_team( nanos_team );
+   if ( err != NANOS_OK ) nanos_handle_error( err );
+
+   for ( loop = 0; loop < NUM_LOOPS; loop++ ) {
+      if ( hits[loop] != NUM_ITERS ) {
+         fprintf( stderr, "Loop %d executed %d iterations instead of %d\n", loop, hits[loop], NUM_ITERS );
+         errors++;
+      }
+   }
+
+   if ( errors ) return 1;
+   return 0;
+}
@@ -0,0 +1,135 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_generator="gens/core-generator -a \"--gpus=0\""
+exec_versions="hierarchical hierarchical_fanin_2"
+
+declare test_ENV_hierarchical="NX_ARGS='--barrier=hierarchical'"
+declare test_ENV_hierarchical_fanin_2="NX_ARGS='--barrier=hierarchical --hier-barrier-fanin=2 --hier-barrier-spins=10'"
+</testinfo>
+*/
+
+#include "config.hpp"
+#include "nanos.h"
+#include <iostream>
+#include "smpprocessor.hpp"
+#include "system.hpp"
+#include "threadteam.hpp"
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace nanos;
+using namespace nanos::ext;
+
+#define BARR_NUM 20
+
+int* counts;
+long* privates;
+long result;
+int size;
+
+void barrier_code ( void * );
+
+void sum_bop ( void *original, void *priv, int num_scalars )
+{
+   *( long * ) original += *( long * ) priv;
+}
+
+void sum_vop ( int n, void *original, void *priv )
+{
+   for ( int i = 0; i < n; i++ ) *( long * ) original += ( ( long * ) priv )[i];
+}
+
+void no_cleanup ( void * ) {}
+
+/*! Thread 0 registers a team reduction every iteration, alternating scalar and vector
+ *  operations, that the barrier must compute after every thread has set its private value.
+ */
+void register_reduction ( int i )
+{
+   nanos_reduction_t *red;
+   nanos_malloc( ( void ** ) &red, sizeof( nanos_reduction_t ), __FILE__, __LINE__ );
+
+   result = 0;
+   red->original = &result;
+   red->privates = privates;
+   red->descriptor = privates;
+   red->element_size = sizeof( long );
+   red->num_scalars = 1;
+   red->bop = sum_bop;
+   red->vop = ( i % 2 ) ? sum_vop : NULL;
+   red->cleanup = no_cleanup;
+
+   nanos_register_reduction( red );
+}
+
+void barrier_code ( void * )
+{
+       int id = getMyThreadSafe()->getTeamId();
+
+       for ( int i = 0; i < BARR_NUM; i++ ) {
+              privates[id] = id + i;
+              if ( id == 0 ) register_reduction( i );
+
+              nanos_team_barrier();
+
+              counts[id]++;
+              long expected = ( long ) size * ( size - 1 ) / 2 + ( long ) size * i;
+              if ( result != expected ) {
+                 cerr << "Error: wrong reduction " << result << " (expected " << expected << ")" << std::endl;
+                 abort();
+              }
+
+              nanos_team_barrier();
+
+              if ( counts[ ( id + 1 ) % size ] != i + 1 ) {
+                 cerr << "Error: the barrier is broken." << std::endl;
+                 abort();
+              }
+       }
+}
+
+int main (int argc, char **argv)
+{
+       cout << "start" << endl;
+       //all threads perform a barrier:
+       ThreadTeam &team = *getMyThreadSafe()->getTeam();
+
+       size = team.size();
+       counts = new int[size];
+       privates = new long[size];
+       for ( int i = 0; i < size; i++ ) counts[i] = 0;
+
+       for ( int i = 1; i < size; i++ ) {
+              WD * wd = new WD(new SMPDD(barrier_code));
+              wd->tieTo(team[i]);
+              sys.submit(*wd);
+       }
+       usleep(100);
+
+       WD *wd = getMyThreadSafe()->getCurrentWD();
+       wd->tieTo(*getMyThreadSafe());
+       barrier_code(NULL);
+
+       cout << "end" << endl;
+}
@@ -0,0 +1,245 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_mode=performance
+test_generator='gens/api-generator -a --schedule=bf'
+test_LDFLAGS=-lm
+</testinfo>
+*/
+
+/*
+ * Contention benchmark for the floating point nanos_atomic updates that do not fit in a
+ * 64-bit CAS: _Complex float, _Complex double, long double and _Complex long double.
+ *
+ * NX_BENCH_TASKS tasks per thread (4 by default) each perform NX_BENCH_OPS atomic additions
+ * (10000 by default), either all on one shared variable or each one on its own variable.
+ * 16-byte types are also measured at an address that is only 8-byte aligned, which forces
+ * the lock fallback, and _Complex long double always takes the lock, so both serve as
+ * baselines for the lock-free paths.
+ *
+ * Results (nanoseconds per update) are written as one JSON object, to stdout or appended to
+ * the file given in NX_BENCH_JSON. The final values are checked: any mismatch fails the test.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <complex.h>
+#include <nanos.h>
+#include <nanos_atomic.h>
+
+enum { T_CFLOAT, T_CDOUBLE, T_LDOUBLE, T_CLDOUBLE };
+
+#define SLOT_SIZE    128
+#define MAX_TASKS    1024
+#define MAX_RESULTS  16
+
+typedef struct {
+   int    type;
+   char  *addr;
+   int    ops;
+} update_args_t;
+
+typedef struct {
+   char    name[32];
+   double  ns_per_op;
+} bench_result_t;
+
+static char            slots[MAX_TASKS * SLOT_SIZE] __attribute__((aligned(SLOT_SIZE)));
+static bench_result_t  bench_results[MAX_RESULTS];
+static int             bench_num_results = 0;
+static int             bench_errors = 0;
+
+static inline uint64_t get_nsecs ( void )
+{
+   struct timespec tp;
+   clock_gettime( CLOCK_MONOTONIC, &tp );
+   return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+static void update_task ( void *args )
+{
+   update_args_t *uargs = (update_args_t *) args;
+   int i;
+
+   switch ( uargs->type ) {
+      case T_CFLOAT:
+         for ( i = 0; i < uargs->ops; i++ ) nanos_atomic_add_cfloat( (_Complex float *) uargs->addr, 1.0f + 2.0f * I );
+         break;
+      case T_CDOUBLE:
+         for ( i = 0; i < uargs->ops; i++ ) nanos_atomic_add_cdouble( (_Complex double *) uargs->addr, 1.0 + 2.0 * I );
+         break;
+      case T_LDOUBLE:
+         for ( i = 0; i < uargs->ops; i++ ) nanos_atomic_add_ldouble( (long double *) uargs->addr, 1.0L );
+         break;
+      case T_CLDOUBLE:
+         for ( i = 0; i < uargs->ops; i++ ) nanos_atomic_add_cldouble( (_Complex long double *) uargs->addr, 1.0L + 2.0L * I );
+         break;
+   }
+}
+
+static nanos_smp_args_t update_task_args = { (void (*)(void *)) update_task };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} update_task_def =
+{
+   { { .mandatory_creation = true, .tied = false }, __alignof__(update_args_t), 0, 1, 0, "atomic_update" },
+   { { nanos_smp_factory, &update_task_args } }
+};
+
+static void spawn ( update_args_t *args )
+{
+   nanos_wd_t wd = NULL;
+   void *data = NULL;
+   nanos_wd_dyn_props_t dyn_props = { 0 };
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &update_task_def.base, &dyn_props, sizeof(update_args_t), &data,
+                                        nanos_current_wd(), NULL, NULL ) );
+   memcpy( data, args, sizeof(update_args_t) );
+   NANOS_SAFE( nanos_submit( wd, 0, NULL, 0 ) );
+}
+
+static void clear ( int type, char *addr )
+{
+   switch ( type ) {
+      case T_CFLOAT: *(_Complex float *) addr = 0; break;
+      case T_CDOUBLE: *(_Complex double *) addr = 0; break;
+      case T_LDOUBLE: *(long double *) addr = 0; break;
+      case T_CLDOUBLE: *(_Complex long double *) addr = 0; break;
+   }
+}
+
+/*! Checks that addr holds n times the value added by update_task */
+static int check ( int type, char *addr, long n )
+{
+   switch ( type ) {
+      case T_CFLOAT: return *(_Complex float *) addr == n * ( 1.0f + 2.0f * I );
+      case T_CDOUBLE: return *(_Complex double *) addr == n * ( 1.0 + 2.0 * I );
+      case T_LDOUBLE: return *(long double *) addr == (long double) n;
+      case T_CLDOUBLE: return *(_Complex long double *) addr == n * ( 1.0L + 2.0L * I );
+   }
+   return 0;
+}
+
+/*! Runs ntasks tasks of ops updates each, on a shared variable or one per task */
+static void run_bench ( const char *name, int type, int shared, int offset, int ntasks, int ops )
+{
+   update_args_t args;
+   uint64_t t0, t1;
+   int i;
+
+   for ( i = 0; i < ntasks; i++ ) clear( type, slots + i * SLOT_SIZE + offset );
+
+   /* Queue all the tasks before letting the workers run them so they contend */
+   NANOS_SAFE( nanos_stop_scheduler() );
+   for ( i = 0; i < ntasks; i++ ) {
+      args.type = type;
+      args.addr = slots + ( shared ? 0 : i * SLOT_SIZE ) + offset;
+      args.ops = ops;
+      spawn( &args );
+   }
+   NANOS_SAFE( nanos_wait_until_threads_paused() );
+   t0 = get_nsecs();
+   NANOS_SAFE( nanos_start_scheduler() );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+   t1 = get_nsecs();
+   NANOS_SAFE( nanos_wait_until_threads_unpaused() );
+
+   if ( shared ) {
+      if ( !check( type, slots + offset, (long) ntasks * ops ) ) {
+         fprintf( stderr, "%s: wrong final value\n", name );
+         bench_errors++;
+      }
+   } else {
+      for ( i = 0; i < ntasks; i++ ) {
+         if ( !check( type, slots + i * SLOT_SIZE + offset, ops ) ) {
+            fprintf( stderr, "%s: wrong final value in task %d\n", name, i );
+            bench_errors++;
+            break;
+         }
+      }
+   }
+
+   snprintf( bench_results[bench_num_results].name, sizeof(bench_results[0].name), "%s", name );
+   bench_results[bench_num_results].ns_per_op = (double) ( t1 - t0 ) / ( (double) ntasks * ops );
+   bench_num_results++;
+}
+
+static void print_json ( FILE *out, int nthreads, int ntasks, int ops )
+{
+   int i;
+
+   fprintf( out, "{\"benchmark\": \"atomic_contention\", \"runtime_version\": \"%s\", \"threads\": %d, "
+                 "\"tasks\": %d, \"ops_per_task\": %d, \"unit\": \"ns/op\", \"results\": {",
+            nanos_get_runtime_version(), nthreads, ntasks, ops );
+   for ( i = 0; i < bench_num_results; i++ ) {
+      fprintf( out, "%s\"%s\": %.1f", i == 0 ? "" : ", ", bench_results[i].name, bench_results[i].ns_per_op );
+   }
+   fprintf( out, "}}\n" );
+}
+
+int main ( int argc, char *argv[] )
+{
+   const char *env;
+   const char *json_path = getenv( "NX_BENCH_JSON" );
+   FILE *out = stdout;
+   int nthreads = 1, ntasks, tasks_per_thread = 4, ops = 10000;
+
+   if ( ( env = getenv( "NX_BENCH_TASKS" ) ) != NULL && atoi( env ) > 0 ) tasks_per_thread = atoi( env );
+   if ( ( env = getenv( "NX_BENCH_OPS" ) ) != NULL && atoi( env ) > 0 ) ops = atoi( env );
+
+   NANOS_SAFE( nanos_team_get_num_threads( &nthreads ) );
+   ntasks = nthreads * tasks_per_thread;
+   if ( ntasks > MAX_TASKS ) ntasks = MAX_TASKS;
+
+   /* Warm-up run, not reported */
+   run_bench( "warmup", T_CFLOAT, 0, 0, ntasks, ops );
+   bench_num_results = 0;
+
+   run_bench( "cfloat_shared", T_CFLOAT, 1, 0, ntasks, ops );
+   run_bench( "cfloat_private", T_CFLOAT, 0, 0, ntasks, ops );
+   run_bench( "cdouble_shared", T_CDOUBLE, 1, 0, ntasks, ops );
+   run_bench( "cdouble_private", T_CDOUBLE, 0, 0, ntasks, ops );
+   run_bench( "cdouble_unaligned_shared", T_CDOUBLE, 1, 8, ntasks, ops );
+   run_bench( "cdouble_unaligned_private", T_CDOUBLE, 0, 8, ntasks, ops );
+   run_bench( "ldouble_shared", T_LDOUBLE, 1, 0, ntasks, ops );
+   run_bench( "ldouble_private", T_LDOUBLE, 0, 0, ntasks, ops );
+   run_bench( "cldouble_shared", T_CLDOUBLE, 1, 0, ntasks, ops );
+   run_bench( "cldouble_private", T_CLDOUBLE, 0, 0, ntasks, ops );
+
+   if ( json_path != NULL ) {
+      out = fopen( json_path, "a" );
+      if ( out == NULL ) {
+         fprintf( stderr, "Cannot open %s\n", json_path );
+         return 1;
+      }
+   }
+
+   print_json( out, nthreads, ntasks, ops );
+
+   if ( out != stdout ) fclose( out );
+
+   return bench_errors == 0 ? 0 : 1;
+}
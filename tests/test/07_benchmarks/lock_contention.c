@@ -0,0 +1,172 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_mode=performance
+test_generator='gens/api-generator -a --user-lock=spin|--user-lock=queue'
+</testinfo>
+*/
+
+/*
+ * User lock benchmark: throughput and hand-off latency of nanos_set_lock/nanos_unset_lock
+ * on a lock created by nanos_init_lock, whose implementation is selected with
+ * --user-lock=spin|queue. Sweep the thread count with --smp-workers (e.g. 1 to 128).
+ *
+ * NX_BENCH_TASKS tasks per thread (1 by default) each acquire the lock NX_BENCH_OPS times
+ * (20000 by default) around a short critical section.
+ *  - throughput: total run time divided by the number of acquisitions (ns/op)
+ *  - handoff: time from a release to the next acquisition by a different task (ns), and the
+ *    fraction of acquisitions that were such hand-overs (1.0 means strict alternation, values
+ *    close to 0 mean the same task keeps re-acquiring the lock)
+ *
+ * Results are written as one JSON object, to stdout or appended to the file given in
+ * NX_BENCH_JSON. The protected counter is checked: a lost update fails the test.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <nanos.h>
+
+typedef struct {
+   int id;
+   int ops;
+} lock_args_t;
+
+static nanos_lock_t       *lock;
+
+/* Protected by lock */
+static volatile long       counter = 0;
+static volatile int        last_owner = -1;
+static volatile uint64_t   last_release = 0;
+static uint64_t            handoff_ns = 0;
+static long                handoffs = 0;
+
+static inline uint64_t get_nsecs ( void )
+{
+   struct timespec tp;
+   clock_gettime( CLOCK_MONOTONIC, &tp );
+   return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+static void lock_task ( void *args )
+{
+   lock_args_t *largs = (lock_args_t *) args;
+   int i;
+
+   for ( i = 0; i < largs->ops; i++ ) {
+      NANOS_SAFE( nanos_set_lock( lock ) );
+      if ( last_owner != largs->id && last_owner != -1 ) {
+         handoff_ns += get_nsecs() - last_release;
+         handoffs++;
+      }
+      counter++;
+      last_owner = largs->id;
+      last_release = get_nsecs();
+      NANOS_SAFE( nanos_unset_lock( lock ) );
+   }
+}
+
+static nanos_smp_args_t lock_task_args = { (void (*)(void *)) lock_task };
+
+static struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} lock_task_def =
+{
+   { { .mandatory_creation = true, .tied = false }, __alignof__(lock_args_t), 0, 1, 0, "lock_bench" },
+   { { nanos_smp_factory, &lock_task_args } }
+};
+
+static void spawn ( lock_args_t *args )
+{
+   nanos_wd_t wd = NULL;
+   void *data = NULL;
+   nanos_wd_dyn_props_t dyn_props = { 0 };
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &lock_task_def.base, &dyn_props, sizeof(lock_args_t), &data,
+                                        nanos_current_wd(), NULL, NULL ) );
+   memcpy( data, args, sizeof(lock_args_t) );
+   NANOS_SAFE( nanos_submit( wd, 0, NULL, 0 ) );
+}
+
+int main ( int argc, char *argv[] )
+{
+   const char *env;
+   const char *json_path = getenv( "NX_BENCH_JSON" );
+   const char *nx_args = getenv( "NX_ARGS" );
+   FILE *out = stdout;
+   int nthreads = 1, ntasks, tasks_per_thread = 1, ops = 20000, i;
+   lock_args_t args;
+   uint64_t t0, t1;
+   long expected;
+
+   if ( ( env = getenv( "NX_BENCH_TASKS" ) ) != NULL && atoi( env ) > 0 ) tasks_per_thread = atoi( env );
+   if ( ( env = getenv( "NX_BENCH_OPS" ) ) != NULL && atoi( env ) > 0 ) ops = atoi( env );
+
+   NANOS_SAFE( nanos_team_get_num_threads( &nthreads ) );
+   ntasks = nthreads * tasks_per_thread;
+   expected = (long) ntasks * ops;
+
+   NANOS_SAFE( nanos_init_lock( &lock ) );
+
+   /* Queue all the tasks before letting the workers run them so they contend */
+   NANOS_SAFE( nanos_stop_scheduler() );
+   for ( i = 0; i < ntasks; i++ ) {
+      args.id = i;
+      args.ops = ops;
+      spawn( &args );
+   }
+   NANOS_SAFE( nanos_wait_until_threads_paused() );
+   t0 = get_nsecs();
+   NANOS_SAFE( nanos_start_scheduler() );
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+   t1 = get_nsecs();
+   NANOS_SAFE( nanos_wait_until_threads_unpaused() );
+
+   NANOS_SAFE( nanos_destroy_lock( lock ) );
+
+   if ( json_path != NULL ) {
+      out = fopen( json_path, "a" );
+      if ( out == NULL ) {
+         fprintf( stderr, "Cannot open %s\n", json_path );
+         return 1;
+      }
+   }
+
+   fprintf( out, "{\"benchmark\": \"lock_contention\", \"runtime_version\": \"%s\", \"nx_args\": \"%s\", "
+                 "\"threads\": %d, \"tasks\": %d, \"ops_per_task\": %d, \"results\": {"
+                 "\"throughput_ns_per_op\": %.1f, \"handoff_ns\": %.1f, \"handoff_fraction\": %.3f}}\n",
+            nanos_get_runtime_version(), nx_args != NULL ? nx_args : "", nthreads, ntasks, ops,
+            (double) ( t1 - t0 ) / expected,
+            handoffs > 0 ? (double) handoff_ns / handoffs : 0.0,
+            (double) handoffs / expected );
+
+   if ( out != stdout ) fclose( out );
+
+   if ( counter != expected ) {
+      fprintf( stderr, "Lost updates: counter is %ld, expected %ld\n", counter, expected );
+      return 1;
+   }
+
+   return 0;
+}
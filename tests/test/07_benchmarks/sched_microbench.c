@@ -0,0 +1,372 @@
+/*************************************************************************************/
+/*      Copyright 2015 Barcelona Supercomputing Center                               */
+/*                                                                                   */
+/*      This file is part of the NANOS++ library.                                    */
+/*                                                                                   */
+/*      NANOS++ is free software: you can redistribute it and/or modify              */
+/*      it under the terms of the GNU Lesser General Public License as published by  */
+/*      the Free Software Foundation, either version 3 of the License, or            */
+/*      (at your option) any later version.                                          */
+/*                                                                                   */
+/*      NANOS++ is distributed in the hope that it will be useful,                   */
+/*      but WITHOUT ANY WARRANTY; without even the implied warranty of               */
+/*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the                */
+/*      GNU Lesser General Public License for more details.                          */
+/*                                                                                   */
+/*      You should have received a copy of the GNU Lesser General Public License     */
+/*      along with NANOS++.  If not, see <http://www.gnu.org/licenses/>.             */
+/*************************************************************************************/
+
+/*
+<testinfo>
+test_mode=performance
+test_generator='gens/api-generator -a --schedule=bf|--schedule=wf|--schedule=dbf'
+test_deps_plugins=plain,regions,sharded
+test_LDFLAGS=-lm
+</testinfo>
+*/
+
+/*
+ * Scheduler microbenchmarks: task create+submit, empty task execution, steal latency,
+ * taskwait, dependency chain release and fan-out/fan-in release.
+ *
+ * Every benchmark takes NX_BENCH_SAMPLES samples (20 by default), each one the mean cost
+ * of NX_BENCH_OPS operations (200 by default, a tenth of that for steals), and reports
+ * nanoseconds per operation.
+ * Results are written as one JSON object per run, to stdout or appended to the file
+ * given in NX_BENCH_JSON, so several thread counts and plugins can be collected together.
+ *
+ * steal_latency is the time from submitting a task until another thread starts it while the
+ * submitter busy-waits (under work-first the submitter runs it itself and hands off its
+ * continuation instead). It needs at least two threads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <nanos.h>
+
+typedef struct {
+   const char *name;
+   int         valid;
+   int         ops;
+   double      mean;
+   double      sd;
+   double      min;
+   double      p50;
+   double      p90;
+   double      p99;
+   double      max;
+} bench_result_t;
+
+#define BENCH_MAX_RESULTS 8
+#define BENCH_STEAL_TIMEOUT 1000000000ULL /* ns */
+
+static int             bench_samples = 20;
+static int             bench_ops = 200;
+static bench_result_t  bench_results[BENCH_MAX_RESULTS];
+static int             bench_num_results = 0;
+
+static inline uint64_t get_nsecs ( void )
+{
+   struct timespec tp;
+   clock_gettime( CLOCK_MONOTONIC, &tp );
+   return (uint64_t) tp.tv_sec * 1000000000ULL + tp.tv_nsec;
+}
+
+/* ******************************* TASKS ******************************* */
+
+typedef struct {
+   nanos_const_wd_definition_t base;
+   nanos_device_t devices[1];
+} bench_const_wd_t;
+
+static void empty_task ( void *args ) { }
+
+typedef struct {
+   volatile uint64_t *start;
+   volatile int      *done;
+} steal_args_t;
+
+static void steal_task ( void *args )
+{
+   steal_args_t *sargs = (steal_args_t *) args;
+   *sargs->start = get_nsecs();
+   __sync_synchronize();
+   *sargs->done = 1;
+}
+
+static nanos_smp_args_t empty_task_args = { (void (*)(void *)) empty_task };
+static nanos_smp_args_t steal_task_args = { (void (*)(void *)) steal_task };
+
+static bench_const_wd_t empty_task_def =
+{
+   { { .mandatory_creation = true, .tied = false }, 1, 0, 1, 0, "bench_empty" },
+   { { nanos_smp_factory, &empty_task_args } }
+};
+
+static bench_const_wd_t steal_task_def =
+{
+   { { .mandatory_creation = true, .tied = false }, __alignof__(steal_args_t), 0, 1, 0, "bench_steal" },
+   { { nanos_smp_factory, &steal_task_args } }
+};
+
+static nanos_region_dimension_t int_dims[1] = { { sizeof(int), 0, sizeof(int) } };
+
+static void set_access ( nanos_data_access_t *access, int *addr, bool input, bool output )
+{
+   memset( access, 0, sizeof(nanos_data_access_t) );
+   access->address = addr;
+   access->flags.input = input;
+   access->flags.output = output;
+   access->dimension_count = 1;
+   access->dimensions = int_dims;
+}
+
+static void spawn ( bench_const_wd_t *def, void *args, size_t args_size, size_t num_deps, nanos_data_access_t *deps )
+{
+   nanos_wd_t wd = NULL;
+   void *data = NULL;
+   nanos_wd_dyn_props_t dyn_props = { 0 };
+
+   NANOS_SAFE( nanos_create_wd_compact( &wd, &def->base, &dyn_props, args_size, args_size ? &data : NULL,
+                                        nanos_current_wd(), NULL, NULL ) );
+   if ( args_size ) memcpy( data, args, args_size );
+   NANOS_SAFE( nanos_submit( wd, num_deps, deps, 0 ) );
+}
+
+static void taskwait ( void )
+{
+   NANOS_SAFE( nanos_wg_wait_completion( nanos_current_wd(), false ) );
+}
+
+/*! Keeps the workers from running anything until released with start_and_wait() */
+static void hold_workers ( void )
+{
+   NANOS_SAFE( nanos_stop_scheduler() );
+}
+
+/*! Releases the workers and returns how long the queued work took to drain */
+static uint64_t start_and_wait ( void )
+{
+   uint64_t t0, t1;
+
+   NANOS_SAFE( nanos_wait_until_threads_paused() );
+   t0 = get_nsecs();
+   NANOS_SAFE( nanos_start_scheduler() );
+   taskwait();
+   t1 = get_nsecs();
+   NANOS_SAFE( nanos_wait_until_threads_unpaused() );
+
+   return t1 - t0;
+}
+
+/* ***************************** BENCHMARKS **************************** */
+
+/* Each benchmark runs 'n' operations and returns the mean cost in nanoseconds */
+
+static double bench_create_submit ( int n )
+{
+   int i;
+   uint64_t t0 = get_nsecs();
+   for ( i = 0; i < n; i++ ) spawn( &empty_task_def, NULL, 0, 0, NULL );
+   uint64_t t1 = get_nsecs();
+   taskwait();
+   return (double) ( t1 - t0 ) / n;
+}
+
+static double bench_execute ( int n )
+{
+   int i;
+   hold_workers();
+   for ( i = 0; i < n; i++ ) spawn( &empty_task_def, NULL, 0, 0, NULL );
+   return (double) start_and_wait() / n;
+}
+
+static double bench_steal ( int n )
+{
+   int i;
+   uint64_t total = 0;
+
+   for ( i = 0; i < n; i++ ) {
+      volatile uint64_t start = 0;
+      volatile int done = 0;
+      steal_args_t args = { &start, &done };
+
+      uint64_t t0 = get_nsecs();
+      /* A task not stolen within the timeout accounts for the whole timeout */
+      start = t0 + BENCH_STEAL_TIMEOUT;
+      spawn( &steal_task_def, &args, sizeof(args), 0, NULL );
+
+      /* Do not enter the scheduler: the task must be taken by another thread */
+      while ( !done && get_nsecs() - t0 < BENCH_STEAL_TIMEOUT ) ;
+      uint64_t stolen = done ? start : t0 + BENCH_STEAL_TIMEOUT;
+      taskwait();
+
+      total += stolen - t0;
+   }
+   return (double) total / n;
+}
+
+static double bench_taskwait ( int n )
+{
+   int i;
+   uint64_t t0 = get_nsecs();
+   for ( i = 0; i < n; i++ ) taskwait();
+   return (double) ( get_nsecs() - t0 ) / n;
+}
+
+static double bench_chain ( int n )
+{
+   int i, dep = 0;
+   nanos_data_access_t access;
+
+   set_access( &access, &dep, true, true );
+
+   hold_workers();
+   for ( i = 0; i < n; i++ ) spawn( &empty_task_def, NULL, 0, 1, &access );
+   return (double) start_and_wait() / n;
+}
+
+static double bench_fan ( int n )
+{
+   int i, root = 0;
+   int *leaves = (int *) calloc( n, sizeof(int) );
+   nanos_data_access_t *accesses = (nanos_data_access_t *) malloc( n * sizeof(nanos_data_access_t) );
+   nanos_data_access_t pair[2];
+   uint64_t time;
+
+   hold_workers();
+
+   /* Fan-out: one writer releases n readers... */
+   set_access( &pair[0], &root, false, true );
+   spawn( &empty_task_def, NULL, 0, 1, pair );
+   for ( i = 0; i < n; i++ ) {
+      set_access( &pair[0], &root, true, false );
+      set_access( &pair[1], &leaves[i], false, true );
+      spawn( &empty_task_def, NULL, 0, 2, pair );
+   }
+
+   /* ...fan-in: that are all waited for by a single task */
+   for ( i = 0; i < n; i++ ) set_access( &accesses[i], &leaves[i], true, false );
+   spawn( &empty_task_def, NULL, 0, n, accesses );
+
+   time = start_and_wait();
+
+   free( accesses );
+   free( leaves );
+
+   return (double) time / ( n + 2 );
+}
+
+/* ****************************** DRIVER ******************************* */
+
+static int cmp_double ( const void *a, const void *b )
+{
+   double x = *(const double *) a, y = *(const double *) b;
+   return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static double percentile ( const double *sorted, int n, double p )
+{
+   int idx = (int) ( p / 100.0 * n + 0.999999 ) - 1;
+   if ( idx < 0 ) idx = 0;
+   if ( idx >= n ) idx = n - 1;
+   return sorted[idx];
+}
+
+static void run_bench ( const char *name, double (*bench) ( int ), int ops, int enabled )
+{
+   bench_result_t *r = &bench_results[bench_num_results++];
+   double *values;
+   double sum = 0.0, sumsq = 0.0;
+   int i;
+
+   r->name = name;
+   r->valid = enabled;
+   r->ops = ops;
+   if ( !enabled ) return;
+
+   values = (double *) malloc( bench_samples * sizeof(double) );
+
+   /* Warm-up: fills allocator caches, spawns the worker stacks, etc. */
+   bench( ops );
+
+   for ( i = 0; i < bench_samples; i++ ) {
+      values[i] = bench( ops );
+      sum += values[i];
+   }
+   r->mean = sum / bench_samples;
+   for ( i = 0; i < bench_samples; i++ ) sumsq += ( values[i] - r->mean ) * ( values[i] - r->mean );
+   r->sd = bench_samples > 1 ? sqrt( sumsq / ( bench_samples - 1 ) ) : 0.0;
+
+   qsort( values, bench_samples, sizeof(double), cmp_double );
+   r->min = values[0];
+   r->p50 = percentile( values, bench_samples, 50.0 );
+   r->p90 = percentile( values, bench_samples, 90.0 );
+   r->p99 = percentile( values, bench_samples, 99.0 );
+   r->max = values[bench_samples - 1];
+
+   free( values );
+}
+
+static void print_json ( FILE *out, int nthreads )
+{
+   bool binding = false;
+   int i, first = 1;
+
+   nanos_get_default_binding( &binding );
+
+   fprintf( out, "{\"benchmark\": \"sched_microbench\", \"runtime_version\": \"%s\", \"threads\": %d, "
+                 "\"schedule\": \"%s\", \"deps\": \"%s\", \"binding\": %s, \"samples\": %d, "
+                 "\"unit\": \"ns/op\", \"results\": {",
+            nanos_get_runtime_version(), nthreads, nanos_get_default_scheduler(),
+            nanos_get_default_dependencies_manager(), binding ? "true" : "false", bench_samples );
+
+   for ( i = 0; i < bench_num_results; i++ ) {
+      bench_result_t *r = &bench_results[i];
+      if ( !r->valid ) continue;
+      fprintf( out, "%s\"%s\": {\"ops_per_sample\": %d, \"mean\": %.1f, \"sd\": %.1f, \"min\": %.1f, \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}",
+               first ? "" : ", ", r->name, r->ops, r->mean, r->sd, r->min, r->p50, r->p90, r->p99, r->max );
+      first = 0;
+   }
+   fprintf( out, "}}\n" );
+}
+
+int main ( int argc, char *argv[] )
+{
+   const char *env;
+   const char *json_path = getenv( "NX_BENCH_JSON" );
+   FILE *out = stdout;
+   int nthreads = 1;
+
+   if ( ( env = getenv( "NX_BENCH_SAMPLES" ) ) != NULL && atoi( env ) > 0 ) bench_samples = atoi( env );
+   if ( ( env = getenv( "NX_BENCH_OPS" ) ) != NULL && atoi( env ) > 0 ) bench_ops = atoi( env );
+
+   NANOS_SAFE( nanos_team_get_num_threads( &nthreads ) );
+
+   /* Steals are full round trips between two threads, use fewer of them per sample */
+   run_bench( "task_create_submit", bench_create_submit, bench_ops, 1 );
+   run_bench( "task_execute", bench_execute, bench_ops, 1 );
+   run_bench( "steal_latency", bench_steal, ( bench_ops + 9 ) / 10, nthreads > 1 );
+   run_bench( "taskwait", bench_taskwait, bench_ops, 1 );
+   run_bench( "dep_chain_release", bench_chain, bench_ops, 1 );
+   run_bench( "dep_fan_release", bench_fan, bench_ops, 1 );
+
+   if ( json_path != NULL ) {
+      out = fopen( json_path, "a" );
+      if ( out == NULL ) {
+         fprintf( stderr, "Cannot open %s\n", json_path );
+         return 1;
+      }
+   }
+
+   print_json( out, nthreads );
+
+   if ( out != stdout ) fclose( out );
+
+   return 0;
+}